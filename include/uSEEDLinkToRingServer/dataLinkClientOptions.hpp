@@ -2,6 +2,10 @@
 #define USEED_LINK_TO_RING_SERVER_DATA_LINK_CLIENT_OPTIONS_HPP
 #include <memory>
 #include <future>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
 namespace USEEDLinkToRingServer
 {
 /// @class DataLinkClientOptions "dataLinkClientOptions.hpp"
@@ -52,6 +56,41 @@ public:
     /// @note By default this is localhost.
     [[nodiscard]] std::string getHost() const;
 
+    /// @brief Sets the ordered list of failover RingServers.  Should the
+    ///        primary RingServer (host/port) become unavailable the client
+    ///        will move to the next server in this list, and so on.  While
+    ///        on a failover server the client periodically probes the
+    ///        servers ahead of it and fails back once one is healthy.
+    ///        Queued and held data are preserved across these switches.
+    /// @param[in] endpoints  The host and port of each failover server in
+    ///                       order of preference.
+    /// @throws std::invalid_argument if any host is empty or too long.
+    void setFailoverEndpoints(
+        const std::vector<std::pair<std::string, uint16_t>> &endpoints);
+    /// @result The failover servers in order of preference.
+    /// @note By default there are none.
+    [[nodiscard]] std::vector<std::pair<std::string, uint16_t>>
+        getFailoverEndpoints() const;
+    /// @result The primary server followed by the failover servers.
+    [[nodiscard]] std::vector<std::pair<std::string, uint16_t>>
+        getEndpoints() const;
+
+    /// @brief Sets the time after which a connection attempt or write that
+    ///        has made no progress is considered failed.
+    /// @param[in] timeOut  The I/O time out.
+    /// @throws std::invalid_argument if this is not positive.
+    void setIOTimeOut(const std::chrono::milliseconds &timeOut);
+    /// @result The I/O time out.  By default this is 60 seconds.
+    [[nodiscard]] std::chrono::milliseconds getIOTimeOut() const noexcept;
+
+    /// @brief While writing to a failover server this is how often the
+    ///        more preferred servers are probed.
+    /// @param[in] interval  The probe interval.
+    /// @throws std::invalid_argument if this is not positive.
+    void setFailbackProbeInterval(const std::chrono::milliseconds &interval);
+    /// @result The failback probe interval.  By default this is 30 seconds.
+    [[nodiscard]] std::chrono::milliseconds getFailbackProbeInterval() const noexcept;
+
     /// @brief Sets the client identifier.
     //void setIdentifier(const std::string &identifier);
     /// @result The client identiifer.
@@ -78,10 +117,37 @@ public:
 
     /// @brief Specifies the size in bytes of the MiniSEED records.
     /// @param[in] recordSize  The MiniSEED record size to write.
-    /// @throws std::invalid_argument if not positive or exceeds 512.
+    /// @throws std::invalid_argument if not positive or exceeds the largest
+    ///         DataLink packet (MAXPACKETSIZE).
+    /// @note The record size is further limited to the packet size the
+    ///       RingServer advertises when we connect.
     void setMiniSEEDRecordSize(int recordSize);
     /// @result The MiniSEED record size in bytes.  By default this is 512.
     [[nodiscard]] int getMiniSEEDRecordSize() const noexcept;
+    /// @brief Overrides the MiniSEED record size for the streams matching
+    ///        the pattern.  This is useful for high-rate streams for which
+    ///        larger records greatly reduce the packet rate.
+    /// @param[in] streamPattern  The pattern of the form
+    ///                           NETWORK.STATION.CHANNEL[.LOCATION] where
+    ///                           each field may use the shell wildcards
+    ///                           * and ? - e.g., *.*.HN?.* or UU.*.DAS.
+    ///                           An omitted location code matches any
+    ///                           location code.
+    /// @param[in] recordSize     The MiniSEED record size for these streams.
+    /// @throws std::invalid_argument if the pattern is malformed or the
+    ///         record size is invalid.
+    /// @note Patterns are checked in the order they were added and the first
+    ///       match wins.
+    void addMiniSEEDRecordSize(const std::string &streamPattern,
+                               int recordSize);
+    /// @result The stream patterns and their record sizes.
+    [[nodiscard]] std::vector<std::pair<std::string, int>>
+        getMiniSEEDRecordSizes() const;
+    /// @param[in] streamIdentifier  The stream identifier of the form
+    ///                              NETWORK.STATION.CHANNEL[.LOCATION].
+    /// @result The MiniSEED record size for the stream.
+    [[nodiscard]] int getMiniSEEDRecordSize(
+        const std::string &streamIdentifier) const;
 
     /// @brief This will enable writing MSEED3 packets.
     void enableWriteMiniSEED3() noexcept;
@@ -99,17 +165,112 @@ public:
     /// @brief Enables the flushing of packets.  This will result in
     ///        packets always being written.
     void enablePacketFlushing() noexcept;
-    /// @brief Disables packet flushing.  If a time series does not
-    ///        completely fill a packet (see miniSEEDRecordSize) then
-    ///        the remaining data may not be packed.
-    /// @note It is strongly recommended to not disable packet flushing.
+    /// @brief Disables packet flushing.
+    /// @note Since records are packed in a single pass the final, partially
+    ///       filled record of a packet is always written so as to not drop
+    ///       samples.  To write full records enable packet aggregation.
     void disablePacketFlushing() noexcept;
     /// @result True means packets will be flushed prior to writing (i.e.,
     ///         the smallest possible miniSEED packets will be written to
     ///         the ringserver).
     /// @note True is the default.
     [[nodiscard]] bool flushPackets() const noexcept;
-    
+
+    /// @brief Enables per-stream packet aggregation.  Rather than writing
+    ///        each SEEDLink packet to its own (typically mostly empty)
+    ///        miniSEED record, contiguous samples are accumulated until
+    ///        a record is full or the aggregation latency is exceeded.
+    void enablePacketAggregation() noexcept;
+    /// @brief Disables packet aggregation.  Each packet will be written
+    ///        as soon as it is dequeued.
+    void disablePacketAggregation() noexcept;
+    /// @result True indicates packets will be aggregated prior to writing.
+    /// @note False is the default.
+    [[nodiscard]] bool aggregatePackets() const noexcept;
+
+    /// @brief When aggregating packets this is the maximum amount of time
+    ///        a sample can be held before its record is flushed.
+    /// @param[in] latency  The maximum aggregation latency.
+    /// @throws std::invalid_argument if this is not positive.
+    void setAggregationLatency(const std::chrono::milliseconds &latency);
+    /// @result The maximum aggregation latency.  By default this is 1 second.
+    [[nodiscard]] std::chrono::milliseconds getAggregationLatency() const noexcept;
+
+    /// @brief When the connection to the RingServer is lost the client will
+    ///        attempt to reconnect indefinitely.  After each failed attempt
+    ///        the delay until the next attempt is doubled, starting at the
+    ///        initial delay and capped at the maximum delay.
+    /// @param[in] initialDelay  The delay after the first failed attempt.
+    /// @param[in] maximumDelay  The largest delay between attempts.
+    /// @throws std::invalid_argument if initialDelay is negative or
+    ///         maximumDelay is less than initialDelay.
+    void setReconnectDelays(const std::chrono::milliseconds &initialDelay,
+                            const std::chrono::milliseconds &maximumDelay);
+    /// @result The delay after the first failed reconnect attempt.
+    /// @note By default this is 1 second.
+    [[nodiscard]] std::chrono::milliseconds getInitialReconnectDelay() const noexcept;
+    /// @result The maximum delay between reconnect attempts.
+    /// @note By default this is 60 seconds.
+    [[nodiscard]] std::chrono::milliseconds getMaximumReconnectDelay() const noexcept;
+
+    /// @brief To prevent many clients from reconnecting in lockstep each
+    ///        reconnect delay is randomly perturbed by up to this fraction.
+    /// @param[in] jitter  The jitter fraction.
+    /// @throws std::invalid_argument if jitter is not in the range [0,1].
+    void setReconnectJitter(double jitter);
+    /// @result The reconnect jitter fraction.  By default this is 0.2.
+    [[nodiscard]] double getReconnectJitter() const noexcept;
+
+    /// @brief While disconnected the internal queue continues to be drained
+    ///        into a holdover buffer of miniSEED records which is written
+    ///        upon reconnecting.  This sets the maximum number of records
+    ///        in that buffer.  After this point, the oldest records are
+    ///        discarded.
+    /// @param[in] maximumHoldoverSize  The maximum number of records.
+    /// @throws std::invalid_argument if this is not positive.
+    void setMaximumHoldoverSize(int maximumHoldoverSize);
+    /// @result The maximum number of records in the holdover buffer.
+    /// @note By default this is 65536.
+    [[nodiscard]] int getMaximumHoldoverSize() const noexcept;
+
+    /// @brief Limits the rate at which miniSEED records are sent to the
+    ///        RingServer.  This prevents the replay that follows an upstream
+    ///        reconnect from flooding the RingServer.
+    /// @param[in] packetsPerSecond  The maximum number of records per second.
+    ///                              If this is 0 then the record rate is not
+    ///                              limited.
+    /// @throws std::invalid_argument if this is negative.
+    void setMaximumPacketsPerSecond(double packetsPerSecond);
+    /// @result The maximum number of records sent per second.
+    /// @note By default this is 0, i.e., unlimited.
+    [[nodiscard]] double getMaximumPacketsPerSecond() const noexcept;
+    /// @brief Limits the rate at which miniSEED bytes are sent to the
+    ///        RingServer.
+    /// @param[in] bytesPerSecond  The maximum number of bytes per second.
+    ///                            If this is 0 then the byte rate is not
+    ///                            limited.
+    /// @throws std::invalid_argument if this is negative.
+    void setMaximumBytesPerSecond(double bytesPerSecond);
+    /// @result The maximum number of bytes sent per second.
+    /// @note By default this is 0, i.e., unlimited.
+    [[nodiscard]] double getMaximumBytesPerSecond() const noexcept;
+    /// @brief After an idle period the writer may send this much time's
+    ///        worth of data at full speed before the rate limits apply.
+    /// @param[in] burstAllowance  The burst allowance.
+    /// @throws std::invalid_argument if this is not positive.
+    void setBurstAllowance(const std::chrono::milliseconds &burstAllowance);
+    /// @result The burst allowance.  By default this is 1 second.
+    [[nodiscard]] std::chrono::milliseconds getBurstAllowance() const noexcept;
+    /// @brief While rate limited, records whose data ends within this
+    ///        duration of now are considered real-time and are sent ahead
+    ///        of older, backfilled records.
+    /// @param[in] threshold  The real-time threshold.  If this is 0 then
+    ///                       records are always sent in the order received.
+    /// @throws std::invalid_argument if this is negative.
+    void setRealTimeThreshold(const std::chrono::milliseconds &threshold);
+    /// @result The real-time threshold.
+    /// @note By default this is 0, i.e., nothing is prioritized.
+    [[nodiscard]] std::chrono::milliseconds getRealTimeThreshold() const noexcept;
     /// @}
 
     /// @name Destructors
@@ -0,0 +1,59 @@
+#ifndef USEED_LINK_TO_RING_SERVER_DATA_LINK_ENGINE_HPP
+#define USEED_LINK_TO_RING_SERVER_DATA_LINK_ENGINE_HPP
+#include <memory>
+#include <future>
+#include <vector>
+#include <spdlog/spdlog.h>
+namespace USEEDLinkToRingServer
+{
+ class Packet;
+ class DataLinkClientOptions;
+}
+
+namespace USEEDLinkToRingServer
+{
+/// @class DataLinkEngine
+/// @brief Writes MiniSEED data to any number of RingServers from a single
+///        thread.  Rather than dedicating a blocking libdali client and a
+///        thread to each server, every connection is a non-blocking socket
+///        driven by one epoll event loop.  Sends, reconnects, and time-outs
+///        are all handled as events so the number of writers is no longer
+///        tied to the number of threads.
+/// @note Each connection is configured by its own DataLinkClientOptions and
+///       receives every enqueued packet.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+class DataLinkEngine
+{
+public:
+    /// @brief Constructor.
+    /// @param[in] options  The options for each connection.
+    /// @param[in] logger   The logger.
+    /// @throws std::invalid_argument if options is empty.
+    /// @throws std::runtime_error if the event loop cannot be created.
+    DataLinkEngine(const std::vector<DataLinkClientOptions> &options,
+                   std::shared_ptr<spdlog::logger> logger);
+
+    /// @brief Starts the event loop thread.
+    [[nodiscard]] std::future<void> start();
+    /// @brief Enqueues a packet to write to every connection.
+    void enqueue(Packet &&packet);
+    /// @brief Enqueues a packet to write to every connection.
+    void enqueue(const Packet &packet);
+    /// @result The number of DataLink connections served by the event loop.
+    [[nodiscard]] int getNumberOfConnections() const noexcept;
+    /// @brief Stops the event loop thread.
+    void stop();
+    /// @brief Destructor.
+    ~DataLinkEngine();
+
+    DataLinkEngine(const DataLinkEngine &) = delete;
+    DataLinkEngine(DataLinkEngine &&) noexcept = delete;
+    DataLinkEngine& operator=(const DataLinkEngine &) = delete;
+    DataLinkEngine& operator=(DataLinkEngine &&) noexcept = delete;
+private:
+    class DataLinkEngineImpl;
+    std::unique_ptr<DataLinkEngineImpl> pImpl;
+};
+}
+#endif
@@ -0,0 +1,111 @@
+#ifndef USEED_LINK_TO_RING_SERVER_MINISEED_RECORD_AGGREGATOR_HPP
+#define USEED_LINK_TO_RING_SERVER_MINISEED_RECORD_AGGREGATOR_HPP
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <string>
+#include "uSEEDLinkToRingServer/packet.hpp"
+namespace USEEDLinkToRingServer
+{
+/// @class MiniSEEDRecordAggregator "miniSEEDRecordAggregator.hpp"
+/// @brief Upstream packets are frequently much smaller than a miniSEED
+///        record.  Rather than flushing every packet to its own, mostly
+///        empty, record this class accumulates contiguous samples on a
+///        per-stream basis and only emits a record when it is full or
+///        when the oldest buffered sample has waited longer than the
+///        maximum latency.
+/// @note This class is not thread safe.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+class MiniSEEDRecordAggregator
+{
+public:
+    /// @brief Constructor.
+    /// @param[in] recordLength    The miniSEED record length in bytes.
+    /// @param[in] useMiniSEED3    True indicates miniSEED3 records will be
+    ///                            created; otherwise, miniSEED2.
+    /// @param[in] compression     The compression to apply to integer data.
+    /// @param[in] maximumLatency  The maximum amount of time a sample can be
+    ///                            held before its record is flushed.
+    /// @throws std::invalid_argument if recordLength or maximumLatency is not
+    ///         positive.
+    MiniSEEDRecordAggregator(int recordLength,
+                             bool useMiniSEED3,
+                             Compression compression,
+                             const std::chrono::microseconds &maximumLatency);
+    /// @brief Constructor for when the record length varies by stream.
+    /// @param[in] getRecordLength  Given a stream identifier of the form
+    ///                             NETWORK.STATION.CHANNEL[.LOCATION] this
+    ///                             returns the stream's record length in
+    ///                             bytes.  It is consulted each time a
+    ///                             stream begins a new run of records.
+    /// @param[in] useMiniSEED3     True indicates miniSEED3 records will be
+    ///                             created; otherwise, miniSEED2.
+    /// @param[in] compression      The compression to apply to integer data.
+    /// @param[in] maximumLatency   The maximum amount of time a sample can be
+    ///                             held before its record is flushed.
+    /// @throws std::invalid_argument if getRecordLength is not callable or
+    ///         maximumLatency is not positive.
+    MiniSEEDRecordAggregator(
+        const std::function<int (const std::string &)> &getRecordLength,
+        bool useMiniSEED3,
+        Compression compression,
+        const std::chrono::microseconds &maximumLatency);
+
+    /// @brief Adds the packet's samples to the stream's in-progress record.
+    /// @param[in] packet  The packet to add.
+    /// @param[in] now     The current time in microseconds since the epoch.
+    /// @result Any records that were filled by adding this packet.  Note, if
+    ///         the packet is not contiguous with the buffered samples then
+    ///         the buffered samples are flushed prior to adding the packet.
+    /// @throws std::invalid_argument if the packet lacks an identifier,
+    ///         sampling rate, or data.
+    [[nodiscard]] std::vector<DataLinkPacket>
+        add(const Packet &packet, const std::chrono::microseconds &now);
+    /// @brief Adds the packet's samples to the stream's in-progress record.
+    ///        Any filled records are appended to records.
+    /// @throws std::invalid_argument if records is NULL.
+    void add(const Packet &packet,
+             const std::chrono::microseconds &now,
+             std::vector<DataLinkPacket> *records);
+    /// @brief Flushes the streams whose oldest buffered sample has been
+    ///        held for at least the maximum latency.  Only those streams
+    ///        are visited.  Streams that have not buffered anything for
+    ///        several minutes are also forgotten.
+    /// @param[in] now  The current time in microseconds since the epoch.
+    /// @result The flushed records.
+    [[nodiscard]] std::vector<DataLinkPacket>
+        flushExpired(const std::chrono::microseconds &now);
+    /// @brief Flushes the expired streams appending the records to records.
+    /// @throws std::invalid_argument if records is NULL.
+    void flushExpired(const std::chrono::microseconds &now,
+                      std::vector<DataLinkPacket> *records);
+    /// @brief Flushes all buffered samples.
+    /// @result The flushed records.
+    [[nodiscard]] std::vector<DataLinkPacket> flush();
+    /// @brief Flushes all buffered samples appending the records to records.
+    /// @throws std::invalid_argument if records is NULL.
+    void flush(std::vector<DataLinkPacket> *records);
+
+    /// @result The number of streams being aggregated.
+    [[nodiscard]] int getNumberOfStreams() const noexcept;
+    /// @result The total number of samples awaiting packing.
+    [[nodiscard]] int64_t getNumberOfBufferedSamples() const noexcept;
+    /// @result The maximum latency.
+    [[nodiscard]] std::chrono::microseconds getMaximumLatency() const noexcept;
+
+    /// @brief Destructor.
+    ~MiniSEEDRecordAggregator();
+
+    MiniSEEDRecordAggregator() = delete;
+    MiniSEEDRecordAggregator(const MiniSEEDRecordAggregator &) = delete;
+    MiniSEEDRecordAggregator(MiniSEEDRecordAggregator &&) noexcept = delete;
+    MiniSEEDRecordAggregator& operator=(const MiniSEEDRecordAggregator &) = delete;
+    MiniSEEDRecordAggregator& operator=(MiniSEEDRecordAggregator &&) noexcept = delete;
+private:
+    class MiniSEEDRecordAggregatorImpl;
+    std::unique_ptr<MiniSEEDRecordAggregatorImpl> pImpl;
+};
+}
+#endif
@@ -2,10 +2,16 @@
 #define USEED_LINK_TO_RING_SERVER_PACKET_HPP
 #include <vector>
 #include <chrono>
+#include <cstdint>
 #include <memory>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <spdlog/spdlog.h>
 #include <libmseed.h>
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
+#include "uSEEDLinkToRingServer/pipelineTimestamps.hpp"
 namespace USEEDLinkToRingServer
 {
   class StreamIdentifier;
@@ -14,9 +20,11 @@ namespace USEEDLinkToRingServer
 {
  struct DataLinkPacket
  {
-     std::string data;
+     RecordBuffer data; // The miniSEED record
+     std::shared_ptr<const std::string> streamIdentifier; // The DataLink stream identifier
      std::chrono::microseconds startTime{0};
      std::chrono::microseconds endTime{0};
+     PipelineTimestamps timestamps{}; // When the samples passed each stage
  };
 }
 namespace USEEDLinkToRingServer
@@ -124,6 +132,20 @@ public:
     /// @throws std::runtime_error if \c hasSamplingRate() is false or
     ///         \c getNumberOfSamples() is 0.
     [[nodiscard]] std::chrono::nanoseconds getEndTime() const;
+    /// @brief Stamps the time the packet was handed to a queue.  This is
+    ///        used to measure how long packets wait between stages.
+    void setEnqueueTime(
+        const std::chrono::steady_clock::time_point &enqueueTime) noexcept;
+    /// @result The time the packet was last handed to a queue.
+    [[nodiscard]] std::chrono::steady_clock::time_point
+        getEnqueueTime() const noexcept;
+    /// @brief Sets the times at which the packet passed through each stage
+    ///        of the pipeline.
+    void setPipelineTimestamps(const PipelineTimestamps &timestamps) noexcept;
+    /// @result The times at which the packet passed through each stage of
+    ///         the pipeline.
+    [[nodiscard]] const PipelineTimestamps &
+        getPipelineTimestampsReference() const noexcept;
     /// @}
 
     /// @name Data
@@ -157,6 +179,22 @@ public:
     /// @result A pointer to the underlying data packet.  This is an array whose
     ///         dimensions is [\c getNumberOfSamples()] 
     [[nodiscard]] const void *getDataPointer() const noexcept;
+    /// @result A view of the samples.  This does not copy the data and is
+    ///         valid until the packet's data is changed.  If there are no
+    ///         samples then the view is empty.
+    /// @throws std::invalid_argument if T does not match \c getDataType().
+    template<typename T>
+    [[nodiscard]] std::span<const T> getDataSpan() const;
+    /// @brief Calls the visitor with a view of the samples in their native
+    ///        type - i.e., std::span<const int>, std::span<const float>,
+    ///        std::span<const double>, or std::span<const char>.  This
+    ///        dispatches on the data type once so the visitor can process
+    ///        the samples without copies or further type checks.
+    /// @param[in] visitor  The callable invoked with the samples.
+    /// @result The visitor's result.
+    /// @throws std::runtime_error if the data type is unknown.
+    template<typename F>
+    decltype(auto) visit(F &&visitor) const;
     /// @result The number of data samples in the packet.
     [[nodiscard]] int getNumberOfSamples() const noexcept;
     /// @}
@@ -188,9 +226,44 @@ private:
     class PacketImpl;
     std::unique_ptr<PacketImpl> pImpl;
 };
+
+template<typename F>
+decltype(auto) Packet::visit(F &&visitor) const
+{
+    switch (getDataType())
+    {
+        case DataType::Integer32:
+            return std::forward<F> (visitor)(getDataSpan<int> ());
+        case DataType::Float:
+            return std::forward<F> (visitor)(getDataSpan<float> ());
+        case DataType::Double:
+            return std::forward<F> (visitor)(getDataSpan<double> ());
+        case DataType::Text:
+            return std::forward<F> (visitor)(getDataSpan<char> ());
+        default:
+            break;
+    }
+    throw std::runtime_error("Cannot visit data of unknown type");
+}
+
 [[nodiscard]] double computeSumOfSamples(const Packet &packet);
 [[nodiscard]] double computeSumOfSamplesSquared(const Packet &packet);
 
+/// @brief Summary statistics of a packet's samples.
+struct SampleStatistics
+{
+    int64_t count{0}; // The number of samples
+    int64_t integerSum{0}; // The exact sum for integer data
+    double sum{0}; // The sum of the samples
+    double sumOfSquares{0}; // The sum of the squared samples
+    double minimum{0}; // The smallest sample
+    double maximum{0}; // The largest sample
+};
+/// @result The count, sum, sum of squares, minimum, and maximum of the
+///         packet's samples computed in a single vectorized pass.
+/// @throws std::runtime_error if the packet holds text data.
+[[nodiscard]] SampleStatistics computeSampleStatistics(const Packet &packet);
+
 enum class Compression
 {
     None,
@@ -198,14 +271,33 @@ enum class Compression
     STEIM2
 };
 
-/// @result Converts the packet to MiniSEED records to string buffers.
+/// @result Converts the packet to MiniSEED records.
+/// @note The records' buffers are taken from pool.  If pool is NULL then
+///       the calling thread's pool is used.
 [[nodiscard]] std::vector<DataLinkPacket>
      toDataLinkPackets(const Packet &packet,
                        int maxRecordLength,
                        bool useMiniSEED3,
                        Compression compression,
                        bool flushPackets,
-                       std::shared_ptr<spdlog::logger> &logger);
+                       std::shared_ptr<spdlog::logger> &logger,
+                       RecordBufferPool *pool = nullptr);
+/// @brief Converts the packet to MiniSEED records.  This variant lets the
+///        caller reuse the output vector and a cached stream identifier so
+///        that, in the steady state, no memory is allocated.
+/// @param[in] dataLinkIdentifier  The packet's DataLink stream identifier.
+/// @param[in,out] pool            The pool from which record buffers are
+///                                taken.
+/// @param[in,out] records         The records are appended to this vector.
+void toDataLinkPackets(const Packet &packet,
+                       int maxRecordLength,
+                       bool useMiniSEED3,
+                       Compression compression,
+                       bool flushPackets,
+                       std::shared_ptr<spdlog::logger> &logger,
+                       const std::shared_ptr<const std::string> &dataLinkIdentifier,
+                       RecordBufferPool &pool,
+                       std::vector<DataLinkPacket> *records);
 
 }
 #endif
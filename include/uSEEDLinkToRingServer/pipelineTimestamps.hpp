@@ -0,0 +1,26 @@
+#ifndef USEED_LINK_TO_RING_SERVER_PIPELINE_TIMESTAMPS_HPP
+#define USEED_LINK_TO_RING_SERVER_PIPELINE_TIMESTAMPS_HPP
+#include <chrono>
+namespace USEEDLinkToRingServer
+{
+/// @struct PipelineTimestamps "pipelineTimestamps.hpp"
+/// @brief The monotonic times at which a packet passed through each stage
+///        of the pipeline.  A default-constructed time indicates the packet
+///        has not (yet) reached that stage.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+struct PipelineTimestamps
+{
+    /// When the SEEDLink packet was returned by the socket.
+    std::chrono::steady_clock::time_point received{};
+    /// When the miniSEED was unpacked.
+    std::chrono::steady_clock::time_point decoded{};
+    /// When the packet was taken off the import queue.
+    std::chrono::steady_clock::time_point dequeued{};
+    /// When the DataLink record was packed.
+    std::chrono::steady_clock::time_point encoded{};
+    /// When the record was handed to the DataLink server.
+    std::chrono::steady_clock::time_point written{};
+};
+}
+#endif
@@ -0,0 +1,106 @@
+#ifndef USEED_LINK_TO_RING_SERVER_RECORD_BUFFER_HPP
+#define USEED_LINK_TO_RING_SERVER_RECORD_BUFFER_HPP
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+namespace USEEDLinkToRingServer
+{
+class RecordBufferArena;
+/// @class RecordBuffer "recordBuffer.hpp"
+/// @brief A move-only handle to the bytes of a single miniSEED record.
+///        The bytes live in a fixed-size slab taken from a RecordBufferPool
+///        and the slab is returned to that pool when the handle is
+///        destroyed.  Records that do not fit in a slab are given their
+///        own allocation.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+class RecordBuffer
+{
+public:
+    /// @brief Constructor.
+    RecordBuffer() = default;
+    /// @brief Move constructor.
+    RecordBuffer(RecordBuffer &&buffer) noexcept;
+    /// @brief Move assignment.
+    RecordBuffer& operator=(RecordBuffer &&buffer) noexcept;
+
+    /// @result A pointer to the record.
+    [[nodiscard]] char *data() noexcept{return mData;}
+    /// @result A pointer to the record.
+    [[nodiscard]] const char *data() const noexcept{return mData;}
+    /// @result The record length in bytes.
+    [[nodiscard]] size_t size() const noexcept{return mSize;}
+    /// @result True indicates the buffer is empty.
+    [[nodiscard]] bool empty() const noexcept{return mSize == 0;}
+    /// @result The number of bytes the buffer can hold.
+    [[nodiscard]] size_t capacity() const noexcept{return mCapacity;}
+
+    /// @brief Returns the slab to its pool (or releases its memory).
+    void clear() noexcept;
+    /// @brief Destructor.
+    ~RecordBuffer();
+
+    RecordBuffer(const RecordBuffer &) = delete;
+    RecordBuffer& operator=(const RecordBuffer &) = delete;
+private:
+    friend class RecordBufferPool;
+    std::shared_ptr<RecordBufferArena> mArena{nullptr};
+    std::unique_ptr<char[]> mOwned{nullptr};
+    char *mData{nullptr};
+    uint32_t mSlab{0};
+    size_t mSize{0};
+    size_t mCapacity{0};
+};
+
+/// @class RecordBufferPool "recordBuffer.hpp"
+/// @brief A pool of fixed-size slabs from which record buffers are made.
+///        Slabs are carved from large, preallocated chunks and recycled
+///        through a lock-free free list so that, in the steady state,
+///        creating a record does not touch the heap.
+/// @note Buffers may be created and destroyed from any thread.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+class RecordBufferPool
+{
+public:
+    /// @brief Constructor.
+    /// @param[in] slabSize       The size of each slab in bytes.
+    /// @param[in] slabsPerChunk  The number of slabs to allocate each time
+    ///                           the pool is exhausted.
+    /// @throws std::invalid_argument if slabSize is not positive or
+    ///         slabsPerChunk is less than 2.
+    explicit RecordBufferPool(int slabSize = 512, int slabsPerChunk = 64);
+
+    /// @brief Creates a record buffer holding a copy of the given bytes.
+    /// @param[in] record        The record.
+    /// @param[in] recordLength  The length of the record in bytes.
+    /// @result The record buffer.
+    /// @throws std::invalid_argument if record is NULL or recordLength is
+    ///         negative.
+    /// @throws std::runtime_error if the pool cannot grow any further.
+    [[nodiscard]] RecordBuffer create(const char *record, int recordLength);
+
+    /// @result The slab size in bytes.
+    [[nodiscard]] int getSlabSize() const noexcept;
+    /// @result The total number of slabs allocated by the pool.
+    [[nodiscard]] int getNumberOfSlabs() const noexcept;
+    /// @result The number of slabs not currently in use.
+    [[nodiscard]] int getNumberOfAvailableSlabs() const noexcept;
+
+    /// @result A pool owned by the calling thread with 512 byte slabs.
+    [[nodiscard]] static RecordBufferPool &getThreadLocalInstance();
+
+    /// @brief Destructor.  Slabs still held by buffers remain valid until
+    ///        those buffers are destroyed.
+    ~RecordBufferPool();
+
+    RecordBufferPool(const RecordBufferPool &) = delete;
+    RecordBufferPool(RecordBufferPool &&) noexcept = delete;
+    RecordBufferPool& operator=(const RecordBufferPool &) = delete;
+    RecordBufferPool& operator=(RecordBufferPool &&) noexcept = delete;
+private:
+    std::shared_ptr<RecordBufferArena> mArena{nullptr};
+};
+
+}
+#endif
@@ -1,23 +1,39 @@
 #ifndef USEED_LINK_TO_RING_SERVER_STREAM_IDENTIFIER_HPP
 #define USEED_LINK_TO_RING_SERVER_STREAM_IDENTIFIER_HPP
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <string_view>
 #include <string>
-#include <memory>
 namespace USEEDLinkToRingServer
 {
+/// @brief A SEED stream identifier.  The codes are held in fixed-size
+///        storage so the class is trivially copyable and never allocates.
+///        The dotted name and its hash are computed when a code is set.
 class StreamIdentifier
 {
 public:
+    /// @brief The longest network, station, or location code.
+    static constexpr int MaximumCodeLength{8};
+    /// @brief The longest channel code.  FDSN source identifiers spell
+    ///        channels as band, source, and subsource codes - e.g., B_S_SS -
+    ///        and limit the whole identifier, FDSN:NET_STA_LOC_B_S_SS, to
+    ///        64 characters.
+    static constexpr int MaximumChannelLength{32};
+    /// @brief The longest dotted name - e.g., NET.STA.CHA.LOC.
+    static constexpr int MaximumStringLength{3*MaximumCodeLength
+                                           + MaximumChannelLength + 3};
+
     /// @brief Constructor.
-    StreamIdentifier();
+    StreamIdentifier() = default;
     /// @brief Copy constructor.
     /// @param[in] identifier  The stream identifier from which to initialize
     ///                        this class.
-    StreamIdentifier(const StreamIdentifier &identifier);
+    StreamIdentifier(const StreamIdentifier &identifier) = default;
     /// @brief Move constructor.
     /// @param[in] identifier  The stream identifier from which to initialize
-    ///                        this class.  On exit, identifier is undefined.
-    StreamIdentifier(StreamIdentifier &&identifier) noexcept;
+    ///                        this class.
+    StreamIdentifier(StreamIdentifier &&identifier) noexcept = default;
     /// @brief Constructs from a network, station, and channel name.
     /// @param[in] network  The network code - e.g, UU.
     /// @param[in] station  The station name - e.g., CTU.
@@ -30,7 +46,8 @@ public:
 
     /// @brief Sets the network code.
     /// @param[in] network  The network code.
-    /// @throws std::invalid_argument if network is empty.
+    /// @throws std::invalid_argument if network is empty or longer than
+    ///         \c MaximumCodeLength.
     void setNetwork(const std::string_view &network);
     /// @result The network code.
     /// @throws std::runtime_error if \c hasNetwork() is false.
@@ -40,7 +57,8 @@ public:
 
     /// @brief Sets the station name.
     /// @param[in] station   The station name.
-    /// @throws std::invalid_argument if station is empty.
+    /// @throws std::invalid_argument if station is empty or longer than
+    ///         \c MaximumCodeLength.
     void setStation(const std::string_view &station);
     /// @result The station name.
     /// @throws std::runtime_error if \c hasStation() is false.
@@ -50,7 +68,8 @@ public:
 
     /// @brief Sets the channel name.
     /// @param[in] channel  The channel name.
-    /// @throws std::invalid_argument if channel is empty.
+    /// @throws std::invalid_argument if channel is empty or longer than
+    ///         \c MaximumChannelLength.
     void setChannel(const std::string_view &channel);
     /// @result The channel name.
     /// @throws std::runtime_error if the channel was not set.
@@ -60,7 +79,8 @@ public:
 
     /// @brief Sets the location code.
     /// @param[in] locationCode  The location code.
-    /// @throws std::invalid_argument if location is empty.
+    /// @throws std::invalid_argument if location is longer than
+    ///         \c MaximumCodeLength.
     void setLocationCode(const std::string_view &locationCode);
     /// @brief Sets the location code.
     /// @throws std::runtime_error if \c hasLocationCode() is false.
@@ -72,9 +92,13 @@ public:
     /// @throws std::runtime_error if the network, station, channel, or location
     ///         code is not set.
     [[nodiscard]] std::string toString() const;
-    /// @result A reference to the underlying string.  This exists for
+    /// @result A view of the underlying string.  This exists for
     ///         performance sensitive applications.
-    [[nodiscard]] const std::string &getStringReference() const;
+    /// @throws std::runtime_error if the network, station, channel, or location
+    ///         code is not set.
+    [[nodiscard]] std::string_view getStringReference() const;
+    /// @result The hash of the string representation.
+    [[nodiscard]] size_t getHash() const noexcept;
 
     /// @name Destructors
     /// @{
@@ -82,25 +106,47 @@ public:
     /// @brief Resets the class.
     void clear() noexcept;
     /// @brief Destructor.
-    ~StreamIdentifier();
+    ~StreamIdentifier() = default;
     /// @}
 
     /// @name Operators
     /// @{
 
     /// @brief Copy assignment.
-    /// @result A deep copy of the stream identifier.
-    StreamIdentifier &operator=(const StreamIdentifier &identifier);
+    /// @result A copy of the stream identifier.
+    StreamIdentifier &operator=(const StreamIdentifier &identifier) = default;
     /// @brief Move assignment.
     /// @result The identifier moved to this.
-    StreamIdentifier &operator=(StreamIdentifier &&identifier) noexcept;
+    StreamIdentifier &operator=(StreamIdentifier &&identifier) noexcept
+        = default;
     /// @}
 private:
-    class StreamIdentifierImpl;
-    std::unique_ptr<StreamIdentifierImpl> pImpl;
+    void update() noexcept;
+    std::array<char, MaximumCodeLength> mNetwork{};
+    std::array<char, MaximumCodeLength> mStation{};
+    std::array<char, MaximumChannelLength> mChannel{};
+    std::array<char, MaximumCodeLength> mLocationCode{};
+    std::array<char, MaximumStringLength + 1> mString{};
+    size_t mHash{0};
+    uint8_t mNetworkLength{0};
+    uint8_t mStationLength{0};
+    uint8_t mChannelLength{0};
+    uint8_t mLocationCodeLength{0};
+    uint8_t mStringLength{0};
+    bool mHasLocationCode{false};
 };
 [[nodiscard]] std::string toDataLinkIdentifier(const StreamIdentifier &identifier);
 bool operator<(const StreamIdentifier &, const StreamIdentifier &);
 bool operator==(const StreamIdentifier &, const StreamIdentifier &);
 }
+
+template<>
+struct std::hash<USEEDLinkToRingServer::StreamIdentifier>
+{
+    size_t operator()(const USEEDLinkToRingServer::StreamIdentifier &identifier)
+        const noexcept
+    {
+        return identifier.getHash();
+    }
+};
 #endif
@@ -1,18 +1,86 @@
 #ifndef USEEDLINK_TO_RINGSERVER_WRITER_METRICS_HPP
 #define USEEDLINK_TO_RINGSERVER_WRITER_METRICS_HPP
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <chrono>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
+#include "uSEEDLinkToRingServer/pipelineTimestamps.hpp"
 
 namespace USEEDLinkToRingServer
 {
 
-class WriterMetricsSingleton
+/// @class DurationHistogram "writerMetricsSingleton.hpp"
+/// @brief A fixed-bucket histogram of durations.  Recording is a pair of
+///        relaxed atomic increments so any thread can record while the
+///        exporter reads.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+class DurationHistogram
 {
 public:
-    [[maybe_unused]] static WriterMetricsSingleton &getInstance();
-    
+    /// The upper bounds of the buckets in microseconds.  Anything slower
+    /// lands in the overflow bucket.
+    static constexpr std::array<int64_t, 19> mBucketBounds
+    {
+            10,      25,      50,
+           100,     250,     500,     1000,
+          2500,    5000,   10000,    25000,
+         50000,  100000,  250000,   500000,
+       1000000, 2500000, 5000000, 10000000
+    };
+    /// @brief Tallies a duration.
+    void record(const std::chrono::microseconds &duration) noexcept;
+    /// @result The cumulative number of durations in each bucket, i.e., the
+    ///         i'th entry counts the durations that were no more than the
+    ///         i'th bucket bound.  The final entry counts every duration.
+    [[nodiscard]] std::array<int64_t, mBucketBounds.size() + 1>
+        getCumulativeCounts() const noexcept;
+    /// @result The sum of all durations.
+    [[nodiscard]] std::chrono::microseconds getSum() const noexcept;
+private:
+    std::array<std::atomic<int64_t>, mBucketBounds.size() + 1> mCounts{};
+    std::atomic<int64_t> mSum{0}; // Microseconds
+};
+
+/// @brief The stages of the pipeline whose durations are tallied.
+enum class PipelineStage
+{
+    Decode, /*!< From receipt on the SEEDLink socket to unpacked. */
+    Import, /*!< From unpacked to taken off the import queue. */
+    Export, /*!< From the import queue to packed as a DataLink record. */
+    Write,  /*!< From packed to handed to the DataLink server. */
+    Total   /*!< From receipt on the SEEDLink socket to handed to the
+                 DataLink server. */
+};
+
+/// @class WriterMetrics "writerMetricsSingleton.hpp"
+/// @brief The metrics for a single DataLink writer.  Each counter lives on
+///        its own cache line since the writer thread updates them while the
+///        exporter reads them.
+/// @copyright Ben Baker (University of Utah) distributed under the
+///            MIT NO AI license.
+class WriterMetrics
+{
+public:
+    /// The upper bounds of the write latency histogram buckets in
+    /// microseconds.  Anything slower lands in the overflow bucket.
+    static constexpr auto mWriteLatencyBucketBounds
+        = DurationHistogram::mBucketBounds;
+
+    /// @brief Constructor.
+    /// @param[in] name  The writer's name.
+    /// @param[in] host  The address of the DataLink server.
+    WriterMetrics(const std::string &name, const std::string &host);
+
+    /// @result The writer's name.
+    [[nodiscard]] const std::string &getName() const noexcept;
+    /// @result The address of the DataLink server.
+    [[nodiscard]] const std::string &getHost() const noexcept;
+
     void incrementPacketsWrittenCounter();
 
     [[nodiscard]] int64_t getPacketsWrittenCount() const noexcept;
@@ -25,17 +93,159 @@ public:
 
     [[nodiscard]] int64_t getFailedPacketsSentCount() const noexcept;
 
+    /// @brief Tallies an ERROR response from the DataLink server.  The
+    ///        record was already counted as written when it was sent.
+    void incrementServerErrorsCounter();
+
+    [[nodiscard]] int64_t getServerErrorsCount() const noexcept;
+
     void incrementFailedPacketsFailedToEnqueueCounter();
 
     [[nodiscard]] int64_t getFailedPacketsFailedToEnqueueCount() const noexcept;
 
+    void incrementReconnectAttemptsCounter();
+
+    [[nodiscard]] int64_t getReconnectAttemptsCount() const noexcept;
+
+    /// @brief Marks the start of an outage.
+    void beginOutage();
+    /// @brief Marks the end of an outage that lasted the given duration.
+    void endOutage(const std::chrono::microseconds &duration);
+
+    /// @result True indicates the writer is disconnected.
+    [[nodiscard]] bool isDisconnected() const noexcept;
+    /// @result The cumulative duration of all completed outages.
+    [[nodiscard]] std::chrono::microseconds getOutageDuration() const noexcept;
+
+    /// @brief Adds (or, if negative, subtracts) records to the holdover size.
+    void addToHoldoverSize(int64_t nRecords);
+
+    [[nodiscard]] int64_t getHoldoverSize() const noexcept;
+
+    void incrementHoldoverRecordsDroppedCounter(int64_t nRecords = 1);
+
+    [[nodiscard]] int64_t getHoldoverRecordsDroppedCount() const noexcept;
+
+    /// @brief Sets the capacity of the writer's queue.
+    void setQueueCapacity(int64_t capacity);
+    /// @brief Sets the number of items in the writer's queue.
+    void setQueueDepth(int64_t depth);
+
+    [[nodiscard]] int64_t getQueueCapacity() const noexcept;
+
+    [[nodiscard]] int64_t getQueueDepth() const noexcept;
+    /// @result The fraction of the queue that is in use.
+    [[nodiscard]] double getQueueOccupancy() const noexcept;
+
+    /// @brief Tallies the time it took to write a record.
+    void recordWriteLatency(const std::chrono::microseconds &latency);
+    /// @result The cumulative number of writes in each bucket, i.e., the
+    ///         i'th entry counts the writes that took no more than the i'th
+    ///         bucket bound.  The final entry counts every write.
+    [[nodiscard]] std::array<int64_t, mWriteLatencyBucketBounds.size() + 1>
+        getCumulativeWriteLatencyCounts() const noexcept;
+    /// @result The sum of all write latencies.
+    [[nodiscard]] std::chrono::microseconds getWriteLatencySum() const noexcept;
+    /// @result The histogram of the time taken to write records.
+    [[nodiscard]] const DurationHistogram &
+        getWriteLatencyHistogram() const noexcept;
+
+    /// @brief Tallies the time a packet waited in the writer's queue, i.e.,
+    ///        from when it was enqueued to when the writer dequeued it.
+    void recordQueueResidency(const std::chrono::microseconds &residency);
+    /// @result The histogram of the time packets waited in the queue.
+    [[nodiscard]] const DurationHistogram &
+        getQueueResidencyHistogram() const noexcept;
+
+    /// @brief Tallies the time a record spent in each stage of the
+    ///        pipeline.  A stage is skipped unless the times at which the
+    ///        record entered and left it are both set.
+    void recordPipelineTimestamps(const PipelineTimestamps &timestamps);
+    /// @result The histogram of the time records spent in the given stage.
+    [[nodiscard]] const DurationHistogram &
+        getPipelineStageHistogram(PipelineStage stage) const noexcept;
+
+    WriterMetrics(const WriterMetrics &) = delete;
+    WriterMetrics(WriterMetrics &&) noexcept = delete;
+    WriterMetrics& operator=(const WriterMetrics &) = delete;
+    WriterMetrics& operator=(WriterMetrics &&) noexcept = delete;
+private:
+    std::string mName;
+    std::string mHost;
+    alignas(64) std::atomic<int64_t> mPacketsWrittenCounter{0};
+    alignas(64) std::atomic<int64_t> mInvalidPacketsCounter{0};
+    alignas(64) std::atomic<int64_t> mFailedPacketsSentCounter{0};
+    alignas(64) std::atomic<int64_t> mServerErrorsCounter{0};
+    alignas(64) std::atomic<int64_t> mPacketsFailedToEnqueueCounter{0};
+    alignas(64) std::atomic<int64_t> mReconnectAttemptsCounter{0};
+    alignas(64) std::atomic<int64_t> mDisconnected{0};
+    alignas(64) std::atomic<int64_t> mOutageDuration{0}; // Microseconds
+    alignas(64) std::atomic<int64_t> mHoldoverSize{0};
+    alignas(64) std::atomic<int64_t> mHoldoverRecordsDroppedCounter{0};
+    alignas(64) std::atomic<int64_t> mQueueCapacity{0};
+    alignas(64) std::atomic<int64_t> mQueueDepth{0};
+    alignas(64) DurationHistogram mWriteLatency;
+    alignas(64) DurationHistogram mQueueResidency;
+    alignas(64) std::array<DurationHistogram, 5> mPipelineStages;
+};
+
+/// @class WriterMetricsSingleton "writerMetricsSingleton.hpp"
+/// @brief The registry of every writer's metrics.  The totals are the sums
+///        over all registered writers.
+class WriterMetricsSingleton
+{
+public:
+    [[maybe_unused]] static WriterMetricsSingleton &getInstance();
+
+    /// @brief Creates and registers the metrics for a writer.
+    /// @param[in] name  The writer's name.
+    /// @param[in] host  The address of the DataLink server.
+    /// @result The writer's metrics.
+    [[nodiscard]] std::shared_ptr<WriterMetrics>
+        createWriterMetrics(const std::string &name, const std::string &host);
+    /// @result The metrics of every registered writer.
+    [[nodiscard]] std::vector<std::shared_ptr<const WriterMetrics>>
+        getWriterMetrics() const;
+    /// @brief Calls f(metrics) for every registered writer.  Unlike
+    ///        getWriterMetrics() this does not copy the registry.
+    /// @note f must not register writers.
+    template<typename F>
+    void forEachWriterMetrics(F &&f) const
+    {
+        const std::scoped_lock lock{mMutex};
+        for (const auto &writerMetrics : mWriterMetrics)
+        {
+            f(static_cast<const WriterMetrics &> (*writerMetrics));
+        }
+    }
+
+    [[nodiscard]] int64_t getPacketsWrittenCount() const noexcept;
+
+    [[nodiscard]] int64_t getInvalidPacketsCount() const noexcept;
+
+    [[nodiscard]] int64_t getFailedPacketsSentCount() const noexcept;
+
+    [[nodiscard]] int64_t getServerErrorsCount() const noexcept;
+
+    [[nodiscard]] int64_t getFailedPacketsFailedToEnqueueCount() const noexcept;
+
+    [[nodiscard]] int64_t getReconnectAttemptsCount() const noexcept;
+
+    /// @result The number of writers currently disconnected.
+    [[nodiscard]] int64_t getNumberOfDisconnectedWriters() const noexcept;
+    /// @result The cumulative duration of all completed outages.
+    [[nodiscard]] std::chrono::microseconds getOutageDuration() const noexcept;
+
+    [[nodiscard]] int64_t getHoldoverSize() const noexcept;
+
+    [[nodiscard]] int64_t getHoldoverRecordsDroppedCount() const noexcept;
+
 private:
     WriterMetricsSingleton() = default;
     ~WriterMetricsSingleton() = default;
-    std::atomic<int64_t> mPacketsWrittenCounter{0};
-    std::atomic<int64_t> mInvalidPacketsCounter{0};
-    std::atomic<int64_t> mFailedPacketsSentCounter{0};
-    std::atomic<int64_t> mPacketsFailedToEnqueueCounter{0};
+    template<typename F> [[nodiscard]] int64_t sum(F &&getValue) const noexcept;
+    mutable std::mutex mMutex;
+    std::vector<std::shared_ptr<WriterMetrics>> mWriterMetrics;
 };
 
 void initializeWriterMetricsSingleton();
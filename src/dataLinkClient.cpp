@@ -1,12 +1,19 @@
 #include <iostream>
 #include <string>
 #include <array>
+#include <algorithm>
+#include <map>
+#include <deque>
+#include <random>
+#include <vector>
 #include <mutex>
 #include <chrono>
 #include <condition_variable>
-#ifndef NDEBUG
-#include <cassert>
-#endif
+#include <cstring>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #ifdef USE_TBB
 #include <oneapi/tbb/concurrent_queue.h>
 #else
@@ -18,10 +25,15 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include "uSEEDLinkToRingServer/dataLinkClient.hpp"
 #include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
+#include "uSEEDLinkToRingServer/miniSEEDRecordAggregator.hpp"
 #include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
 #include "uSEEDLinkToRingServer/streamIdentifier.hpp"
 #include "uSEEDLinkToRingServer/writerMetricsSingleton.hpp"
 #include "getNow.hpp"
+#include "logSuppressor.hpp"
+#include "rateLimiter.hpp"
+#include "recordLengths.hpp"
 
 using namespace USEEDLinkToRingServer;
 
@@ -44,6 +56,58 @@ void dataLinkDiagnosticsToSPDLOG(const char *message)
         SPDLOG_LOGGER_WARN(mGlobalLogger, "DataLink message: {}", message);
     }   
 }
+
+/// A resolved address of a preferred endpoint
+struct ProbeAddress
+{
+    sockaddr_storage address{};
+    socklen_t length{0};
+    int family{AF_UNSPEC};
+    int socketType{SOCK_STREAM};
+    int protocol{0};
+    size_t endpointIndex{0};
+};
+
+/// Resolves every address of the first nEndpoints endpoints, in order of
+/// preference, so the failback probes need not block on name resolution.
+[[nodiscard]] std::vector<ProbeAddress>
+    resolveEndpoints(const std::vector<std::pair<std::string, uint16_t>> &endpoints,
+                     const size_t nEndpoints)
+{
+    std::vector<ProbeAddress> result;
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    for (size_t i = 0; i < std::min(nEndpoints, endpoints.size()); ++i)
+    {
+        const auto &[host, port] = endpoints[i];
+        addrinfo *addresses{nullptr};
+        auto portString = std::to_string(port);
+        if (::getaddrinfo(host.c_str(), portString.c_str(),
+                          &hints, &addresses) != 0)
+        {
+            if (addresses){::freeaddrinfo(addresses);}
+            continue;
+        }
+        for (auto address = addresses;
+             address != nullptr;
+             address = address->ai_next)
+        {
+            if (address->ai_addrlen > sizeof(sockaddr_storage)){continue;}
+            ProbeAddress probeAddress;
+            std::memcpy(&probeAddress.address, address->ai_addr,
+                        address->ai_addrlen);
+            probeAddress.length = address->ai_addrlen;
+            probeAddress.family = address->ai_family;
+            probeAddress.socketType = address->ai_socktype;
+            probeAddress.protocol = address->ai_protocol;
+            probeAddress.endpointIndex = i;
+            result.push_back(probeAddress);
+        }
+        ::freeaddrinfo(addresses);
+    }
+    return result;
+}
 }
 
 class DataLinkClient::DataLinkClientImpl
@@ -63,8 +127,33 @@ public:
         mGlobalLogger = mLogger;
         mWriteMiniSEED3 = mOptions.writeMiniSEED3();
         mFlushPackets = mOptions.flushPackets();
-        mMaxMiniSEEDRecordSize = mOptions.getMiniSEEDRecordSize();
         mMaximumInternalQueueSize = mOptions.getMaximumInternalQueueSize();
+        mMaximumHoldoverSize = mOptions.getMaximumHoldoverSize();
+        mEndpoints = mOptions.getEndpoints();
+        // libdali's time out is in whole seconds
+        mTimeOut = std::max(std::chrono::seconds {1},
+                            std::chrono::ceil<std::chrono::seconds>
+                                (mOptions.getIOTimeOut()));
+        mMetrics = WriterMetricsSingleton::getInstance().createWriterMetrics(
+                       mOptions.getName(),
+                       mOptions.getHost() + ":"
+                     + std::to_string(mOptions.getPort()));
+        mMetrics->setQueueCapacity(mMaximumInternalQueueSize);
+        mRateLimiter = ::RateLimiter {mOptions};
+        mRealTimeThreshold = mOptions.getRealTimeThreshold();
+        if (mOptions.aggregatePackets())
+        {
+            mAggregator
+                = std::make_unique<MiniSEEDRecordAggregator>
+                  ([this](const std::string &streamIdentifier)
+                   {
+                       return mRecordLengths.getRecordLength(streamIdentifier);
+                   },
+                   mWriteMiniSEED3,
+                   mCompression,
+                   std::chrono::duration_cast<std::chrono::microseconds>
+                       (mOptions.getAggregationLatency()));
+        }
 #ifdef USE_TBB
         mQueue.set_capacity(mMaximumInternalQueueSize);
 #else
@@ -72,20 +161,22 @@ public:
             = std::make_unique<moodycamel::ConcurrentQueue<Packet>>
               (mMaximumInternalQueueSize);
 #endif
-        connect();
+        // N.B. The writer thread makes the first connection attempt so an
+        // unreachable server is handled like any other outage
     }
     /// Destructor
     ~DataLinkClientImpl()
     {
         stop();
+        closeProbe();
         destroyDataLinkClient();
         mGlobalLogger = nullptr;
     }
-    /// Creates the client
+    /// Creates the client for the current endpoint
     void createClient()
     {   
-        mAddress = mOptions.getHost() + ":" 
-                 + std::to_string(mOptions.getPort());
+        const auto &[host, port] = mEndpoints.at(mEndpointIndex);
+        mAddress = host + ":" + std::to_string(port);
         auto addressCopy = mAddress;
         auto clientNameCopy = mOptions.getName();
         mDataLinkClient = dl_newdlcp(addressCopy.data(),
@@ -98,11 +189,13 @@ public:
                      logPrint, nullptr, diagPrint, nullptr);
 
     }
-    /// Connect
+    /// Connect to the current endpoint
     void connect()
     {
-        if (!mDataLinkClient){createClient();}
-        disconnect();
+        // The address is baked into the client so start fresh in case
+        // we've moved to another server
+        destroyDataLinkClient();
+        createClient();
         SPDLOG_LOGGER_INFO(mLogger, "Connecting to DataLink server at {}",
                             mAddress);
         if (dl_connect(mDataLinkClient) < 0)
@@ -116,6 +209,160 @@ public:
                                    + mClientName + " at " + mAddress);
         }
         SPDLOG_LOGGER_DEBUG(mLogger, "Connected to DataLink server!");
+        // Records can't exceed what this server will accept
+        if (mRecordLengths.setServerPacketSize(mDataLinkClient->maxpktsize) &&
+            mOptions.getMiniSEEDRecordSize() >
+               mRecordLengths.getServerPacketSize())
+        {
+            SPDLOG_LOGGER_INFO(mLogger,
+                "DataLink server at {} accepts {} byte packets; records will be limited to this size",
+                mAddress, mRecordLengths.getServerPacketSize());
+        }
+    }
+    /// Moves to the next endpoint.
+    /// @result True indicates we've wrapped back around to the primary.
+    bool advanceEndpoint() noexcept
+    {
+        mEndpointIndex = (mEndpointIndex + 1)%mEndpoints.size();
+        return mEndpointIndex == 0;
+    }
+    /// While on a failover server periodically check whether a more
+    /// preferred server is healthy and, if so, move back to it.  The
+    /// queue and held records are untouched.  This is called on every pass
+    /// of the writer loop so the probe connects without blocking and its
+    /// result is collected on a later pass.
+    void probeForFailback(const std::chrono::microseconds &now)
+    {
+        if (mEndpointIndex == 0)
+        {
+            closeProbe();
+            return;
+        }
+        if (mProbeFD < 0)
+        {
+            if (now < mNextFailbackProbe){return;}
+            mProbeAddressIndex = 0;
+            startProbe(now);
+            return;
+        }
+        pollfd pollFD{mProbeFD, POLLOUT, 0};
+        auto returnCode = ::poll(&pollFD, 1, 0);
+        if (returnCode == 0)
+        {
+            if (now > mProbeDeadline)
+            {
+                closeProbe();
+                mProbeAddressIndex = mProbeAddressIndex + 1;
+                startProbe(now);
+            }
+            return;
+        }
+        int error{0};
+        socklen_t length{sizeof(error)};
+        if (returnCode < 0 ||
+            ::getsockopt(mProbeFD, SOL_SOCKET, SO_ERROR, &error, &length) < 0)
+        {
+            error = errno;
+        }
+        closeProbe();
+        if (error == 0)
+        {
+            failBack(mProbeAddresses[mProbeAddressIndex].endpointIndex, now);
+            return;
+        }
+        mProbeAddressIndex = mProbeAddressIndex + 1;
+        startProbe(now);
+    }
+    /// Begins a non-blocking connection to the next preferred address.
+    /// If every address has been tried then the next probe is scheduled.
+    void startProbe(const std::chrono::microseconds &now)
+    {
+        for (; mProbeAddressIndex < mProbeAddresses.size(); ++mProbeAddressIndex)
+        {
+            const auto &probeAddress = mProbeAddresses[mProbeAddressIndex];
+            if (probeAddress.endpointIndex >= mEndpointIndex){break;}
+            auto fd = ::socket(probeAddress.family,
+                               probeAddress.socketType
+                             | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                               probeAddress.protocol);
+            if (fd < 0){continue;}
+            auto returnCode
+                = ::connect(fd,
+                            reinterpret_cast<const sockaddr *>
+                                (&probeAddress.address),
+                            probeAddress.length);
+            if (returnCode == 0)
+            {
+                ::close(fd);
+                failBack(probeAddress.endpointIndex, now);
+                return;
+            }
+            if (errno == EINPROGRESS)
+            {
+                constexpr std::chrono::milliseconds maximumProbeTimeOut{1000};
+                mProbeFD = fd;
+                mProbeDeadline = now + std::min(maximumProbeTimeOut,
+                                                mOptions.getIOTimeOut());
+                return;
+            }
+            ::close(fd);
+        }
+        // Nothing better is available - try again later
+        mNextFailbackProbe = now + mOptions.getFailbackProbeInterval();
+    }
+    /// Closes the failback probe
+    void closeProbe()
+    {
+        if (mProbeFD >= 0)
+        {
+            ::close(mProbeFD);
+            mProbeFD =-1;
+        }
+    }
+    /// Resolves the endpoints ahead of the current one then schedules the
+    /// first failback probe
+    void scheduleFailbackProbe(const std::chrono::microseconds &now)
+    {
+        closeProbe();
+        mProbeAddresses = ::resolveEndpoints(mEndpoints, mEndpointIndex);
+        mProbeAddressIndex = 0;
+        mNextFailbackProbe = now + mOptions.getFailbackProbeInterval();
+    }
+    /// Moves back to the given, more preferred endpoint
+    void failBack(const size_t endpointIndex,
+                  const std::chrono::microseconds &now)
+    {
+        const auto &[host, port] = mEndpoints.at(endpointIndex);
+        SPDLOG_LOGGER_INFO(mLogger,
+                           "DataLink server at {}:{} is healthy; failing back",
+                           host, port);
+        auto currentIndex = mEndpointIndex;
+        mEndpointIndex = endpointIndex;
+        try
+        {
+            connect();
+            if (mEndpointIndex > 0){scheduleFailbackProbe(now);}
+            return;
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_LOGGER_WARN(mLogger,
+                               "Failed to fail back because {}",
+                               std::string {e.what()});
+        }
+        // Stay where we are
+        mEndpointIndex = currentIndex;
+        mNextFailbackProbe = now + mOptions.getFailbackProbeInterval();
+        try
+        {
+            connect();
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_LOGGER_WARN(mLogger,
+                               "Failed to reconnect because {}",
+                               std::string {e.what()});
+        }
     }
     /// Connected?
     [[nodiscard]] bool isConnected() const noexcept
@@ -161,14 +408,10 @@ public:
     /// Writes the packets
     void runWriter()
     {
-#ifndef NDEBUG
-        assert(mDataLinkClient != nullptr);
-#endif
         SPDLOG_LOGGER_DEBUG(mLogger, "Thread entering packet writer");
         constexpr std::chrono::milliseconds timeOut{15};
         constexpr std::chrono::seconds refreshMetricsInterval{60};
         std::chrono::microseconds lastRefresh{0};
-        int consecutiveWriteFailures{0};
         while (mKeepRunning.load(std::memory_order_seq_cst))
         {
             auto now = ::getNow();
@@ -176,45 +419,32 @@ public:
             {
                 lastRefresh = now; 
             } 
-            // Test my connection and, if necessary, reconnect
-            if (!isConnected())
+            // Test my connection and, if necessary, try to reconnect.  Note,
+            // we keep draining the queue while disconnected.
+            if (!isConnected()){handleDisconnected(now);}
+            // Move back to a preferred server if possible
+            if (isConnected()){probeForFailback(now);}
+            // Catch up on anything we held onto while disconnected or
+            // while rate limited
+            if (isConnected() && !isHoldoverEmpty())
             {
-                SPDLOG_LOGGER_WARN(mLogger, "Currently not connected");
-                for (const auto &waitFor : mReconnectInterval)
+                drainHoldover();
+            }
+            // Flush any aggregated records that have waited too long
+            if (mAggregator)
+            {
+                mDataLinkPackets.clear();
+                try
                 {
-                    auto lockTimeOut = waitFor;
-                    SPDLOG_LOGGER_INFO(mLogger,
-                        "Will attempt to reconnect in {} seconds", 
-                        std::to_string(waitFor.count()));
-                    {
-                    std::unique_lock<std::mutex>
-                        conditionVariableLock(mConditionVariableMutex);
-                    mConditionVariable.wait_for(conditionVariableLock,
-                                                lockTimeOut,
-                                                [this]
-                                                {
-                                                    return mTerminateRequested;
-                                                });
-                    }
-                    try
-                    {
-                        connect(); // Connects or throws
-                        break; // I win
-                    }
-                    catch (const std::exception &e)
-                    {
-                        SPDLOG_LOGGER_WARN(mLogger,
-                                   "Failed to connect because {}",
-                                   std::string {e.what()});
-                    }
+                    mAggregator->flushExpired(now, &mDataLinkPackets);
                 }
-                if (!isConnected())
+                catch (const std::exception &e)
                 {
-                    throw std::runtime_error(
-                        "Could not reconnect after "
-                      + std::to_string(mReconnectInterval.size())
-                      + " attempts");
+                    SPDLOG_LOGGER_WARN(mLogger,
+                                       "Failed to flush aggregated records because {}",
+                                       std::string {e.what()});
                 }
+                writePackets(mDataLinkPackets);
             }
             // Presumably we're connected - let's rip
             Packet packet;
@@ -224,84 +454,68 @@ public:
             if (mQueue->try_dequeue(packet))
 #endif
             {
-                // Make a miniseed packet
-                std::vector<DataLinkPacket> dataLinkPackets;
+#ifdef USE_TBB
+                mMetrics->setQueueDepth(std::max<int64_t> (0, mQueue.size()));
+#else
+                mMetrics->setQueueDepth(static_cast<int64_t> (mQueue->size_approx()));
+#endif
+                mMetrics->recordQueueResidency(
+                    std::chrono::duration_cast<std::chrono::microseconds>
+                    (std::chrono::steady_clock::now()
+                   - packet.getEnqueueTime()));
+                // Make a miniseed packet.  Note, the output vector and
+                // record buffers are recycled so the steady state does
+                // not allocate.
+                mDataLinkPackets.clear();
                 try
                 {
-                    dataLinkPackets
-                        = toDataLinkPackets(packet,
-                                            mMaxMiniSEEDRecordSize,
-                                            mWriteMiniSEED3,
-                                            mCompression,
-                                            mFlushPackets,
-                                            mLogger);
+                    if (mAggregator)
+                    {
+                        mAggregator->add(packet, now, &mDataLinkPackets);
+                    }
+                    else
+                    {
+                        auto recordLength
+                            = mRecordLengths.getRecordLength(
+                                 packet.getStreamIdentifierReference()
+                                       .getStringReference());
+                        toDataLinkPackets(packet,
+                                          recordLength,
+                                          mWriteMiniSEED3,
+                                          mCompression,
+                                          mFlushPackets,
+                                          mLogger,
+                                          getDataLinkIdentifier(packet),
+                                          mRecordLengths.getPool(recordLength),
+                                          &mDataLinkPackets);
+                    }
                 }
                 catch (const std::exception &e)
                 {
-                    mMetrics.incrementInvalidPacketsCounter();
-                    SPDLOG_LOGGER_WARN(mLogger,
-                                       "Failed to convert packet to mseed"); 
+                    mMetrics->incrementInvalidPacketsCounter();
+                    RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+                        "Failed to convert packet to mseed because {}",
+                        std::string {e.what()});
                     continue; 
                 }
-                // DataLink stream identifier
-                std::string streamIdentifier;
-                try
-                {
-                    const auto streamIdentifierReference
-                        = packet.getStreamIdentifierReference();
-                    streamIdentifier
-                        = toDataLinkIdentifier(
-                             streamIdentifierReference);
-                }
-                catch (const std::exception &e)
-                {
-                    mMetrics.incrementInvalidPacketsCounter();
-                    SPDLOG_LOGGER_WARN(mLogger,
-                                   "Failed to create stream name because {}",
-                                    std::string {e.what()});
-                    continue;
-                }
                 // Write it
-                for (auto &dataLinkPacket : dataLinkPackets)
+                writePackets(mDataLinkPackets);
+            }
+            else if (mRateLimiter.isLimited() &&
+                     isConnected() &&
+                     !isHoldoverEmpty())
+            {
+                // Sleep until exactly when the next held record may be sent
+                const auto &nextRecord = mRealTimeHoldover.empty() ?
+                                         mHoldover.front() :
+                                         mRealTimeHoldover.front();
+                auto waitTime
+                    = mRateLimiter.getWaitTime(nextRecord.data.size(),
+                                               std::chrono::steady_clock::now());
+                if (waitTime > std::chrono::nanoseconds {0})
                 {
-                    if (dataLinkPacket.data.empty())
-                    {
-                        SPDLOG_LOGGER_WARN(mLogger, "Skipping empty packet");
-                        continue;
-                    }
-                    // N.B. These are microseconds
-                    dltime_t startTime = dataLinkPacket.startTime.count();
-                    dltime_t endTime = dataLinkPacket.endTime.count();
-                    constexpr int writeAcknowledgement{0};
-                    auto returnCode
-                        = dl_write(mDataLinkClient,
-                                   dataLinkPacket.data.data(),
-                                   dataLinkPacket.data.size(),
-                                   streamIdentifier.data(),
-                                   startTime,
-                                   endTime,
-                                   writeAcknowledgement);
-                    if (returnCode < 0)
-                    {
-                        consecutiveWriteFailures = consecutiveWriteFailures + 1;
-                        mMetrics.incrementFailedPacketsSentCounter();
-                        SPDLOG_LOGGER_WARN(mLogger,
-                      "DataLink failed to write packet for {}.  Failed with {}",
-                            streamIdentifier, returnCode);
-                        if (consecutiveWriteFailures >= 32)
-                        {
-                            SPDLOG_LOGGER_ERROR(mLogger,
-                               "DataLink too many consecutive write failures - killing connection");
-                            disconnect();
-                            throw std::runtime_error(
-                               "Too many consecutive write failures");
-                        }
-                    }
-                    else
-                    { 
-                        mMetrics.incrementPacketsWrittenCounter();
-                        consecutiveWriteFailures = 0;
-                    }
+                    std::this_thread::sleep_for(
+                        std::min<std::chrono::nanoseconds> (waitTime, timeOut));
                 }
             }
             else
@@ -309,8 +523,298 @@ public:
                 std::this_thread::sleep_for(timeOut);
             }
         }
+        // Don't leave partially filled records behind
+        if (mAggregator)
+        {
+            mDataLinkPackets.clear();
+            try
+            {
+                mAggregator->flush(&mDataLinkPackets);
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_WARN(mLogger,
+                                   "Failed to flush aggregated records because {}",
+                                   std::string {e.what()});
+            }
+            writePackets(mDataLinkPackets);
+        }
+        if (isConnected() && !isHoldoverEmpty())
+        {
+            drainHoldover();
+        }
+        if (!isHoldoverEmpty())
+        {
+            auto nHeld = static_cast<int64_t> (mRealTimeHoldover.size()
+                                             + mHoldover.size());
+            SPDLOG_LOGGER_WARN(mLogger,
+                               "Discarding {} held records on exit", nHeld);
+            mMetrics->incrementHoldoverRecordsDroppedCounter(nHeld);
+            mMetrics->addToHoldoverSize(-nHeld);
+            mRealTimeHoldover.clear();
+            mHoldover.clear();
+        }
+        if (mOutageStart.count() > 0)
+        {
+            mMetrics->endOutage(::getNow() - mOutageStart);
+            mOutageStart = std::chrono::microseconds {0};
+        }
         SPDLOG_LOGGER_INFO(mLogger, "DataLink writer thread exiting");
     }
+    /// Marks the start of an outage.
+    void beginOutage(const std::chrono::microseconds &now)
+    {
+        mOutageStart = now;
+        mNextReconnectAttempt = now;
+        mReconnectDelay = mOptions.getInitialReconnectDelay();
+        mMetrics->beginOutage();
+    }
+    /// Connection state machine.  This makes the initial connection,
+    /// reconnects after an outage, never blocks for longer than a single
+    /// connection attempt, and never gives up.
+    void handleDisconnected(const std::chrono::microseconds &now)
+    {
+        // N.B. The client is destroyed when a connection attempt fails so
+        // a client without a link was connected and has since been lost
+        if (mDataLinkClient != nullptr && mOutageStart.count() == 0)
+        {
+            SPDLOG_LOGGER_WARN(mLogger,
+                               "Connection to DataLink server at {} lost",
+                               mAddress);
+            beginOutage(now);
+            closeProbe();
+            // Fail over immediately
+            advanceEndpoint();
+        }
+        if (now < mNextReconnectAttempt){return;}
+        if (mOutageStart.count() > 0)
+        {
+            mMetrics->incrementReconnectAttemptsCounter();
+        }
+        try
+        {
+            connect(); // Connects or throws
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_LOGGER_WARN(mLogger,
+                               "Failed to connect because {}",
+                               std::string {e.what()});
+        }
+        if (isConnected())
+        {
+            if (mOutageStart.count() > 0)
+            {
+                auto outageDuration = ::getNow() - mOutageStart;
+                SPDLOG_LOGGER_INFO(mLogger,
+                    "Reconnected after {} seconds; {} held records will be written",
+                    std::chrono::duration_cast<std::chrono::seconds>
+                        (outageDuration).count(),
+                    mRealTimeHoldover.size() + mHoldover.size());
+                mMetrics->endOutage(outageDuration);
+                mOutageStart = std::chrono::microseconds {0};
+            }
+            if (mEndpointIndex > 0){scheduleFailbackProbe(::getNow());}
+            return;
+        }
+        // The initial connection attempt failed
+        if (mOutageStart.count() == 0){beginOutage(now);}
+        // Try the next server right away.  We only back off after every
+        // server has been tried.
+        if (!advanceEndpoint())
+        {
+            mNextReconnectAttempt = ::getNow();
+            return;
+        }
+        // Exponential backoff with jitter
+        std::uniform_real_distribution<double>
+            jitter(-mOptions.getReconnectJitter(),
+                    mOptions.getReconnectJitter());
+        std::chrono::microseconds delay
+        {
+            static_cast<int64_t>
+            (
+               std::chrono::duration_cast<std::chrono::microseconds>
+                  (mReconnectDelay).count()
+              *(1 + jitter(mRandomNumberGenerator))
+            )
+        };
+        mNextReconnectAttempt = ::getNow() + delay;
+        constexpr std::chrono::milliseconds minimumGrowth{100};
+        mReconnectDelay = std::min(std::max(2*mReconnectDelay, minimumGrowth),
+                                   mOptions.getMaximumReconnectDelay());
+        SPDLOG_LOGGER_INFO(mLogger,
+                           "Will attempt to reconnect in {} seconds",
+                           delay.count()*1.e-6);
+    }
+    /// Holds onto a record until we reconnect or the rate limit permits.
+    /// When full, the oldest backfilled records are discarded first.
+    void addToHoldover(DataLinkPacket &&dataLinkPacket,
+                       const bool isRealTime = false)
+    {
+        if (static_cast<int> (mRealTimeHoldover.size() + mHoldover.size())
+            >= mMaximumHoldoverSize)
+        {
+            if (!mHoldover.empty())
+            {
+                mHoldover.pop_front();
+            }
+            else
+            {
+                mRealTimeHoldover.pop_front();
+            }
+            mMetrics->addToHoldoverSize(-1);
+            mMetrics->incrementHoldoverRecordsDroppedCounter();
+        }
+        if (isRealTime)
+        {
+            mRealTimeHoldover.push_back(std::move(dataLinkPacket));
+        }
+        else
+        {
+            mHoldover.push_back(std::move(dataLinkPacket));
+        }
+        mMetrics->addToHoldoverSize(1);
+    }
+    /// @result True indicates nothing is held.
+    [[nodiscard]] bool isHoldoverEmpty() const noexcept
+    {
+        return mRealTimeHoldover.empty() && mHoldover.empty();
+    }
+    /// Writes the held records as quickly as the rate limit allows.  The
+    /// real-time records go first.
+    void drainHoldover()
+    {
+        for (auto *holdover : {&mRealTimeHoldover, &mHoldover})
+        {
+            while (!holdover->empty() && isConnected())
+            {
+                if (!mRateLimiter.tryAcquire(holdover->front().data.size(),
+                                             std::chrono::steady_clock::now()))
+                {
+                    return;
+                }
+                if (!writeRecord(holdover->front()))
+                {
+                    return;
+                }
+                holdover->pop_front();
+                mMetrics->addToHoldoverSize(-1);
+            }
+        }
+    }
+    /// @result True indicates the record is recent enough that it should
+    ///         be sent ahead of backfilled records.
+    [[nodiscard]] bool isRealTime(const DataLinkPacket &dataLinkPacket,
+                                  const std::chrono::microseconds &now) const
+    {
+        return mRealTimeThreshold.count() > 0 &&
+               dataLinkPacket.endTime >= now - mRealTimeThreshold;
+    }
+    /// Caches the DataLink stream identifiers so they need not be rebuilt
+    /// for every packet
+    [[nodiscard]] const std::shared_ptr<const std::string> &
+        getDataLinkIdentifier(const Packet &packet)
+    {
+        const auto &streamIdentifier = packet.getStreamIdentifierReference();
+        auto key = streamIdentifier.getStringReference();
+        auto index = mDataLinkIdentifiers.find(key);
+        if (index == mDataLinkIdentifiers.end())
+        {
+            auto dataLinkIdentifier
+                = std::make_shared<const std::string>
+                  (toDataLinkIdentifier(streamIdentifier));
+            index = mDataLinkIdentifiers.emplace(std::string {key},
+                                                 std::move(dataLinkIdentifier))
+                    .first;
+        }
+        return index->second;
+    }
+    /// Writes the miniSEED records to the DataLink server then recycles
+    /// their buffers.  If we are not connected, are still catching up, or
+    /// are over the rate limit then the records are held.  Real-time
+    /// records may skip ahead of held, backfilled records.
+    void writePackets(std::vector<DataLinkPacket> &dataLinkPackets)
+    {
+        auto now = ::getNow();
+        for (auto &dataLinkPacket : dataLinkPackets)
+        {
+            if (!isConnected())
+            {
+                addToHoldover(std::move(dataLinkPacket));
+                continue;
+            }
+            auto realTime = isRealTime(dataLinkPacket, now);
+            auto &holdover = realTime ? mRealTimeHoldover : mHoldover;
+            if (!holdover.empty() ||
+                (!realTime && !mRealTimeHoldover.empty()) ||
+                !mRateLimiter.tryAcquire(dataLinkPacket.data.size(),
+                                         std::chrono::steady_clock::now()))
+            {
+                addToHoldover(std::move(dataLinkPacket), realTime);
+                continue;
+            }
+            if (!writeRecord(dataLinkPacket))
+            {
+                addToHoldover(std::move(dataLinkPacket), realTime);
+            }
+        }
+        dataLinkPackets.clear();
+    }
+    /// Writes a single record.
+    /// @result False indicates the write failed.  The connection is dropped
+    ///         so the reconnection logic can fail over and the record is
+    ///         left intact so the caller can hold onto it.
+    [[nodiscard]] bool writeRecord(DataLinkPacket &dataLinkPacket)
+    {
+        if (dataLinkPacket.data.empty())
+        {
+            RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+                                     "Skipping empty packet");
+            return true;
+        }
+        if (dataLinkPacket.streamIdentifier == nullptr)
+        {
+            RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+                                     "Skipping packet without an identifier");
+            return true;
+        }
+        // N.B. These are microseconds
+        dltime_t startTime = dataLinkPacket.startTime.count();
+        dltime_t endTime = dataLinkPacket.endTime.count();
+        const auto &streamIdentifier = *dataLinkPacket.streamIdentifier;
+        constexpr int writeAcknowledgement{0};
+        auto writeStart = std::chrono::steady_clock::now();
+        auto returnCode
+            = dl_write(mDataLinkClient,
+                       dataLinkPacket.data.data(),
+                       dataLinkPacket.data.size(),
+                       const_cast<char *> (streamIdentifier.data()),
+                       startTime,
+                       endTime,
+                       writeAcknowledgement);
+        auto writeEnd = std::chrono::steady_clock::now();
+        mMetrics->recordWriteLatency(
+            std::chrono::duration_cast<std::chrono::microseconds>
+                (writeEnd - writeStart));
+        if (returnCode < 0)
+        {
+            // Without acknowledgements a failed write means the connection
+            // is broken; there is no point in trying the next record on it
+            mMetrics->incrementFailedPacketsSentCounter();
+            RATE_LIMITED_LOGGER_WARN(mLogger, streamIdentifier,
+              "DataLink failed to write packet for {}.  Failed with {}",
+                streamIdentifier, returnCode);
+            disconnect();
+            return false;
+        }
+        mMetrics->incrementPacketsWrittenCounter();
+        dataLinkPacket.timestamps.written = writeEnd;
+        mMetrics->recordPipelineTimestamps(dataLinkPacket.timestamps);
+        // Done with this slab
+        dataLinkPacket.data.clear();
+        return true;
+    }
     /// Enqueues the packet
     void enqueue(Packet &&packet)
     {
@@ -321,7 +825,7 @@ public:
 #endif
         if (approximateQueueSize >= mMaximumInternalQueueSize)
         {
-            SPDLOG_LOGGER_WARN(mLogger,
+            RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
                 "SEEDLink thread popping elements from export queue");
 #ifdef USE_TBB
             while (mQueue.size() >= mMaximumInternalQueueSize)
@@ -329,7 +833,7 @@ public:
             while (mQueue->size_approx() >= mMaximumInternalQueueSize)
 #endif
             {
-                mMetrics.incrementFailedPacketsFailedToEnqueueCounter();
+                mMetrics->incrementFailedPacketsFailedToEnqueueCounter();
                 //MeasurementFetcher::mObservablePacketsFailedToEnqueue.fetch_add(1);
                 //metrics.incrementFailedToEnqueuntCounter();
                 Packet workSpace;
@@ -345,25 +849,22 @@ public:
             }
         }
         // Enqueue 
+        packet.setEnqueueTime(std::chrono::steady_clock::now());
 #ifdef USE_TBB
         if (!mQueue.try_push(std::move(packet)))
 #else
         if (!mQueue->try_enqueue(std::move(packet)))
 #endif
         {
-            auto &writerMetrics = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance(); 
-            writerMetrics.incrementFailedPacketsFailedToEnqueueCounter();
-            SPDLOG_LOGGER_WARN(mLogger,
+            mMetrics->incrementFailedPacketsFailedToEnqueueCounter();
+            RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
                "Failed to add packet to export queue - queue may be full");
         }
     }
 //private:
     DataLinkClientOptions mOptions;
     std::shared_ptr<spdlog::logger> mLogger{nullptr};
-    USEEDLinkToRingServer::WriterMetricsSingleton &mMetrics
-    {
-        USEEDLinkToRingServer::WriterMetricsSingleton::getInstance()
-    };
+    std::shared_ptr<USEEDLinkToRingServer::WriterMetrics> mMetrics{nullptr};
     std::mutex mConditionVariableMutex;
     std::mutex mMutex;
     std::condition_variable mConditionVariable;
@@ -372,21 +873,36 @@ public:
 #else
     std::unique_ptr<moodycamel::ConcurrentQueue<Packet>> mQueue{nullptr};
 #endif
+    std::unique_ptr<MiniSEEDRecordAggregator> mAggregator{nullptr};
+    // The record length of each stream and the pools holding the records
+    ::RecordLengths mRecordLengths{mOptions};
+    std::vector<DataLinkPacket> mDataLinkPackets;
+    std::map<std::string, std::shared_ptr<const std::string>, std::less<>>
+        mDataLinkIdentifiers;
     DLCP *mDataLinkClient{nullptr};
     std::string mClientName{"daliClient"};
     std::string mAddress;
+    std::vector<std::pair<std::string, uint16_t>> mEndpoints;
+    size_t mEndpointIndex{0};
+    std::chrono::microseconds mNextFailbackProbe{0};
+    std::chrono::microseconds mProbeDeadline{0};
+    // The resolved addresses of the endpoints ahead of the current one
+    std::vector<::ProbeAddress> mProbeAddresses;
+    size_t mProbeAddressIndex{0};
+    int mProbeFD{-1};
     std::array<char, MAXPACKETSIZE> mBuffer;
-    std::vector<std::chrono::seconds> mReconnectInterval
-    {
-        std::chrono::seconds {0},
-        std::chrono::seconds {5},
-        std::chrono::seconds {30},
-        std::chrono::seconds {60}
-    };
+    std::deque<DataLinkPacket> mHoldover;
+    std::deque<DataLinkPacket> mRealTimeHoldover;
+    ::RateLimiter mRateLimiter;
+    std::chrono::microseconds mRealTimeThreshold{0};
+    std::mt19937 mRandomNumberGenerator{std::random_device {}()};
+    std::chrono::microseconds mOutageStart{0};
+    std::chrono::microseconds mNextReconnectAttempt{0};
+    std::chrono::milliseconds mReconnectDelay{1000};
     std::chrono::seconds mTimeOut{60};
     std::chrono::seconds mHeartbeatInterval{5}; // I don't think this is used for writing
-    int mMaxMiniSEEDRecordSize{512};
     int mMaximumInternalQueueSize{8192};
+    int mMaximumHoldoverSize{65536};
     //std::atomic<uint64_t> mPacketsFailedToEnqueue{0};
     //std::atomic<uint64_t> mInvalidPackets{0};
     //std::atomic<uint64_t> mPacketsFailedToWrite{0};
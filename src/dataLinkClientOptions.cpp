@@ -1,19 +1,80 @@
 #include <string>
 #include <algorithm>
+#include <chrono>
+#include <vector>
+#include <fnmatch.h>
+#include <libdali.h>
 #include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
 
 using namespace USEEDLinkToRingServer;
 
+namespace
+{
+/// Removes spaces and lower-cases the host name
+[[nodiscard]] std::string normalizeHost(const std::string &hostIn)
+{
+    auto host = hostIn;
+    host.erase(std::remove(host.begin(), host.end(), ' '), host.end());
+    std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+    if (host.empty())
+    {
+        throw std::invalid_argument("Host is empty");
+    }
+    if (host.size() >= 100)
+    {
+        throw std::invalid_argument("Host name is too long");
+    }
+    return host;
+}
+
+/// Verifies the record size is something DataLink can carry
+void checkRecordSize(const int size)
+{
+    if (size < 1 || size > MAXPACKETSIZE)
+    {
+        throw std::invalid_argument("Output MiniSEED record size "
+                                  + std::to_string(size)
+                                  + " must be in range [1,"
+                                  + std::to_string(MAXPACKETSIZE) + "]");
+    }
+}
+
+/// Pads NET.STA.CHA to NET.STA.CHA. so it can match NET.STA.CHA.LOC
+/// patterns
+[[nodiscard]] std::string toMatchable(const std::string &streamIdentifier)
+{
+    if (std::count(streamIdentifier.begin(), streamIdentifier.end(), '.') == 2)
+    {
+        return streamIdentifier + ".";
+    }
+    return streamIdentifier;
+}
+}
+
 class DataLinkClientOptions::DataLinkClientOptionsImpl
 {
 public:
     std::string mHost{"localhost"};
     std::string mName{"seedLinkToRingServerDALIClient"};
+    std::vector<std::pair<std::string, uint16_t>> mFailoverEndpoints;
+    std::vector<std::pair<std::string, int>> mMiniSEEDRecordSizes;
+    std::chrono::milliseconds mIOTimeOut{60000};
+    std::chrono::milliseconds mFailbackProbeInterval{30000};
+    std::chrono::milliseconds mAggregationLatency{1000};
+    std::chrono::milliseconds mInitialReconnectDelay{1000};
+    std::chrono::milliseconds mMaximumReconnectDelay{60000};
+    std::chrono::milliseconds mBurstAllowance{1000};
+    std::chrono::milliseconds mRealTimeThreshold{0};
+    double mReconnectJitter{0.2};
+    double mMaximumPacketsPerSecond{0};
+    double mMaximumBytesPerSecond{0};
+    int mMaximumHoldoverSize{65536};
     int mMaximumInternalQueueSize{8192}; 
     int mMiniSEEDRecordSize{512};
     uint16_t mPort{16000};
     bool mWriteMiniSEED3{false};
     bool mFlushPackets{true};
+    bool mAggregatePackets{false};
 };
 
 /// Constructor
@@ -58,25 +119,79 @@ DataLinkClientOptions::operator=(DataLinkClientOptions &&options) noexcept
 }
 
 /// Host
-void DataLinkClientOptions::setHost(const std::string &hostIn)
+void DataLinkClientOptions::setHost(const std::string &host)
 {
-    auto host = hostIn;
-    host.erase(std::remove(host.begin(), host.end(), ' '), host.end());
-    std::transform(host.begin(), host.end(), host.begin(), ::tolower);
-    if (host.empty())
+    pImpl->mHost = ::normalizeHost(host);
+}
+
+std::string DataLinkClientOptions::getHost() const
+{
+    return pImpl->mHost;
+}
+
+/// Failover endpoints
+void DataLinkClientOptions::setFailoverEndpoints(
+    const std::vector<std::pair<std::string, uint16_t>> &endpoints)
+{
+    std::vector<std::pair<std::string, uint16_t>> failoverEndpoints;
+    failoverEndpoints.reserve(endpoints.size());
+    for (const auto &endpoint : endpoints)
     {
-        throw std::invalid_argument("Host is empty");
+        failoverEndpoints.push_back(
+            std::pair {::normalizeHost(endpoint.first), endpoint.second});
     }
-    if (host.size() >= 100)
+    pImpl->mFailoverEndpoints = std::move(failoverEndpoints);
+}
+
+std::vector<std::pair<std::string, uint16_t>>
+DataLinkClientOptions::getFailoverEndpoints() const
+{
+    return pImpl->mFailoverEndpoints;
+}
+
+std::vector<std::pair<std::string, uint16_t>>
+DataLinkClientOptions::getEndpoints() const
+{
+    std::vector<std::pair<std::string, uint16_t>> endpoints;
+    endpoints.reserve(pImpl->mFailoverEndpoints.size() + 1);
+    endpoints.push_back(std::pair {pImpl->mHost, pImpl->mPort});
+    endpoints.insert(endpoints.end(),
+                     pImpl->mFailoverEndpoints.begin(),
+                     pImpl->mFailoverEndpoints.end());
+    return endpoints;
+}
+
+/// I/O time out
+void DataLinkClientOptions::setIOTimeOut(
+    const std::chrono::milliseconds &timeOut)
+{
+    if (timeOut.count() <= 0)
     {
-        throw std::invalid_argument("Host name is too long");
+        throw std::invalid_argument("I/O time out must be positive");
     }
-    pImpl->mHost = host;
+    pImpl->mIOTimeOut = timeOut;
 }
 
-std::string DataLinkClientOptions::getHost() const
+std::chrono::milliseconds DataLinkClientOptions::getIOTimeOut() const noexcept
 {
-    return pImpl->mHost;
+    return pImpl->mIOTimeOut;
+}
+
+/// Failback probe interval
+void DataLinkClientOptions::setFailbackProbeInterval(
+    const std::chrono::milliseconds &interval)
+{
+    if (interval.count() <= 0)
+    {
+        throw std::invalid_argument("Failback probe interval must be positive");
+    }
+    pImpl->mFailbackProbeInterval = interval;
+}
+
+std::chrono::milliseconds
+DataLinkClientOptions::getFailbackProbeInterval() const noexcept
+{
+    return pImpl->mFailbackProbeInterval;
 }
 
 /// MSEED3
@@ -131,12 +246,7 @@ std::string DataLinkClientOptions::getName() const noexcept
 // Record size
 void DataLinkClientOptions::setMiniSEEDRecordSize(const int size)
 {
-    if (size < 1 || size > 512)
-    {
-        throw std::invalid_argument("Output MiniSEED record size "
-                                  + std::to_string(size)
-                                  + " must be in range [1,512]");
-    }
+    ::checkRecordSize(size);
     pImpl->mMiniSEEDRecordSize = size;
 }
 
@@ -145,6 +255,48 @@ int DataLinkClientOptions::getMiniSEEDRecordSize() const noexcept
     return pImpl->mMiniSEEDRecordSize;
 }
 
+void DataLinkClientOptions::addMiniSEEDRecordSize(
+    const std::string &streamPatternIn, const int size)
+{
+    ::checkRecordSize(size);
+    auto streamPattern = streamPatternIn;
+    streamPattern.erase(std::remove(streamPattern.begin(),
+                                    streamPattern.end(), ' '),
+                        streamPattern.end());
+    auto nDots = std::count(streamPattern.begin(), streamPattern.end(), '.');
+    if (nDots < 2 || nDots > 3)
+    {
+        throw std::invalid_argument("Stream pattern " + streamPatternIn
+            + " must be of the form NETWORK.STATION.CHANNEL[.LOCATION]");
+    }
+    if (nDots == 2){streamPattern = streamPattern + ".*";}
+    pImpl->mMiniSEEDRecordSizes.push_back(std::pair {streamPattern, size});
+}
+
+std::vector<std::pair<std::string, int>>
+DataLinkClientOptions::getMiniSEEDRecordSizes() const
+{
+    return pImpl->mMiniSEEDRecordSizes;
+}
+
+int DataLinkClientOptions::getMiniSEEDRecordSize(
+    const std::string &streamIdentifier) const
+{
+    if (pImpl->mMiniSEEDRecordSizes.empty())
+    {
+        return pImpl->mMiniSEEDRecordSize;
+    }
+    auto matchable = ::toMatchable(streamIdentifier);
+    for (const auto &[pattern, size] : pImpl->mMiniSEEDRecordSizes)
+    {
+        if (::fnmatch(pattern.c_str(), matchable.c_str(), 0) == 0)
+        {
+            return size;
+        }
+    }
+    return pImpl->mMiniSEEDRecordSize;
+}
+
 /// Max queue size
 void DataLinkClientOptions::setMaximumInternalQueueSize(const int queueSize)
 {
@@ -175,3 +327,162 @@ bool DataLinkClientOptions::flushPackets() const noexcept
 {
     return pImpl->mFlushPackets;
 }
+
+/// Packet aggregation
+void DataLinkClientOptions::enablePacketAggregation() noexcept
+{
+    pImpl->mAggregatePackets = true;
+}
+
+void DataLinkClientOptions::disablePacketAggregation() noexcept
+{
+    pImpl->mAggregatePackets = false;
+}
+
+bool DataLinkClientOptions::aggregatePackets() const noexcept
+{
+    return pImpl->mAggregatePackets;
+}
+
+/// Aggregation latency
+void DataLinkClientOptions::setAggregationLatency(
+    const std::chrono::milliseconds &latency)
+{
+    if (latency.count() <= 0)
+    {
+        throw std::invalid_argument("Aggregation latency must be positive");
+    }
+    pImpl->mAggregationLatency = latency;
+}
+
+std::chrono::milliseconds
+DataLinkClientOptions::getAggregationLatency() const noexcept
+{
+    return pImpl->mAggregationLatency;
+}
+
+/// Reconnect delays
+void DataLinkClientOptions::setReconnectDelays(
+    const std::chrono::milliseconds &initialDelay,
+    const std::chrono::milliseconds &maximumDelay)
+{
+    if (initialDelay.count() < 0)
+    {
+        throw std::invalid_argument("Initial reconnect delay cannot be negative");
+    }
+    if (maximumDelay < initialDelay)
+    {
+        throw std::invalid_argument(
+           "Maximum reconnect delay cannot be less than initial delay");
+    }
+    pImpl->mInitialReconnectDelay = initialDelay;
+    pImpl->mMaximumReconnectDelay = maximumDelay;
+}
+
+std::chrono::milliseconds
+DataLinkClientOptions::getInitialReconnectDelay() const noexcept
+{
+    return pImpl->mInitialReconnectDelay;
+}
+
+std::chrono::milliseconds
+DataLinkClientOptions::getMaximumReconnectDelay() const noexcept
+{
+    return pImpl->mMaximumReconnectDelay;
+}
+
+/// Reconnect jitter
+void DataLinkClientOptions::setReconnectJitter(const double jitter)
+{
+    if (jitter < 0 || jitter > 1)
+    {
+        throw std::invalid_argument("Jitter must be in range [0,1]");
+    }
+    pImpl->mReconnectJitter = jitter;
+}
+
+double DataLinkClientOptions::getReconnectJitter() const noexcept
+{
+    return pImpl->mReconnectJitter;
+}
+
+/// Holdover size
+void DataLinkClientOptions::setMaximumHoldoverSize(
+    const int maximumHoldoverSize)
+{
+    if (maximumHoldoverSize <= 0)
+    {
+        throw std::invalid_argument("Maximum holdover size must be positive");
+    }
+    pImpl->mMaximumHoldoverSize = maximumHoldoverSize;
+}
+
+int DataLinkClientOptions::getMaximumHoldoverSize() const noexcept
+{
+    return pImpl->mMaximumHoldoverSize;
+}
+
+/// Rate limits
+void DataLinkClientOptions::setMaximumPacketsPerSecond(
+    const double packetsPerSecond)
+{
+    if (packetsPerSecond < 0)
+    {
+        throw std::invalid_argument(
+            "Maximum packets per second cannot be negative");
+    }
+    pImpl->mMaximumPacketsPerSecond = packetsPerSecond;
+}
+
+double DataLinkClientOptions::getMaximumPacketsPerSecond() const noexcept
+{
+    return pImpl->mMaximumPacketsPerSecond;
+}
+
+void DataLinkClientOptions::setMaximumBytesPerSecond(
+    const double bytesPerSecond)
+{
+    if (bytesPerSecond < 0)
+    {
+        throw std::invalid_argument(
+            "Maximum bytes per second cannot be negative");
+    }
+    pImpl->mMaximumBytesPerSecond = bytesPerSecond;
+}
+
+double DataLinkClientOptions::getMaximumBytesPerSecond() const noexcept
+{
+    return pImpl->mMaximumBytesPerSecond;
+}
+
+void DataLinkClientOptions::setBurstAllowance(
+    const std::chrono::milliseconds &burstAllowance)
+{
+    if (burstAllowance.count() <= 0)
+    {
+        throw std::invalid_argument("Burst allowance must be positive");
+    }
+    pImpl->mBurstAllowance = burstAllowance;
+}
+
+std::chrono::milliseconds
+DataLinkClientOptions::getBurstAllowance() const noexcept
+{
+    return pImpl->mBurstAllowance;
+}
+
+void DataLinkClientOptions::setRealTimeThreshold(
+    const std::chrono::milliseconds &threshold)
+{
+    if (threshold.count() < 0)
+    {
+        throw std::invalid_argument("Real-time threshold cannot be negative");
+    }
+    pImpl->mRealTimeThreshold = threshold;
+}
+
+std::chrono::milliseconds
+DataLinkClientOptions::getRealTimeThreshold() const noexcept
+{
+    return pImpl->mRealTimeThreshold;
+}
@@ -0,0 +1,1314 @@
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+#ifndef NDEBUG
+#include <cassert>
+#endif
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef USE_TBB
+#include <oneapi/tbb/concurrent_queue.h>
+#else
+#include <concurrentqueue.h>
+#endif
+#include <libdali.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "uSEEDLinkToRingServer/dataLinkEngine.hpp"
+#include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
+#include "uSEEDLinkToRingServer/miniSEEDRecordAggregator.hpp"
+#include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
+#include "uSEEDLinkToRingServer/streamIdentifier.hpp"
+#include "uSEEDLinkToRingServer/writerMetricsSingleton.hpp"
+#include "getNow.hpp"
+#include "inFlightRecords.hpp"
+#include "logSuppressor.hpp"
+#include "rateLimiter.hpp"
+#include "recordLengths.hpp"
+
+using namespace USEEDLinkToRingServer;
+
+namespace
+{
+
+enum class ConnectionState
+{
+    Disconnected, /*!< Waiting to (re)connect. */
+    Connecting,   /*!< The TCP connection is being established. */
+    Identifying,  /*!< Waiting on the server's response to our ID. */
+    Ready         /*!< Records can be written. */
+};
+
+/// The epoll token for the wake-up event
+constexpr uint64_t WAKE_UP_TOKEN{std::numeric_limits<uint64_t>::max()};
+/// Set in the epoll token of a connection's failback probe
+constexpr uint64_t PROBE_BIT{uint64_t {1} << 62};
+/// Records are coalesced into send buffers of about this many bytes
+constexpr size_t MAXIMUM_SEND_BUFFER_SIZE{65536};
+/// Bound the number of packets converted per pass so the I/O stays lively
+constexpr int MAXIMUM_PACKETS_PER_ITERATION{1024};
+
+/// Appends a DataLink frame - i.e., the preheader "DL", the one byte
+/// header length, the header, and the data - to the buffer.
+void appendFrame(const std::string_view &header,
+                 const char *data, const size_t dataLength,
+                 std::string *buffer)
+{
+#ifndef NDEBUG
+    assert(header.size() <= 255);
+#endif
+    buffer->push_back('D');
+    buffer->push_back('L');
+    buffer->push_back(static_cast<char> (static_cast<uint8_t> (header.size())));
+    buffer->append(header);
+    if (data != nullptr && dataLength > 0){buffer->append(data, dataLength);}
+}
+
+/// Creates the ID the same way libdali does - program:user:pid:architecture
+[[nodiscard]] std::string toClientIdentifier(const std::string &name)
+{
+    std::string user;
+    if (const char *userName = std::getenv("USER"); userName != nullptr)
+    {
+        user = userName;
+    }
+    return "ID " + name + ":" + user + ":"
+         + std::to_string(static_cast<long> (::getpid())) + ":Linux";
+}
+
+/// Extracts the maximum packet size from the server's ID response, e.g.,
+/// ID DataLink 2018.078 :: DLPROTO:1.0 PACKETSIZE:512 WRITE
+[[nodiscard]] int getServerPacketSize(const std::string_view &header)
+{
+    constexpr std::string_view key{"PACKETSIZE:"};
+    auto position = header.find(key);
+    if (position == std::string_view::npos){return MAXPACKETSIZE;}
+    int packetSize{0};
+    for (auto i = position + key.size(); i < header.size(); ++i)
+    {
+        if (header[i] < '0' || header[i] > '9'){break;}
+        packetSize = 10*packetSize + (header[i] - '0');
+        if (packetSize > MAXPACKETSIZE){return MAXPACKETSIZE;}
+    }
+    return packetSize > 0 ? packetSize : MAXPACKETSIZE;
+}
+
+/// Extracts the size of the message following an OK or ERROR header, e.g.,
+/// ERROR 0 27
+[[nodiscard]] size_t getMessageSize(const std::string_view &header)
+{
+    auto position = header.find_last_of(' ');
+    if (position == std::string_view::npos){return 0;}
+    size_t messageSize{0};
+    for (auto i = position + 1; i < header.size(); ++i)
+    {
+        if (header[i] < '0' || header[i] > '9'){return 0;}
+        messageSize = 10*messageSize + static_cast<size_t> (header[i] - '0');
+    }
+    return messageSize;
+}
+
+/// A single, non-blocking DataLink connection
+struct Connection
+{
+    Connection(const DataLinkClientOptions &optionsIn, const uint64_t indexIn) :
+        options(optionsIn),
+        recordLengths{optionsIn},
+        rateLimiter{optionsIn},
+        index(indexIn)
+    {
+        endpoints = options.getEndpoints();
+        address = options.getHost() + ":" + std::to_string(options.getPort());
+        reconnectDelay = options.getInitialReconnectDelay();
+        metrics = WriterMetricsSingleton::getInstance().createWriterMetrics(
+                      options.getName(), address);
+        metrics->setQueueCapacity(options.getMaximumHoldoverSize());
+    }
+    DataLinkClientOptions options;
+    ::RecordLengths recordLengths;
+    std::shared_ptr<WriterMetrics> metrics{nullptr};
+    std::unique_ptr<MiniSEEDRecordAggregator> aggregator{nullptr};
+    ::RateLimiter rateLimiter;
+    // Records waiting to be written.  These accumulate while we are
+    // disconnected.
+    std::deque<DataLinkPacket> pending;
+    // Records copied to the send buffer.  These are put back on the pending
+    // queue if the connection dies before they are fully sent.
+    ::InFlightRecords inFlight;
+    std::string sendBuffer;
+    std::string receiveBuffer;
+    std::string address;
+    // The primary server followed by the failover servers
+    std::vector<std::pair<std::string, uint16_t>> endpoints;
+    std::chrono::microseconds outageStart{0};
+    std::chrono::microseconds nextReconnectAttempt{0};
+    std::chrono::microseconds deadline{0};
+    std::chrono::microseconds lastProgress{0};
+    std::chrono::microseconds nextFailbackProbe{0};
+    std::chrono::microseconds probeDeadline{0};
+    std::chrono::milliseconds reconnectDelay{1000};
+    size_t bytesSent{0};
+    size_t endpointIndex{0};
+    size_t probeIndex{0};
+    uint64_t index{0};
+    int fd{-1};
+    int probeFD{-1};
+    int serverPacketSize{MAXPACKETSIZE};
+    ConnectionState state{ConnectionState::Disconnected};
+    bool watchingWrites{false};
+};
+
+}
+
+class DataLinkEngine::DataLinkEngineImpl
+{
+public:
+    /// Constructor
+    DataLinkEngineImpl(
+        const std::vector<DataLinkClientOptions> &options,
+        std::shared_ptr<spdlog::logger> logger) :
+        mLogger(logger)
+    {
+        if (options.empty())
+        {
+            throw std::invalid_argument("No DataLink connections specified");
+        }
+        if (mLogger == nullptr)
+        {
+            mLogger = spdlog::stdout_color_mt("DataLinkEngineConsole");
+        }
+        mMaximumInternalQueueSize = 0;
+        for (const auto &option : options)
+        {
+            auto connection
+                = std::make_unique<::Connection>
+                  (option, static_cast<uint64_t> (mConnections.size()));
+            if (option.aggregatePackets())
+            {
+                auto recordLengths = &connection->recordLengths;
+                connection->aggregator
+                    = std::make_unique<MiniSEEDRecordAggregator>
+                      ([recordLengths](const std::string &streamIdentifier)
+                       {
+                           return recordLengths->getRecordLength(
+                                      streamIdentifier);
+                       },
+                       option.writeMiniSEED3(),
+                       mCompression,
+                       std::chrono::duration_cast<std::chrono::microseconds>
+                           (option.getAggregationLatency()));
+            }
+            mMaximumInternalQueueSize
+                = std::max(mMaximumInternalQueueSize,
+                           option.getMaximumInternalQueueSize());
+            mConnections.push_back(std::move(connection));
+        }
+#ifdef USE_TBB
+        mQueue.set_capacity(mMaximumInternalQueueSize);
+#else
+        mQueue
+            = std::make_unique<moodycamel::ConcurrentQueue<Packet>>
+              (mMaximumInternalQueueSize);
+#endif
+        mEpoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (mEpoll < 0)
+        {
+            throw std::runtime_error("Failed to create epoll instance because "
+                                   + std::string {std::strerror(errno)});
+        }
+        mWakeUp = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (mWakeUp < 0)
+        {
+            ::close(mEpoll);
+            throw std::runtime_error("Failed to create event file descriptor because "
+                                   + std::string {std::strerror(errno)});
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = WAKE_UP_TOKEN;
+        if (::epoll_ctl(mEpoll, EPOLL_CTL_ADD, mWakeUp, &event) < 0)
+        {
+            ::close(mWakeUp);
+            ::close(mEpoll);
+            throw std::runtime_error("Failed to watch wake up event because "
+                                   + std::string {std::strerror(errno)});
+        }
+    }
+    /// Destructor
+    ~DataLinkEngineImpl()
+    {
+        stop();
+        for (auto &connection : mConnections){releaseSocket(*connection);}
+        if (mWakeUp >= 0){::close(mWakeUp);}
+        if (mEpoll >= 0){::close(mEpoll);}
+    }
+    /// Stop the event loop
+    void stop()
+    {
+        mKeepRunning.store(false, std::memory_order_seq_cst);
+        uint64_t one{1};
+        [[maybe_unused]] auto nWritten = ::write(mWakeUp, &one, sizeof(one));
+    }
+    /// Start the event loop
+    std::future<void> start()
+    {
+        stop();
+        mKeepRunning.store(true, std::memory_order_seq_cst);
+        auto result = std::async(&DataLinkEngineImpl::run, this);
+        return result;
+    }
+    /// Wakes the event loop
+    void wakeUp()
+    {
+        // Only the first producer since the loop last woke needs to signal
+        if (!mWakeUpPending.exchange(true, std::memory_order_acq_rel))
+        {
+            uint64_t one{1};
+            [[maybe_unused]] auto nWritten = ::write(mWakeUp, &one, sizeof(one));
+        }
+    }
+    /// The event loop
+    void run()
+    {
+        SPDLOG_LOGGER_DEBUG(mLogger, "Thread entering DataLink event loop");
+        std::array<epoll_event, 64> events;
+        for (auto &connection : mConnections)
+        {
+            startConnecting(*connection, ::getNow());
+        }
+        bool moreToConvert{false};
+        while (mKeepRunning.load(std::memory_order_seq_cst))
+        {
+            auto timeOut = moreToConvert ? 0 : getEventTimeOut(::getNow());
+            auto nEvents = ::epoll_wait(mEpoll,
+                                        events.data(),
+                                        static_cast<int> (events.size()),
+                                        timeOut);
+            if (nEvents < 0)
+            {
+                if (errno == EINTR){continue;}
+                throw std::runtime_error("epoll_wait failed because "
+                                       + std::string {std::strerror(errno)});
+            }
+            auto now = ::getNow();
+            for (int i = 0; i < nEvents; ++i)
+            {
+                handleEvent(events[i], now);
+            }
+            moreToConvert = convertPackets(now);
+            handleTimers(now);
+            serviceConnections(now);
+        }
+        shutdown();
+        SPDLOG_LOGGER_INFO(mLogger, "DataLink event loop exiting");
+    }
+    /// The time in milliseconds until the next timer fires
+    [[nodiscard]] int getEventTimeOut(const std::chrono::microseconds &now) const
+    {
+        constexpr std::chrono::microseconds maximumTimeOut{1000000};
+        constexpr std::chrono::microseconds aggregatorTimeOut{50000};
+        auto timeOut = maximumTimeOut;
+        for (const auto &connection : mConnections)
+        {
+            if (connection->aggregator)
+            {
+                timeOut = std::min(timeOut, aggregatorTimeOut);
+            }
+            if (connection->state == ConnectionState::Disconnected)
+            {
+                timeOut = std::min(timeOut,
+                                   connection->nextReconnectAttempt - now);
+            }
+            else if (connection->state != ConnectionState::Ready)
+            {
+                timeOut = std::min(timeOut, connection->deadline - now);
+            }
+            else
+            {
+                if (connection->endpointIndex > 0)
+                {
+                    timeOut = std::min(timeOut,
+                                       connection->probeFD >= 0 ?
+                                       connection->probeDeadline - now :
+                                       connection->nextFailbackProbe - now);
+                }
+                // Wake up when the rate limit lets the next record go
+                if (connection->rateLimiter.isLimited() &&
+                    connection->sendBuffer.empty() &&
+                    !connection->pending.empty())
+                {
+                    timeOut = std::min(timeOut,
+                        std::chrono::ceil<std::chrono::microseconds>
+                        (connection->rateLimiter.getWaitTime(
+                             connection->pending.front().data.size(),
+                             std::chrono::steady_clock::now())));
+                }
+            }
+        }
+        timeOut = std::max(timeOut, std::chrono::microseconds {0});
+        // Round up so we don't spin just short of the deadline
+        return static_cast<int> ((timeOut.count() + 999)/1000);
+    }
+    /// Dispatches an epoll event
+    void handleEvent(const epoll_event &event,
+                     const std::chrono::microseconds &now)
+    {
+        if (event.data.u64 == WAKE_UP_TOKEN)
+        {
+            uint64_t count{0};
+            [[maybe_unused]] auto nRead = ::read(mWakeUp, &count, sizeof(count));
+            mWakeUpPending.store(false, std::memory_order_release);
+            return;
+        }
+        if ((event.data.u64 & PROBE_BIT) != 0)
+        {
+            auto index = event.data.u64 & ~PROBE_BIT;
+            if (index < mConnections.size())
+            {
+                handleProbeEvent(*mConnections[index], now);
+            }
+            return;
+        }
+        if (event.data.u64 >= mConnections.size()){return;}
+        auto &connection = *mConnections[event.data.u64];
+        if (connection.fd < 0){return;}
+        if (connection.state == ConnectionState::Connecting)
+        {
+            if ((event.events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) == 0)
+            {
+                return;
+            }
+            int error{0};
+            socklen_t length{sizeof(error)};
+            if (::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR,
+                             &error, &length) < 0)
+            {
+                error = errno;
+            }
+            if (error != 0)
+            {
+                handleFailure(connection, now,
+                              "connect failed with "
+                            + std::string {std::strerror(error)});
+                return;
+            }
+            startIdentifying(connection, now);
+            return;
+        }
+        if ((event.events & EPOLLIN) != 0)
+        {
+            if (!readFromServer(connection, now)){return;}
+        }
+        else if ((event.events & (EPOLLERR | EPOLLHUP)) != 0)
+        {
+            handleFailure(connection, now, "socket error or hang up");
+            return;
+        }
+        if ((event.events & EPOLLOUT) != 0)
+        {
+            if (!flushSendBuffer(connection, now))
+            {
+                handleFailure(connection, now,
+                              "send failed with "
+                            + std::string {std::strerror(errno)});
+            }
+        }
+    }
+    /// Opens a non-blocking socket and begins connecting to the endpoint.
+    /// @param[out] fd      The socket.
+    /// @param[out] reason  If the connection could not be started then this
+    ///                     is the reason.
+    /// @result 0 if connected, EINPROGRESS if connecting, or an error.
+    [[nodiscard]] static int
+        openSocket(const std::pair<std::string, uint16_t> &endpoint,
+                   int *fd, std::string *reason)
+    {
+        *fd =-1;
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses{nullptr};
+        // N.B. This can block while the name is resolved
+        auto port = std::to_string(endpoint.second);
+        auto returnCode = ::getaddrinfo(endpoint.first.c_str(),
+                                        port.c_str(), &hints, &addresses);
+        if (returnCode != 0 || addresses == nullptr)
+        {
+            if (addresses){::freeaddrinfo(addresses);}
+            *reason = "could not resolve host: "
+                    + std::string {::gai_strerror(returnCode)};
+            return EHOSTUNREACH;
+        }
+        *fd = ::socket(addresses->ai_family,
+                       addresses->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       addresses->ai_protocol);
+        if (*fd < 0)
+        {
+            auto error = errno;
+            ::freeaddrinfo(addresses);
+            *reason = "could not create socket: "
+                    + std::string {std::strerror(error)};
+            return error;
+        }
+        returnCode = ::connect(*fd, addresses->ai_addr, addresses->ai_addrlen);
+        auto error = returnCode == 0 ? 0 : errno;
+        ::freeaddrinfo(addresses);
+        if (error != 0 && error != EINPROGRESS)
+        {
+            ::close(*fd);
+            *fd =-1;
+            *reason = "connect failed with "
+                    + std::string {std::strerror(error)};
+        }
+        return error;
+    }
+    /// Begins a non-blocking connection to the current endpoint
+    void startConnecting(::Connection &connection,
+                         const std::chrono::microseconds &now)
+    {
+        releaseSocket(connection);
+        const auto &endpoint = connection.endpoints.at(connection.endpointIndex);
+        connection.address = endpoint.first + ":"
+                           + std::to_string(endpoint.second);
+        SPDLOG_LOGGER_INFO(mLogger, "Connecting to DataLink server at {}",
+                           connection.address);
+        int fd{-1};
+        std::string reason;
+        auto returnCode = openSocket(endpoint, &fd, &reason);
+        if (fd < 0)
+        {
+            handleFailure(connection, now, reason);
+            return;
+        }
+        connection.fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.u64 = connection.index;
+        if (::epoll_ctl(mEpoll, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            handleFailure(connection, now,
+                          "could not watch socket: "
+                        + std::string {std::strerror(errno)});
+            return;
+        }
+        connection.watchingWrites = true;
+        if (returnCode == 0)
+        {
+            startIdentifying(connection, now);
+        }
+        else
+        {
+            connection.state = ConnectionState::Connecting;
+            connection.deadline = now + connection.options.getIOTimeOut();
+        }
+    }
+    /// Probes the endpoints ahead of the current one, starting with the
+    /// given endpoint, to see if we can fail back
+    void startProbing(::Connection &connection, const size_t firstIndex,
+                      const std::chrono::microseconds &now)
+    {
+        closeProbe(connection);
+        for (auto i = firstIndex; i < connection.endpointIndex; ++i)
+        {
+            int fd{-1};
+            std::string reason;
+            auto returnCode = openSocket(connection.endpoints[i], &fd, &reason);
+            if (fd < 0){continue;}
+            if (returnCode == 0)
+            {
+                ::close(fd);
+                failBack(connection, i, now);
+                return;
+            }
+            epoll_event event{};
+            event.events = EPOLLOUT;
+            event.data.u64 = connection.index | PROBE_BIT;
+            if (::epoll_ctl(mEpoll, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                ::close(fd);
+                continue;
+            }
+            connection.probeFD = fd;
+            connection.probeIndex = i;
+            constexpr std::chrono::milliseconds maximumProbeTimeOut{1000};
+            connection.probeDeadline
+                = now + std::min(maximumProbeTimeOut,
+                                 connection.options.getIOTimeOut());
+            return;
+        }
+        // Nothing better is available - try again later
+        connection.nextFailbackProbe
+            = now + connection.options.getFailbackProbeInterval();
+    }
+    /// The probe either connected or failed
+    void handleProbeEvent(::Connection &connection,
+                          const std::chrono::microseconds &now)
+    {
+        if (connection.probeFD < 0){return;}
+        int error{0};
+        socklen_t length{sizeof(error)};
+        if (::getsockopt(connection.probeFD, SOL_SOCKET, SO_ERROR,
+                         &error, &length) < 0)
+        {
+            error = errno;
+        }
+        auto probeIndex = connection.probeIndex;
+        closeProbe(connection);
+        if (error == 0)
+        {
+            failBack(connection, probeIndex, now);
+        }
+        else
+        {
+            startProbing(connection, probeIndex + 1, now);
+        }
+    }
+    /// Closes the failback probe
+    void closeProbe(::Connection &connection)
+    {
+        if (connection.probeFD >= 0)
+        {
+            ::epoll_ctl(mEpoll, EPOLL_CTL_DEL, connection.probeFD, nullptr);
+            ::close(connection.probeFD);
+            connection.probeFD =-1;
+        }
+    }
+    /// Moves back to a more preferred endpoint.  Anything not yet sent
+    /// stays queued for the new connection.
+    void failBack(::Connection &connection, const size_t endpointIndex,
+                  const std::chrono::microseconds &now)
+    {
+        const auto &endpoint = connection.endpoints.at(endpointIndex);
+        SPDLOG_LOGGER_INFO(mLogger,
+                           "DataLink server at {}:{} is healthy; failing back from {}",
+                           endpoint.first, endpoint.second,
+                           connection.address);
+        connection.endpointIndex = endpointIndex;
+        startConnecting(connection, now);
+    }
+    /// Sends our ID.  The server responds with its capabilities.
+    void startIdentifying(::Connection &connection,
+                          const std::chrono::microseconds &now)
+    {
+        connection.state = ConnectionState::Identifying;
+        connection.deadline = now + connection.options.getIOTimeOut();
+        connection.lastProgress = now;
+        connection.sendBuffer.clear();
+        connection.bytesSent = 0;
+        auto header = ::toClientIdentifier(connection.options.getName());
+        if (header.size() > 255){header.resize(255);}
+        ::appendFrame(header, nullptr, 0, &connection.sendBuffer);
+        if (!flushSendBuffer(connection, now))
+        {
+            handleFailure(connection, now,
+                          "send failed with "
+                        + std::string {std::strerror(errno)});
+        }
+    }
+    /// Reads and parses the server's responses.
+    /// @result False indicates the connection failed.
+    [[nodiscard]] bool readFromServer(::Connection &connection,
+                                      const std::chrono::microseconds &now)
+    {
+        while (true)
+        {
+            auto nRead = ::recv(connection.fd,
+                                mReceiveBuffer.data(), mReceiveBuffer.size(),
+                                MSG_DONTWAIT);
+            if (nRead > 0)
+            {
+                connection.receiveBuffer.append(mReceiveBuffer.data(),
+                                                static_cast<size_t> (nRead));
+                continue;
+            }
+            if (nRead == 0)
+            {
+                handleFailure(connection, now, "server closed the connection");
+                return false;
+            }
+            if (errno == EINTR){continue;}
+            if (errno == EAGAIN || errno == EWOULDBLOCK){break;}
+            handleFailure(connection, now,
+                          "receive failed with "
+                        + std::string {std::strerror(errno)});
+            return false;
+        }
+        auto &buffer = connection.receiveBuffer;
+        size_t offset{0};
+        while (buffer.size() - offset >= 3)
+        {
+            if (buffer[offset] != 'D' || buffer[offset + 1] != 'L')
+            {
+                handleFailure(connection, now, "received malformed packet");
+                return false;
+            }
+            auto headerLength
+                = static_cast<size_t> (static_cast<uint8_t> (buffer[offset + 2]));
+            if (buffer.size() - offset < 3 + headerLength){break;}
+            std::string_view header{buffer.data() + offset + 3, headerLength};
+            size_t messageSize{0};
+            if (header.starts_with("OK") || header.starts_with("ERROR"))
+            {
+                messageSize = ::getMessageSize(header);
+            }
+            if (buffer.size() - offset < 3 + headerLength + messageSize){break;}
+            std::string_view message{buffer.data() + offset + 3 + headerLength,
+                                     messageSize};
+            if (header.starts_with("ID"))
+            {
+                if (connection.state == ConnectionState::Identifying)
+                {
+                    if (header.find("WRITE") == std::string_view::npos)
+                    {
+                        handleFailure(connection, now,
+                                      "server did not grant write permission");
+                        return false;
+                    }
+                    connection.serverPacketSize = ::getServerPacketSize(header);
+                    // Size subsequent records to what this server accepts
+                    connection.recordLengths.setServerPacketSize(
+                        connection.serverPacketSize);
+                    handleReady(connection, now);
+                }
+            }
+            else if (header.starts_with("ERROR"))
+            {
+                // The record was counted as written when the socket took it
+                connection.metrics->incrementServerErrorsCounter();
+                SPDLOG_LOGGER_WARN(mLogger,
+                                   "DataLink server at {} responded with error: {}",
+                                   connection.address, std::string {message});
+            }
+            else if (!header.starts_with("OK"))
+            {
+                SPDLOG_LOGGER_DEBUG(mLogger,
+                                    "Ignoring unexpected DataLink packet: {}",
+                                    std::string {header});
+            }
+            offset = offset + 3 + headerLength + messageSize;
+        }
+        buffer.erase(0, offset);
+        return true;
+    }
+    /// The server accepted our ID so we can begin writing
+    void handleReady(::Connection &connection,
+                     const std::chrono::microseconds &now)
+    {
+        connection.state = ConnectionState::Ready;
+        connection.lastProgress = now;
+        if (connection.outageStart.count() > 0)
+        {
+            auto outageDuration = now - connection.outageStart;
+            SPDLOG_LOGGER_INFO(mLogger,
+                "Reconnected to {} after {} seconds; {} held records will be written",
+                connection.address,
+                std::chrono::duration_cast<std::chrono::seconds>
+                    (outageDuration).count(),
+                connection.pending.size());
+            connection.metrics->endOutage(outageDuration);
+            connection.outageStart = std::chrono::microseconds {0};
+        }
+        else
+        {
+            SPDLOG_LOGGER_DEBUG(mLogger, "Connected to DataLink server at {}",
+                                connection.address);
+        }
+        connection.reconnectDelay = connection.options.getInitialReconnectDelay();
+        connection.nextFailbackProbe
+            = now + connection.options.getFailbackProbeInterval();
+    }
+    /// Closes the socket.  Anything not fully sent is put back on the
+    /// pending queue.
+    void releaseSocket(::Connection &connection)
+    {
+        closeProbe(connection);
+        if (connection.fd >= 0)
+        {
+            ::epoll_ctl(mEpoll, EPOLL_CTL_DEL, connection.fd, nullptr);
+            ::close(connection.fd);
+            connection.fd =-1;
+        }
+        while (!connection.inFlight.empty())
+        {
+            connection.pending.push_front(
+                std::move(connection.inFlight.back()));
+            connection.inFlight.pop_back();
+            connection.metrics->addToHoldoverSize(1);
+        }
+        connection.sendBuffer.clear();
+        connection.receiveBuffer.clear();
+        connection.bytesSent = 0;
+        connection.watchingWrites = false;
+        connection.state = ConnectionState::Disconnected;
+    }
+    /// Tears down a failed connection and fails over to the next endpoint.
+    /// Once every endpoint has been tried the next attempt is scheduled
+    /// with exponential backoff and jitter.
+    void handleFailure(::Connection &connection,
+                       const std::chrono::microseconds &now,
+                       const std::string &reason)
+    {
+        releaseSocket(connection);
+        connection.endpointIndex
+            = (connection.endpointIndex + 1)%connection.endpoints.size();
+        auto wrapped = connection.endpointIndex == 0;
+        if (connection.outageStart.count() == 0)
+        {
+            SPDLOG_LOGGER_WARN(mLogger,
+                               "Connection to DataLink server at {} lost: {}",
+                               connection.address, reason);
+            connection.outageStart = now;
+            connection.nextReconnectAttempt = now;
+            connection.reconnectDelay
+                = connection.options.getInitialReconnectDelay();
+            connection.metrics->beginOutage();
+            return;
+        }
+        if (!wrapped)
+        {
+            SPDLOG_LOGGER_INFO(mLogger,
+                               "Failed to connect to {} because {}; failing over",
+                               connection.address, reason);
+            connection.nextReconnectAttempt = now;
+            return;
+        }
+        std::uniform_real_distribution<double>
+            jitter(-connection.options.getReconnectJitter(),
+                    connection.options.getReconnectJitter());
+        std::chrono::microseconds delay
+        {
+            static_cast<int64_t>
+            (
+               std::chrono::duration_cast<std::chrono::microseconds>
+                  (connection.reconnectDelay).count()
+              *(1 + jitter(mRandomNumberGenerator))
+            )
+        };
+        connection.nextReconnectAttempt = now + delay;
+        constexpr std::chrono::milliseconds minimumGrowth{100};
+        connection.reconnectDelay
+            = std::min(std::max(2*connection.reconnectDelay, minimumGrowth),
+                       connection.options.getMaximumReconnectDelay());
+        SPDLOG_LOGGER_INFO(mLogger,
+                           "Failed to connect to {} because {}; will retry in {} seconds",
+                           connection.address, reason, delay.count()*1.e-6);
+    }
+    /// Watches (or stops watching) for the socket to become writable
+    void watchWrites(::Connection &connection, const bool watch)
+    {
+        if (connection.fd < 0 || connection.watchingWrites == watch){return;}
+        epoll_event event{};
+        event.events = watch ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u64 = connection.index;
+        if (::epoll_ctl(mEpoll, EPOLL_CTL_MOD, connection.fd, &event) == 0)
+        {
+            connection.watchingWrites = watch;
+        }
+    }
+    /// Copies pending records into the send buffer as WRITE packets
+    void fillSendBuffer(::Connection &connection)
+    {
+        auto steadyNow = std::chrono::steady_clock::now();
+        auto popPending = [&connection]()
+        {
+            connection.pending.pop_front();
+            connection.metrics->addToHoldoverSize(-1);
+        };
+        while (!connection.pending.empty() &&
+               connection.sendBuffer.size() < MAXIMUM_SEND_BUFFER_SIZE)
+        {
+            // Discard what can't be framed before spending rate limit tokens
+            auto &record = connection.pending.front();
+            if (record.data.empty() || record.streamIdentifier == nullptr)
+            {
+                RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+                                   "Skipping empty or unidentified record");
+                popPending();
+                continue;
+            }
+            if (static_cast<int> (record.data.size()) >
+                connection.serverPacketSize)
+            {
+                connection.metrics->incrementFailedPacketsSentCounter();
+                RATE_LIMITED_LOGGER_WARN(mLogger, *record.streamIdentifier,
+                   "Skipping {} byte record for {}; server at {} accepts {} bytes",
+                   record.data.size(), *record.streamIdentifier,
+                   connection.address, connection.serverPacketSize);
+                popPending();
+                continue;
+            }
+            // N.B. These are microseconds and we don't request an
+            // acknowledgement
+            mHeader = "WRITE ";
+            mHeader.append(*record.streamIdentifier);
+            mHeader.append(" ");
+            mHeader.append(std::to_string(record.startTime.count()));
+            mHeader.append(" ");
+            mHeader.append(std::to_string(record.endTime.count()));
+            mHeader.append(" N ");
+            mHeader.append(std::to_string(record.data.size()));
+            if (mHeader.size() > 255)
+            {
+                connection.metrics->incrementFailedPacketsSentCounter();
+                RATE_LIMITED_LOGGER_WARN(mLogger, *record.streamIdentifier,
+                                   "Skipping record with oversized header for {}",
+                                   *record.streamIdentifier);
+                popPending();
+                continue;
+            }
+            if (!connection.rateLimiter.tryAcquire(record.data.size(),
+                                                   steadyNow))
+            {
+                break;
+            }
+            ::appendFrame(mHeader,
+                          record.data.data(), record.data.size(),
+                          &connection.sendBuffer);
+            connection.inFlight.push_back(std::move(record),
+                                          connection.sendBuffer.size(),
+                                          steadyNow);
+            popPending();
+        }
+        connection.metrics->setQueueDepth(
+            static_cast<int64_t> (connection.pending.size()));
+    }
+    /// Writes as much of the send buffer as the socket will take and
+    /// refills it while the socket keeps up.
+    /// @result False indicates the send failed.
+    [[nodiscard]] bool flushSendBuffer(::Connection &connection,
+                                       const std::chrono::microseconds &now)
+    {
+        if (connection.fd < 0){return true;}
+        while (true)
+        {
+            if (connection.bytesSent == connection.sendBuffer.size())
+            {
+                connection.sendBuffer.clear();
+                connection.bytesSent = 0;
+                if (connection.state == ConnectionState::Ready)
+                {
+                    fillSendBuffer(connection);
+                }
+                if (connection.sendBuffer.empty())
+                {
+                    watchWrites(connection, false);
+                    return true;
+                }
+            }
+            auto nSent = ::send(connection.fd,
+                                connection.sendBuffer.data()
+                              + connection.bytesSent,
+                                connection.sendBuffer.size()
+                              - connection.bytesSent,
+                                MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (nSent < 0)
+            {
+                if (errno == EINTR){continue;}
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    watchWrites(connection, true);
+                    return true;
+                }
+                return false;
+            }
+            connection.bytesSent = connection.bytesSent
+                                 + static_cast<size_t> (nSent);
+            connection.lastProgress = now;
+            // Release the records that made it to the socket.  The latency
+            // is the time the record waited in the send buffer.
+            auto writtenTime = std::chrono::steady_clock::now();
+            connection.inFlight.release(
+                connection.bytesSent,
+                writtenTime,
+                [&](DataLinkPacket &record,
+                    const std::chrono::microseconds &latency)
+                {
+                    connection.metrics->incrementPacketsWrittenCounter();
+                    connection.metrics->recordWriteLatency(latency);
+                    record.timestamps.written = writtenTime;
+                    connection.metrics->recordPipelineTimestamps(
+                        record.timestamps);
+                });
+        }
+    }
+    /// Holds a record until it can be written
+    void addToPending(::Connection &connection, DataLinkPacket &&record)
+    {
+        if (static_cast<int> (connection.pending.size()) >=
+            connection.options.getMaximumHoldoverSize())
+        {
+            connection.pending.pop_front();
+            connection.metrics->addToHoldoverSize(-1);
+            connection.metrics->incrementHoldoverRecordsDroppedCounter();
+        }
+        connection.pending.push_back(std::move(record));
+        connection.metrics->addToHoldoverSize(1);
+        connection.metrics->setQueueDepth(
+            static_cast<int64_t> (connection.pending.size()));
+    }
+    /// Moves the converted records onto the connection's pending queue
+    void addToPending(::Connection &connection,
+                      std::vector<DataLinkPacket> &records)
+    {
+        for (auto &record : records)
+        {
+            addToPending(connection, std::move(record));
+        }
+        records.clear();
+    }
+    /// Converts queued packets to records for every connection.
+    /// @result True indicates there are likely more packets to convert.
+    [[nodiscard]] bool convertPackets(const std::chrono::microseconds &now)
+    {
+        Packet packet;
+        for (int i = 0; i < MAXIMUM_PACKETS_PER_ITERATION; ++i)
+        {
+#ifdef USE_TBB
+            if (!mQueue.try_pop(packet)){return false;}
+#else
+            if (!mQueue->try_dequeue(packet)){return false;}
+#endif
+            const auto residency
+                = std::chrono::duration_cast<std::chrono::microseconds>
+                  (std::chrono::steady_clock::now() - packet.getEnqueueTime());
+            const auto &dataLinkIdentifier = getDataLinkIdentifier(packet);
+            for (auto &connection : mConnections)
+            {
+                connection->metrics->recordQueueResidency(residency);
+                mRecords.clear();
+                try
+                {
+                    if (connection->aggregator)
+                    {
+                        connection->aggregator->add(packet, now, &mRecords);
+                    }
+                    else
+                    {
+                        auto recordLength
+                            = connection->recordLengths.getRecordLength(
+                                 packet.getStreamIdentifierReference()
+                                       .getStringReference());
+                        toDataLinkPackets(packet,
+                                          recordLength,
+                                          connection->options.writeMiniSEED3(),
+                                          mCompression,
+                                          connection->options.flushPackets(),
+                                          mLogger,
+                                          dataLinkIdentifier,
+                                          connection->recordLengths
+                                                     .getPool(recordLength),
+                                          &mRecords);
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    connection->metrics->incrementInvalidPacketsCounter();
+                    RATE_LIMITED_LOGGER_WARN(mLogger, *dataLinkIdentifier,
+                                       "Failed to convert packet to mseed because {}",
+                                       std::string {e.what()});
+                }
+                addToPending(*connection, mRecords);
+            }
+        }
+        return true;
+    }
+    /// Handles reconnects, time-outs, and aggregation latency
+    void handleTimers(const std::chrono::microseconds &now)
+    {
+        for (auto &connectionPointer : mConnections)
+        {
+            auto &connection = *connectionPointer;
+            if (connection.aggregator)
+            {
+                mRecords.clear();
+                try
+                {
+                    connection.aggregator->flushExpired(now, &mRecords);
+                }
+                catch (const std::exception &e)
+                {
+                    SPDLOG_LOGGER_WARN(mLogger,
+                                       "Failed to flush aggregated records because {}",
+                                       std::string {e.what()});
+                }
+                addToPending(connection, mRecords);
+            }
+            if (connection.state == ConnectionState::Disconnected)
+            {
+                if (now >= connection.nextReconnectAttempt)
+                {
+                    connection.metrics->incrementReconnectAttemptsCounter();
+                    startConnecting(connection, now);
+                }
+            }
+            else if (connection.state == ConnectionState::Ready)
+            {
+                if (!connection.sendBuffer.empty() &&
+                    now > connection.lastProgress
+                        + connection.options.getIOTimeOut())
+                {
+                    handleFailure(connection, now, "writes timed out");
+                }
+                else if (connection.endpointIndex > 0)
+                {
+                    if (connection.probeFD >= 0)
+                    {
+                        if (now > connection.probeDeadline)
+                        {
+                            startProbing(connection,
+                                         connection.probeIndex + 1, now);
+                        }
+                    }
+                    else if (now >= connection.nextFailbackProbe)
+                    {
+                        startProbing(connection, 0, now);
+                    }
+                }
+            }
+            else if (now > connection.deadline)
+            {
+                handleFailure(connection, now, "connection timed out");
+            }
+        }
+    }
+    /// Starts writing on any idle connection with pending records
+    void serviceConnections(const std::chrono::microseconds &now)
+    {
+        for (auto &connectionPointer : mConnections)
+        {
+            auto &connection = *connectionPointer;
+            if (connection.state != ConnectionState::Ready ||
+                connection.pending.empty() ||
+                !connection.sendBuffer.empty())
+            {
+                continue;
+            }
+            if (!flushSendBuffer(connection, now))
+            {
+                handleFailure(connection, now,
+                              "send failed with "
+                            + std::string {std::strerror(errno)});
+            }
+        }
+    }
+    /// Flushes the aggregators and gives the connections a moment to drain
+    /// before exiting
+    void shutdown()
+    {
+        auto now = ::getNow();
+        for (auto &connection : mConnections)
+        {
+            if (connection->aggregator)
+            {
+                mRecords.clear();
+                try
+                {
+                    connection->aggregator->flush(&mRecords);
+                }
+                catch (const std::exception &e)
+                {
+                    SPDLOG_LOGGER_WARN(mLogger,
+                                       "Failed to flush aggregated records because {}",
+                                       std::string {e.what()});
+                }
+                addToPending(*connection, mRecords);
+            }
+        }
+        constexpr std::chrono::seconds gracePeriod{1};
+        auto deadline = now + gracePeriod;
+        std::array<epoll_event, 64> events;
+        while (now < deadline)
+        {
+            serviceConnections(now);
+            bool busy{false};
+            for (const auto &connection : mConnections)
+            {
+                if (connection->state == ConnectionState::Ready &&
+                    (!connection->pending.empty() ||
+                     !connection->sendBuffer.empty()))
+                {
+                    busy = true;
+                }
+            }
+            if (!busy){break;}
+            auto timeOut = std::chrono::duration_cast<std::chrono::milliseconds>
+                           (deadline - now).count();
+            auto nEvents = ::epoll_wait(mEpoll,
+                                        events.data(),
+                                        static_cast<int> (events.size()),
+                                        static_cast<int> (timeOut) + 1);
+            now = ::getNow();
+            for (int i = 0; i < std::max(0, nEvents); ++i)
+            {
+                handleEvent(events[i], now);
+            }
+        }
+        for (auto &connection : mConnections)
+        {
+            releaseSocket(*connection);
+            if (!connection->pending.empty())
+            {
+                auto nDiscarded = static_cast<int64_t> (connection->pending.size());
+                SPDLOG_LOGGER_WARN(mLogger,
+                                   "Discarding {} held records for {} on exit",
+                                   nDiscarded, connection->address);
+                connection->metrics->incrementHoldoverRecordsDroppedCounter(nDiscarded);
+                connection->metrics->addToHoldoverSize(-nDiscarded);
+                connection->pending.clear();
+            }
+            if (connection->outageStart.count() > 0)
+            {
+                connection->metrics->endOutage(now - connection->outageStart);
+                connection->outageStart = std::chrono::microseconds {0};
+            }
+        }
+    }
+    /// Caches the DataLink stream identifiers so they need not be rebuilt
+    /// for every packet
+    [[nodiscard]] const std::shared_ptr<const std::string> &
+        getDataLinkIdentifier(const Packet &packet)
+    {
+        const auto &streamIdentifier = packet.getStreamIdentifierReference();
+        auto key = streamIdentifier.getStringReference();
+        auto index = mDataLinkIdentifiers.find(key);
+        if (index == mDataLinkIdentifiers.end())
+        {
+            auto dataLinkIdentifier
+                = std::make_shared<const std::string>
+                  (toDataLinkIdentifier(streamIdentifier));
+            index = mDataLinkIdentifiers.emplace(std::string {key},
+                                                 std::move(dataLinkIdentifier))
+                    .first;
+        }
+        return index->second;
+    }
+    /// Enqueues the packet
+    void enqueue(Packet &&packet)
+    {
+#ifdef USE_TBB
+        auto approximateQueueSize = mQueue.size();
+#else
+        auto approximateQueueSize = mQueue->size_approx();
+#endif
+        if (approximateQueueSize >= mMaximumInternalQueueSize)
+        {
+            RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+                "SEEDLink thread popping elements from export queue");
+#ifdef USE_TBB
+            while (mQueue.size() >= mMaximumInternalQueueSize)
+#else
+            while (mQueue->size_approx() >= mMaximumInternalQueueSize)
+#endif
+            {
+                for (auto &connection : mConnections)
+                {
+                    connection->metrics->incrementFailedPacketsFailedToEnqueueCounter();
+                }
+                Packet workSpace;
+#ifdef USE_TBB
+                if (!mQueue.try_pop(workSpace))
+#else
+                if (!mQueue->try_dequeue(workSpace))
+#endif
+                {
+                    SPDLOG_LOGGER_ERROR(mLogger,
+                       "Failed to dequeue packet in overfull queue");
+                    break;
+                }
+            }
+        }
+        packet.setEnqueueTime(std::chrono::steady_clock::now());
+#ifdef USE_TBB
+        if (!mQueue.try_push(std::move(packet)))
+#else
+        if (!mQueue->try_enqueue(std::move(packet)))
+#endif
+        {
+            for (auto &connection : mConnections)
+            {
+                connection->metrics->incrementFailedPacketsFailedToEnqueueCounter();
+            }
+            RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+               "Failed to add packet to export queue - queue may be full");
+            return;
+        }
+        wakeUp();
+    }
+//private:
+    std::shared_ptr<spdlog::logger> mLogger{nullptr};
+#ifdef USE_TBB
+    oneapi::tbb::concurrent_bounded_queue<Packet> mQueue;
+#else
+    std::unique_ptr<moodycamel::ConcurrentQueue<Packet>> mQueue{nullptr};
+#endif
+    std::vector<std::unique_ptr<::Connection>> mConnections;
+    std::vector<DataLinkPacket> mRecords;
+    std::map<std::string, std::shared_ptr<const std::string>, std::less<>>
+        mDataLinkIdentifiers;
+    std::array<char, 4096> mReceiveBuffer;
+    std::string mHeader;
+    std::mt19937 mRandomNumberGenerator{std::random_device {}()};
+    int mEpoll{-1};
+    int mWakeUp{-1};
+    int mMaximumInternalQueueSize{8192};
+    std::atomic<bool> mWakeUpPending{false};
+    std::atomic<bool> mKeepRunning{true};
+    Compression mCompression{Compression::None};
+};
+
+/// Constructor
+DataLinkEngine::DataLinkEngine(
+    const std::vector<DataLinkClientOptions> &options,
+    std::shared_ptr<spdlog::logger> logger) :
+    pImpl(std::make_unique<DataLinkEngineImpl> (options, logger))
+{
+}
+
+/// Destructor
+DataLinkEngine::~DataLinkEngine() = default;
+
+/// Start the event loop
+std::future<void> DataLinkEngine::start()
+{
+    return pImpl->start();
+}
+
+/// Allow a thread to enqueue a packet
+void DataLinkEngine::enqueue(Packet &&packet)
+{
+    pImpl->enqueue(std::move(packet));
+}
+
+void DataLinkEngine::enqueue(const Packet &packet)
+{
+    auto copy = packet;
+    enqueue(std::move(copy));
+}
+
+/// Number of connections
+int DataLinkEngine::getNumberOfConnections() const noexcept
+{
+    return static_cast<int> (pImpl->mConnections.size());
+}
+
+/// Stop the event loop
+void DataLinkEngine::stop()
+{
+    pImpl->stop();
+}
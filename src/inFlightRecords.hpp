@@ -0,0 +1,84 @@
+#ifndef IN_FLIGHT_RECORDS_HPP
+#define IN_FLIGHT_RECORDS_HPP
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include "uSEEDLinkToRingServer/packet.hpp"
+
+namespace
+{
+
+/// @brief The records copied to a connection's send buffer that have not
+///        yet been fully handed to the socket.  Each record remembers the
+///        offset of the byte following it in the send buffer and when it
+///        was appended so that, as sends complete (possibly partially),
+///        the records can be released with the time each spent waiting in
+///        the send buffer.
+class InFlightRecords
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    /// @brief Adds a record that was appended to the send buffer.
+    /// @param[in] record    The record.
+    /// @param[in] end       The offset of the byte following the record in
+    ///                      the send buffer.
+    /// @param[in] appended  When the record was appended.
+    void push_back(USEEDLinkToRingServer::DataLinkPacket &&record,
+                   const size_t end,
+                   const Clock::time_point &appended)
+    {
+        mRecords.push_back(Entry {std::move(record), end, appended});
+    }
+    /// @brief Releases the records whose final byte has been sent.
+    /// @param[in] bytesSent  The number of bytes of the send buffer that
+    ///                       have been sent.
+    /// @param[in] sentTime   When the bytes were sent.
+    /// @param[in] f          Called as f(record, latency) for each released
+    ///                       record, oldest first, where latency is the
+    ///                       time from when the record was appended to
+    ///                       sentTime.
+    template<typename F>
+    void release(const size_t bytesSent,
+                 const Clock::time_point &sentTime,
+                 F &&f)
+    {
+        while (!mRecords.empty() && mRecords.front().end <= bytesSent)
+        {
+            auto &entry = mRecords.front();
+            f(entry.record,
+              std::chrono::duration_cast<std::chrono::microseconds>
+                  (sentTime - entry.appended));
+            mRecords.pop_front();
+        }
+    }
+    /// @result The newest record.
+    [[nodiscard]] USEEDLinkToRingServer::DataLinkPacket &back() noexcept
+    {
+        return mRecords.back().record;
+    }
+    /// @brief Removes the newest record.
+    void pop_back()
+    {
+        mRecords.pop_back();
+    }
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return mRecords.empty();
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return mRecords.size();
+    }
+private:
+    struct Entry
+    {
+        USEEDLinkToRingServer::DataLinkPacket record;
+        size_t end{0};
+        Clock::time_point appended;
+    };
+    std::deque<Entry> mRecords;
+};
+
+}
+#endif
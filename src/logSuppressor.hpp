@@ -0,0 +1,337 @@
+#ifndef LOG_SUPPRESSOR_HPP
+#define LOG_SUPPRESSOR_HPP
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <spdlog/spdlog.h>
+
+/// @brief The registry of every RATE_LIMITED_LOGGER_WARN call site in the
+///        process.  A call site only reports what it suppressed when the
+///        warning recurs so flush() should be called periodically, and
+///        once more before exiting, to report suppressed warnings that
+///        have since stopped.
+/// @note Unlike the call sites this spans translation units so it is not
+///       in the anonymous namespace.
+class SuppressedWarnings
+{
+public:
+    using Flush = std::function<void (const std::chrono::steady_clock::time_point &,
+                                      bool)>;
+    [[nodiscard]] static SuppressedWarnings &getInstance()
+    {
+        static SuppressedWarnings instance;
+        return instance;
+    }
+    /// @brief Registers a call site's flush function.
+    /// @result The registration to later remove.
+    [[nodiscard]] uint64_t add(Flush flush)
+    {
+        const std::scoped_lock lock{mMutex};
+        mNextRegistration = mNextRegistration + 1;
+        mFlushes.emplace(mNextRegistration, std::move(flush));
+        return mNextRegistration;
+    }
+    /// @brief Unregisters a call site.
+    void remove(const uint64_t registration)
+    {
+        const std::scoped_lock lock{mMutex};
+        mFlushes.erase(registration);
+    }
+    /// @brief Logs the number of warnings suppressed at each call site at
+    ///        least an interval ago that have yet to be reported.
+    /// @param[in] now    The current time.
+    /// @param[in] force  If true then every unreported suppressed warning
+    ///                   is reported regardless of the interval, e.g.,
+    ///                   when exiting.
+    void flush(const std::chrono::steady_clock::time_point &now
+                   = std::chrono::steady_clock::now(),
+               const bool force = false)
+    {
+        const std::scoped_lock lock{mMutex};
+        for (const auto &[registration, flush] : mFlushes){flush(now, force);}
+    }
+private:
+    SuppressedWarnings() = default;
+    std::mutex mMutex;
+    std::map<uint64_t, Flush> mFlushes;
+    uint64_t mNextRegistration{0};
+};
+
+namespace
+{
+
+/// @brief Throttles a message that may repeat at a high rate.  The first
+///        occurrence is logged.  After that at most one occurrence per
+///        interval is logged along with the number of occurrences that were
+///        suppressed in between.  Occurrences can be further keyed by, e.g.,
+///        the stream they concern.  Unkeyed checks are lock free.
+class LogSuppressor
+{
+public:
+    /// Beyond this many keys new keys share the unkeyed state.
+    static constexpr size_t MaximumNumberOfKeys{4096};
+    /// @brief Describes an occurrence that should be logged.
+    struct Emission
+    {
+        /// The occurrences suppressed since the last one was logged.
+        int64_t suppressed{0};
+        /// The time since the last occurrence was logged.
+        std::chrono::steady_clock::duration elapsed{0};
+    };
+
+    /// @param[in] interval  The minimum time between logged occurrences.
+    explicit LogSuppressor(const std::chrono::steady_clock::duration &interval
+                               = std::chrono::seconds {10}) :
+        mInterval(interval.count())
+    {
+    }
+    /// @param[in] key  Distinguishes occurrences at the same call site, e.g.,
+    ///                 the stream name.  If empty then the occurrence is
+    ///                 unkeyed.
+    /// @param[in] now  The current time.
+    /// @result The occurrence should be logged with the given summary of the
+    ///         suppressed occurrences.  If std::nullopt then the occurrence
+    ///         is suppressed.
+    [[nodiscard]] std::optional<Emission>
+        check(const std::string_view &key = {},
+              const std::chrono::steady_clock::time_point &now
+                  = std::chrono::steady_clock::now())
+    {
+        auto time = now.time_since_epoch().count();
+        if (key.empty()){return check(mUnkeyed, time);}
+        const std::scoped_lock lock{mMutex};
+        auto index = mKeyed.find(key);
+        if (index == mKeyed.end())
+        {
+            if (mKeyed.size() >= MaximumNumberOfKeys)
+            {
+                return check(mUnkeyed, time);
+            }
+            index = mKeyed.try_emplace(std::string {key}).first;
+        }
+        return check(index->second, time);
+    }
+    /// @brief Reports the occurrences that were suppressed and have not
+    ///        been summarized by a later occurrence once an interval has
+    ///        passed since the last logged occurrence.
+    /// @param[in] f      Called as f(key, emission) for each key with
+    ///                   occurrences to report.  The key is empty for
+    ///                   unkeyed occurrences.
+    /// @param[in] now    The current time.
+    /// @param[in] force  If true then report regardless of the interval.
+    template<typename F>
+    void flush(F &&f,
+               const std::chrono::steady_clock::time_point &now
+                   = std::chrono::steady_clock::now(),
+               const bool force = false)
+    {
+        auto time = now.time_since_epoch().count();
+        if (auto emission = flush(mUnkeyed, time, force))
+        {
+            f(std::string_view {}, *emission);
+        }
+        const std::scoped_lock lock{mMutex};
+        for (auto &[key, state] : mKeyed)
+        {
+            if (auto emission = flush(state, time, force))
+            {
+                f(std::string_view {key}, *emission);
+            }
+        }
+    }
+private:
+    using Rep = std::chrono::steady_clock::rep;
+    static constexpr Rep NeverLogged{std::numeric_limits<Rep>::lowest()};
+    struct State
+    {
+        std::atomic<Rep> lastLogged{NeverLogged};
+        std::atomic<int64_t> suppressed{0};
+    };
+    [[nodiscard]] std::optional<Emission> check(State &state,
+                                                const Rep now) noexcept
+    {
+        auto lastLogged = state.lastLogged.load(std::memory_order_relaxed);
+        if ((lastLogged == NeverLogged || now - lastLogged >= mInterval) &&
+            state.lastLogged.compare_exchange_strong(
+                lastLogged, now, std::memory_order_relaxed))
+        {
+            Emission emission;
+            emission.suppressed
+                = state.suppressed.exchange(0, std::memory_order_relaxed);
+            if (lastLogged != NeverLogged)
+            {
+                emission.elapsed
+                    = std::chrono::steady_clock::duration {now - lastLogged};
+            }
+            return emission;
+        }
+        state.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    [[nodiscard]] std::optional<Emission> flush(State &state,
+                                                const Rep now,
+                                                const bool force) noexcept
+    {
+        if (state.suppressed.load(std::memory_order_relaxed) == 0)
+        {
+            return std::nullopt;
+        }
+        // Restarting the interval keeps this to one summary per interval
+        auto lastLogged = state.lastLogged.load(std::memory_order_relaxed);
+        if (lastLogged == NeverLogged ||
+            (!force && now - lastLogged < mInterval) ||
+            !state.lastLogged.compare_exchange_strong(
+                lastLogged, now, std::memory_order_relaxed))
+        {
+            return std::nullopt;
+        }
+        Emission emission;
+        emission.suppressed
+            = state.suppressed.exchange(0, std::memory_order_relaxed);
+        emission.elapsed
+            = std::chrono::steady_clock::duration {now - lastLogged};
+        return emission;
+    }
+    Rep mInterval;
+    State mUnkeyed;
+    std::mutex mMutex;
+    std::map<std::string, State, std::less<>> mKeyed;
+};
+
+/// @brief A RATE_LIMITED_LOGGER_WARN call site.  This throttles the
+///        warning and registers itself with SuppressedWarnings so what it
+///        suppressed is reported even if the warning stops.  The summary
+///        names the call site and key.
+class RateLimitedWarningSite
+{
+public:
+    RateLimitedWarningSite(const char *file,
+                           const int line,
+                           const char *function) :
+        mLocation{file, line, function}
+    {
+        std::string_view fileName{file};
+        auto slash = fileName.find_last_of("/\\");
+        if (slash != std::string_view::npos)
+        {
+            fileName.remove_prefix(slash + 1);
+        }
+        mName = std::string {fileName} + ":" + std::to_string(line);
+        mRegistration = SuppressedWarnings::getInstance().add(
+            [this](const std::chrono::steady_clock::time_point &now,
+                   const bool force)
+            {
+                flush(now, force);
+            });
+    }
+    ~RateLimitedWarningSite()
+    {
+        SuppressedWarnings::getInstance().remove(mRegistration);
+    }
+    /// @result The warning should be logged with the given summary of
+    ///         the suppressed warnings.  If std::nullopt then the warning
+    ///         is suppressed.
+    [[nodiscard]] std::optional<::LogSuppressor::Emission>
+        check(const std::shared_ptr<spdlog::logger> &logger,
+              const std::string_view &key)
+    {
+        auto emission = mSuppressor.check(key);
+        if (emission)
+        {
+            // Remember where to report what is suppressed from here on
+            const std::scoped_lock lock{mMutex};
+            if (mLogger != logger){mLogger = logger;}
+        }
+        return emission;
+    }
+    /// @brief Logs the number of suppressed warnings, if any.
+    void logSuppressed(spdlog::logger &logger,
+                       const std::string_view &key,
+                       const ::LogSuppressor::Emission &emission)
+    {
+        if (emission.suppressed <= 0){return;}
+        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>
+                       (emission.elapsed).count();
+        if (key.empty())
+        {
+            logger.log(mLocation, spdlog::level::warn,
+                       "Suppressed {} similar messages from {} in {} s",
+                       emission.suppressed, mName, elapsed);
+        }
+        else
+        {
+            logger.log(mLocation, spdlog::level::warn,
+                       "Suppressed {} similar messages from {} for {} in {} s",
+                       emission.suppressed, mName, key, elapsed);
+        }
+    }
+    RateLimitedWarningSite(const RateLimitedWarningSite &) = delete;
+    RateLimitedWarningSite& operator=(const RateLimitedWarningSite &) = delete;
+private:
+    void flush(const std::chrono::steady_clock::time_point &now,
+               const bool force)
+    {
+        std::shared_ptr<spdlog::logger> logger;
+        {
+            const std::scoped_lock lock{mMutex};
+            logger = mLogger;
+        }
+        if (logger == nullptr || !logger->should_log(spdlog::level::warn))
+        {
+            return;
+        }
+        mSuppressor.flush(
+            [&](const std::string_view &key,
+                const ::LogSuppressor::Emission &emission)
+            {
+                logSuppressed(*logger, key, emission);
+            },
+            now,
+            force);
+    }
+    ::LogSuppressor mSuppressor;
+    spdlog::source_loc mLocation;
+    std::string mName;
+    std::mutex mMutex;
+    std::shared_ptr<spdlog::logger> mLogger{nullptr};
+    uint64_t mRegistration{0};
+};
+
+}
+
+/// @brief Logs a warning that may repeat at a high rate.  Each call site
+///        logs at most one warning per 10 s per key and reports how many
+///        were suppressed, either when the warning recurs or when
+///        SuppressedWarnings::flush() is called.  The arguments are only
+///        formatted when the warning is logged.
+/// @param[in] logger  The spdlog logger.
+/// @param[in] key     Distinguishes warnings at this call site, e.g., the
+///                    stream name.  Use an empty string_view for none.
+#define RATE_LIMITED_LOGGER_WARN(logger, key, ...) \
+    do \
+    { \
+        static ::RateLimitedWarningSite rateLimitedWarningSite_ \
+            {__FILE__, __LINE__, SPDLOG_FUNCTION}; \
+        if ((logger)->should_log(spdlog::level::warn)) \
+        { \
+            auto &&rateLimitedKey_ = (key); \
+            if (auto emission_ \
+                    = rateLimitedWarningSite_.check(logger, rateLimitedKey_)) \
+            { \
+                SPDLOG_LOGGER_WARN(logger, __VA_ARGS__); \
+                rateLimitedWarningSite_.logSuppressed(*(logger), \
+                                                      rateLimitedKey_, \
+                                                      *emission_); \
+            } \
+        } \
+    } while (false)
+
+#endif
@@ -6,6 +6,8 @@
 #endif
 #include <filesystem>
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/async_logger.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <opentelemetry/exporters/otlp/otlp_http_exporter_options.h>
 #include <opentelemetry/exporters/otlp/otlp_http_exporter_factory.h>
@@ -17,13 +19,36 @@
 #endif
 #include <opentelemetry/logs/provider.h>
 #include <opentelemetry/sdk/logs/logger_provider_factory.h>
-#include <opentelemetry/sdk/logs/simple_log_record_processor_factory.h>
+#include <opentelemetry/sdk/logs/batch_log_record_processor_factory.h>
+#include <opentelemetry/sdk/logs/batch_log_record_processor_options.h>
 #include "otelSpdlogSink.hpp"
 
 namespace
 {
 
 std::shared_ptr<opentelemetry::sdk::logs::LoggerProvider> loggerProvider{nullptr};
+std::shared_ptr<spdlog::details::thread_pool> loggerThreadPool{nullptr};
+
+/// @brief Creates a logger whose sinks run on a background thread.  The
+///        calling thread only formats and enqueues the message.  When the
+///        queue is full the oldest message is dropped so logging never
+///        blocks the data path.
+[[nodiscard]] std::shared_ptr<spdlog::logger>
+    createAsynchronousLogger(const ::ProgramOptions &programOptions,
+                             const std::string &name,
+                             spdlog::sinks_init_list sinks)
+{
+    if (loggerThreadPool == nullptr)
+    {
+        constexpr size_t nThreads{1};
+        loggerThreadPool
+            = std::make_shared<spdlog::details::thread_pool>
+              (static_cast<size_t> (programOptions.logQueueSize), nThreads);
+    }
+    return std::make_shared<spdlog::async_logger>
+           (name, sinks, loggerThreadPool,
+            spdlog::async_overflow_policy::overrun_oldest);
+}
 
 void setVerbosityForSPDLOG(const int verbosity,
                            spdlog::logger *logger)
@@ -40,6 +65,24 @@ void setVerbosityForSPDLOG(const int verbosity,
     if (verbosity >= 4){logger->set_level(spdlog::level::debug);}
 }
 
+/// @brief Creates a processor that queues the log records and exports them
+///        in batches from a background thread.  When the queue is full the
+///        record is dropped so logging never blocks the calling thread.
+[[nodiscard]] std::unique_ptr<opentelemetry::sdk::logs::LogRecordProcessor>
+    createBatchLogRecordProcessor(
+        std::unique_ptr<opentelemetry::sdk::logs::LogRecordExporter> &&exporter,
+        const ::OTelBatchLogOptions &batchOptions)
+{
+    opentelemetry::sdk::logs::BatchLogRecordProcessorOptions processorOptions;
+    processorOptions.max_queue_size
+        = static_cast<size_t> (batchOptions.maximumQueueSize);
+    processorOptions.max_export_batch_size
+        = static_cast<size_t> (batchOptions.maximumExportBatchSize);
+    processorOptions.schedule_delay_millis = batchOptions.exportInterval;
+    return opentelemetry::sdk::logs::BatchLogRecordProcessorFactory::Create(
+              std::move(exporter), processorOptions);
+}
+
 std::shared_ptr<spdlog::logger> 
     initializeHTTPLogger(const ::ProgramOptions &programOptions)
 {
@@ -56,8 +99,9 @@ std::shared_ptr<spdlog::logger>
         auto exporter
               = otel::exporter::otlp::OtlpHttpLogRecordExporterFactory::Create(httpOptions);
         auto processor
-            = otel::sdk::logs::SimpleLogRecordProcessorFactory::Create(
-                 std::move(exporter));
+            = ::createBatchLogRecordProcessor(
+                 std::move(exporter),
+                 programOptions.otelHTTPLogOptions.batchOptions);
         loggerProvider
             = otel::sdk::logs::LoggerProviderFactory::Create(
                 std::move(processor));
@@ -66,15 +110,14 @@ std::shared_ptr<spdlog::logger>
 
         auto otelLogger
             = std::make_shared<spdlog::sinks::opentelemetry_sink_mt> ();
-        logger
-            = std::make_shared<spdlog::logger>
-              (spdlog::logger ("OTelLogger", {otelLogger, consoleSink}));
+        logger = ::createAsynchronousLogger(programOptions,
+                                            "OTelLogger",
+                                            {otelLogger, consoleSink});
     }
     else
     {
-        logger
-            = std::make_shared<spdlog::logger>
-              (spdlog::logger ("", {consoleSink}));
+        logger = ::createAsynchronousLogger(programOptions, "",
+                                            {consoleSink});
     }
     ::setVerbosityForSPDLOG(programOptions.verbosity, &*logger);
     return logger;
@@ -103,8 +146,8 @@ std::shared_ptr<spdlog::logger>
         auto exporter
             = otel::exporter::otlp::OtlpGrpcLogRecordExporterFactory::Create(grpcOptions);
         auto processor
-            = otel::sdk::logs::SimpleLogRecordProcessorFactory::Create(
-                 std::move(exporter));
+            = ::createBatchLogRecordProcessor(
+                 std::move(exporter), otelGRPCLogOptions.batchOptions);
         loggerProvider
             = otel::sdk::logs::LoggerProviderFactory::Create(
                 std::move(processor));
@@ -114,15 +157,14 @@ std::shared_ptr<spdlog::logger>
         auto otelLogger
             = std::make_shared<spdlog::sinks::OpenTelemetrySink<std::mutex>> ();
 
-        logger
-            = std::make_shared<spdlog::logger>
-              (spdlog::logger ("OTelLogger", {otelLogger, consoleSink}));
+        logger = ::createAsynchronousLogger(programOptions,
+                                            "OTelLogger",
+                                            {otelLogger, consoleSink});
     }
     else
     {
-        logger
-            = std::make_shared<spdlog::logger>
-              (spdlog::logger ("", {consoleSink}));
+        logger = ::createAsynchronousLogger(programOptions, "",
+                                            {consoleSink});
     }
     // Verbosity
     ::setVerbosityForSPDLOG(programOptions.verbosity, &*logger);
@@ -150,6 +192,9 @@ std::shared_ptr<spdlog::logger>
 
 void cleanupLogger()
 {
+    // Releasing the thread pool writes the queued messages to the sinks
+    // and joins the logging thread
+    loggerThreadPool = nullptr;
     if (loggerProvider != nullptr)
     {
         loggerProvider->ForceFlush();
@@ -128,30 +128,6 @@ void initializeMetrics(const ::ProgramOptions &programOptions)
     }
 }
 
-/*
-void initializeMetrics(const std::string &prometheusURL)
-{
-    opentelemetry::exporter::metrics::PrometheusExporterOptions
-        prometheusOptions;
-    prometheusOptions.url = prometheusURL;
-    auto prometheusExporter
-        = opentelemetry::exporter::metrics::PrometheusExporterFactory::Create(
-              prometheusOptions);
-
-    // Initialize and set the global MeterProvider
-    auto providerInstance 
-        = opentelemetry::sdk::metrics::MeterProviderFactory::Create();
-    auto *meterProvider
-        = static_cast<opentelemetry::sdk::metrics::MeterProvider *>
-          (providerInstance.get());
-    meterProvider->AddMetricReader(std::move(prometheusExporter));
-
-    std::shared_ptr<opentelemetry::metrics::MeterProvider>
-        provider(std::move(providerInstance));
-    opentelemetry::sdk::metrics::Provider::SetMeterProvider(provider);
-}
-*/
-
 void cleanupMetrics()
 {
     if (metricsInitialized)
@@ -0,0 +1,449 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <libmseed.h>
+#include "uSEEDLinkToRingServer/miniSEEDRecordAggregator.hpp"
+#include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/pipelineTimestamps.hpp"
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
+#include "uSEEDLinkToRingServer/streamIdentifier.hpp"
+#include "packMiniSEED.hpp"
+
+using namespace USEEDLinkToRingServer;
+
+namespace
+{
+
+/// The in-progress record(s) for a single stream.
+class StreamBuffer
+{
+public:
+    StreamBuffer() = default;
+    ~StreamBuffer()
+    {
+        if (mTraceList){mstl3_free(&mTraceList, 0);}
+    }
+    /// @result True indicates there are samples waiting to be packed.
+    [[nodiscard]] bool hasBufferedSamples() const noexcept
+    {
+        return mSamplesAdded > mSamplesPacked;
+    }
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer& operator=(const StreamBuffer &) = delete;
+
+    MS3TraceList *mTraceList{nullptr};
+    std::shared_ptr<const std::string> mDataLinkIdentifier;
+    std::string mName;
+    // Cumulative number of samples added at the time each packet arrived
+    // and when it arrived.  This lets us track the arrival time of the
+    // oldest sample that has not yet been packed.
+    std::deque<std::pair<int64_t, std::chrono::microseconds>> mArrivals;
+    // The arrival time under which this stream is queued for an expiration
+    // check
+    std::chrono::microseconds mQueuedArrival{0};
+    // When the most recent packet arrived
+    std::chrono::microseconds mLastArrival{0};
+    // The pipeline timestamps of the most recently added packet.  Records
+    // are attributed to the packet whose arrival caused them to be packed.
+    PipelineTimestamps mTimestamps{};
+    std::chrono::nanoseconds mSegmentStartTime{0};
+    std::chrono::nanoseconds mNextSampleTime{0};
+    double mSamplingRate{0};
+    int64_t mSamplesAdded{0};
+    int64_t mSamplesPacked{0};
+    Packet::DataType mDataType{Packet::DataType::Unknown};
+    int mRecordLength{512};
+    int8_t mEncoding{DE_INT32};
+    bool mIsQueued{false};
+};
+
+}
+
+/// Streams that have buffered nothing for this long are forgotten
+constexpr std::chrono::microseconds IDLE_STREAM_TIME{std::chrono::minutes {10}};
+/// How often to look for idle streams
+constexpr std::chrono::microseconds
+    IDLE_STREAM_SWEEP_INTERVAL{std::chrono::minutes {1}};
+
+class MiniSEEDRecordAggregator::MiniSEEDRecordAggregatorImpl
+{
+public:
+    explicit MiniSEEDRecordAggregatorImpl(const int recordLength) :
+        mPool(recordLength),
+        mRecordLength(recordLength)
+    {
+    }
+    /// The pool whose slabs fit the record length
+    [[nodiscard]] RecordBufferPool &getPool(const int recordLength)
+    {
+        if (recordLength == mRecordLength){return mPool;}
+        auto &pool = mPools[recordLength];
+        if (pool == nullptr)
+        {
+            pool = std::make_unique<RecordBufferPool> (recordLength);
+        }
+        return *pool;
+    }
+    /// Packs the trace list.  If flush is true then all samples are packed
+    /// otherwise only full records are created.
+    void pack(StreamBuffer &stream,
+              const bool flush,
+              std::vector<DataLinkPacket> *records)
+    {
+        if (!stream.hasBufferedSamples()){return;}
+        uint32_t flags{0};
+        if (flush){flags |= MSF_FLUSHDATA;}
+        if (!mUseMiniSEED3){flags |= MSF_PACKVER2;}
+        auto nRecordsBefore = records->size();
+        int64_t packedSamples{0};
+        constexpr int8_t verbose{0};
+        // The trace list holds a single contiguous segment whose first
+        // unpacked sample is mSamplesPacked samples past the segment start
+        RecordHandlerContext context
+        {
+            records,
+            &getPool(stream.mRecordLength),
+            stream.mSegmentStartTime,
+            stream.mSamplingRate,
+            stream.mSamplesPacked,
+            mUseMiniSEED3,
+            stream.mTimestamps
+        };
+        auto nRecordsCreated = mstl3_pack(stream.mTraceList,
+                                          &msRecordHandler,
+                                          &context,
+                                          stream.mRecordLength,
+                                          stream.mEncoding,
+                                          &packedSamples,
+                                          flags,
+                                          verbose,
+                                          nullptr);
+        if (nRecordsCreated < 0)
+        {
+            throw std::runtime_error("Failed to pack miniSEED trace list for "
+                                   + *stream.mDataLinkIdentifier);
+        }
+        for (auto i = nRecordsBefore; i < records->size(); ++i)
+        {
+            records->at(i).streamIdentifier = stream.mDataLinkIdentifier;
+        }
+        stream.mSamplesPacked = stream.mSamplesPacked + packedSamples;
+        while (!stream.mArrivals.empty() &&
+               stream.mArrivals.front().first <= stream.mSamplesPacked)
+        {
+            stream.mArrivals.pop_front();
+        }
+        // Everything is packed so start over with a clean trace list
+        if (flush || !stream.hasBufferedSamples())
+        {
+            reset(stream);
+        }
+    }
+    /// Releases the stream's trace list
+    void reset(StreamBuffer &stream)
+    {
+        if (stream.mTraceList){mstl3_free(&stream.mTraceList, 0);}
+        stream.mTraceList = mstl3_init(nullptr);
+        if (stream.mTraceList == nullptr)
+        {
+            throw std::runtime_error("Failed to initialize trace list");
+        }
+        stream.mArrivals.clear();
+        stream.mSamplesAdded = 0;
+        stream.mSamplesPacked = 0;
+        // Nothing is buffered so this is a safe time to pick up a new
+        // record length
+        stream.mRecordLength = mGetRecordLength ?
+                               mGetRecordLength(stream.mName) : mRecordLength;
+        if (stream.mRecordLength < 1)
+        {
+            throw std::runtime_error("Invalid record length for "
+                                   + stream.mName);
+        }
+    }
+    /// Adds the packet
+    void add(const Packet &packet,
+             const std::chrono::microseconds &now,
+             std::vector<DataLinkPacket> *records)
+    {
+        if (!packet.hasStreamIdentifier())
+        {
+            throw std::invalid_argument("Stream identifier not set");
+        }
+        if (!packet.hasSamplingRate())
+        {
+            throw std::invalid_argument("Sampling rate not set");
+        }
+        auto nSamples = packet.getNumberOfSamples();
+        if (nSamples < 1)
+        {
+            throw std::invalid_argument("No samples in packet");
+        }
+        const auto &identifier = packet.getStreamIdentifierReference();
+        auto name = identifier.getStringReference();
+        auto index = mStreams.find(name);
+        bool isNew{index == mStreams.end()};
+        if (isNew)
+        {
+            index = mStreams.try_emplace(std::string {name}).first;
+        }
+        auto &stream = index->second;
+        if (isNew)
+        {
+            stream.mName = name;
+            stream.mDataLinkIdentifier
+                = std::make_shared<const std::string>
+                  (toDataLinkIdentifier(identifier));
+            reset(stream);
+        }
+        stream.mTimestamps = packet.getPipelineTimestampsReference();
+        // A discontinuity (gap, overlap, sampling rate change, or data type
+        // change) means the in-progress record cannot be extended.
+        auto dataType = packet.getDataType();
+        auto samplingRate = packet.getSamplingRate();
+        auto startTime = packet.getStartTime();
+        if (stream.hasBufferedSamples())
+        {
+            const std::chrono::nanoseconds tolerance
+            {
+                static_cast<int64_t> (std::round(0.5e9/samplingRate))
+            };
+            if (dataType != stream.mDataType ||
+                std::abs(samplingRate - stream.mSamplingRate) >
+                   1.e-6*stream.mSamplingRate ||
+                std::chrono::abs(startTime - stream.mNextSampleTime)
+                   > tolerance)
+            {
+                pack(stream, true, records);
+            }
+        }
+        if (!stream.hasBufferedSamples())
+        {
+            stream.mSegmentStartTime = startTime;
+        }
+        // Append the samples
+        MS3Record msRecord MS3Record_INITIALIZER;
+        ::packetToMiniSEEDRecord(packet, stream.mRecordLength, mCompression,
+                                 &msRecord);
+        constexpr int8_t splitVersion{0};
+        constexpr int8_t autoHeal{1};
+        constexpr uint32_t flags{0};
+        auto segment = mstl3_addmsr(stream.mTraceList, &msRecord,
+                                    splitVersion, autoHeal, flags, nullptr);
+        msRecord.datasamples = nullptr;
+        if (segment == nullptr)
+        {
+            throw std::runtime_error("Failed to add packet to trace list for "
+                                   + *stream.mDataLinkIdentifier);
+        }
+        stream.mEncoding = msRecord.encoding;
+        stream.mDataType = dataType;
+        stream.mSamplingRate = samplingRate;
+        const std::chrono::nanoseconds duration
+        {
+            static_cast<int64_t> (std::round(nSamples*(1.e9/samplingRate)))
+        };
+        stream.mNextSampleTime = startTime + duration;
+        stream.mSamplesAdded = stream.mSamplesAdded + nSamples;
+        stream.mArrivals.push_back(std::pair {stream.mSamplesAdded, now});
+        stream.mLastArrival = now;
+        updateDeadline(stream);
+        // Emit any full records
+        pack(stream, false, records);
+        updateDeadline(stream);
+    }
+    /// Queues the stream by the arrival time of its oldest unpacked sample
+    /// so that only streams which may have expired need to be visited
+    void updateDeadline(StreamBuffer &stream)
+    {
+        if (stream.mArrivals.empty())
+        {
+            if (stream.mIsQueued)
+            {
+                mDeadlines.erase(std::pair {stream.mQueuedArrival, &stream});
+                stream.mIsQueued = false;
+            }
+            return;
+        }
+        auto oldestArrival = stream.mArrivals.front().second;
+        if (stream.mIsQueued)
+        {
+            if (oldestArrival == stream.mQueuedArrival){return;}
+            mDeadlines.erase(std::pair {stream.mQueuedArrival, &stream});
+        }
+        mDeadlines.insert(std::pair {oldestArrival, &stream});
+        stream.mQueuedArrival = oldestArrival;
+        stream.mIsQueued = true;
+    }
+    /// Flushes the streams whose oldest unpacked sample has waited for at
+    /// least the maximum latency
+    void flushExpired(const std::chrono::microseconds &now,
+                      std::vector<DataLinkPacket> *records)
+    {
+        while (!mDeadlines.empty() &&
+               now - mDeadlines.begin()->first >= mMaximumLatency)
+        {
+            auto &stream = *mDeadlines.begin()->second;
+            mDeadlines.erase(mDeadlines.begin());
+            stream.mIsQueued = false;
+            pack(stream, true, records);
+            updateDeadline(stream);
+        }
+        if (now >= mNextIdleStreamSweep)
+        {
+            mNextIdleStreamSweep = now + IDLE_STREAM_SWEEP_INTERVAL;
+            evictIdleStreams(now);
+        }
+    }
+    /// Forgets streams that have not buffered anything in a while
+    void evictIdleStreams(const std::chrono::microseconds &now)
+    {
+        for (auto index = mStreams.begin(); index != mStreams.end();)
+        {
+            const auto &stream = index->second;
+            if (!stream.hasBufferedSamples() &&
+                !stream.mIsQueued &&
+                now - stream.mLastArrival >= IDLE_STREAM_TIME)
+            {
+                index = mStreams.erase(index);
+            }
+            else
+            {
+                ++index;
+            }
+        }
+    }
+    std::map<std::string, StreamBuffer, std::less<>> mStreams;
+    // The streams with unpacked samples ordered by the arrival time of
+    // their oldest unpacked sample.  N.B. map nodes do not move so the
+    // stream pointers are stable.
+    std::set<std::pair<std::chrono::microseconds, StreamBuffer *>> mDeadlines;
+    std::chrono::microseconds mNextIdleStreamSweep{0};
+    std::function<int (const std::string &)> mGetRecordLength;
+    RecordBufferPool mPool;
+    std::map<int, std::unique_ptr<RecordBufferPool>> mPools;
+    std::chrono::microseconds mMaximumLatency{1000000};
+    Compression mCompression{Compression::None};
+    int mRecordLength{512};
+    bool mUseMiniSEED3{true};
+};
+
+/// Constructor
+MiniSEEDRecordAggregator::MiniSEEDRecordAggregator(
+    const int recordLength,
+    const bool useMiniSEED3,
+    const Compression compression,
+    const std::chrono::microseconds &maximumLatency)
+{
+    if (recordLength < 1)
+    {
+        throw std::invalid_argument("Record length must be positive");
+    }
+    if (maximumLatency.count() <= 0)
+    {
+        throw std::invalid_argument("Maximum latency must be positive");
+    }
+    pImpl = std::make_unique<MiniSEEDRecordAggregatorImpl> (recordLength);
+    pImpl->mUseMiniSEED3 = useMiniSEED3;
+    pImpl->mCompression = compression;
+    pImpl->mMaximumLatency = maximumLatency;
+}
+
+MiniSEEDRecordAggregator::MiniSEEDRecordAggregator(
+    const std::function<int (const std::string &)> &getRecordLength,
+    const bool useMiniSEED3,
+    const Compression compression,
+    const std::chrono::microseconds &maximumLatency) :
+    MiniSEEDRecordAggregator(512, useMiniSEED3, compression, maximumLatency)
+{
+    if (!getRecordLength)
+    {
+        throw std::invalid_argument("Record length function not set");
+    }
+    pImpl->mGetRecordLength = getRecordLength;
+}
+
+/// Destructor
+MiniSEEDRecordAggregator::~MiniSEEDRecordAggregator() = default;
+
+/// Add a packet
+std::vector<DataLinkPacket> MiniSEEDRecordAggregator::add(
+    const Packet &packet, const std::chrono::microseconds &now)
+{
+    std::vector<DataLinkPacket> records;
+    add(packet, now, &records);
+    return records;
+}
+
+void MiniSEEDRecordAggregator::add(const Packet &packet,
+                                   const std::chrono::microseconds &now,
+                                   std::vector<DataLinkPacket> *records)
+{
+    if (records == nullptr){throw std::invalid_argument("Records is NULL");}
+    pImpl->add(packet, now, records);
+}
+
+/// Flush streams that have waited too long
+std::vector<DataLinkPacket> MiniSEEDRecordAggregator::flushExpired(
+    const std::chrono::microseconds &now)
+{
+    std::vector<DataLinkPacket> records;
+    flushExpired(now, &records);
+    return records;
+}
+
+void MiniSEEDRecordAggregator::flushExpired(
+    const std::chrono::microseconds &now,
+    std::vector<DataLinkPacket> *records)
+{
+    if (records == nullptr){throw std::invalid_argument("Records is NULL");}
+    pImpl->flushExpired(now, records);
+}
+
+/// Flush everything
+std::vector<DataLinkPacket> MiniSEEDRecordAggregator::flush()
+{
+    std::vector<DataLinkPacket> records;
+    flush(&records);
+    return records;
+}
+
+void MiniSEEDRecordAggregator::flush(std::vector<DataLinkPacket> *records)
+{
+    if (records == nullptr){throw std::invalid_argument("Records is NULL");}
+    for (auto &stream : pImpl->mStreams)
+    {
+        pImpl->pack(stream.second, true, records);
+        pImpl->updateDeadline(stream.second);
+    }
+}
+
+/// Number of streams
+int MiniSEEDRecordAggregator::getNumberOfStreams() const noexcept
+{
+    return static_cast<int> (pImpl->mStreams.size());
+}
+
+/// Number of samples waiting
+int64_t MiniSEEDRecordAggregator::getNumberOfBufferedSamples() const noexcept
+{
+    int64_t result{0};
+    for (const auto &stream : pImpl->mStreams)
+    {
+        result = result
+               + (stream.second.mSamplesAdded - stream.second.mSamplesPacked);
+    }
+    return result;
+}
+
+/// Maximum latency
+std::chrono::microseconds
+MiniSEEDRecordAggregator::getMaximumLatency() const noexcept
+{
+    return pImpl->mMaximumLatency;
+}
@@ -11,19 +11,36 @@
 #include <opentelemetry/semconv/incubating/thread_attributes.h>
 #include <opentelemetry/version.h>
 
+#include <string_view>
+
 namespace spdlog
 {
 namespace sinks
 {
 
 template <typename Mutex>
-void OpenTelemetrySink<Mutex>::sink_it_(const spdlog::details::log_msg &msg)
+opentelemetry::logs::Logger &
+OpenTelemetrySink<Mutex>::getLogger(const spdlog::string_view_t &loggerName)
 {
   static constexpr auto kLibraryName = "spdlog";
 
-  auto provider   = opentelemetry::logs::Provider::GetLoggerProvider();
-  auto logger     = provider->GetLogger(msg.logger_name.data(), kLibraryName, libraryVersion());
-  auto log_record = logger->CreateLogRecord();
+  // N.B. The base sink's mutex is held so the cache needs no locking
+  auto provider = opentelemetry::logs::Provider::GetLoggerProvider();
+  if (mLogger == nullptr || provider.get() != mProvider ||
+      std::string_view(loggerName.data(), loggerName.size()) != mLoggerName)
+  {
+    mLoggerName.assign(loggerName.data(), loggerName.size());
+    mLogger   = provider->GetLogger(mLoggerName, kLibraryName, libraryVersion());
+    mProvider = provider.get();
+  }
+  return *mLogger;
+}
+
+template <typename Mutex>
+void OpenTelemetrySink<Mutex>::sink_it_(const spdlog::details::log_msg &msg)
+{
+  auto &logger    = getLogger(msg.logger_name);
+  auto log_record = logger.CreateLogRecord();
 
   if (log_record)
   {
@@ -39,7 +56,7 @@ void OpenTelemetrySink<Mutex>::sink_it_(const spdlog::details::log_msg &msg)
       log_record->SetAttribute(kCodeLineNumber, msg.source.line);
     }
     log_record->SetAttribute(kThreadId, msg.thread_id);
-    logger->EmitLogRecord(std::move(log_record));
+    logger.EmitLogRecord(std::move(log_record));
   }
 }
 
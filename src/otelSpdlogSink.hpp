@@ -5,13 +5,17 @@
 
 #pragma once
 
+#include <opentelemetry/logs/logger.h>
+#include <opentelemetry/logs/logger_provider.h>
 #include <opentelemetry/logs/severity.h>
+#include <opentelemetry/nostd/shared_ptr.h>
 
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/sinks/base_sink.h>
 #include <spdlog/version.h>
 
 #include <mutex>
+#include <string>
 
 namespace spdlog
 {
@@ -58,6 +62,14 @@ public:
 protected:
   void sink_it_(const spdlog::details::log_msg &msg) override;
   void flush_() override {}
+
+private:
+  /// Resolving the OTel logger is costly so it is done once and redone only
+  /// when the global provider or the spdlog logger's name changes.
+  opentelemetry::logs::Logger &getLogger(const spdlog::string_view_t &loggerName);
+  const opentelemetry::logs::LoggerProvider *mProvider{nullptr};
+  opentelemetry::nostd::shared_ptr<opentelemetry::logs::Logger> mLogger{nullptr};
+  std::string mLoggerName;
 };
 
 using opentelemetry_sink_mt = OpenTelemetrySink<std::mutex>;
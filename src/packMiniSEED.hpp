@@ -0,0 +1,344 @@
+#ifndef PACK_MINISEED_HPP
+#define PACK_MINISEED_HPP
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <libmseed.h>
+#include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/pipelineTimestamps.hpp"
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
+#include "uSEEDLinkToRingServer/streamIdentifier.hpp"
+
+namespace
+{
+
+/// @brief The state threaded through msr3_pack/mstl3_pack to the record
+///        handler.  Since records are emitted in order, the start time of
+///        each record follows from the number of samples already packed.
+struct RecordHandlerContext
+{
+    std::vector<USEEDLinkToRingServer::DataLinkPacket> *records{nullptr};
+    USEEDLinkToRingServer::RecordBufferPool *pool{nullptr};
+    std::chrono::nanoseconds startTime{0}; // Time of first sample being packed
+    double samplingRate{0};
+    int64_t samplesPacked{0}; // Samples packed since startTime
+    bool useMiniSEED3{true};
+    // When the samples being packed passed the earlier pipeline stages
+    USEEDLinkToRingServer::PipelineTimestamps timestamps{};
+};
+
+/// @result The number of samples in the record read directly from the
+///         fixed header or -1 if the header does not look like a record
+///         of the expected version.
+[[nodiscard]]
+int64_t readNumberOfSamples(const char *record, const int recordLength,
+                            const bool useMiniSEED3) noexcept
+{
+    auto bytes = reinterpret_cast<const uint8_t *> (record);
+    if (useMiniSEED3)
+    {
+        // Fixed header: "MS", version 3, ..., uint32 sample count at byte 24
+        // which is always little endian
+        if (recordLength < MS3FSDH_LENGTH ||
+            bytes[0] != 'M' || bytes[1] != 'S' || bytes[2] != 3)
+        {
+            return -1;
+        }
+        return static_cast<int64_t> (bytes[24])
+            | (static_cast<int64_t> (bytes[25]) << 8)
+            | (static_cast<int64_t> (bytes[26]) << 16)
+            | (static_cast<int64_t> (bytes[27]) << 24);
+    }
+    // Fixed header: uint16 sample count at byte 30.  The byte order is given
+    // by the word order of blockette 1000 which immediately follows.
+    constexpr int blockette1000Offset{MS2FSDH_LENGTH};
+    if (recordLength < blockette1000Offset + 8){return -1;}
+    auto wordOrder = bytes[blockette1000Offset + 5];
+    uint16_t blocketteType{0};
+    uint16_t nSamples{0};
+    if (wordOrder == 1) // Big endian
+    {
+        blocketteType = static_cast<uint16_t> ((bytes[blockette1000Offset] << 8)
+                                              | bytes[blockette1000Offset + 1]);
+        nSamples = static_cast<uint16_t> ((bytes[30] << 8) | bytes[31]);
+    }
+    else if (wordOrder == 0)
+    {
+        blocketteType = static_cast<uint16_t> ((bytes[blockette1000Offset + 1] << 8)
+                                              | bytes[blockette1000Offset]);
+        nSamples = static_cast<uint16_t> ((bytes[31] << 8) | bytes[30]);
+    }
+    if (blocketteType != 1000){return -1;}
+    return static_cast<int64_t> (nSamples);
+}
+
+/// @brief Handles a record created by msr3_pack or mstl3_pack.  The record
+///        start and end times are computed from the packing cursor in the
+///        RecordHandlerContext pointed to by handlerData and the record is
+///        copied into a pooled buffer then appended to the context's records.
+void msRecordHandler(char *record, int recordLength, void *handlerData)
+{
+    auto context = reinterpret_cast<RecordHandlerContext *> (handlerData);
+    std::chrono::microseconds startTime{0};
+    std::chrono::microseconds endTime{0};
+    auto nSamples = ::readNumberOfSamples(record, recordLength,
+                                          context->useMiniSEED3);
+    if (nSamples >= 0)
+    {
+        std::chrono::nanoseconds startTimeNanoS{context->startTime};
+        std::chrono::nanoseconds endTimeNanoS{context->startTime};
+        if (context->samplingRate > 0)
+        {
+            const double samplingPeriod{1.e9/context->samplingRate};
+            startTimeNanoS = context->startTime
+                           + std::chrono::nanoseconds
+                             {
+                               std::llround(context->samplesPacked
+                                           *samplingPeriod)
+                             };
+            endTimeNanoS = startTimeNanoS;
+            if (nSamples > 0)
+            {
+                endTimeNanoS = startTimeNanoS
+                             + std::chrono::nanoseconds
+                               {
+                                  std::llround((nSamples - 1)*samplingPeriod)
+                               };
+            }
+        }
+        startTime = std::chrono::duration_cast<std::chrono::microseconds> (startTimeNanoS);
+        endTime = std::chrono::duration_cast<std::chrono::microseconds> (endTimeNanoS);
+        context->samplesPacked = context->samplesPacked + nSamples;
+    }
+    else
+    {
+        // Unexpected header so fall back to the parser
+        constexpr uint32_t flags{0};
+        constexpr int8_t verbose{0};
+        MS3Record *miniSEEDRecord{nullptr};
+        auto returnCode = msr3_parse(record,
+                                     recordLength,
+                                     &miniSEEDRecord,
+                                     flags,
+                                     verbose);
+        if (returnCode == MS_NOERROR && miniSEEDRecord)
+        {
+            std::chrono::nanoseconds startTimeNanoS{miniSEEDRecord->starttime};
+            std::chrono::nanoseconds endTimeNanoS{msr3_endtime(miniSEEDRecord)};
+            startTime = std::chrono::duration_cast<std::chrono::microseconds> (startTimeNanoS);
+            endTime = std::chrono::duration_cast<std::chrono::microseconds> (endTimeNanoS);
+            context->samplesPacked = context->samplesPacked
+                                   + miniSEEDRecord->samplecnt;
+        }
+        if (miniSEEDRecord){msr3_free(&miniSEEDRecord);}
+        if (returnCode != MS_NOERROR)
+        {
+            spdlog::warn("Error decoding packet");
+        }
+    }
+    // Want these in microseconds
+    USEEDLinkToRingServer::DataLinkPacket packet
+    {
+       context->pool->create(record, recordLength),
+       nullptr,
+       startTime,
+       endTime,
+       context->timestamps
+    };
+    packet.timestamps.encoded = std::chrono::steady_clock::now();
+    context->records->push_back(std::move(packet));
+}
+
+/// @result The libmseed encoding for the given data type and compression.
+/// @throws std::runtime_error if the data type is not handled.
+[[nodiscard]]
+int8_t toMiniSEEDEncoding(
+    const USEEDLinkToRingServer::Packet::DataType dataType,
+    const USEEDLinkToRingServer::Compression compression)
+{
+    using namespace USEEDLinkToRingServer;
+    if (dataType == Packet::DataType::Integer32)
+    {
+        if (compression == Compression::STEIM1){return DE_STEIM1;}
+        if (compression == Compression::STEIM2){return DE_STEIM2;}
+        return DE_INT32;
+    }
+    else if (dataType == Packet::DataType::Float)
+    {
+        return DE_FLOAT32;
+    }
+    else if (dataType == Packet::DataType::Double)
+    {
+        return DE_FLOAT64;
+    }
+    else if (dataType == Packet::DataType::Text)
+    {
+        return DE_TEXT;
+    }
+    throw std::runtime_error("Unhandled precision");
+}
+
+/// @brief Describes how the samples in a single miniSEED record will be
+///        laid out into records of a fixed length.
+struct RecordPlan
+{
+    int64_t samplesPerRecord{0}; // Zero indicates this can't be known a priori
+    int64_t numberOfRecords{0};  // Exact when samplesPerRecord > 0; otherwise an upper bound
+};
+
+/// @brief Plans the record boundaries for the given record.  For the
+///        uncompressed encodings the sample capacity of a record follows
+///        directly from the record length, header length, and sample size.
+///        For the Steim encodings the capacity depends on the data so an
+///        upper bound on the record count is computed from the worst-case
+///        (one difference per 32-bit word) packing.
+/// @param[in] msRecord      The record to pack.  The record length, encoding,
+///                          SID, and number of samples must be set.
+/// @param[in] useMiniSEED3  True indicates miniSEED3 records will be packed.
+[[nodiscard]]
+RecordPlan planMiniSEEDRecords(const MS3Record &msRecord,
+                               const bool useMiniSEED3)
+{
+    RecordPlan plan;
+    if (msRecord.numsamples < 1){return plan;}
+    const bool isSteim = (msRecord.encoding == DE_STEIM1 ||
+                          msRecord.encoding == DE_STEIM2);
+    int headerLength{0};
+    if (useMiniSEED3)
+    {
+        // Fixed section of header + SID + no extra headers
+        headerLength = MS3FSDH_LENGTH
+                     + static_cast<int> (std::strlen(msRecord.sid));
+    }
+    else
+    {
+        // Fixed header + blockette 1000; Steim frames begin on a 64-byte
+        // boundary
+        headerLength = isSteim ? 64 : MS2FSDH_LENGTH + 8;
+    }
+    auto dataBytes = msRecord.reclen - headerLength;
+    int sampleSize{0};
+    if (msRecord.encoding == DE_INT32 || msRecord.encoding == DE_FLOAT32)
+    {
+        sampleSize = 4;
+    }
+    else if (msRecord.encoding == DE_FLOAT64)
+    {
+        sampleSize = 8;
+    }
+    else if (msRecord.encoding == DE_TEXT)
+    {
+        sampleSize = 1;
+    }
+    if (sampleSize > 0)
+    {
+        if (dataBytes < sampleSize)
+        {
+            throw std::invalid_argument("Record length "
+                                      + std::to_string(msRecord.reclen)
+                                      + " too small to hold any samples");
+        }
+        plan.samplesPerRecord = dataBytes/sampleSize;
+        plan.numberOfRecords
+            = (msRecord.numsamples + plan.samplesPerRecord - 1)
+             /plan.samplesPerRecord;
+    }
+    else if (isSteim)
+    {
+        // A 64-byte frame holds at most 15 data words; the first frame
+        // loses two more words to the integration constants.
+        auto framesPerRecord = dataBytes/64;
+        int64_t worstCaseSamples = framesPerRecord*15 - 2;
+        if (worstCaseSamples < 1)
+        {
+            throw std::invalid_argument("Record length "
+                                      + std::to_string(msRecord.reclen)
+                                      + " too small to hold a Steim frame");
+        }
+        plan.numberOfRecords
+            = (msRecord.numsamples + worstCaseSamples - 1)/worstCaseSamples;
+    }
+    return plan;
+}
+
+/// @brief Fills the header and data of a miniSEED record from the packet.
+/// @param[in] packet        The packet to convert.
+/// @param[in] recordLength  The maximum record length in bytes.
+/// @param[in] compression   The compression to use for integer data.
+/// @param[out] msRecord     The miniSEED record.  Note, the data samples
+///                          point into the packet so the packet must outlive
+///                          msRecord and msRecord->datasamples must be set to
+///                          NULL prior to freeing msRecord.
+/// @throws std::runtime_error if the packet is malformed.
+void packetToMiniSEEDRecord(const USEEDLinkToRingServer::Packet &packet,
+                            const int recordLength,
+                            const USEEDLinkToRingServer::Compression compression,
+                            MS3Record *msRecord)
+{
+    using namespace USEEDLinkToRingServer;
+    // Pack the easy stuff
+    msRecord->datasamples = nullptr;
+    try
+    {
+        msRecord->reclen = recordLength > 0 ? recordLength : 4096;
+        msRecord->pubversion = 1;
+        msRecord->starttime
+            = static_cast<int64_t> (packet.getStartTime().count());
+        msRecord->samprate = packet.getSamplingRate();
+        msRecord->numsamples = packet.getNumberOfSamples();
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error("Failed to pack mseed record because "
+                               + std::string {e.what()});
+    }
+    // Pack the sid
+    const auto &streamIdentifier = packet.getStreamIdentifierReference();
+    std::string locationCode;
+    if (streamIdentifier.hasLocationCode())
+    {
+        locationCode = streamIdentifier.getLocationCode();
+    }
+    auto sidLength
+        = ms_nslc2sid(
+            msRecord->sid, LM_SIDLEN, 0,
+            const_cast<char *> (streamIdentifier.getNetwork().c_str()),
+            const_cast<char *> (streamIdentifier.getStation().c_str()),
+            const_cast<char *> (locationCode.c_str()),
+            const_cast<char *> (streamIdentifier.getChannel().c_str()));
+    if (sidLength < 1)
+    {
+        throw std::runtime_error("Failed to pack SID");
+    }
+    // Now do the data
+    if (msRecord->numsamples > 0)
+    {
+        auto dataType = packet.getDataType();
+        msRecord->encoding = ::toMiniSEEDEncoding(dataType, compression);
+        if (dataType == Packet::DataType::Integer32)
+        {
+            msRecord->sampletype = 'i';
+        }
+        else if (dataType == Packet::DataType::Float)
+        {
+            msRecord->sampletype = 'f';
+        }
+        else if (dataType == Packet::DataType::Double)
+        {
+            msRecord->sampletype = 'd';
+        }
+        else if (dataType == Packet::DataType::Text)
+        {
+            msRecord->sampletype = 't';
+        }
+        msRecord->datasamples = (void *) packet.getDataPointer();
+    }
+    msRecord->samplecnt = msRecord->numsamples;
+}
+
+}
+#endif
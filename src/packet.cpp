@@ -1,5 +1,11 @@
 #include <iostream>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <memory>
 #include <numeric>
+#include <type_traits>
 #include <string>
 #include <vector>
 #include <chrono>
@@ -12,126 +18,139 @@
 #endif
 #include "uSEEDLinkToRingServer/packet.hpp"
 #include "uSEEDLinkToRingServer/streamIdentifier.hpp"
+#include "packMiniSEED.hpp"
+#include "sampleStatistics.hpp"
 
 using namespace USEEDLinkToRingServer;
 
 namespace
 {
 
-void msRecordHandler(char *record, int recordLength, void *buffer)
+/// @brief Holds a packet's samples in one contiguous, type-tagged block.
+///        Typical SEEDLink packets fit in the inline storage so the samples
+///        live alongside the packet header and a packet is one allocation.
+///        Larger packets spill to a heap block whose capacity is rounded to
+///        a power of two and which is reused when the buffer is refilled.
+class SampleBuffer
 {
-    // Awkward but I need the start/end times to send this.
-    constexpr uint32_t flags{0};
-    constexpr int8_t verbose{0};
-    MS3Record *miniSEEDRecord{nullptr};
-    auto returnCode = msr3_parse(record,
-                                 recordLength,
-                                 &miniSEEDRecord,
-                                 flags,
-                                 verbose);
-    // Start/end time are in nanoseconds
-    std::chrono::microseconds startTime{0};
-    std::chrono::microseconds endTime{0};
-    if (returnCode == MS_NOERROR && miniSEEDRecord)
-    {
-        std::chrono::nanoseconds startTimeNanoS{miniSEEDRecord->starttime};
-        std::chrono::nanoseconds endTimeNanoS{msr3_endtime(miniSEEDRecord)};
-        startTime = std::chrono::duration_cast<std::chrono::microseconds> (startTimeNanoS);
-        endTime = std::chrono::duration_cast<std::chrono::microseconds> (endTimeNanoS);
+public:
+    static constexpr size_t InlineCapacity{2048};
+    SampleBuffer() = default;
+    SampleBuffer(const SampleBuffer &buffer)
+    {
+        *this = buffer;
     }
-    if (miniSEEDRecord){msr3_free(&miniSEEDRecord);}
-    if (MS_NOERROR)
+    SampleBuffer& operator=(const SampleBuffer &buffer)
     {
-        spdlog::warn("Error decoding packet");
+        if (&buffer == this){return *this;}
+        auto nBytes = buffer.mSize*buffer.getSampleSize();
+        auto destination = reserve(nBytes);
+        if (nBytes > 0){std::memcpy(destination, buffer.data(), nBytes);}
+        mSize = buffer.mSize;
+        mDataType = buffer.mDataType;
+        return *this;
     }
-
-    std::string nextRecord(record, recordLength); //record + recordLength);
-    auto outputPackets
-        = reinterpret_cast<std::vector<DataLinkPacket> *> (buffer);
-    // Want these in miccroseconds
-    DataLinkPacket packet
+    /// @brief Copies the samples into the buffer.
+    template<typename T>
+    void assign(const T *samples, const int nSamples)
     {
-       std::move(nextRecord),
-       startTime,
-       endTime
-    }; 
-    outputPackets->push_back(std::move(packet));
-}    
-
-}
-
-
-class Packet::PacketImpl
-{
-public:
-    [[nodiscard]] int size() const
-    {   
-        if (mDataType == Packet::DataType::Unknown)
+        auto nBytes = static_cast<size_t> (nSamples)*sizeof(T);
+        auto destination = reserve(nBytes);
+        if (nBytes > 0){std::memcpy(destination, samples, nBytes);}
+        mSize = nSamples;
+        mDataType = getDataType<T>();
+    }
+    /// @brief Releases the samples.  The heap block is kept for reuse.
+    void clear() noexcept
+    {
+        mSize = 0;
+        mDataType = Packet::DataType::Unknown;
+    }
+    /// @result The number of samples.
+    [[nodiscard]] int size() const noexcept
+    {
+        return mSize;
+    }
+    /// @result The sample type.
+    [[nodiscard]] Packet::DataType getDataType() const noexcept
+    {
+        return mDataType;
+    }
+    /// @result A pointer to the samples.
+    [[nodiscard]] const std::byte *data() const noexcept
+    {
+        return mHeap != nullptr ? mHeap.get() : mInline.data();
+    }
+private:
+    template<typename T>
+    [[nodiscard]] static constexpr Packet::DataType getDataType() noexcept
+    {
+        if constexpr (std::is_same_v<T, int>)
         {
-            return 0;
+            return Packet::DataType::Integer32;
         }
-        else if (mDataType == Packet::DataType::Integer32)
-        {   
-            return static_cast<int> (mInteger32Data.size());
-        }   
-        else if (mDataType == Packet::DataType::Float)
+        else if constexpr (std::is_same_v<T, float>)
         {
-            return static_cast<int> (mFloatData.size());
+            return Packet::DataType::Float;
         }
-        else if (mDataType == Packet::DataType::Double)
+        else if constexpr (std::is_same_v<T, double>)
         {
-            return static_cast<int> (mDoubleData.size());
+            return Packet::DataType::Double;
         }
-        else if (mDataType == Packet::DataType::Text)
+        else
         {
-            return static_cast<int> (mTextData.size());
+            static_assert(std::is_same_v<T, char>, "Unhandled sample type");
+            return Packet::DataType::Text;
         }
-#ifndef NDEBUG
-        assert(false);
-#else
-        throw std::runtime_error("Unhandled data type in packet impl size");
-#endif
     }
-    void clearData()
+    [[nodiscard]] size_t getSampleSize() const noexcept
     {
-        mInteger32Data.clear();
-        mFloatData.clear();
-        mDoubleData.clear();
-        mTextData.clear();
-        mDataType = Packet::DataType::Unknown;
+        if (mDataType == Packet::DataType::Integer32){return sizeof(int);}
+        if (mDataType == Packet::DataType::Float){return sizeof(float);}
+        if (mDataType == Packet::DataType::Double){return sizeof(double);}
+        if (mDataType == Packet::DataType::Text){return sizeof(char);}
+        return 0;
     }
-    void setData(std::vector<int> &&data)
+    std::byte *reserve(const size_t nBytes)
     {
-        if (data.empty()){return;}
-        clearData();
-        mInteger32Data = std::move(data);
-        mDataType = Packet::DataType::Integer32;
-        updateEndTime();
+        if (nBytes <= InlineCapacity && mHeap == nullptr)
+        {
+            return mInline.data();
+        }
+        if (nBytes > mHeapCapacity)
+        {
+            mHeapCapacity = std::bit_ceil(nBytes);
+            mHeap = std::make_unique_for_overwrite<std::byte[]> (mHeapCapacity);
+        }
+        return mHeap.get();
     }
-    void setData(std::vector<float> &&data)
+    alignas(std::max_align_t) std::array<std::byte, InlineCapacity> mInline;
+    std::unique_ptr<std::byte[]> mHeap{nullptr};
+    size_t mHeapCapacity{0};
+    int mSize{0};
+    Packet::DataType mDataType{Packet::DataType::Unknown};
+};
+
+}
+
+class Packet::PacketImpl
+{
+public:
+    [[nodiscard]] int size() const noexcept
     {
-        if (data.empty()){return;}
-        clearData();
-        mFloatData = std::move(data);
-        mDataType = Packet::DataType::Float;
-        updateEndTime();
+        return mSamples.size();
     }
-    void setData(std::vector<double> &&data)
+    void clearData() noexcept
     {
-        if (data.empty()){return;}
-        clearData();
-        mDoubleData = std::move(data);
-        mDataType = Packet::DataType::Double;
-        updateEndTime();
+        mSamples.clear();
     }
-    void setData(std::vector<char> &&data)
+    template<typename U>
+    void setData(const U *data, const int nSamples)
     {
-        if (data.empty()){return;}
-        clearData();
-        mTextData = std::move(data);
-        mDataType = Packet::DataType::Text;
+        if (nSamples < 1){return;}
+        mSamples.assign(data, nSamples);
         updateEndTime();
-    }   
+    }
     void updateEndTime()
     {
         mEndTimeMicroSeconds = mStartTimeMicroSeconds;
@@ -146,15 +165,13 @@ public:
         }
     }
     StreamIdentifier mIdentifier;
-    std::vector<char> mTextData;
-    std::vector<int> mInteger32Data;
-    std::vector<float> mFloatData;
-    std::vector<double> mDoubleData;
     std::chrono::nanoseconds mStartTimeMicroSeconds{0};
     std::chrono::nanoseconds mEndTimeMicroSeconds{0};
+    std::chrono::steady_clock::time_point mEnqueueTime{};
+    PipelineTimestamps mPipelineTimestamps{};
     double mSamplingRate{0};
-    Packet::DataType mDataType{Packet::DataType::Unknown};
     bool mHasIdentifier = false;
+    SampleBuffer mSamples;
 };
 
 /// Clear class
@@ -165,12 +182,14 @@ void Packet::clear() noexcept
     pImpl->mHasIdentifier = false;
     pImpl->mStartTimeMicroSeconds = std::chrono::nanoseconds {0};
     pImpl->mEndTimeMicroSeconds = std::chrono::nanoseconds {0};
+    pImpl->mEnqueueTime = std::chrono::steady_clock::time_point {};
+    pImpl->mPipelineTimestamps = PipelineTimestamps {};
     pImpl->mSamplingRate = 0;
 }
 
 /// Constructor
 Packet::Packet() :
-    pImpl(std::make_unique<PacketImpl> ())
+    pImpl(std::make_unique_for_overwrite<PacketImpl> ())
 {
 }
 
@@ -190,7 +209,14 @@ Packet::Packet(Packet &&packet) noexcept
 Packet& Packet::operator=(const Packet &packet)
 {
     if (&packet == this){return *this;}
-    pImpl = std::make_unique<PacketImpl> (*packet.pImpl);
+    if (pImpl)
+    {
+        *pImpl = *packet.pImpl;
+    }
+    else
+    {
+        pImpl = std::make_unique<PacketImpl> (*packet.pImpl);
+    }
     return *this;
 }
 
@@ -301,6 +327,31 @@ std::chrono::nanoseconds Packet::getStartTime() const noexcept
     return pImpl->mStartTimeMicroSeconds;
 }
 
+/// Enqueue time
+void Packet::setEnqueueTime(
+    const std::chrono::steady_clock::time_point &enqueueTime) noexcept
+{
+    pImpl->mEnqueueTime = enqueueTime;
+}
+
+std::chrono::steady_clock::time_point Packet::getEnqueueTime() const noexcept
+{
+    return pImpl->mEnqueueTime;
+}
+
+/// Pipeline timestamps
+void Packet::setPipelineTimestamps(
+    const PipelineTimestamps &timestamps) noexcept
+{
+    pImpl->mPipelineTimestamps = timestamps;
+}
+
+const PipelineTimestamps &
+Packet::getPipelineTimestampsReference() const noexcept
+{
+    return pImpl->mPipelineTimestamps;
+}
+
 std::chrono::nanoseconds Packet::getEndTime() const
 {
     if (!hasSamplingRate())
@@ -318,15 +369,13 @@ std::chrono::nanoseconds Packet::getEndTime() const
 template<typename U>
 void Packet::setData(std::vector<U> &&x)
 {
-    pImpl->setData(std::move(x));
-    pImpl->updateEndTime();
+    pImpl->setData(x.data(), static_cast<int> (x.size()));
 }
 
 template<typename U>
 void Packet::setData(const std::vector<U> &x)
 {
-    auto xWork = x;
-    setData(std::move(xWork));
+    pImpl->setData(x.data(), static_cast<int> (x.size()));
 }
 
 template<typename U>
@@ -335,9 +384,7 @@ void Packet::setData(const int nSamples, const U *x)
     // Invalid
     if (nSamples < 0){throw std::invalid_argument("nSamples not positive");}
     if (x == nullptr){throw std::invalid_argument("x is NULL");}
-    std::vector<U> data(nSamples);
-    std::copy(x, x + nSamples, data.begin());
-    setData(std::move(data));
+    pImpl->setData(x, nSamples);
 }
 
 /// Gets a reference to the underlying data
@@ -375,83 +422,46 @@ const void *Packet::getDataPointer() const noexcept
 template<typename U>
 std::vector<U> Packet::getData() const noexcept
 {
-    std::vector<U> result;
-    auto nSamples = getNumberOfSamples();
-    if (nSamples < 1){return result;}
-    result.resize(nSamples);
-    auto dataType = getDataType();
-    if (dataType == DataType::Integer32)
-    {   
-        std::copy(pImpl->mInteger32Data.begin(),
-                  pImpl->mInteger32Data.end(),
-                  result.begin());
-    }   
-    else if (dataType == DataType::Float)
-    {   
-        std::copy(pImpl->mFloatData.begin(),
-                  pImpl->mFloatData.end(),
-                  result.begin());
-    }   
-    else if (dataType == DataType::Double)
-    {   
-        std::copy(pImpl->mDoubleData.begin(),
-                  pImpl->mDoubleData.end(),
-                  result.begin());
-    }   
-    else if (dataType == DataType::Text)
+    if (getNumberOfSamples() < 1){return std::vector<U> {};}
+    return visit([](const auto samples)
     {
-        std::copy(pImpl->mTextData.begin(),
-                  pImpl->mTextData.end(),
-                  result.begin());
-    }
-    else
-    {   
-#ifndef NDEBUG
-        assert(false);
-#endif
-        constexpr U zero{0};
-        std::fill(result.begin(), result.end(), zero); 
-    }   
-    return result;
+        return std::vector<U> (samples.begin(), samples.end());
+    });
 }
 
 const void* Packet::getDataPointer() const noexcept
 {
     if (getNumberOfSamples() < 1){return nullptr;}
-    auto dataType = getDataType();
-    if (dataType == DataType::Integer32)
-    {   
-        return pImpl->mInteger32Data.data();
-    }   
-    else if (dataType == DataType::Float)
-    {   
-        return pImpl->mFloatData.data();
-    }   
-    else if (dataType == DataType::Double)
-    {   
-        return pImpl->mDoubleData.data();
-    }   
-    else if (dataType == DataType::Text)
+    return pImpl->mSamples.data();
+}
+
+template<typename T>
+std::span<const T> Packet::getDataSpan() const
+{
+    auto nSamples = getNumberOfSamples();
+    if (nSamples < 1){return std::span<const T> {};}
+    constexpr auto dataType = []()
     {
-        return pImpl->mTextData.data();
+        if constexpr (std::is_same_v<T, int>){return DataType::Integer32;}
+        else if constexpr (std::is_same_v<T, float>){return DataType::Float;}
+        else if constexpr (std::is_same_v<T, double>){return DataType::Double;}
+        else {return DataType::Text;}
+    }();
+    if (getDataType() != dataType)
+    {
+        throw std::invalid_argument("Requested type does not match data type");
     }
-    else if (dataType  == DataType::Unknown)
-    {   
-        return nullptr;
-    }   
-#ifndef NDEBUG
-    else 
-    {   
-        assert(false);
-    }   
-#endif
-    return nullptr;
+    return std::span<const T>
+           {
+               reinterpret_cast<const T *> (pImpl->mSamples.data()),
+               static_cast<size_t> (nSamples)
+           };
 }
 
 /// Data type
 Packet::DataType Packet::getDataType() const noexcept
 {
-    return pImpl->mDataType;
+    return pImpl->mSamples.getDataType();
 }
 
 std::vector<USEEDLinkToRingServer::DataLinkPacket> 
@@ -461,164 +471,82 @@ USEEDLinkToRingServer::toDataLinkPackets(
     const bool useMiniSEED3,
     const Compression compression,
     const bool flushPackets,
-    std::shared_ptr<spdlog::logger> &logger)
+    std::shared_ptr<spdlog::logger> &logger,
+    RecordBufferPool *pool)
 {
     std::vector<DataLinkPacket> outputPackets;
+    auto dataLinkIdentifier
+        = std::make_shared<const std::string>
+          (toDataLinkIdentifier(packet.getStreamIdentifierReference()));
+    toDataLinkPackets(packet,
+                      maxRecordLength,
+                      useMiniSEED3,
+                      compression,
+                      flushPackets,
+                      logger,
+                      dataLinkIdentifier,
+                      pool ? *pool : RecordBufferPool::getThreadLocalInstance(),
+                      &outputPackets);
+    return outputPackets;
+}
+
+void USEEDLinkToRingServer::toDataLinkPackets(
+    const Packet &packet,
+    const int maxRecordLength,
+    const bool useMiniSEED3,
+    const Compression compression,
+    const bool flushPackets,
+    std::shared_ptr<spdlog::logger> &logger,
+    const std::shared_ptr<const std::string> &dataLinkIdentifier,
+    RecordBufferPool &pool,
+    std::vector<DataLinkPacket> *records)
+{
+    if (records == nullptr){throw std::invalid_argument("Records is NULL");}
+    auto &outputPackets = *records;
+    const auto nRecordsBefore = outputPackets.size();
     MS3Record msRecord MS3Record_INITIALIZER;//{nullptr};
-    // Pack the easy stuff
-    msRecord.datasamples = nullptr;
+    ::packetToMiniSEEDRecord(packet, maxRecordLength, compression, &msRecord);
+    // Lay out the record boundaries up front so that we can size the output
+    // and pack everything in a single pass.  Note, a partially filled final
+    // record is always flushed since, for a single packet, the alternative
+    // is to silently drop those samples.
+    RecordPlan plan;
     try
     {
-        msRecord.reclen = maxRecordLength > 0 ? maxRecordLength : 4096;
-        msRecord.pubversion = 1;
-        msRecord.starttime
-            = static_cast<int64_t> (packet.getStartTime().count());
-        msRecord.samprate = packet.getSamplingRate();
-        msRecord.numsamples = packet.getNumberOfSamples();
+        plan = ::planMiniSEEDRecords(msRecord, useMiniSEED3);
     }
-    catch (const std::exception &e)
+    catch (...)
     {
-        throw std::runtime_error("Failed to pack mseed record because "
-                               + std::string {e.what()});
+        msRecord.datasamples = nullptr;
+        throw;
     }
-    // Pack the sid
-    const auto streamIdentifier = packet.getStreamIdentifierReference();
-    std::string locationCode;
-    if (streamIdentifier.hasLocationCode())
+    if (!flushPackets && plan.samplesPerRecord > 0 && logger &&
+        msRecord.numsamples%plan.samplesPerRecord != 0)
     {
-        locationCode = streamIdentifier.getLocationCode();
+        SPDLOG_LOGGER_DEBUG(logger,
+            "Final record for {} will be partially filled",
+            *dataLinkIdentifier);
     }
-    auto sidLength
-        = ms_nslc2sid(
-            msRecord.sid, LM_SIDLEN, 0,
-            const_cast<char *> (streamIdentifier.getNetwork().c_str()),
-            const_cast<char *> (streamIdentifier.getStation().c_str()),
-            const_cast<char *> (locationCode.c_str()),
-            const_cast<char *> (streamIdentifier.getChannel().c_str()));
-    if (sidLength < 1)
-    {
-        throw std::runtime_error("Failed to pack SID");
-    }
-    // Now do the data
-    auto dataType = packet.getDataType(); 
-    std::vector<double> i64Data;
-    if (msRecord.numsamples > 0)
-    {
-        if (dataType == Packet::DataType::Integer32)
-        {
-            msRecord.encoding = DE_INT32;
-            if (compression == Compression::STEIM1)
-            {
-                msRecord.encoding = DE_STEIM1;
-            }
-            else if (compression == Compression::STEIM2)
-            {
-                msRecord.encoding = DE_STEIM2;
-            }
-            msRecord.sampletype = 'i';
-            msRecord.datasamples = (void *) packet.getDataPointer();
-            //    = reinterpret_cast<void *> (pImpl->mInteger32Data.data());
-        }
-        else if (dataType == Packet::DataType::Float)
-        {
-            msRecord.encoding = DE_FLOAT32;
-            msRecord.sampletype = 'f';
-            msRecord.datasamples = (void *) packet.getDataPointer();
-            //    = reinterpret_cast<void *> (pImpl->mFloatData.data());
-        }
-        else if (dataType == Packet::DataType::Double)
-        {
-            msRecord.encoding = DE_FLOAT64;
-            msRecord.sampletype = 'd';
-            msRecord.datasamples = (void *) packet.getDataPointer();
-            //   = reinterpret_cast<void *> (pImpl->mDoubleData.data());
-        }
-        else if (dataType == Packet::DataType::Text)
-        {
-            msRecord.encoding = DE_TEXT;
-            msRecord.sampletype = 't';
-            msRecord.datasamples = (void *) packet.getDataPointer();
-            //   = reinterpret_cast<void *> (pImpl->mTextData.data());
-        }
-        else
-        {
-            throw std::runtime_error("Unhandled precision");
-        }
-    }
-    msRecord.samplecnt = msRecord.numsamples;
-    // Flushing packets is a dangerous activity.  Basically we need to exceed
-    // some amount based on the max record size.
-    if (!flushPackets)
-    {
-        uint32_t writeToBufferFlags{0};
-        writeToBufferFlags |= MSF_MAINTAINMSTL; // Do not modify while packing
-        if (!useMiniSEED3){writeToBufferFlags |= MSF_PACKVER2;}
-        int64_t packedSamplesCount{0};
-        constexpr int8_t verbose{0};
-        auto nRecordsCreated = msr3_pack(&msRecord,
-                                         &msRecordHandler,
-                                         &outputPackets,
-                                         &packedSamplesCount,
-                                         writeToBufferFlags,
-                                         verbose);
-        bool isOkay{true};
-        if (nRecordsCreated < 1 && isOkay)
-        {
-            isOkay = false;
-            if (logger)
-            {
-                SPDLOG_LOGGER_WARN(logger,
-                    "Failed to create any packets - failing through");
-            }
-        }
-        if (nRecordsCreated != static_cast<int> (outputPackets.size())
-            && isOkay)
-        {
-            isOkay = false;
-            if (logger)
-            {
-                SPDLOG_LOGGER_WARN(logger,
-                   "Inconsistent records created/output packets created - failing through");
-            }
-        }
-        if (msRecord.numsamples > 0 &&
-            packedSamplesCount < msRecord.numsamples && isOkay)
-        {
-            if (logger)
-            {
-                SPDLOG_LOGGER_WARN(logger,
-                                   "Its possible not all samples were packed");
-            }
-        }
-        if (isOkay)
-        {
-            for (const auto &packet : outputPackets)
-            {
-                constexpr size_t maxDataLinkSize{512};
-                if (packet.data.size() > maxDataLinkSize)
-                {
-                    isOkay = false;
-                    if (logger)
-                    {
-                        SPDLOG_LOGGER_WARN(logger,
-                          "Output packet too big - repacking");
-                    }
-                }
-            }
-        }
-        if (isOkay){return outputPackets;}
-        outputPackets.clear();
-    }
-    // Fail through 
+    outputPackets.reserve(nRecordsBefore + plan.numberOfRecords);
     uint32_t writeToBufferFlags{0};
     writeToBufferFlags |= MSF_FLUSHDATA;
     writeToBufferFlags |= MSF_MAINTAINMSTL; // Do not modify while packing
     if (!useMiniSEED3){writeToBufferFlags |= MSF_PACKVER2;}
+    RecordHandlerContext context
+    {
+        &outputPackets,
+        &pool,
+        packet.getStartTime(),
+        msRecord.samprate,
+        0,
+        useMiniSEED3,
+        packet.getPipelineTimestampsReference()
+    };
     int64_t packedSamplesCount{0};
     constexpr int8_t verbose{0};
     auto nRecordsCreated = msr3_pack(&msRecord,
                                      &msRecordHandler,
-                                     &outputPackets,
+                                     &context,
                                      &packedSamplesCount,
                                      writeToBufferFlags,
                                      verbose);
@@ -629,11 +557,19 @@ USEEDLinkToRingServer::toDataLinkPackets(
     }
     if (logger)
     {
-        if (nRecordsCreated != static_cast<int> (outputPackets.size()))
+        if (nRecordsCreated !=
+            static_cast<int> (outputPackets.size() - nRecordsBefore))
         {
             SPDLOG_LOGGER_WARN(logger,
                 "Inconsistent records created/output packets created");
         }
+        if (plan.samplesPerRecord > 0 &&
+            nRecordsCreated != plan.numberOfRecords)
+        {
+            SPDLOG_LOGGER_WARN(logger,
+                "Expected {} records for {} but created {}",
+                plan.numberOfRecords, *dataLinkIdentifier, nRecordsCreated);
+        }
         if (msRecord.numsamples > 0 &&
             packedSamplesCount < msRecord.numsamples)
         { 
@@ -641,73 +577,65 @@ USEEDLinkToRingServer::toDataLinkPackets(
                                "Its possible not all samples were packed");
         }
     }
-    return outputPackets;
+    for (auto i = nRecordsBefore; i < outputPackets.size(); ++i)
+    {
+        outputPackets[i].streamIdentifier = dataLinkIdentifier;
+    }
 }
 
 double USEEDLinkToRingServer::computeSumOfSamples(const Packet &packet)
 {
-    double result{0};
-    auto nSamples = packet.getNumberOfSamples();
-    if (nSamples < 1){return 0;}
-    auto dataType = packet.getDataType();
-    constexpr double zero{0};
-    if (dataType == Packet::DataType::Integer32)
-    {
-        auto dPtr = static_cast<const int *> (packet.getDataPointer()); 
-        result = std::accumulate(dPtr, dPtr + nSamples, zero);
-    }
-    else if (dataType == Packet::DataType::Double)
-    {
-        auto dPtr = static_cast<const double *> (packet.getDataPointer());
-        result = std::accumulate(dPtr, dPtr + nSamples, zero);
-    }
-    else if (dataType == Packet::DataType::Float)
-    {
-        auto dPtr = static_cast<const float *> (packet.getDataPointer());
-        result = std::accumulate(dPtr, dPtr + nSamples, zero);
-    }
-    else if (dataType == Packet::DataType::Text)
+    if (packet.getNumberOfSamples() < 1){return 0;}
+    return packet.visit([](const auto samples) -> double
     {
-        throw std::runtime_error("Cannot compute sum of text data");
-    }
-    else
-    {
-        throw std::runtime_error("Unhandled data type");
-    }
-    return result; 
+        using T = typename decltype(samples)::value_type;
+        if constexpr (std::is_same_v<T, char>)
+        {
+            throw std::runtime_error("Cannot compute sum of text data");
+        }
+        else
+        {
+            constexpr double zero{0};
+            return std::accumulate(samples.begin(), samples.end(), zero);
+        }
+    });
 }
 
 double USEEDLinkToRingServer::computeSumOfSamplesSquared(const Packet &packet)
 {
-    double result{0};
-    auto nSamples = packet.getNumberOfSamples();
-    if (nSamples < 1){return 0;} 
-    auto dataType = packet.getDataType();
-    constexpr double zero{0};
-    if (dataType == Packet::DataType::Integer32)
+    if (packet.getNumberOfSamples() < 1){return 0;}
+    return packet.visit([](const auto samples) -> double
     {
-        auto dPtr = static_cast<const int *> (packet.getDataPointer()); 
-        result = std::inner_product(dPtr, dPtr + nSamples, dPtr, zero);
-    }   
-    else if (dataType == Packet::DataType::Double)
+        using T = typename decltype(samples)::value_type;
+        if constexpr (std::is_same_v<T, char>)
+        {
+            throw std::runtime_error("Cannot compute sum squared of text data");
+        }
+        else
+        {
+            constexpr double zero{0};
+            return std::inner_product(samples.begin(), samples.end(),
+                                      samples.begin(), zero);
+        }
+    });
+}
+
+SampleStatistics
+USEEDLinkToRingServer::computeSampleStatistics(const Packet &packet)
+{
+    if (packet.getNumberOfSamples() < 1){return SampleStatistics {};}
+    return packet.visit([](const auto samples) -> SampleStatistics
     {
-        auto dPtr = static_cast<const double *> (packet.getDataPointer());
-        result = std::inner_product(dPtr, dPtr + nSamples, dPtr, zero);
-    }   
-    else if (dataType == Packet::DataType::Float)
-    {   
-        auto dPtr = static_cast<const float *> (packet.getDataPointer());
-        result = std::inner_product(dPtr, dPtr + nSamples, dPtr, zero);
-    }   
-    else if (dataType == Packet::DataType::Text)
-    {   
-        throw std::runtime_error("Cannot compute sum squared of text data");
-    }   
-    else
-    {   
-        throw std::runtime_error("Unhandled data type");
-    }   
-    return result; 
+        using T = typename decltype(samples)::value_type;
+        if constexpr (std::is_same_v<T, char>)
+        {
+            throw std::runtime_error("Cannot compute statistics of text data");
+        }
+        else
+        {
+            return ::computeStatistics(samples);
+        }
+    });
 }
 
 
@@ -733,3 +661,8 @@ template std::vector<int> USEEDLinkToRingServer::Packet::getData<int> () const n
 template std::vector<double> USEEDLinkToRingServer::Packet::getData<double> () const noexcept;
 template std::vector<float> USEEDLinkToRingServer::Packet::getData<float> () const noexcept;
 template std::vector<char> USEEDLinkToRingServer::Packet::getData<char> () const noexcept;
+
+template std::span<const int> USEEDLinkToRingServer::Packet::getDataSpan<int> () const;
+template std::span<const double> USEEDLinkToRingServer::Packet::getDataSpan<double> () const;
+template std::span<const float> USEEDLinkToRingServer::Packet::getDataSpan<float> () const;
+template std::span<const char> USEEDLinkToRingServer::Packet::getDataSpan<char> () const;
@@ -4,6 +4,7 @@
 #include <vector>
 #include <filesystem>
 #include <chrono>
+#include <cstdint>
 #include "uSEEDLinkToRingServer/seedLinkClientOptions.hpp"
 #include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
 //#include "uSEEDLinkToRingServer/seedLinkWriterOptions.hpp"
@@ -22,12 +23,20 @@ struct OTelGRPCMetricsOptions
     std::filesystem::path certificatePath; // Path to the cert file
 };
 
+struct OTelBatchLogOptions
+{
+    int maximumQueueSize{2048}; // Records beyond this are dropped
+    int maximumExportBatchSize{512};
+    std::chrono::milliseconds exportInterval{1000};
+};
+
 struct OTelGRPCLogOptions
 {
     std::string url{"localhost"};
     uint16_t port{4317};
     //std::chrono::milliseconds exportTimeOut{500};
     std::filesystem::path certificatePath; // Path to the cert file
+    ::OTelBatchLogOptions batchOptions;
 };
 
 struct OTelHTTPMetricsOptions
@@ -43,6 +52,7 @@ struct OTelHTTPLogOptions
     std::string url{"localhost:4318"};
     std::filesystem::path certificatePath;
     std::string suffix{"/v1/logs"};
+    ::OTelBatchLogOptions batchOptions;
 };
 
 struct ProgramOptions
@@ -52,7 +62,7 @@ struct ProgramOptions
     ::OTelGRPCMetricsOptions otelGRPCMetricsOptions;
     ::OTelHTTPLogOptions otelHTTPLogOptions;
     ::OTelGRPCLogOptions otelGRPCLogOptions;
-    //std::string prometheusURL{"localhost:9020"}; 
+    std::string prometheusHost{"localhost"}; // Address of /metrics endpoint
     std::vector<USEEDLinkToRingServer::DataLinkClientOptions>
         dataLinkClientOptions;
     //std::vector<USEEDLinkToRingServer::SEEDLinkWriterOptions>
@@ -60,12 +70,19 @@ struct ProgramOptions
     USEEDLinkToRingServer::SEEDLinkClientOptions seedLinkClientOptions;
     std::string dataSource;
     std::chrono::minutes printSummaryInterval{std::chrono::minutes {15}};
+    std::chrono::minutes streamMetricsTimeOut{std::chrono::hours {24}};
+    double continuityTolerance{0.5}; // Sample periods
+    int maximumNumberOfStreamMetrics{0};
     int importQueueSize{8192};
+    int logQueueSize{8192};
     int verbosity{3};
+    uint16_t prometheusPort{9200};
     bool exportLogs{false};
     bool exportMetrics{false};
     bool exportMetricsWithHTTP{true};
+    bool exportPrometheusMetrics{false};
     bool exportLogsWithHTTP{true};
+    bool useDataLinkEventLoop{false};
 };
 
 ::ProgramOptions parseIniFile(const std::filesystem::path &iniFile);
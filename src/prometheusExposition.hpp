@@ -0,0 +1,257 @@
+#ifndef PROMETHEUS_EXPOSITION_HPP
+#define PROMETHEUS_EXPOSITION_HPP
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+
+/// @brief The labels of a Prometheus sample.  The labels are views so
+///        building them does not allocate; the referenced strings must
+///        outlive the sample being written.
+class PrometheusLabels
+{
+public:
+    static constexpr size_t MaximumNumberOfLabels{8};
+    PrometheusLabels() = default;
+    /// @brief Adds the attributes of an OTel instrument as labels.
+    explicit PrometheusLabels(
+        const std::map<std::string, std::string> &attributes)
+    {
+        for (const auto &[key, value] : attributes){add(key, value);}
+    }
+    /// @brief Adds a label.
+    /// @throws std::length_error if there are too many labels.
+    void add(const std::string_view key, const std::string_view value)
+    {
+        if (mSize >= mLabels.size())
+        {
+            throw std::length_error("Too many Prometheus labels");
+        }
+        mLabels[mSize] = std::pair {key, value};
+        mSize = mSize + 1;
+    }
+    /// @brief Sets the label's value, adding the label if necessary.
+    void set(const std::string_view key, const std::string_view value)
+    {
+        for (size_t i = 0; i < mSize; ++i)
+        {
+            if (mLabels[i].first == key)
+            {
+                mLabels[i].second = value;
+                return;
+            }
+        }
+        add(key, value);
+    }
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return mSize;
+    }
+    [[nodiscard]] const std::pair<std::string_view, std::string_view> &
+        operator[](const size_t index) const noexcept
+    {
+        return mLabels[index];
+    }
+private:
+    std::array<std::pair<std::string_view, std::string_view>,
+               MaximumNumberOfLabels> mLabels{};
+    size_t mSize{0};
+};
+
+/// @brief Serializes metrics in the Prometheus text exposition format
+///        (version 0.0.4).  The output buffer is kept between scrapes so,
+///        once it has grown to the size of a scrape, writing a scrape does
+///        not allocate.
+class PrometheusTextWriter
+{
+public:
+    /// @brief Empties the buffer but keeps its capacity.
+    void clear() noexcept
+    {
+        mBuffer.clear();
+    }
+    /// @result The serialized metrics.
+    [[nodiscard]] const std::string &getText() const noexcept
+    {
+        return mBuffer;
+    }
+    /// @brief Begins a metric family.
+    /// @param[in] name  The family's name, e.g., seismic_data_packets_total.
+    /// @param[in] type  The family's type, e.g., counter, gauge, histogram.
+    /// @param[in] help  The family's description.
+    void writeHeader(const std::string_view name,
+                     const std::string_view type,
+                     const std::string_view help)
+    {
+        mBuffer.append("# HELP ");
+        mBuffer.append(name);
+        mBuffer.push_back(' ');
+        for (const auto c : help)
+        {
+            if (c == '\\')
+            {
+                mBuffer.append("\\\\");
+            }
+            else if (c == '\n')
+            {
+                mBuffer.append("\\n");
+            }
+            else
+            {
+                mBuffer.push_back(c);
+            }
+        }
+        mBuffer.append("\n# TYPE ");
+        mBuffer.append(name);
+        mBuffer.push_back(' ');
+        mBuffer.append(type);
+        mBuffer.push_back('\n');
+    }
+    /// @brief Writes a sample of the current family.
+    void writeSample(const std::string_view name,
+                     const PrometheusLabels &labels,
+                     const int64_t value)
+    {
+        writeName(name, labels);
+        appendNumber(value);
+        mBuffer.push_back('\n');
+    }
+    /// @brief Writes a sample of the current family.
+    void writeSample(const std::string_view name,
+                     const PrometheusLabels &labels,
+                     const double value)
+    {
+        writeName(name, labels);
+        appendNumber(value);
+        mBuffer.push_back('\n');
+    }
+    /// @brief Writes a histogram's samples.
+    /// @param[in] name              The family's name.
+    /// @param[in] labels            The histogram's labels.
+    /// @param[in] cumulativeCounts  The number of observations no larger
+    ///                              than each bucket's bound.  The last
+    ///                              bucket is +Inf.
+    /// @param[in] bucketLabels      The bucket bounds formatted as "le"
+    ///                              labels.
+    /// @param[in] sum               The sum of the observations.
+    template<typename Counts, typename BucketLabels>
+    void writeHistogram(const std::string_view name,
+                        PrometheusLabels labels,
+                        const Counts &cumulativeCounts,
+                        const BucketLabels &bucketLabels,
+                        const double sum)
+    {
+        auto nLabels = labels.size();
+        for (size_t i = 0; i < cumulativeCounts.size(); ++i)
+        {
+            labels.set("le", bucketLabels[i]);
+            writeName(name, "_bucket", labels);
+            appendNumber(static_cast<int64_t> (cumulativeCounts[i]));
+            mBuffer.push_back('\n');
+        }
+        // Drop the le label
+        PrometheusLabels histogramLabels;
+        for (size_t i = 0; i < nLabels; ++i)
+        {
+            histogramLabels.add(labels[i].first, labels[i].second);
+        }
+        writeName(name, "_sum", histogramLabels);
+        appendNumber(sum);
+        mBuffer.push_back('\n');
+        writeName(name, "_count", histogramLabels);
+        int64_t count{0};
+        if (cumulativeCounts.size() > 0)
+        {
+            count = static_cast<int64_t> (cumulativeCounts.back());
+        }
+        appendNumber(count);
+        mBuffer.push_back('\n');
+    }
+private:
+    void writeName(const std::string_view name,
+                   const PrometheusLabels &labels)
+    {
+        writeName(name, std::string_view {}, labels);
+    }
+    void writeName(const std::string_view name,
+                   const std::string_view suffix,
+                   const PrometheusLabels &labels)
+    {
+        mBuffer.append(name);
+        mBuffer.append(suffix);
+        if (labels.size() > 0)
+        {
+            mBuffer.push_back('{');
+            for (size_t i = 0; i < labels.size(); ++i)
+            {
+                if (i > 0){mBuffer.push_back(',');}
+                mBuffer.append(labels[i].first);
+                mBuffer.append("=\"");
+                appendLabelValue(labels[i].second);
+                mBuffer.push_back('"');
+            }
+            mBuffer.push_back('}');
+        }
+        mBuffer.push_back(' ');
+    }
+    void appendLabelValue(const std::string_view value)
+    {
+        for (const auto c : value)
+        {
+            if (c == '\\')
+            {
+                mBuffer.append("\\\\");
+            }
+            else if (c == '"')
+            {
+                mBuffer.append("\\\"");
+            }
+            else if (c == '\n')
+            {
+                mBuffer.append("\\n");
+            }
+            else
+            {
+                mBuffer.push_back(c);
+            }
+        }
+    }
+    void appendNumber(const int64_t value)
+    {
+        std::array<char, 32> digits;
+        auto [end, error]
+            = std::to_chars(digits.data(), digits.data() + digits.size(),
+                            value);
+        mBuffer.append(digits.data(), end);
+    }
+    void appendNumber(const double value)
+    {
+        if (std::isnan(value))
+        {
+            mBuffer.append("NaN");
+            return;
+        }
+        if (std::isinf(value))
+        {
+            mBuffer.append(value > 0 ? "+Inf" : "-Inf");
+            return;
+        }
+        std::array<char, 32> digits;
+        auto [end, error]
+            = std::to_chars(digits.data(), digits.data() + digits.size(),
+                            value);
+        mBuffer.append(digits.data(), end);
+    }
+    std::string mBuffer;
+};
+
+}
+#endif
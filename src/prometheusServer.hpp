@@ -0,0 +1,284 @@
+#ifndef PROMETHEUS_SERVER_HPP
+#define PROMETHEUS_SERVER_HPP
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include "prometheusExposition.hpp"
+
+namespace
+{
+
+/// @brief A minimal HTTP server from which Prometheus pulls the metrics.
+///        GET /metrics serializes the in-process counters into a buffer
+///        that is reused between scrapes.  GET /health answers from the
+///        server thread alone so a health check never waits on, or reads
+///        from, the data path.  Connections are served one at a time and
+///        closed after the response which is all a scraper needs.
+class PrometheusServer
+{
+public:
+    /// @brief Binds and listens on the address.
+    /// @param[in] host     The address on which to listen, e.g., localhost
+    ///                     or 0.0.0.0.
+    /// @param[in] port     The port on which to listen.
+    /// @param[in] collect  Writes the metrics for a scrape.
+    /// @param[in] logger   The logger.
+    /// @throws std::runtime_error if the address cannot be bound.
+    PrometheusServer(const std::string &host,
+                     const uint16_t port,
+                     std::function<void (::PrometheusTextWriter &)> collect,
+                     std::shared_ptr<spdlog::logger> logger) :
+        mCollect(std::move(collect)),
+        mLogger(logger)
+    {
+        if (!mCollect){throw std::invalid_argument("Collect function not set");}
+        if (mLogger == nullptr){mLogger = spdlog::default_logger();}
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo *addresses{nullptr};
+        auto service = std::to_string(port);
+        auto status = ::getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                    service.c_str(),
+                                    &hints, &addresses);
+        if (status != 0)
+        {
+            throw std::runtime_error("Failed to resolve Prometheus address "
+                                   + host + ":" + service + " because "
+                                   + std::string {::gai_strerror(status)});
+        }
+        std::string reason{"no address"};
+        for (auto address = addresses;
+             address != nullptr;
+             address = address->ai_next)
+        {
+            auto socket = ::socket(address->ai_family,
+                                   address->ai_socktype | SOCK_CLOEXEC,
+                                   address->ai_protocol);
+            if (socket < 0)
+            {
+                reason = std::strerror(errno);
+                continue;
+            }
+            int reuse{1};
+            ::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR,
+                         &reuse, sizeof(reuse));
+            if (::bind(socket, address->ai_addr, address->ai_addrlen) == 0 &&
+                ::listen(socket, 16) == 0)
+            {
+                mSocket = socket;
+                break;
+            }
+            reason = std::strerror(errno);
+            ::close(socket);
+        }
+        ::freeaddrinfo(addresses);
+        if (mSocket < 0)
+        {
+            throw std::runtime_error("Failed to listen on Prometheus address "
+                                   + host + ":" + service + " because "
+                                   + reason);
+        }
+        mAddress = host + ":" + service;
+    }
+    /// @brief Starts serving requests.
+    void start()
+    {
+        stop();
+        mKeepRunning = true;
+        mThread = std::thread(&PrometheusServer::run, this);
+        SPDLOG_LOGGER_INFO(mLogger, "Serving Prometheus metrics on {}",
+                           mAddress);
+    }
+    /// @brief Stops serving requests.
+    void stop()
+    {
+        mKeepRunning = false;
+        if (mThread.joinable()){mThread.join();}
+    }
+    /// @brief Destructor.
+    ~PrometheusServer()
+    {
+        stop();
+        if (mSocket >= 0){::close(mSocket);}
+    }
+    PrometheusServer(const PrometheusServer &) = delete;
+    PrometheusServer& operator=(const PrometheusServer &) = delete;
+private:
+    void run()
+    {
+        // Poll with a time out so a stop request is noticed
+        constexpr int pollTimeOut{100}; // Milliseconds
+        while (mKeepRunning.load(std::memory_order_relaxed))
+        {
+            pollfd descriptor{mSocket, POLLIN, 0};
+            auto nReady = ::poll(&descriptor, 1, pollTimeOut);
+            if (nReady < 0)
+            {
+                if (errno == EINTR){continue;}
+                SPDLOG_LOGGER_ERROR(mLogger,
+                                    "Prometheus server poll failed because {}",
+                                    std::string {std::strerror(errno)});
+                break;
+            }
+            if (nReady == 0){continue;}
+            auto client = ::accept4(mSocket, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0){continue;}
+            try
+            {
+                serve(client);
+            }
+            catch (const std::exception &e)
+            {
+                SPDLOG_LOGGER_WARN(mLogger,
+                                   "Failed to serve Prometheus request because {}",
+                                   std::string {e.what()});
+            }
+            ::close(client);
+        }
+    }
+    void serve(const int client)
+    {
+        // A stalled client can only hold up the next scrape so long
+        timeval timeOut{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO,
+                     &timeOut, sizeof(timeOut));
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO,
+                     &timeOut, sizeof(timeOut));
+        // Only the request line matters so stop reading at the end of the
+        // headers or when the buffer is full
+        size_t length{0};
+        while (length < mRequest.size())
+        {
+            auto nRead = ::recv(client, mRequest.data() + length,
+                                mRequest.size() - length, 0);
+            if (nRead < 0 && errno == EINTR){continue;}
+            if (nRead <= 0){break;}
+            length = length + static_cast<size_t> (nRead);
+            std::string_view received{mRequest.data(), length};
+            if (received.find("\r\n\r\n") != std::string_view::npos){break;}
+        }
+        std::string_view request{mRequest.data(), length};
+        auto endOfLine = request.find("\r\n");
+        if (endOfLine == std::string_view::npos)
+        {
+            respond(client, "400 Bad Request", "Bad request\n", true);
+            return;
+        }
+        auto requestLine = request.substr(0, endOfLine);
+        auto endOfMethod = requestLine.find(' ');
+        auto endOfTarget = requestLine.find(' ', endOfMethod + 1);
+        if (endOfMethod == std::string_view::npos ||
+            endOfTarget == std::string_view::npos)
+        {
+            respond(client, "400 Bad Request", "Bad request\n", true);
+            return;
+        }
+        auto method = requestLine.substr(0, endOfMethod);
+        auto target = requestLine.substr(endOfMethod + 1,
+                                         endOfTarget - endOfMethod - 1);
+        // Ignore any query string
+        target = target.substr(0, target.find('?'));
+        bool includeBody{method == "GET"};
+        if (method != "GET" && method != "HEAD")
+        {
+            respond(client, "405 Method Not Allowed", "Method not allowed\n",
+                    true);
+            return;
+        }
+        if (target == "/metrics")
+        {
+            mWriter.clear();
+            mCollect(mWriter);
+            respond(client, "200 OK", mWriter.getText(), includeBody,
+                    "text/plain; version=0.0.4; charset=utf-8");
+        }
+        else if (target == "/health" || target == "/healthz")
+        {
+            respond(client, "200 OK", "OK\n", includeBody);
+        }
+        else
+        {
+            respond(client, "404 Not Found", "Not found\n", includeBody);
+        }
+    }
+    void respond(const int client,
+                 const std::string_view status,
+                 const std::string_view body,
+                 const bool includeBody,
+                 const std::string_view contentType = "text/plain; charset=utf-8")
+    {
+        mHeader.clear();
+        mHeader.append("HTTP/1.1 ");
+        mHeader.append(status);
+        mHeader.append("\r\nContent-Type: ");
+        mHeader.append(contentType);
+        mHeader.append("\r\nContent-Length: ");
+        std::array<char, 32> digits;
+        auto [end, error]
+            = std::to_chars(digits.data(), digits.data() + digits.size(),
+                            body.size());
+        mHeader.append(digits.data(), end);
+        mHeader.append("\r\nConnection: close\r\n\r\n");
+        // Send the header and body together without copying the body
+        std::array<iovec, 2> vectors
+        {
+            iovec {mHeader.data(), mHeader.size()},
+            iovec {const_cast<char *> (body.data()),
+                   includeBody ? body.size() : 0}
+        };
+        msghdr message{};
+        message.msg_iov = vectors.data();
+        message.msg_iovlen = vectors.size();
+        while (vectors[0].iov_len + vectors[1].iov_len > 0)
+        {
+            auto nSent = ::sendmsg(client, &message, MSG_NOSIGNAL);
+            if (nSent < 0)
+            {
+                if (errno == EINTR){continue;}
+                throw std::runtime_error("Send failed because "
+                                       + std::string {std::strerror(errno)});
+            }
+            auto remaining = static_cast<size_t> (nSent);
+            for (auto &vector : vectors)
+            {
+                auto consumed = std::min(remaining, vector.iov_len);
+                vector.iov_base = static_cast<char *> (vector.iov_base)
+                                + consumed;
+                vector.iov_len = vector.iov_len - consumed;
+                remaining = remaining - consumed;
+            }
+        }
+    }
+    std::function<void (::PrometheusTextWriter &)> mCollect;
+    std::shared_ptr<spdlog::logger> mLogger{nullptr};
+    ::PrometheusTextWriter mWriter;
+    std::array<char, 4096> mRequest{};
+    std::string mHeader;
+    std::string mAddress;
+    std::thread mThread;
+    std::atomic<bool> mKeepRunning{false};
+    int mSocket{-1};
+};
+
+}
+#endif
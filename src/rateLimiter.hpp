@@ -0,0 +1,137 @@
+#ifndef RATE_LIMITER_HPP
+#define RATE_LIMITER_HPP
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
+
+namespace
+{
+
+/// @brief A token bucket.  Tokens accrue continuously at the given rate up
+///        to the capacity.  Time is tracked with the steady clock at
+///        nanosecond resolution so the pacing is exact rather than
+///        quantized by a sleep interval.
+class TokenBucket
+{
+public:
+    /// @brief Creates an unlimited bucket.
+    TokenBucket() = default;
+    /// @param[in] rate      The tokens added per second.  If this is not
+    ///                      positive then the bucket is unlimited.
+    /// @param[in] capacity  The maximum number of tokens.  This is the burst.
+    TokenBucket(const double rate, const double capacity) :
+        mRate(rate),
+        mCapacity(std::max(1.0, capacity)),
+        mTokens(mCapacity),
+        mLimited(rate > 0)
+    {
+    }
+    /// @result True indicates tokens can be taken.
+    [[nodiscard]] bool canConsume(const double tokens,
+                                  const std::chrono::steady_clock::time_point &now)
+    {
+        if (!mLimited){return true;}
+        refill(now);
+        // A request larger than the bucket is allowed once it is full
+        return mTokens >= std::min(tokens, mCapacity);
+    }
+    /// @brief Takes tokens.  This can leave the bucket in debt.
+    void consume(const double tokens)
+    {
+        if (mLimited){mTokens = mTokens - tokens;}
+    }
+    /// @result The time until the tokens can be taken.
+    [[nodiscard]] std::chrono::nanoseconds
+        getWaitTime(const double tokens,
+                    const std::chrono::steady_clock::time_point &now) const
+    {
+        if (!mLimited){return std::chrono::nanoseconds {0};}
+        auto available = mTokens;
+        if (now > mLastRefill)
+        {
+            std::chrono::duration<double> elapsed = now - mLastRefill;
+            available = std::min(mCapacity, mTokens + elapsed.count()*mRate);
+        }
+        auto deficit = std::min(tokens, mCapacity) - available;
+        if (deficit <= 0){return std::chrono::nanoseconds {0};}
+        return std::chrono::nanoseconds
+               {
+                   static_cast<int64_t> (std::ceil(deficit/mRate*1.e9))
+               };
+    }
+private:
+    void refill(const std::chrono::steady_clock::time_point &now)
+    {
+        if (now > mLastRefill)
+        {
+            std::chrono::duration<double> elapsed = now - mLastRefill;
+            mTokens = std::min(mCapacity, mTokens + elapsed.count()*mRate);
+            mLastRefill = now;
+        }
+    }
+    std::chrono::steady_clock::time_point mLastRefill
+    {
+        std::chrono::steady_clock::now()
+    };
+    double mRate{0};
+    double mCapacity{std::numeric_limits<double>::max()};
+    double mTokens{std::numeric_limits<double>::max()};
+    bool mLimited{false};
+};
+
+/// @brief Limits a writer's record and byte rates.
+class RateLimiter
+{
+public:
+    /// @brief Creates an unlimited rate limiter.
+    RateLimiter() = default;
+    /// @brief Creates the rate limiter from the writer's options.
+    explicit RateLimiter(
+        const USEEDLinkToRingServer::DataLinkClientOptions &options)
+    {
+        std::chrono::duration<double> burst = options.getBurstAllowance();
+        auto packetsPerSecond = options.getMaximumPacketsPerSecond();
+        auto bytesPerSecond = options.getMaximumBytesPerSecond();
+        mPackets = TokenBucket(packetsPerSecond, packetsPerSecond*burst.count());
+        mBytes = TokenBucket(bytesPerSecond, bytesPerSecond*burst.count());
+        mLimited = packetsPerSecond > 0 || bytesPerSecond > 0;
+    }
+    /// @result True indicates the rate is limited.
+    [[nodiscard]] bool isLimited() const noexcept
+    {
+        return mLimited;
+    }
+    /// @brief Attempts to take the allowance for sending a record.
+    /// @result True indicates the record can be sent now.
+    [[nodiscard]] bool tryAcquire(const size_t nBytes,
+                                  const std::chrono::steady_clock::time_point &now)
+    {
+        if (!mLimited){return true;}
+        auto bytes = static_cast<double> (nBytes);
+        if (mPackets.canConsume(1, now) && mBytes.canConsume(bytes, now))
+        {
+            mPackets.consume(1);
+            mBytes.consume(bytes);
+            return true;
+        }
+        return false;
+    }
+    /// @result The time until a record of the given size can be sent.
+    [[nodiscard]] std::chrono::nanoseconds
+        getWaitTime(const size_t nBytes,
+                    const std::chrono::steady_clock::time_point &now) const
+    {
+        if (!mLimited){return std::chrono::nanoseconds {0};}
+        return std::max(mPackets.getWaitTime(1, now),
+                        mBytes.getWaitTime(static_cast<double> (nBytes), now));
+    }
+private:
+    TokenBucket mPackets;
+    TokenBucket mBytes;
+    bool mLimited{false};
+};
+
+}
+#endif
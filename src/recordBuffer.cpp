@@ -0,0 +1,278 @@
+#include <array>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
+
+using namespace USEEDLinkToRingServer;
+
+namespace USEEDLinkToRingServer
+{
+/// The memory behind a record buffer pool.  This is shared with the
+/// outstanding buffers so that it outlives the pool if need be.
+///
+/// Slabs are identified by a 32-bit index and the free list is a Treiber
+/// stack whose head packs a 32-bit modification tag above the index of the
+/// top slab.  The tag is bumped on every update which defeats the ABA
+/// problem.  Chunks are only ever appended to a fixed-size table so the
+/// index to address map never moves underneath a reader.  Growing the
+/// arena is rare and is serialized with a mutex.
+class RecordBufferArena
+{
+public:
+    static constexpr uint32_t mEmpty{std::numeric_limits<uint32_t>::max()};
+    static constexpr size_t mMaximumNumberOfChunks{4096};
+    struct Chunk
+    {
+        std::unique_ptr<char[]> slabs;
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+    };
+    RecordBufferArena(const int slabSize, const int slabsPerChunk) :
+        mSlabSize(static_cast<size_t> (slabSize)),
+        mSlabsPerChunk(static_cast<uint32_t> (slabsPerChunk))
+    {
+        for (auto &chunk : mChunks){chunk.store(nullptr);}
+    }
+    ~RecordBufferArena()
+    {
+        for (auto &chunk : mChunks)
+        {
+            delete chunk.load(std::memory_order_relaxed);
+        }
+    }
+    [[nodiscard]] static uint32_t toIndex(const uint64_t head) noexcept
+    {
+        return static_cast<uint32_t> (head & 0xFFFFFFFF);
+    }
+    [[nodiscard]] static uint64_t toHead(const uint64_t previousHead,
+                                         const uint32_t index) noexcept
+    {
+        return (((previousHead >> 32) + 1) << 32) | index;
+    }
+    [[nodiscard]] const Chunk &getChunk(const uint32_t index) const noexcept
+    {
+        return *mChunks[index/mSlabsPerChunk].load(std::memory_order_acquire);
+    }
+    [[nodiscard]] std::atomic<uint32_t> &next(const uint32_t index) const noexcept
+    {
+        return getChunk(index).next[index%mSlabsPerChunk];
+    }
+    [[nodiscard]] char *toSlab(const uint32_t index) const noexcept
+    {
+        return getChunk(index).slabs.get() + (index%mSlabsPerChunk)*mSlabSize;
+    }
+    /// Pops a slab from the free list
+    [[nodiscard]] uint32_t pop() noexcept
+    {
+        auto head = mHead.load(std::memory_order_acquire);
+        while (true)
+        {
+            auto index = toIndex(head);
+            if (index == mEmpty){return mEmpty;}
+            auto nextIndex = next(index).load(std::memory_order_relaxed);
+            if (mHead.compare_exchange_weak(head,
+                                            toHead(head, nextIndex),
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire))
+            {
+                mAvailable.fetch_sub(1, std::memory_order_relaxed);
+                return index;
+            }
+        }
+    }
+    /// Pushes the chain first -> ... -> last onto the free list
+    void push(const uint32_t first, const uint32_t last,
+              const int64_t count) noexcept
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        do
+        {
+            next(last).store(toIndex(head), std::memory_order_relaxed);
+        }
+        while (!mHead.compare_exchange_weak(head,
+                                            toHead(head, first),
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+        mAvailable.fetch_add(count, std::memory_order_relaxed);
+    }
+    /// Adds a chunk of slabs to the free list
+    void grow()
+    {
+        std::lock_guard<std::mutex> lock(mGrowMutex);
+        // Another thread may have beat us to it
+        if (toIndex(mHead.load(std::memory_order_acquire)) != mEmpty)
+        {
+            return;
+        }
+        auto nChunks = mNumberOfChunks.load(std::memory_order_relaxed);
+        if (nChunks >= mMaximumNumberOfChunks)
+        {
+            throw std::runtime_error("Record buffer pool is exhausted");
+        }
+        auto chunk = new Chunk;
+        chunk->slabs = std::make_unique<char[]> (mSlabSize*mSlabsPerChunk);
+        chunk->next
+            = std::make_unique<std::atomic<uint32_t>[]> (mSlabsPerChunk);
+        auto first = static_cast<uint32_t> (nChunks)*mSlabsPerChunk;
+        auto last = first + mSlabsPerChunk - 1;
+        for (uint32_t i = 0; i < mSlabsPerChunk - 1; ++i)
+        {
+            chunk->next[i].store(first + i + 1, std::memory_order_relaxed);
+        }
+        mChunks[nChunks].store(chunk, std::memory_order_release);
+        mNumberOfChunks.store(nChunks + 1, std::memory_order_release);
+        push(first, last, mSlabsPerChunk);
+    }
+    /// Gets a slab from the free list - growing the arena if necessary
+    [[nodiscard]] uint32_t acquire()
+    {
+        while (true)
+        {
+            auto index = pop();
+            if (index != mEmpty){return index;}
+            grow();
+        }
+    }
+    /// Puts a slab back on the free list
+    void release(const uint32_t index) noexcept
+    {
+        push(index, index, 1);
+    }
+    std::array<std::atomic<Chunk *>, mMaximumNumberOfChunks> mChunks;
+    std::mutex mGrowMutex;
+    alignas(64) std::atomic<uint64_t> mHead{mEmpty};
+    alignas(64) std::atomic<int64_t> mAvailable{0};
+    std::atomic<size_t> mNumberOfChunks{0};
+    size_t mSlabSize{512};
+    uint32_t mSlabsPerChunk{64};
+};
+}
+
+///--------------------------------------------------------------------------///
+///                                 Record Buffer                            ///
+///--------------------------------------------------------------------------///
+
+/// Move constructor
+RecordBuffer::RecordBuffer(RecordBuffer &&buffer) noexcept
+{
+    *this = std::move(buffer);
+}
+
+/// Move assignment
+RecordBuffer& RecordBuffer::operator=(RecordBuffer &&buffer) noexcept
+{
+    if (&buffer == this){return *this;}
+    clear();
+    mArena = std::move(buffer.mArena);
+    mOwned = std::move(buffer.mOwned);
+    mData = buffer.mData;
+    mSlab = buffer.mSlab;
+    mSize = buffer.mSize;
+    mCapacity = buffer.mCapacity;
+    buffer.mData = nullptr;
+    buffer.mSize = 0;
+    buffer.mCapacity = 0;
+    return *this;
+}
+
+/// Release the memory
+void RecordBuffer::clear() noexcept
+{
+    if (mArena && mData){mArena->release(mSlab);}
+    mArena = nullptr;
+    mOwned = nullptr;
+    mData = nullptr;
+    mSize = 0;
+    mCapacity = 0;
+}
+
+/// Destructor
+RecordBuffer::~RecordBuffer()
+{
+    clear();
+}
+
+///--------------------------------------------------------------------------///
+///                               Record Buffer Pool                         ///
+///--------------------------------------------------------------------------///
+
+/// Constructor
+RecordBufferPool::RecordBufferPool(const int slabSize,
+                                   const int slabsPerChunk)
+{
+    if (slabSize < 1)
+    {
+        throw std::invalid_argument("Slab size must be positive");
+    }
+    if (slabsPerChunk < 2)
+    {
+        throw std::invalid_argument("Slabs per chunk must be at least 2");
+    }
+    mArena = std::make_shared<RecordBufferArena> (slabSize, slabsPerChunk);
+}
+
+/// Destructor
+RecordBufferPool::~RecordBufferPool() = default;
+
+/// Create a buffer
+RecordBuffer RecordBufferPool::create(const char *record,
+                                      const int recordLength)
+{
+    if (record == nullptr)
+    {
+        throw std::invalid_argument("Record is NULL");
+    }
+    if (recordLength < 0)
+    {
+        throw std::invalid_argument("Record length cannot be negative");
+    }
+    RecordBuffer result;
+    auto length = static_cast<size_t> (recordLength);
+    if (length <= mArena->mSlabSize)
+    {
+        result.mSlab = mArena->acquire();
+        result.mData = mArena->toSlab(result.mSlab);
+        result.mArena = mArena;
+        result.mCapacity = mArena->mSlabSize;
+    }
+    else
+    {
+        result.mOwned = std::make_unique<char[]> (length);
+        result.mData = result.mOwned.get();
+        result.mCapacity = length;
+    }
+    std::memcpy(result.mData, record, length);
+    result.mSize = length;
+    return result;
+}
+
+/// Slab size
+int RecordBufferPool::getSlabSize() const noexcept
+{
+    return static_cast<int> (mArena->mSlabSize);
+}
+
+/// Number of slabs
+int RecordBufferPool::getNumberOfSlabs() const noexcept
+{
+    return static_cast<int>
+           (mArena->mNumberOfChunks.load(std::memory_order_relaxed)
+           *mArena->mSlabsPerChunk);
+}
+
+/// Number of available slabs
+int RecordBufferPool::getNumberOfAvailableSlabs() const noexcept
+{
+    return static_cast<int>
+           (mArena->mAvailable.load(std::memory_order_relaxed));
+}
+
+/// Thread local pool
+RecordBufferPool &RecordBufferPool::getThreadLocalInstance()
+{
+    thread_local RecordBufferPool pool;
+    return pool;
+}
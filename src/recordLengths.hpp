@@ -0,0 +1,82 @@
+#ifndef RECORD_LENGTHS_HPP
+#define RECORD_LENGTHS_HPP
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <libdali.h>
+#include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
+
+namespace
+{
+
+/// @brief Resolves the miniSEED record length of each stream from the
+///        writer's options and the largest packet the RingServer accepts.
+///        The lookups are cached since pattern matching every packet would
+///        be wasteful.  This also keeps a record buffer pool for each
+///        record length in use so larger records are pooled too.
+class RecordLengths
+{
+public:
+    explicit RecordLengths(
+        const USEEDLinkToRingServer::DataLinkClientOptions &options) :
+        mOptions(options)
+    {
+    }
+    /// @brief Sets the largest packet the server accepts.  If this is not
+    ///        positive then the DataLink limit is assumed.
+    /// @result True indicates the packet size changed.
+    bool setServerPacketSize(const int serverPacketSizeIn)
+    {
+        auto serverPacketSize = serverPacketSizeIn > 0 ?
+                                std::min(serverPacketSizeIn, MAXPACKETSIZE) :
+                                MAXPACKETSIZE;
+        if (serverPacketSize == mServerPacketSize){return false;}
+        mServerPacketSize = serverPacketSize;
+        mRecordLengths.clear();
+        return true;
+    }
+    /// @result The largest packet the server accepts.
+    [[nodiscard]] int getServerPacketSize() const noexcept
+    {
+        return mServerPacketSize;
+    }
+    /// @result The record length for the stream.
+    [[nodiscard]] int getRecordLength(const std::string_view &streamIdentifier)
+    {
+        auto index = mRecordLengths.find(streamIdentifier);
+        if (index == mRecordLengths.end())
+        {
+            std::string key{streamIdentifier};
+            auto recordLength
+                = std::min(mOptions.getMiniSEEDRecordSize(key),
+                           mServerPacketSize);
+            index = mRecordLengths.emplace(std::move(key), recordLength)
+                    .first;
+        }
+        return index->second;
+    }
+    /// @result The pool whose slabs hold records of the given length.
+    [[nodiscard]] USEEDLinkToRingServer::RecordBufferPool &
+        getPool(const int recordLength)
+    {
+        auto &pool = mPools[recordLength];
+        if (pool == nullptr)
+        {
+            pool = std::make_unique<USEEDLinkToRingServer::RecordBufferPool>
+                   (recordLength);
+        }
+        return *pool;
+    }
+private:
+    USEEDLinkToRingServer::DataLinkClientOptions mOptions;
+    std::map<std::string, int, std::less<>> mRecordLengths;
+    std::map<int, std::unique_ptr<USEEDLinkToRingServer::RecordBufferPool>>
+        mPools;
+    int mServerPacketSize{MAXPACKETSIZE};
+};
+
+}
+#endif
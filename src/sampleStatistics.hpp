@@ -0,0 +1,276 @@
+#ifndef SAMPLE_STATISTICS_HPP
+#define SAMPLE_STATISTICS_HPP
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define USEED_LINK_HAVE_AVX2_KERNELS
+#endif
+#include "uSEEDLinkToRingServer/packet.hpp"
+
+namespace
+{
+
+/// @brief Computes the statistics one sample at a time.  This handles the
+///        tail of the vectorized kernels and is the fallback on machines
+///        without AVX2.  Since it is a single pass over contiguous memory
+///        the compiler can still vectorize it for the baseline target.
+template<typename T>
+void accumulateStatistics(const std::span<const T> samples,
+                          USEEDLinkToRingServer::SampleStatistics *statistics)
+{
+    if (samples.empty()){return;}
+    double sum{0};
+    double sumOfSquares{0};
+    int64_t integerSum{0};
+    auto minimum = static_cast<double> (samples[0]);
+    auto maximum = minimum;
+    for (const auto sample : samples)
+    {
+        auto x = static_cast<double> (sample);
+        if constexpr (std::is_integral_v<T>)
+        {
+            integerSum = integerSum + sample;
+        }
+        else
+        {
+            sum = sum + x;
+        }
+        sumOfSquares = sumOfSquares + x*x;
+        minimum = std::min(minimum, x);
+        maximum = std::max(maximum, x);
+    }
+    if (statistics->count == 0)
+    {
+        statistics->minimum = minimum;
+        statistics->maximum = maximum;
+    }
+    else
+    {
+        statistics->minimum = std::min(statistics->minimum, minimum);
+        statistics->maximum = std::max(statistics->maximum, maximum);
+    }
+    statistics->count = statistics->count
+                      + static_cast<int64_t> (samples.size());
+    statistics->integerSum = statistics->integerSum + integerSum;
+    if constexpr (std::is_integral_v<T>)
+    {
+        statistics->sum = static_cast<double> (statistics->integerSum);
+    }
+    else
+    {
+        statistics->sum = statistics->sum + sum;
+    }
+    statistics->sumOfSquares = statistics->sumOfSquares + sumOfSquares;
+}
+
+#ifdef USEED_LINK_HAVE_AVX2_KERNELS
+/// @result The sum of the four doubles.
+__attribute__((target("avx2")))
+double horizontalSum(const __m256d x)
+{
+    auto sum128 = _mm_add_pd(_mm256_castpd256_pd128(x),
+                             _mm256_extractf128_pd(x, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum128, _mm_unpackhi_pd(sum128, sum128)));
+}
+
+/// @brief AVX2 kernel for 32-bit integers.  The sum is accumulated exactly
+///        in 64-bit lanes.
+__attribute__((target("avx2")))
+void accumulateStatisticsAVX2(const std::span<const int> samples,
+                              USEEDLinkToRingServer::SampleStatistics *statistics)
+{
+    constexpr size_t width{8};
+    auto nVector = samples.size() - samples.size()%width;
+    if (nVector == 0)
+    {
+        accumulateStatistics(samples, statistics);
+        return;
+    }
+    const auto *x = samples.data();
+    auto minimum = _mm256_set1_epi32(std::numeric_limits<int>::max());
+    auto maximum = _mm256_set1_epi32(std::numeric_limits<int>::lowest());
+    auto sumLow = _mm256_setzero_si256();
+    auto sumHigh = _mm256_setzero_si256();
+    auto sumOfSquaresLow = _mm256_setzero_pd();
+    auto sumOfSquaresHigh = _mm256_setzero_pd();
+    for (size_t i = 0; i < nVector; i = i + width)
+    {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *> (x + i));
+        minimum = _mm256_min_epi32(minimum, v);
+        maximum = _mm256_max_epi32(maximum, v);
+        auto low = _mm256_castsi256_si128(v);
+        auto high = _mm256_extracti128_si256(v, 1);
+        sumLow = _mm256_add_epi64(sumLow, _mm256_cvtepi32_epi64(low));
+        sumHigh = _mm256_add_epi64(sumHigh, _mm256_cvtepi32_epi64(high));
+        auto dLow = _mm256_cvtepi32_pd(low);
+        auto dHigh = _mm256_cvtepi32_pd(high);
+        sumOfSquaresLow
+            = _mm256_add_pd(sumOfSquaresLow, _mm256_mul_pd(dLow, dLow));
+        sumOfSquaresHigh
+            = _mm256_add_pd(sumOfSquaresHigh, _mm256_mul_pd(dHigh, dHigh));
+    }
+    alignas(32) int minima[width];
+    alignas(32) int maxima[width];
+    alignas(32) int64_t sums[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *> (minima), minimum);
+    _mm256_store_si256(reinterpret_cast<__m256i *> (maxima), maximum);
+    _mm256_store_si256(reinterpret_cast<__m256i *> (sums),
+                       _mm256_add_epi64(sumLow, sumHigh));
+    auto vectorMinimum = static_cast<double>
+                         (*std::min_element(minima, minima + width));
+    auto vectorMaximum = static_cast<double>
+                         (*std::max_element(maxima, maxima + width));
+    if (statistics->count == 0)
+    {
+        statistics->minimum = vectorMinimum;
+        statistics->maximum = vectorMaximum;
+    }
+    else
+    {
+        statistics->minimum = std::min(statistics->minimum, vectorMinimum);
+        statistics->maximum = std::max(statistics->maximum, vectorMaximum);
+    }
+    statistics->count = statistics->count + static_cast<int64_t> (nVector);
+    statistics->integerSum = statistics->integerSum
+                           + sums[0] + sums[1] + sums[2] + sums[3];
+    statistics->sum = static_cast<double> (statistics->integerSum);
+    statistics->sumOfSquares
+        = statistics->sumOfSquares
+        + horizontalSum(_mm256_add_pd(sumOfSquaresLow, sumOfSquaresHigh));
+    accumulateStatistics(samples.subspan(nVector), statistics);
+}
+
+/// @brief AVX2 kernel for floats.  Sums are accumulated in double.
+__attribute__((target("avx2")))
+void accumulateStatisticsAVX2(const std::span<const float> samples,
+                              USEEDLinkToRingServer::SampleStatistics *statistics)
+{
+    constexpr size_t width{8};
+    auto nVector = samples.size() - samples.size()%width;
+    if (nVector == 0)
+    {
+        accumulateStatistics(samples, statistics);
+        return;
+    }
+    const auto *x = samples.data();
+    auto minimum = _mm256_set1_ps(std::numeric_limits<float>::max());
+    auto maximum = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+    auto sum = _mm256_setzero_pd();
+    auto sumOfSquares = _mm256_setzero_pd();
+    for (size_t i = 0; i < nVector; i = i + width)
+    {
+        auto v = _mm256_loadu_ps(x + i);
+        minimum = _mm256_min_ps(minimum, v);
+        maximum = _mm256_max_ps(maximum, v);
+        auto dLow = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+        auto dHigh = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+        sum = _mm256_add_pd(sum, _mm256_add_pd(dLow, dHigh));
+        sumOfSquares = _mm256_add_pd(sumOfSquares,
+                                     _mm256_add_pd(_mm256_mul_pd(dLow, dLow),
+                                                   _mm256_mul_pd(dHigh, dHigh)));
+    }
+    alignas(32) float minima[width];
+    alignas(32) float maxima[width];
+    _mm256_store_ps(minima, minimum);
+    _mm256_store_ps(maxima, maximum);
+    auto vectorMinimum = static_cast<double>
+                         (*std::min_element(minima, minima + width));
+    auto vectorMaximum = static_cast<double>
+                         (*std::max_element(maxima, maxima + width));
+    if (statistics->count == 0)
+    {
+        statistics->minimum = vectorMinimum;
+        statistics->maximum = vectorMaximum;
+    }
+    else
+    {
+        statistics->minimum = std::min(statistics->minimum, vectorMinimum);
+        statistics->maximum = std::max(statistics->maximum, vectorMaximum);
+    }
+    statistics->count = statistics->count + static_cast<int64_t> (nVector);
+    statistics->sum = statistics->sum + horizontalSum(sum);
+    statistics->sumOfSquares = statistics->sumOfSquares
+                             + horizontalSum(sumOfSquares);
+    accumulateStatistics(samples.subspan(nVector), statistics);
+}
+
+/// @brief AVX2 kernel for doubles.
+__attribute__((target("avx2")))
+void accumulateStatisticsAVX2(const std::span<const double> samples,
+                              USEEDLinkToRingServer::SampleStatistics *statistics)
+{
+    constexpr size_t width{4};
+    auto nVector = samples.size() - samples.size()%width;
+    if (nVector == 0)
+    {
+        accumulateStatistics(samples, statistics);
+        return;
+    }
+    const auto *x = samples.data();
+    auto minimum = _mm256_set1_pd(std::numeric_limits<double>::max());
+    auto maximum = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+    auto sum = _mm256_setzero_pd();
+    auto sumOfSquares = _mm256_setzero_pd();
+    for (size_t i = 0; i < nVector; i = i + width)
+    {
+        auto v = _mm256_loadu_pd(x + i);
+        minimum = _mm256_min_pd(minimum, v);
+        maximum = _mm256_max_pd(maximum, v);
+        sum = _mm256_add_pd(sum, v);
+        sumOfSquares = _mm256_add_pd(sumOfSquares, _mm256_mul_pd(v, v));
+    }
+    alignas(32) double minima[width];
+    alignas(32) double maxima[width];
+    _mm256_store_pd(minima, minimum);
+    _mm256_store_pd(maxima, maximum);
+    auto vectorMinimum = *std::min_element(minima, minima + width);
+    auto vectorMaximum = *std::max_element(maxima, maxima + width);
+    if (statistics->count == 0)
+    {
+        statistics->minimum = vectorMinimum;
+        statistics->maximum = vectorMaximum;
+    }
+    else
+    {
+        statistics->minimum = std::min(statistics->minimum, vectorMinimum);
+        statistics->maximum = std::max(statistics->maximum, vectorMaximum);
+    }
+    statistics->count = statistics->count + static_cast<int64_t> (nVector);
+    statistics->sum = statistics->sum + horizontalSum(sum);
+    statistics->sumOfSquares = statistics->sumOfSquares
+                             + horizontalSum(sumOfSquares);
+    accumulateStatistics(samples.subspan(nVector), statistics);
+}
+
+/// @result True indicates the CPU supports AVX2.  This is checked once.
+[[nodiscard]] bool haveAVX2() noexcept
+{
+    static const bool result{__builtin_cpu_supports("avx2") != 0};
+    return result;
+}
+#endif
+
+/// @brief Computes the statistics of the samples in a single pass.  The
+///        vectorized kernel is selected at run time.
+template<typename T>
+[[nodiscard]] USEEDLinkToRingServer::SampleStatistics
+    computeStatistics(const std::span<const T> samples)
+{
+    USEEDLinkToRingServer::SampleStatistics statistics;
+#ifdef USEED_LINK_HAVE_AVX2_KERNELS
+    if (haveAVX2())
+    {
+        accumulateStatisticsAVX2(samples, &statistics);
+        return statistics;
+    }
+#endif
+    accumulateStatistics(samples, &statistics);
+    return statistics;
+}
+
+}
+#endif
@@ -1,13 +1,16 @@
 #include <iostream>
+#include <memory>
 #include <libslink.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include "uSEEDLinkToRingServer/seedLinkClient.hpp"
 #include "uSEEDLinkToRingServer/seedLinkClientOptions.hpp"
 #include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/pipelineTimestamps.hpp"
 #include "uSEEDLinkToRingServer/streamIdentifier.hpp"
 #include "uSEEDLinkToRingServer/streamSelector.hpp"
 #include "uSEEDLinkToRingServer/version.hpp"
+#include "logSuppressor.hpp"
 
 using namespace USEEDLinkToRingServer;
 
@@ -32,6 +35,15 @@ void seedLinkDiagnosticsToSPDLOG(const char *message)
     }
 }
 
+/// Frees a libmseed record when it goes out of scope
+struct MS3RecordDeleter
+{
+    void operator()(MS3Record *record) const noexcept
+    {
+        if (record){msr3_free(&record);}
+    }
+};
+
 /// @brief Unpacks a miniSEED record.
 [[nodiscard]]
 std::vector<Packet>
@@ -52,6 +64,10 @@ std::vector<Packet>
                                      static_cast<uint64_t> (bufferSize) - offset,
                                      &miniSEEDRecord, flags,
                                      verbose);
+        // The record is freed however we leave this iteration - e.g., if
+        // the stream identifier is rejected
+        const std::unique_ptr<MS3Record, ::MS3RecordDeleter>
+            recordGuard{miniSEEDRecord};
         if (returnCode == MS_NOERROR && miniSEEDRecord)
         {
             // SNCL
@@ -74,24 +90,15 @@ std::vector<Packet>
                 const std::string_view network(networkWork.data());
                 const std::string_view station(stationWork.data());
                 const std::string_view channel(channelWork.data());
-                StreamIdentifier identifier;
-                identifier.setNetwork(network);
-                identifier.setStation(station);
-                identifier.setChannel(channel);
-                if (locationWork[0] == '\0')
+                const std::string_view locationCode
                 {
-                    identifier.setLocationCode(std::string_view {"--"});
-                }
-                else
-                {
-                    const std::string_view locationCode(locationWork.data());
-                    identifier.setLocationCode(locationCode);
-                }
-                dataPacket.setStreamIdentifier(std::move(identifier));
+                    locationWork[0] == '\0' ? "--" : locationWork.data()
+                };
+                dataPacket.setStreamIdentifier(
+                    StreamIdentifier {network, station, channel, locationCode});
             }
             else
             {
-                msr3_free(&miniSEEDRecord);
                 throw std::runtime_error("Failed to unpack SNCL");
             }
             // Sampling rate
@@ -130,22 +137,18 @@ std::vector<Packet>
                 }
                 else
                 {
-                    msr3_free(&miniSEEDRecord);
                     throw std::runtime_error("Unhandled sample type");
                 }
             } // End check on nSamples
             dataPackets.push_back(std::move(dataPacket));
             offset = offset + miniSEEDRecord->reclen;
-            msr3_free(&miniSEEDRecord);
         }
         else
         {
             if (returnCode != MS_NOERROR)
             {
-                if (miniSEEDRecord){msr3_free(&miniSEEDRecord);}
                 throw std::runtime_error("libmseed error detected");
             }
-            msr3_free(&miniSEEDRecord);
             throw std::runtime_error(
                  "Insufficient data.  Number of additional bytes estimated is "
                 + std::to_string(returnCode));
@@ -462,30 +465,42 @@ public:
                     seedLinkPacketInfo->payloadformat == SLPAYLOAD_MSEED3)
                 {
                     auto payloadLength = seedLinkPacketInfo->payloadlength;
+                    PipelineTimestamps timestamps;
+                    timestamps.received = std::chrono::steady_clock::now();
                     try
                     {
                         auto packets
                             = ::miniSEEDToDataPackets(seedLinkBuffer.data(),
                                                       payloadLength);
+                        timestamps.decoded = std::chrono::steady_clock::now();
                         if (packets.empty())
                         {
-                            SPDLOG_LOGGER_WARN(mLogger,
-                                               "No mseed packets unpacked");
+                            RATE_LIMITED_LOGGER_WARN(mLogger,
+                                std::string_view {},
+                                "No mseed packets unpacked");
                         }
                         else if (packets.size() > 1)
                         {
-                            SPDLOG_LOGGER_WARN(mLogger,
-                                             "Multiple mseed packets received");
+                            RATE_LIMITED_LOGGER_WARN(mLogger,
+                                packets.front()
+                                       .getStreamIdentifierReference()
+                                       .getStringReference(),
+                                "Multiple mseed packets received for {}",
+                                packets.front()
+                                       .getStreamIdentifierReference()
+                                       .getStringReference());
                         }
                         for (auto &packet : packets)
                         {
+                            packet.setPipelineTimestamps(timestamps);
                             try
                             {
                                 mAddPacketCallback( std::move(packet) );
                             }
                             catch (const std::exception &e)
                             {
-                                SPDLOG_LOGGER_WARN(mLogger,
+                                RATE_LIMITED_LOGGER_WARN(mLogger,
+                                    std::string_view {},
                                     "Failed to propagate packet because {}",
                                     std::string {e.what()});
                             }
@@ -493,7 +508,8 @@ public:
                     }
                     catch (const std::exception &e)
                     {
-                        SPDLOG_LOGGER_WARN(mLogger,
+                        RATE_LIMITED_LOGGER_WARN(mLogger,
+                           std::string_view {},
                            "Skipping packet.  Unpacking failed with {}",
                            std::string(e.what()));
                     }
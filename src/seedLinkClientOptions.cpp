@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <filesystem>
 #include <string>
 #include "uSEEDLinkToRingServer/seedLinkClientOptions.hpp"
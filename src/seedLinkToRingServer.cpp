@@ -7,6 +7,7 @@
 #include <csignal>
 #include <filesystem>
 #include <functional>
+#include <limits>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <boost/algorithm/string.hpp>
@@ -20,6 +21,7 @@
 #endif
 #include "uSEEDLinkToRingServer/dataLinkClient.hpp"
 #include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
+#include "uSEEDLinkToRingServer/dataLinkEngine.hpp"
 #include "uSEEDLinkToRingServer/seedLinkClient.hpp"
 #include "uSEEDLinkToRingServer/seedLinkClientOptions.hpp"
 #include "uSEEDLinkToRingServer/packet.hpp"
@@ -31,7 +33,9 @@
 #include "streamMetrics.hpp"
 #include "writerMetrics.hpp"
 #include "logger.hpp"
+#include "logSuppressor.hpp"
 #include "metricsExporter.hpp"
+#include "prometheusServer.hpp"
 
 namespace
 {
@@ -61,10 +65,29 @@ public:
             mLogger = spdlog::stdout_color_mt("ProcessConsole");
         }
         mImportQueueMaximumSize = options.importQueueSize;
+        mImportQueueMetrics.capacity.store(mImportQueueMaximumSize,
+                                           std::memory_order_relaxed);
+        mTabulateMetrics = mOptions.exportMetrics
+                        || mOptions.exportPrometheusMetrics;
+        mSourceAttribute.source = mOptions.dataSource;
         if (mOptions.exportMetrics)
         {
              SPDLOG_LOGGER_INFO(mLogger, "Initializing metrics");
              ::initializeImportMetrics(mOptions);
+             ::initializeWriterMetrics(mOptions);
+        }
+        if (mOptions.exportPrometheusMetrics)
+        {
+            mPrometheusServer
+                = std::make_unique<::PrometheusServer>
+                  (mOptions.prometheusHost,
+                   mOptions.prometheusPort,
+                   [](::PrometheusTextWriter &writer)
+                   {
+                       ::writePrometheusImportMetrics(writer);
+                       ::writePrometheusWriterMetrics(writer);
+                   },
+                   mLogger);
         }
 #ifdef USE_TBB
         mImportQueue.set_capacity(mImportQueueMaximumSize);
@@ -80,15 +103,25 @@ public:
         {
             throw std::invalid_argument("No writers configured");
         } 
-        for (auto &dataLinkClientOptions : mOptions.dataLinkClientOptions)
+        if (mOptions.useDataLinkEventLoop)
+        {
+            // One thread drives every connection
+            mDataLinkEngine
+                = std::make_unique<USEEDLinkToRingServer::DataLinkEngine>
+                  (mOptions.dataLinkClientOptions, mLogger);
+        }
+        else
         {
-            auto dataLinkClient
-                = std::make_unique<USEEDLinkToRingServer::DataLinkClient>
-                  (dataLinkClientOptions, mLogger);
-            mDataLinkClients.push_back(std::move(dataLinkClient));
+            for (auto &dataLinkClientOptions : mOptions.dataLinkClientOptions)
+            {
+                auto dataLinkClient
+                    = std::make_unique<USEEDLinkToRingServer::DataLinkClient>
+                      (dataLinkClientOptions, mLogger);
+                mDataLinkClients.push_back(std::move(dataLinkClient));
+            }
         }
 #ifndef NDEBUG
-        assert(!mDataLinkClients.empty());
+        assert(!mDataLinkClients.empty() || mDataLinkEngine != nullptr);
 #endif
         mSEEDLinkClient
             = std::make_unique<USEEDLinkToRingServer::SEEDLinkClient>
@@ -116,13 +149,19 @@ public:
         {
             mDataLinkClientFutures.push_back(dataLinkClient->start());
         }
+        if (mDataLinkEngine)
+        {
+            mDataLinkClientFutures.push_back(mDataLinkEngine->start());
+        }
         // Then the reader
         mSEEDLinkClientFuture = mSEEDLinkClient->start();
+        if (mPrometheusServer){mPrometheusServer->start();}
     }
     /// Stops the processes
     void stop()
     {
         mKeepRunning.store(false);
+        if (mPrometheusServer){mPrometheusServer->stop();}
         if (mMetricsThread.joinable()){mMetricsThread.join();}
         // Stop acquiring and give writers a chance to clear 
         if (mSEEDLinkClient)
@@ -140,6 +179,7 @@ public:
         {
             if (dataLinkClient){dataLinkClient->stop();}
         }
+        if (mDataLinkEngine){mDataLinkEngine->stop();}
         std::this_thread::sleep_for(pause);
         // Futures
         if (mSEEDLinkClientFuture.valid())
@@ -172,6 +212,10 @@ public:
         std::this_thread::sleep_for(pause);
         mSEEDLinkClient = nullptr;
         for (auto &dataLinkClient : mDataLinkClients){dataLinkClient = nullptr;}
+        mDataLinkEngine = nullptr;
+        constexpr bool force{true};
+        SuppressedWarnings::getInstance().flush(
+            std::chrono::steady_clock::now(), force);
     }
     /// This callback enables the SEEDLink client to add packets to be processed
     void addPacketCallback(USEEDLinkToRingServer::Packet &&packet)
@@ -185,15 +229,16 @@ public:
 #endif
             if (approximateQueueSize >= mImportQueueMaximumSize)
             {
-                SPDLOG_LOGGER_WARN(mLogger,
-                                   "Popping elements from import queue");
+                RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
+                                         "Popping elements from import queue");
 #ifdef USE_TBB
                 while (mImportQueue.size() >= mImportQueueMaximumSize)
 #else
                 while (mImportQueue->size_approx() >= mImportQueueMaximumSize)
 #endif
                 {
-                     mImportPacketsPopped.fetch_add(1);
+                     mImportQueueMetrics.packetsEvicted.fetch_add(
+                         1, std::memory_order_relaxed);
                      USEEDLinkToRingServer::Packet workSpace;
 #ifdef USE_TBB
                      if (!mImportQueue.try_pop(workSpace))
@@ -207,14 +252,16 @@ public:
                      }
                 }   
             }
+            packet.setEnqueueTime(std::chrono::steady_clock::now());
 #ifdef USE_TBB
             if (!mImportQueue.try_push(std::move(packet)))
 #else
             if (!mImportQueue->try_enqueue(std::move(packet)))
 #endif
             {
-                mImportPacketsFailedToEnqueue.fetch_add(1);
-                SPDLOG_LOGGER_WARN(mLogger,
+                mImportQueueMetrics.packetsFailedToEnqueue.fetch_add(
+                    1, std::memory_order_relaxed);
+                RATE_LIMITED_LOGGER_WARN(mLogger, std::string_view {},
                     "Failed to add packet to import queue");
             }
 /*
@@ -236,11 +283,15 @@ public:
     void tabulateMetrics()
     {
         ::MetricsMap metricsMap; 
+        metricsMap.mStreamTimeOut = mOptions.streamMetricsTimeOut;
+        metricsMap.mMaximumNumberOfStreams
+            = mOptions.maximumNumberOfStreamMetrics;
+        metricsMap.mContinuityTolerance = mOptions.continuityTolerance;
         //std::chrono::hours cleanMetricsInterval{2};
         constexpr std::chrono::milliseconds timeOut{25};
 #ifndef NDEBUG
         //assert(!(mDataLinkClients.empty() && mSEEDLinkWriters.empty()));
-        assert(!mDataLinkClients.empty());
+        assert(!mDataLinkClients.empty() || mDataLinkEngine != nullptr);
 #endif
         auto movePacket = mDataLinkClients.size() == 1 ? true : false;
         //                + mSEEDLinkWriters.size() == 1 ? true : false;
@@ -250,9 +301,9 @@ public:
             // channel will blink out so it doesn't make sense to do this
             // in the update function.  Note, the class handles the timing
             // so this is safe to repeatedly run.
-            if (mOptions.exportMetrics)
+            if (mTabulateMetrics)
             {
-                metricsMap.tabulateAndResetAllMetrics();
+                metricsMap.tabulateAndResetAllMetrics(mLogger);
             }
             // Update the metrics and propagate the packet
             USEEDLinkToRingServer::Packet packet;
@@ -262,8 +313,24 @@ public:
             if (mImportQueue->try_dequeue(packet))
 #endif
             {
+                auto dequeueTime = std::chrono::steady_clock::now();
+                mImportQueueMetrics.residency.record(
+                    std::chrono::duration_cast<std::chrono::microseconds>
+                    (dequeueTime - packet.getEnqueueTime()));
+                auto timestamps = packet.getPipelineTimestampsReference();
+                timestamps.dequeued = dequeueTime;
+                packet.setPipelineTimestamps(timestamps);
+#ifdef USE_TBB
+                mImportQueueMetrics.depth.store(
+                    std::max<int64_t> (0, mImportQueue.size()),
+                    std::memory_order_relaxed);
+#else
+                mImportQueueMetrics.depth.store(
+                    static_cast<int64_t> (mImportQueue->size_approx()),
+                    std::memory_order_relaxed);
+#endif
                 // Update metrics
-                if (mOptions.exportMetrics)
+                if (mTabulateMetrics)
                 {
                     try
                     {
@@ -277,6 +344,21 @@ public:
                     }
                 }
                 // Propagate
+                if (mDataLinkEngine)
+                {
+                    try
+                    {
+                        mDataLinkEngine->enqueue(std::move(packet));
+                    }
+                    catch (const std::exception &e)
+                    {
+                        mImportQueueMetrics.packetsFailedToFanOut.fetch_add(
+                            1, std::memory_order_relaxed);
+                        SPDLOG_LOGGER_WARN(mLogger,
+                           "Failed to enqueue packet to DataLink for publishing because {}",
+                           std::string {e.what()});
+                    }
+                }
                 for (auto &dataLinkClient : mDataLinkClients)
                 {
                     try
@@ -292,6 +374,8 @@ public:
                     }
                     catch (const std::exception &e)
                     {
+                        mImportQueueMetrics.packetsFailedToFanOut.fetch_add(
+                            1, std::memory_order_relaxed);
                         SPDLOG_LOGGER_WARN(mLogger,
                            "Failed to enqueue packet to DataLink for publishing because {}",
                            std::string {e.what()});
@@ -366,6 +450,8 @@ public:
                     break;
                 }
                 printSummary();
+                // Report warnings that were suppressed and have since stopped
+                SuppressedWarnings::getInstance().flush();
                 std::unique_lock<std::mutex> lock(mStopMutex);
                 constexpr std::chrono::milliseconds waitFor{100};
                 mStopCondition.wait_for(lock,
@@ -443,7 +529,10 @@ public:
     std::condition_variable mStopCondition;
     std::vector<std::unique_ptr<USEEDLinkToRingServer::DataLinkClient>>
         mDataLinkClients{};
+    std::unique_ptr<USEEDLinkToRingServer::DataLinkEngine>
+        mDataLinkEngine{nullptr};
     std::unique_ptr<USEEDLinkToRingServer::SEEDLinkClient> mSEEDLinkClient{nullptr};
+    std::unique_ptr<::PrometheusServer> mPrometheusServer{nullptr};
     std::function<void(USEEDLinkToRingServer::Packet &&)>
         mAddPacketCallbackFunction
     {
@@ -451,8 +540,6 @@ public:
                   std::placeholders::_1)
     };
     std::future<void> mDataLinkWriterFuture;
-    std::atomic<uint64_t> mImportPacketsPopped{0};
-    std::atomic<uint64_t> mImportPacketsFailedToEnqueue{0};
     std::atomic<bool> mKeepRunning{true};
     std::chrono::seconds mLastReport
     {   
@@ -462,6 +549,7 @@ public:
     int64_t mReceivedLastReport{0};
     int64_t mWrittenLastReport{0};
     int mImportQueueMaximumSize{DEFAULT_QUEUE_SIZE};
+    bool mTabulateMetrics{false};
     bool mStopRequested{false};
 };
 
@@ -546,6 +634,9 @@ int main(int argc, char *argv[])
                            "Starting uSEEDLinkToRingServer processes...");
         process->start();
         process->handleMainThread();
+        // Anything the process logs while stopping must be queued before
+        // the logging thread is drained
+        process.reset();
         ::cleanupMetrics();
         ::cleanupLogger();
     }
@@ -554,6 +645,7 @@ int main(int argc, char *argv[])
         SPDLOG_LOGGER_CRITICAL(logger,
             "uSEEDLinkToRingServer processes failed with {}",
             std::string {e.what()});
+        process.reset();
         if (programOptions.exportMetrics){::cleanupMetrics();}
         ::cleanupLogger();
         return EXIT_FAILURE;
@@ -663,13 +755,155 @@ getDataLinkOptions(const boost::property_tree::ptree &propertyTree,
     auto miniSEEDRecordSize
         = propertyTree.get<int> (sectionName + ".miniSEEDRecordSize",
                                  dataLinkClientOptions.getMiniSEEDRecordSize());
-    if (miniSEEDRecordSize < 1 || miniSEEDRecordSize > 512)
+    dataLinkClientOptions.setMiniSEEDRecordSize(miniSEEDRecordSize);
+    // Per-stream record sizes, e.g., miniSEEDRecordSize_1 = *.*.HN?.* 4096
+    constexpr int maxRecordSizePatterns{1024};
+    for (int iPattern = 1; iPattern <= maxRecordSizePatterns; ++iPattern)
     {
-        throw std::invalid_argument("miniSEEDRecordSize "
-            + std::to_string(miniSEEDRecordSize)
-            + " must be between 1 and 512");
+        auto recordSizeString
+            = propertyTree.get_optional<std::string>
+              (sectionName + ".miniSEEDRecordSize_"
+             + std::to_string(iPattern));
+        if (!recordSizeString){continue;}
+        std::vector<std::string> splitRecordSize;
+        auto trimmedRecordSize = *recordSizeString;
+        boost::algorithm::trim(trimmedRecordSize);
+        boost::split(splitRecordSize, trimmedRecordSize,
+                     boost::is_any_of(" \t"), boost::token_compress_on);
+        if (splitRecordSize.size() != 2)
+        {
+            throw std::invalid_argument("miniSEEDRecordSize_"
+                + std::to_string(iPattern)
+                + " must be of the form NET.STA.CHA[.LOC] recordSize");
+        }
+        dataLinkClientOptions.addMiniSEEDRecordSize(
+            splitRecordSize.at(0), std::stoi(splitRecordSize.at(1)));
     }
-    dataLinkClientOptions.setMiniSEEDRecordSize(miniSEEDRecordSize);
+
+    auto aggregatePackets
+        = propertyTree.get<bool> (sectionName + ".aggregatePackets",
+                                  dataLinkClientOptions.aggregatePackets());
+    if (aggregatePackets)
+    {
+        dataLinkClientOptions.enablePacketAggregation();
+    }
+    else
+    {
+        dataLinkClientOptions.disablePacketAggregation();
+    }
+    auto aggregationLatency
+        = propertyTree.get<int> (sectionName
+                               + ".aggregationLatencyInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getAggregationLatency().count()));
+    if (aggregationLatency <= 0)
+    {
+        throw std::invalid_argument("aggregationLatencyInMilliSeconds "
+            + std::to_string(aggregationLatency) + " must be positive");
+    }
+    dataLinkClientOptions.setAggregationLatency(
+        std::chrono::milliseconds {aggregationLatency});
+
+    auto initialReconnectDelay
+        = propertyTree.get<int> (sectionName
+                               + ".initialReconnectDelayInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getInitialReconnectDelay().count()));
+    auto maximumReconnectDelay
+        = propertyTree.get<int> (sectionName
+                               + ".maximumReconnectDelayInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getMaximumReconnectDelay().count()));
+    dataLinkClientOptions.setReconnectDelays(
+        std::chrono::milliseconds {initialReconnectDelay},
+        std::chrono::milliseconds {maximumReconnectDelay});
+
+    auto reconnectJitter
+        = propertyTree.get<double> (sectionName + ".reconnectJitter",
+                                    dataLinkClientOptions.getReconnectJitter());
+    dataLinkClientOptions.setReconnectJitter(reconnectJitter);
+
+    auto maximumHoldoverSize
+        = propertyTree.get<int> (sectionName + ".maximumHoldoverSize",
+                                 dataLinkClientOptions.getMaximumHoldoverSize());
+    dataLinkClientOptions.setMaximumHoldoverSize(maximumHoldoverSize);
+
+    // Comma-separated host:port pairs tried in order after the primary
+    auto failoverEndpointsString
+        = propertyTree.get<std::string> (sectionName + ".failoverEndpoints",
+                                         "");
+    boost::algorithm::trim(failoverEndpointsString);
+    if (!failoverEndpointsString.empty())
+    {
+        std::vector<std::string> splitEndpoints;
+        boost::split(splitEndpoints, failoverEndpointsString,
+                     boost::is_any_of(",\t "),
+                     boost::token_compress_on);
+        std::vector<std::pair<std::string, uint16_t>> failoverEndpoints;
+        for (const auto &endpoint : splitEndpoints)
+        {
+            if (endpoint.empty()){continue;}
+            auto colon = endpoint.rfind(':');
+            if (colon == std::string::npos ||
+                colon == 0 ||
+                colon == endpoint.size() - 1)
+            {
+                throw std::invalid_argument("Failover endpoint " + endpoint
+                                          + " must be of the form host:port");
+            }
+            auto port = std::stoi(endpoint.substr(colon + 1));
+            if (port < 1 || port > std::numeric_limits<uint16_t>::max())
+            {
+                throw std::invalid_argument("Failover endpoint port "
+                                          + std::to_string(port)
+                                          + " is invalid");
+            }
+            failoverEndpoints.push_back(
+                std::pair {endpoint.substr(0, colon),
+                           static_cast<uint16_t> (port)});
+        }
+        dataLinkClientOptions.setFailoverEndpoints(failoverEndpoints);
+    }
+
+    auto ioTimeOut
+        = propertyTree.get<int> (sectionName + ".ioTimeOutInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getIOTimeOut().count()));
+    dataLinkClientOptions.setIOTimeOut(std::chrono::milliseconds {ioTimeOut});
+
+    auto failbackProbeInterval
+        = propertyTree.get<int> (sectionName
+                               + ".failbackProbeIntervalInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getFailbackProbeInterval().count()));
+    dataLinkClientOptions.setFailbackProbeInterval(
+        std::chrono::milliseconds {failbackProbeInterval});
+
+    auto maximumPacketsPerSecond
+        = propertyTree.get<double> (sectionName + ".maximumPacketsPerSecond",
+             dataLinkClientOptions.getMaximumPacketsPerSecond());
+    dataLinkClientOptions.setMaximumPacketsPerSecond(maximumPacketsPerSecond);
+
+    auto maximumBytesPerSecond
+        = propertyTree.get<double> (sectionName + ".maximumBytesPerSecond",
+             dataLinkClientOptions.getMaximumBytesPerSecond());
+    dataLinkClientOptions.setMaximumBytesPerSecond(maximumBytesPerSecond);
+
+    auto burstAllowance
+        = propertyTree.get<int> (sectionName
+                               + ".burstAllowanceInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getBurstAllowance().count()));
+    dataLinkClientOptions.setBurstAllowance(
+        std::chrono::milliseconds {burstAllowance});
+
+    auto realTimeThreshold
+        = propertyTree.get<int> (sectionName
+                               + ".realTimeThresholdInMilliSeconds",
+             static_cast<int>
+             (dataLinkClientOptions.getRealTimeThreshold().count()));
+    dataLinkClientOptions.setRealTimeThreshold(
+        std::chrono::milliseconds {realTimeThreshold});
 
     return dataLinkClientOptions;
 }
@@ -933,6 +1167,44 @@ getOTelMetricsIntervalAndTimeOut(
                       std::chrono::milliseconds {exportTimeOut}};
 }
 
+::OTelBatchLogOptions getOTelBatchLogOptions(
+    boost::property_tree::ptree &propertyTree,
+    const std::string &section,
+    const ::OTelBatchLogOptions &defaultOptions)
+{
+    ::OTelBatchLogOptions options{defaultOptions};
+    options.maximumQueueSize
+        = propertyTree.get<int> (section + ".maximumQueueSize",
+                                 options.maximumQueueSize);
+    if (options.maximumQueueSize <= 0)
+    {
+        throw std::invalid_argument("Log queue size must be positive");
+    }
+    options.maximumExportBatchSize
+        = propertyTree.get<int> (section + ".maximumExportBatchSize",
+                                 options.maximumExportBatchSize);
+    if (options.maximumExportBatchSize <= 0)
+    {
+        throw std::invalid_argument("Log export batch size must be positive");
+    }
+    if (options.maximumExportBatchSize > options.maximumQueueSize)
+    {
+        throw std::invalid_argument(
+            "Log export batch size cannot exceed the log queue size");
+    }
+    int64_t exportInterval = options.exportInterval.count();
+    exportInterval
+        = propertyTree.get<int64_t> (
+            section + ".exportIntervalInMilliSeconds",
+            exportInterval);
+    if (exportInterval <= 0)
+    {
+        throw std::invalid_argument("Log export interval must be positive");
+    }
+    options.exportInterval = std::chrono::milliseconds {exportInterval};
+    return options;
+}
+
 ::ProgramOptions parseIniFile(const std::filesystem::path &iniFile)
 {
     ::ProgramOptions options;
@@ -960,6 +1232,49 @@ getOTelMetricsIntervalAndTimeOut(
     options.printSummaryInterval 
         = std::chrono::minutes {summaryIntervalInMinutes};
 
+    // Streams that stop sending are evicted from the metrics after this
+    // many minutes.  A time out of 0 disables eviction.
+    auto streamMetricsTimeOutInMinutes
+        = static_cast<int> (options.streamMetricsTimeOut.count());
+    streamMetricsTimeOutInMinutes
+        = propertyTree.get<int> ("General.streamMetricsTimeOutInMinutes",
+                                 streamMetricsTimeOutInMinutes);
+    if (streamMetricsTimeOutInMinutes < 0)
+    {
+        throw std::invalid_argument(
+            "General.streamMetricsTimeOutInMinutes cannot be negative");
+    }
+    options.streamMetricsTimeOut
+        = std::chrono::minutes {streamMetricsTimeOutInMinutes};
+    // Bounds the number of streams with metrics.  0 is unlimited.
+    options.maximumNumberOfStreamMetrics
+        = propertyTree.get<int> ("General.maximumNumberOfStreamMetrics",
+                                 options.maximumNumberOfStreamMetrics);
+    if (options.maximumNumberOfStreamMetrics < 0)
+    {
+        throw std::invalid_argument(
+            "General.maximumNumberOfStreamMetrics cannot be negative");
+    }
+    // Consecutive packets whose timing is off by more than this many sample
+    // periods are tallied as a gap or an overlap
+    options.continuityTolerance
+        = propertyTree.get<double> ("General.continuityToleranceInSamples",
+                                    options.continuityTolerance);
+    if (!(options.continuityTolerance >= 0))
+    {
+        throw std::invalid_argument(
+            "General.continuityToleranceInSamples cannot be negative");
+    }
+    // Messages waiting for the logging thread.  The oldest are dropped
+    // when this fills.
+    options.logQueueSize
+        = propertyTree.get<int> ("General.logQueueSize",
+                                 options.logQueueSize);
+    if (options.logQueueSize <= 0)
+    {
+        throw std::invalid_argument("General.logQueueSize must be positive");
+    }
+
 
     // Metrics
     options.exportMetrics = false;
@@ -1053,6 +1368,10 @@ getOTelMetricsIntervalAndTimeOut(
                 }
             }
         }
+        logOptions.batchOptions
+            = ::getOTelBatchLogOptions(propertyTree,
+                                       "OTelHTTPLogOptions",
+                                       logOptions.batchOptions);
         if (!logOptions.url.empty())
         {
             options.exportLogs = true;
@@ -1079,6 +1398,10 @@ getOTelMetricsIntervalAndTimeOut(
                 logOptions.certificatePath = *certificatePath;
             }
         }
+        logOptions.batchOptions
+            = ::getOTelBatchLogOptions(propertyTree,
+                                       "OTelGRPCLogOptions",
+                                       logOptions.batchOptions);
         if (!logOptions.url.empty())
         {
             options.exportLogs = true;
@@ -1087,18 +1410,28 @@ getOTelMetricsIntervalAndTimeOut(
         }
     }
 
-/*
     // Prometheus
-    uint16_t prometheusPort
-        = propertyTree.get<uint16_t> ("Prometheus.port", 9200);
-    std::string prometheusHost
-        = propertyTree.get<std::string> ("Prometheus.host", "localhost");
-    if (!prometheusHost.empty())
+    options.exportPrometheusMetrics = false;
+    if (propertyTree.get_optional<std::string> ("Prometheus"))
     {
-        options.prometheusURL = prometheusHost + ":"
-                              + std::to_string(prometheusPort);
+        options.prometheusHost
+            = propertyTree.get<std::string> ("Prometheus.host",
+                                             options.prometheusHost);
+        if (options.prometheusHost.empty())
+        {
+            throw std::invalid_argument("Prometheus.host is empty");
+        }
+        auto prometheusPort
+            = propertyTree.get<int> ("Prometheus.port",
+                                     options.prometheusPort);
+        if (prometheusPort < 1 || prometheusPort > 65535)
+        {
+            throw std::invalid_argument(
+                "Prometheus.port must be in range [1,65535]");
+        }
+        options.prometheusPort = static_cast<uint16_t> (prometheusPort);
+        options.exportPrometheusMetrics = true;
     }
-*/
 /*
     // SEEDLink Writer
     std::vector<USEEDLinkToRingServer::SEEDLinkWriterOptions>
@@ -1170,6 +1503,9 @@ getOTelMetricsIntervalAndTimeOut(
         }
     }
     options.dataLinkClientOptions = dataLinkClientOptions;
+    options.useDataLinkEventLoop
+        = propertyTree.get<bool> ("General.useDataLinkEventLoop",
+                                  options.useDataLinkEventLoop);
 
     if (options.dataLinkClientOptions.empty())
     {
@@ -0,0 +1,137 @@
+#ifndef STREAM_CONTINUITY_HPP
+#define STREAM_CONTINUITY_HPP
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+
+/// @brief Tracks the continuity of a stream packet by packet in O(1).
+///        The next packet is expected to start one sample period after the
+///        last sample seen.  A packet that starts later than that by more
+///        than the tolerance follows a gap; one that starts earlier by more
+///        than the tolerance overlaps data already seen.  Within the
+///        tolerance the expected time is resynchronized to the packet so
+///        small timing errors do not accumulate into a spurious gap.
+///        Instead, over a contiguous run of packets the difference between
+///        the elapsed time and the time implied by the nominal sampling
+///        rate measures the drift of the digitizer's clock.
+class StreamContinuity
+{
+public:
+    /// @brief The packet's relation to the data already seen.
+    enum class Continuity
+    {
+        Started,    /*!< The first packet or the sampling rate changed. */
+        Contiguous, /*!< The packet follows the last one. */
+        Gap,        /*!< Data is missing before the packet. */
+        Overlap,    /*!< The packet repeats data already seen. */
+        Ignored     /*!< The packet has no samples or sampling rate. */
+    };
+    /// @brief Describes a packet's continuity.
+    struct Result
+    {
+        Continuity continuity{Continuity::Ignored};
+        /// The duration of the gap or overlap.
+        std::chrono::nanoseconds duration{0};
+    };
+
+    /// @param[in] tolerance  The allowed timing error in sample periods.
+    ///                       Half a sample is the miniSEED convention.
+    /// @throws std::invalid_argument if the tolerance is negative.
+    explicit StreamContinuity(const double tolerance = 0.5) :
+        mTolerance(tolerance)
+    {
+        if (!(tolerance >= 0))
+        {
+            throw std::invalid_argument("Tolerance cannot be negative");
+        }
+    }
+    /// @brief Checks the next packet against the data already seen.
+    /// @param[in] startTime     The time of the packet's first sample.
+    /// @param[in] nSamples      The number of samples in the packet.
+    /// @param[in] samplingRate  The packet's sampling rate in Hz.
+    /// @result The packet's continuity.
+    [[nodiscard]] Result update(const std::chrono::nanoseconds &startTime,
+                                const int nSamples,
+                                const double samplingRate) noexcept
+    {
+        if (nSamples < 1 || !(samplingRate > 0)){return Result {};}
+        const double samplingPeriod{1.e9/samplingRate}; // Nanoseconds
+        const std::chrono::nanoseconds endTime
+        {
+            startTime.count()
+          + std::llround(nSamples*samplingPeriod)
+        };
+        // The first packet or a new sampling rate starts a run
+        if (!mInitialized ||
+            std::abs(samplingRate - mSamplingRate) > 1.e-6*mSamplingRate)
+        {
+            mInitialized = true;
+            mSamplingRate = samplingRate;
+            mTimingDrift = 0;
+            startRun(startTime, endTime, nSamples);
+            return Result {Continuity::Started};
+        }
+        const auto offset = (startTime - mExpectedStartTime).count();
+        const auto tolerance = mTolerance*samplingPeriod;
+        if (static_cast<double> (offset) > tolerance)
+        {
+            startRun(startTime, endTime, nSamples);
+            return Result {Continuity::Gap,
+                           std::chrono::nanoseconds {offset}};
+        }
+        if (static_cast<double> (-offset) > tolerance)
+        {
+            Result result{Continuity::Overlap,
+                          std::min(mExpectedStartTime, endTime) - startTime};
+            // A packet that is entirely old data (e.g., a retransmission)
+            // leaves the run alone
+            if (endTime > mExpectedStartTime)
+            {
+                startRun(startTime, endTime, nSamples);
+            }
+            return result;
+        }
+        const auto elapsed = (startTime - mRunStartTime).count();
+        const auto nominal = mRunSamples*samplingPeriod;
+        if (nominal > 0)
+        {
+            mTimingDrift = (static_cast<double> (elapsed) - nominal)
+                          /nominal*1.e6;
+        }
+        mRunSamples = mRunSamples + nSamples;
+        mExpectedStartTime = endTime;
+        return Result {Continuity::Contiguous};
+    }
+    /// @result The relative difference in parts per million between the
+    ///         time elapsed over the latest contiguous run of packets and
+    ///         the time implied by the nominal sampling rate.  Positive
+    ///         indicates the stream is slower than the nominal rate.
+    [[nodiscard]] double getTimingDrift() const noexcept
+    {
+        return mTimingDrift;
+    }
+private:
+    void startRun(const std::chrono::nanoseconds &startTime,
+                  const std::chrono::nanoseconds &endTime,
+                  const int nSamples) noexcept
+    {
+        mRunStartTime = startTime;
+        mRunSamples = nSamples;
+        mExpectedStartTime = endTime;
+    }
+    std::chrono::nanoseconds mExpectedStartTime{0};
+    std::chrono::nanoseconds mRunStartTime{0};
+    int64_t mRunSamples{0};
+    double mSamplingRate{0};
+    double mTolerance{0.5};
+    double mTimingDrift{0};
+    bool mInitialized{false};
+};
+
+}
+#endif
@@ -1,209 +1,190 @@
 #include <string>
 #include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <type_traits>
 #include "uSEEDLinkToRingServer/streamIdentifier.hpp"
 
 using namespace USEEDLinkToRingServer;
 
-namespace
-{
+static_assert(std::is_trivially_copyable_v<StreamIdentifier>,
+              "Stream identifiers must be trivially copyable");
 
-/// @result True indicates that the string is empty or full of blanks.
-[[maybe_unused]] [[nodiscard]]
-bool isEmpty(const std::string &s) 
-{
-    if (s.empty()){return true;}
-    return std::all_of(s.begin(), s.end(), [](const char c)
-                       {
-                           return std::isspace(c);
-                       });
-}
-/// @result True indicates that the string is empty or full of blanks.
-[[maybe_unused]] [[nodiscard]]
-bool isEmpty(const std::string_view &s) 
-{
-    if (s.empty()){return true;}
-    return std::all_of(s.begin(), s.end(), [](const char c)
-                       {
-                           return std::isspace(c);
-                       });
-}
-
-[[nodiscard]] std::string convertString(const std::string_view &s) 
+namespace
 {
-    std::string temp{s};
-    temp.erase(std::remove(temp.begin(), temp.end(), ' '), temp.end());
-    std::transform(temp.begin(), temp.end(), temp.begin(), ::toupper);
-    return temp;
-}
-
-}
 
-class StreamIdentifier::StreamIdentifierImpl
+/// @brief Strips the blanks from and upper cases the code then copies it
+///        into the fixed-size storage.
+/// @result The length of the code.
+template<size_t N>
+[[nodiscard]] uint8_t convertString(const std::string_view &s,
+                                    std::array<char, N> &code,
+                                    const std::string &name)
 {
-public:
-    void setString()
+    std::array<char, N> work{};
+    size_t length{0};
+    for (const auto c : s)
     {
-        mString.clear();
-        if (!mNetwork.empty() &&
-            !mStation.empty() &&
-            !mChannel.empty() &&
-            mHasLocationCode)
+        if (std::isspace(static_cast<unsigned char> (c))){continue;}
+        if (length == work.size())
         {
-            mString = mNetwork + "."
-                    + mStation + "."
-                    + mChannel;
-            if (!mLocationCode.empty())
-            {
-                mString = mString + "." + mLocationCode;
-            }
+            throw std::invalid_argument(name + " " + std::string {s}
+                                      + " exceeds "
+                                      + std::to_string(work.size())
+                                      + " characters");
         }
+        work[length] = static_cast<char>
+                       (std::toupper(static_cast<unsigned char> (c)));
+        length = length + 1;
     }
-    std::string mNetwork;
-    std::string mStation;
-    std::string mChannel;
-    std::string mLocationCode;   
-    std::string mString;
-    bool mHasLocationCode{false};
-};
+    code = work;
+    return static_cast<uint8_t> (length);
+}
 
-/// Constructor
-StreamIdentifier::StreamIdentifier() :
-    pImpl(std::make_unique<StreamIdentifierImpl> ())
+/// @result The 64-bit FNV-1a hash of the string.
+[[nodiscard]] size_t computeHash(const std::string_view &s) noexcept
 {
+    uint64_t hash{14695981039346656037ULL};
+    for (const auto c : s)
+    {
+        hash = hash^static_cast<unsigned char> (c);
+        hash = hash*1099511628211ULL;
+    }
+    return static_cast<size_t> (hash);
 }
 
-/// Constructor
+}
+
+/// Constructor.  The codes are filled in directly so the name and hash are
+/// built once rather than by each setter.
 StreamIdentifier::StreamIdentifier(
     const std::string_view &network,
     const std::string_view &station,
     const std::string_view &channel,
     const std::string_view &locationCode)
 {
-    StreamIdentifier temp;
-    temp.setNetwork(network);
-    temp.setStation(station);
-    temp.setChannel(channel);
-    temp.setLocationCode(locationCode);
-    *this = std::move(temp);
-}
-
-/// Copy constructor
-StreamIdentifier::StreamIdentifier(const StreamIdentifier &identifier)
-{
-    *this = identifier;
-}
-
-/// Move constructor
-StreamIdentifier::StreamIdentifier(StreamIdentifier &&identifier) noexcept
-{
-    *this = std::move(identifier);
+    mNetworkLength = ::convertString(network, mNetwork, "Network");
+    if (mNetworkLength == 0){throw std::invalid_argument("Network is empty");}
+    mStationLength = ::convertString(station, mStation, "Station");
+    if (mStationLength == 0){throw std::invalid_argument("Station is empty");}
+    mChannelLength = ::convertString(channel, mChannel, "Channel");
+    if (mChannelLength == 0){throw std::invalid_argument("Channel is empty");}
+    mLocationCodeLength = ::convertString(locationCode, mLocationCode,
+                                          "Location code");
+    mHasLocationCode = true;
+    update();
 }
 
-/// Copy assignment
-StreamIdentifier& 
-StreamIdentifier::operator=(const StreamIdentifier &identifier)
+/// Builds the dotted name and its hash
+void StreamIdentifier::update() noexcept
 {
-    if (&identifier == this){return *this;}
-    pImpl = std::make_unique<StreamIdentifierImpl> (*identifier.pImpl);
-    return *this;
-}
-
-/// Move assignment
-StreamIdentifier& 
-StreamIdentifier::operator=(StreamIdentifier &&identifier) noexcept
-{
-    if (&identifier == this){return *this;}
-    pImpl = std::move(identifier.pImpl);
-    return *this;
+    mStringLength = 0;
+    if (mNetworkLength > 0 &&
+        mStationLength > 0 &&
+        mChannelLength > 0 &&
+        mHasLocationCode)
+    {
+        auto append = [this](const char *code, const uint8_t length)
+        {
+            std::copy(code, code + length, mString.data() + mStringLength);
+            mStringLength = static_cast<uint8_t> (mStringLength + length);
+        };
+        append(mNetwork.data(), mNetworkLength);
+        append(".", 1);
+        append(mStation.data(), mStationLength);
+        append(".", 1);
+        append(mChannel.data(), mChannelLength);
+        if (mLocationCodeLength > 0)
+        {
+            append(".", 1);
+            append(mLocationCode.data(), mLocationCodeLength);
+        }
+    }
+    mString[mStringLength] = '\0';
+    mHash = ::computeHash(std::string_view {mString.data(), mStringLength});
 }
 
 /// Reset class
 void StreamIdentifier::clear() noexcept
 {
-    pImpl->mNetwork.clear();
-    pImpl->mStation.clear();
-    pImpl->mChannel.clear();
-    pImpl->mLocationCode.clear();
-    pImpl->setString();
+    *this = StreamIdentifier {};
 }
 
-/// Destructor
-StreamIdentifier::~StreamIdentifier() = default;
-
 /// Network
 void StreamIdentifier::setNetwork(const std::string_view &network)
 {
-    auto s = ::convertString(network);
-    if (::isEmpty(s)){throw std::invalid_argument("Network is empty");}
-    pImpl->mNetwork = std::move(s);
-    pImpl->setString();
+    std::array<char, MaximumCodeLength> code;
+    auto length = ::convertString(network, code, "Network");
+    if (length == 0){throw std::invalid_argument("Network is empty");}
+    mNetwork = code;
+    mNetworkLength = length;
+    update();
 }
 
 std::string StreamIdentifier::getNetwork() const
 {
     if (!hasNetwork()){throw std::runtime_error("Network not set yet");}
-    return pImpl->mNetwork;
+    return std::string {mNetwork.data(), mNetworkLength};
 }
 
 bool StreamIdentifier::hasNetwork() const noexcept
 {
-    return !pImpl->mNetwork.empty();
+    return mNetworkLength > 0;
 }
 
 /// Station
 void StreamIdentifier::setStation(const std::string_view &station)
 {
-    auto s = ::convertString(station);
-    if (::isEmpty(s)){throw std::invalid_argument("Station is empty");}
-    pImpl->mStation = std::move(s);
-    pImpl->setString();
+    std::array<char, MaximumCodeLength> code;
+    auto length = ::convertString(station, code, "Station");
+    if (length == 0){throw std::invalid_argument("Station is empty");}
+    mStation = code;
+    mStationLength = length;
+    update();
 }
 
 std::string StreamIdentifier::getStation() const
 {
     if (!hasStation()){throw std::runtime_error("Station not set yet");}
-    return pImpl->mStation;
+    return std::string {mStation.data(), mStationLength};
 }
 
 bool StreamIdentifier::hasStation() const noexcept
 {
-    return !pImpl->mStation.empty();
+    return mStationLength > 0;
 }
 
 /// Channel
 void StreamIdentifier::setChannel(const std::string_view &channel)
 {
-    auto s = ::convertString(channel);
-    if (::isEmpty(s)){throw std::invalid_argument("Channel is empty");}
-    pImpl->mChannel = std::move(s);
-    pImpl->setString();
+    std::array<char, MaximumChannelLength> code;
+    auto length = ::convertString(channel, code, "Channel");
+    if (length == 0){throw std::invalid_argument("Channel is empty");}
+    mChannel = code;
+    mChannelLength = length;
+    update();
 }
 
 std::string StreamIdentifier::getChannel() const
 {
     if (!hasChannel()){throw std::runtime_error("Channel not set yet");}
-    return pImpl->mChannel;
+    return std::string {mChannel.data(), mChannelLength};
 }
 
 bool StreamIdentifier::hasChannel() const noexcept
 {
-    return !pImpl->mChannel.empty();
+    return mChannelLength > 0;
 }
 
 /// Location code
 void StreamIdentifier::setLocationCode(const std::string_view &locationCode)
 {
-    auto s = ::convertString(locationCode);
-    if (::isEmpty(locationCode))
-    {
-        pImpl->mLocationCode = "";
-    }
-    else
-    {
-        pImpl->mLocationCode = std::move(s);
-    }
-    pImpl->mHasLocationCode = true;
-    pImpl->setString();
+    std::array<char, MaximumCodeLength> code;
+    auto length = ::convertString(locationCode, code, "Location code");
+    mLocationCode = code;
+    mLocationCodeLength = length;
+    mHasLocationCode = true;
+    update();
 }
 
 std::string StreamIdentifier::getLocationCode() const
@@ -211,19 +192,24 @@ std::string StreamIdentifier::getLocationCode() const
     if (!hasLocationCode())
     {
         throw std::runtime_error("Location code not set yet");
-    }   
-    return pImpl->mLocationCode;
+    }
+    return std::string {mLocationCode.data(), mLocationCodeLength};
 }
 
 bool StreamIdentifier::hasLocationCode() const noexcept
 {
-    return pImpl->mHasLocationCode;
+    return mHasLocationCode;
 }
 
 /// To name
 std::string StreamIdentifier::toString() const
 {
-    if (pImpl->mString.empty())
+    return std::string {getStringReference()};
+}
+
+std::string_view StreamIdentifier::getStringReference() const
+{
+    if (mStringLength == 0)
     {
         if (!hasNetwork()){throw std::runtime_error("Network not set");}
         if (!hasStation()){throw std::runtime_error("Station not set");}
@@ -233,31 +219,30 @@ std::string StreamIdentifier::toString() const
             throw std::runtime_error("Location code not set");
         }
     }
-    return pImpl->mString;
+    return std::string_view {mString.data(), mStringLength};
 }
 
-const std::string &StreamIdentifier::getStringReference() const
+size_t StreamIdentifier::getHash() const noexcept
 {
-    if (pImpl->mString.empty())
-    {   
-        if (!hasNetwork()){throw std::runtime_error("Network not set");}
-        if (!hasStation()){throw std::runtime_error("Station not set");}
-        if (!hasChannel()){throw std::runtime_error("Channel not set");}
-        if (!hasLocationCode())
-        {   
-            throw std::runtime_error("Location code not set");
-        }   
-    }   
-    return *&pImpl->mString;
+    return mHash;
 }
 
 std::string USEEDLinkToRingServer::toDataLinkIdentifier(
     const StreamIdentifier &streamIdentifier)
 {
-    auto result = streamIdentifier.getNetwork() + "_"
-                + streamIdentifier.getStation() + "_"
-                + streamIdentifier.getLocationCode() + "_"
-                + streamIdentifier.getChannel() + "/MSEED";
+    // NET_STA_LOC_CHA/MSEED
+    constexpr std::string_view suffix{"/MSEED"};
+    auto name = streamIdentifier.getStringReference();
+    auto network = streamIdentifier.getNetwork();
+    auto station = streamIdentifier.getStation();
+    auto channel = streamIdentifier.getChannel();
+    auto locationCode = streamIdentifier.getLocationCode();
+    std::string result;
+    result.reserve(name.size() + 1 + suffix.size());
+    result.append(network).append("_")
+          .append(station).append("_")
+          .append(locationCode).append("_")
+          .append(channel).append(suffix);
     return result;
 }
 
@@ -270,5 +255,6 @@ bool USEEDLinkToRingServer::operator<(const StreamIdentifier &lhs,
 bool USEEDLinkToRingServer::operator==(const StreamIdentifier &lhs,
                                        const StreamIdentifier &rhs)
 {
+    if (lhs.getHash() != rhs.getHash()){return false;}
     return lhs.getStringReference() == rhs.getStringReference();
 }
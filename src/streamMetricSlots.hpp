@@ -0,0 +1,270 @@
+#ifndef STREAM_METRIC_SLOTS_HPP
+#define STREAM_METRIC_SLOTS_HPP
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/// @brief The gauges tabulated for a stream over a sampling interval.
+struct StreamGauges
+{
+    std::atomic<double> averageLatency{0};
+    std::atomic<double> averageCounts{0};
+    std::atomic<double> standardDeviationOfCounts{0};
+    std::atomic<double> minimumCounts{0};
+    std::atomic<double> maximumCounts{0};
+};
+
+/// @brief A fixed-bucket latency histogram layout.  Bucket i holds the
+///        latencies below 2^i milliseconds (and at least 2^(i-1) ms) so
+///        the bucket is found in O(1) from the bit width of the latency.
+///        The last bucket is unbounded.  Negative latencies from clock
+///        skew fall in the first bucket.
+struct LatencyHistogram
+{
+    static constexpr int NumberOfBuckets{24};
+    /// @result The bucket holding the latency.
+    [[nodiscard]] static int toBucket(
+        const std::chrono::microseconds &latency) noexcept
+    {
+        auto milliseconds = latency.count()/1000;
+        if (milliseconds <= 0){return 0;}
+        auto bucket
+            = static_cast<int> (std::bit_width(
+                 static_cast<uint64_t> (milliseconds)));
+        return std::min(bucket, NumberOfBuckets - 1);
+    }
+    /// @result The upper bound of the bucket in seconds.
+    [[nodiscard]] static double getUpperBound(const int bucket) noexcept
+    {
+        if (bucket >= NumberOfBuckets - 1)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        return static_cast<double> (uint64_t {1} << bucket)*1.e-3;
+    }
+};
+
+/// @brief The labels of a stream's metrics.  These are built once when the
+///        stream is added so that collection need not.  They are immutable
+///        so the exporter can keep using them while the slot is reused.
+struct StreamLabels
+{
+    std::string metricsKey;
+    std::map<std::string, std::string> attributes;
+};
+
+/// @brief A stream's exported metrics.  The slot is aligned to a cache line
+///        so the metrics thread updating one stream does not contend with
+///        the exporter reading another.
+struct alignas(64) StreamMetricSlot
+{
+    /// Null when the slot is free
+    std::atomic<std::shared_ptr<const StreamLabels>> labels;
+    std::atomic<int64_t> packetsReceived{0};
+    std::atomic<int64_t> futurePacketsReceived{0};
+    std::atomic<int64_t> expiredPacketsReceived{0};
+    std::atomic<int64_t> totalPacketsReceived{0};
+    /// The cumulative latency histogram of the valid packets
+    std::array<std::atomic<int64_t>, LatencyHistogram::NumberOfBuckets>
+        latencyBuckets{};
+    std::atomic<int64_t> latencySum{0}; // microseconds
+    /// Continuity of the stream's data
+    std::atomic<int64_t> gaps{0};
+    std::atomic<int64_t> gapDuration{0}; // microseconds
+    std::atomic<int64_t> overlaps{0};
+    std::atomic<int64_t> overlapDuration{0}; // microseconds
+    std::atomic<double> timingDrift{0}; // parts per million
+    std::array<StreamGauges, 2> gauges;
+};
+
+/// @brief A dense store of per-stream metric slots indexed by a stream id.
+///        A single thread (the metrics thread) adds, removes, and updates
+///        streams while the exporter reads them.  Slots are allocated in
+///        chunks that never move so a reader only needs the published size
+///        to walk them - collecting is O(streams) and does not allocate.
+///        Removed slots are reused by the next stream added.
+///        The gauges are double buffered: an interval's gauges are written
+///        to the back buffer then published together with one flip.
+class StreamMetricSlots
+{
+public:
+    static constexpr int ChunkSize{256};
+    static constexpr int MaximumChunks{1024};
+    static constexpr int MaximumNumberOfStreams{ChunkSize*MaximumChunks};
+    /// @brief Adds a stream.
+    /// @param[in] metricsKey  The stream's name in the metrics.
+    /// @param[in] attributes  The attributes labelling the stream's metrics.
+    /// @result The stream's id.
+    /// @throws std::runtime_error if the store is full.
+    [[nodiscard]] int add(const std::string &metricsKey,
+                          std::map<std::string, std::string> attributes = {})
+    {
+        int index{0};
+        bool append{mFreeSlots.empty()};
+        if (append)
+        {
+            index = mHighWaterMark.load(std::memory_order_relaxed);
+            auto chunk = index/ChunkSize;
+            if (chunk >= MaximumChunks)
+            {
+                throw std::runtime_error("Cannot track more than "
+                                       + std::to_string(MaximumNumberOfStreams)
+                                       + " streams");
+            }
+            if (mChunks[chunk] == nullptr)
+            {
+                mChunks[chunk]
+                    = std::make_unique<StreamMetricSlot[]> (ChunkSize);
+            }
+        }
+        else
+        {
+            index = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            reset((*this)[index]);
+        }
+        auto labels = std::make_shared<const StreamLabels>
+                      (StreamLabels {metricsKey, std::move(attributes)});
+        // Publish the slot to the exporter
+        (*this)[index].labels.store(std::move(labels),
+                                    std::memory_order_release);
+        if (append)
+        {
+            mHighWaterMark.store(index + 1, std::memory_order_release);
+        }
+        mSize.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+    /// @brief Removes a stream.  The exporter stops observing it and the
+    ///        slot is given to the next stream added.
+    void remove(const int index)
+    {
+        auto &slot = (*this)[index];
+        if (slot.labels.exchange(nullptr, std::memory_order_acq_rel)
+            != nullptr)
+        {
+            mFreeSlots.push_back(index);
+            mSize.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    /// @result The number of streams.
+    [[nodiscard]] int size() const noexcept
+    {
+        return mSize.load(std::memory_order_relaxed);
+    }
+    /// @result The stream's slot.
+    [[nodiscard]] StreamMetricSlot &operator[](const int index) noexcept
+    {
+        return mChunks[index/ChunkSize][index%ChunkSize];
+    }
+    /// @result The stream's slot.
+    [[nodiscard]] const StreamMetricSlot &operator[](const int index)
+        const noexcept
+    {
+        return mChunks[index/ChunkSize][index%ChunkSize];
+    }
+    /// @result The gauges the metrics thread is filling for this interval.
+    [[nodiscard]] StreamGauges &getBackGauges(const int index) noexcept
+    {
+        auto back = 1 - mPublished.load(std::memory_order_relaxed);
+        return (*this)[index].gauges[back];
+    }
+    /// @result The most recently published gauges.
+    [[nodiscard]] const StreamGauges &getPublishedGauges(const int index)
+        const noexcept
+    {
+        return (*this)[index].gauges[mPublished.load(std::memory_order_acquire)];
+    }
+    /// @brief Records a packet's latency in the stream's histogram.
+    void recordLatency(const int index,
+                       const std::chrono::microseconds &latency) noexcept
+    {
+        auto &slot = (*this)[index];
+        slot.latencyBuckets[LatencyHistogram::toBucket(latency)]
+            .fetch_add(1, std::memory_order_relaxed);
+        slot.latencySum.fetch_add(latency.count(), std::memory_order_relaxed);
+    }
+    /// @brief Tallies a gap in the stream's data.
+    void recordGap(const int index,
+                   const std::chrono::microseconds &duration) noexcept
+    {
+        auto &slot = (*this)[index];
+        slot.gaps.fetch_add(1, std::memory_order_relaxed);
+        slot.gapDuration.fetch_add(duration.count(),
+                                   std::memory_order_relaxed);
+    }
+    /// @brief Tallies data the stream sent more than once.
+    void recordOverlap(const int index,
+                       const std::chrono::microseconds &duration) noexcept
+    {
+        auto &slot = (*this)[index];
+        slot.overlaps.fetch_add(1, std::memory_order_relaxed);
+        slot.overlapDuration.fetch_add(duration.count(),
+                                       std::memory_order_relaxed);
+    }
+    /// @brief Publishes the back buffer's gauges.
+    void publishGauges() noexcept
+    {
+        auto back = 1 - mPublished.load(std::memory_order_relaxed);
+        mPublished.store(back, std::memory_order_release);
+    }
+    /// @brief Calls f(id, slot, labels) for every stream.
+    template<typename F>
+    void forEach(F &&f) const
+    {
+        auto nSlots = mHighWaterMark.load(std::memory_order_acquire);
+        for (int index = 0; index < nSlots; ++index)
+        {
+            const auto &slot = (*this)[index];
+            auto labels = slot.labels.load(std::memory_order_acquire);
+            if (labels){f(index, slot, *labels);}
+        }
+    }
+private:
+    static void reset(StreamMetricSlot &slot) noexcept
+    {
+        slot.packetsReceived.store(0, std::memory_order_relaxed);
+        slot.futurePacketsReceived.store(0, std::memory_order_relaxed);
+        slot.expiredPacketsReceived.store(0, std::memory_order_relaxed);
+        slot.totalPacketsReceived.store(0, std::memory_order_relaxed);
+        for (auto &bucket : slot.latencyBuckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        slot.latencySum.store(0, std::memory_order_relaxed);
+        slot.gaps.store(0, std::memory_order_relaxed);
+        slot.gapDuration.store(0, std::memory_order_relaxed);
+        slot.overlaps.store(0, std::memory_order_relaxed);
+        slot.overlapDuration.store(0, std::memory_order_relaxed);
+        slot.timingDrift.store(0, std::memory_order_relaxed);
+        for (auto &gauges : slot.gauges)
+        {
+            gauges.averageLatency.store(0, std::memory_order_relaxed);
+            gauges.averageCounts.store(0, std::memory_order_relaxed);
+            gauges.standardDeviationOfCounts.store(0,
+                                                   std::memory_order_relaxed);
+            gauges.minimumCounts.store(0, std::memory_order_relaxed);
+            gauges.maximumCounts.store(0, std::memory_order_relaxed);
+        }
+    }
+    std::array<std::unique_ptr<StreamMetricSlot[]>, MaximumChunks> mChunks;
+    std::vector<int> mFreeSlots;
+    std::atomic<int> mHighWaterMark{0};
+    std::atomic<int> mSize{0};
+    std::atomic<int> mPublished{0};
+};
+
+}
+#endif
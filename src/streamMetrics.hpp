@@ -2,15 +2,25 @@
 #define STREAM_METRICS_HPP
 #include <chrono>
 #include <atomic>
+#include <array>
+#include <charconv>
+#include <list>
 #include <map>
+#include <string_view>
+#include <vector>
 #include <spdlog/spdlog.h>
+#include <opentelemetry/common/key_value_iterable.h>
 #include <opentelemetry/metrics/meter.h>
 #include <opentelemetry/metrics/meter_provider.h>
 #include <opentelemetry/metrics/provider.h>
 #include <opentelemetry/sdk/metrics/view/view_factory.h>
 #include "uSEEDLinkToRingServer/packet.hpp"
 #include "uSEEDLinkToRingServer/streamIdentifier.hpp"
+#include "uSEEDLinkToRingServer/writerMetricsSingleton.hpp"
 #include "getNow.hpp"
+#include "prometheusExposition.hpp"
+#include "streamContinuity.hpp"
+#include "streamMetricSlots.hpp"
 
 namespace
 {
@@ -36,95 +46,166 @@ opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
     mAverageCountsGauge;
 opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
     mStandardDeviationCountsGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mMinimumCountsGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mMaximumCountsGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mLatencyHistogramCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mGapsCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mGapDurationCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mOverlapsCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mOverlapDurationCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mTimingDriftGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mImportQueueDepthGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mImportQueueOccupancyGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mImportQueueResidencyBucketCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mImportQueueResidencyCountCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mImportQueueResidencySumCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mImportPacketsDroppedCounter;
 
-template<typename T>
-class ObservableMap
+/// @brief Instrumentation of the import queue that hands packets from the
+///        SEEDLink client to the thread that tabulates the metrics and fans
+///        the packets out to the writers.
+struct ImportQueueMetrics
 {
-public:
-    /*
-    void insert_or_assign(const std::string &key, const T value)
+    std::atomic<int64_t> capacity{0};
+    std::atomic<int64_t> depth{0};
+    /// Time from the SEEDLink client enqueuing a packet to its dequeue
+    USEEDLinkToRingServer::DurationHistogram residency;
+    /// Packets discarded to make room in the full queue
+    std::atomic<int64_t> packetsEvicted{0};
+    /// Packets the queue would not accept
+    std::atomic<int64_t> packetsFailedToEnqueue{0};
+    /// Packets a writer would not accept
+    std::atomic<int64_t> packetsFailedToFanOut{0};
+};
+
+::ImportQueueMetrics mImportQueueMetrics;
+
+// The per-stream metrics read by the exporter
+::StreamMetricSlots mStreamMetricSlots;
+
+/// Labels each stream by its name, network, and, optionally, the data
+/// source.  This is called once when the stream is registered.
+[[nodiscard]] std::map<std::string, std::string>
+    toAttributes(const std::string &metricsKey, const std::string &network)
+{
+    std::map<std::string, std::string> attributes{ {"stream", metricsKey},
+                                                   {"network", network} };
+    if (!mSourceAttribute.source.empty())
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mMap.insert_or_assign(key, value);
+        attributes.insert(std::pair{"source", mSourceAttribute.source});
     }
-    */
-    /// If the key, value pair is present then value will be added to it
-    /// otherwise the key, value pair is initialized to the given value.
-    void add_or_assign(const std::string &key, const T value)
+    return attributes;
+}
+
+/// @result The bound in seconds formatted as a Prometheus "le" label.
+[[nodiscard]] std::string toBucketLabel(const double upperBound)
+{
+    std::array<char, 32> buffer;
+    auto [end, error]
+        = std::to_chars(buffer.data(), buffer.data() + buffer.size(),
+                        upperBound);
+    return std::string(buffer.data(), end);
+}
+
+/// @result The upper bounds of the latency histogram's buckets formatted as
+///         Prometheus "le" labels.
+[[nodiscard]] const std::array<std::string, ::LatencyHistogram::NumberOfBuckets>
+    &getLatencyBucketLabels()
+{
+    static const auto labels = []()
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        auto idx = mMap.find(key);
-        if (idx != mMap.end())
-        {
-            idx->second = idx->second + value;
-        }
-        else
+        std::array<std::string, ::LatencyHistogram::NumberOfBuckets> result;
+        for (int i = 0; i < ::LatencyHistogram::NumberOfBuckets - 1; ++i)
         {
-            mMap.insert( std::pair {key, value} );
+            result[i] = ::toBucketLabel(::LatencyHistogram::getUpperBound(i));
         }
-    }
-    [[nodiscard]] std::set<std::string> keys() const noexcept
+        result.back() = "+Inf";
+        return result;
+    }();
+    return labels;
+}
+
+/// @result The upper bounds of the residency histogram's buckets formatted
+///         as Prometheus "le" labels.
+[[nodiscard]] const std::vector<std::string> &getResidencyBucketLabels()
+{
+    static const auto labels = []()
     {
-        std::set<std::string> result;
-        std::lock_guard<std::mutex> lock(mMutex);
-        for (const auto &item : mMap)
+        std::vector<std::string> result;
+        for (const auto bound :
+             USEEDLinkToRingServer::DurationHistogram::mBucketBounds)
         {
-            result.insert(item.first);
+            result.push_back(::toBucketLabel(bound*1.e-6));
         }
+        result.push_back("+Inf");
         return result;
-    }
-    [[nodiscard]] std::optional<T> operator[](const std::string &key) const
+    }();
+    return labels;
+}
+
+/// @brief A stream's attributes plus a histogram bucket's upper bound.
+///        This lets the exporter label each bucket without copying the
+///        stream's attributes.
+class LatencyBucketAttributes :
+    public opentelemetry::common::KeyValueIterable
+{
+public:
+    LatencyBucketAttributes(const std::map<std::string, std::string> &attributes,
+                            const std::string &upperBound) noexcept :
+        mAttributes(attributes),
+        mUpperBound(upperBound)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        auto idx = mMap.find(key);
-        if (idx != mMap.end())
-        {
-            return std::make_optional(idx->second);
-        }
-        return std::nullopt;
     }
-    [[nodiscard]] std::optional<T> at(const std::string &key) const
+    bool ForEachKeyValue(
+        opentelemetry::nostd::function_ref
+        <
+            bool (opentelemetry::nostd::string_view,
+                  opentelemetry::common::AttributeValue)
+        > callback) const noexcept override
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        auto idx = mMap.find(key);
-        if (idx != mMap.end())
+        for (const auto &attribute : mAttributes)
         {
-            return std::make_optional (idx->second);
+            if (!callback(attribute.first,
+                          opentelemetry::nostd::string_view {attribute.second}))
+            {
+                return false;
+            }
         }
-        return std::nullopt;
+        return callback("le", opentelemetry::nostd::string_view {mUpperBound});
     }
-    [[nodiscard]] size_t size() const noexcept
+    size_t size() const noexcept override
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        return mMap.size();
+        return mAttributes.size() + 1;
     }
-    mutable std::mutex mMutex;
-    std::map<std::string, T> mMap;
+private:
+    const std::map<std::string, std::string> &mAttributes;
+    const std::string &mUpperBound;
 };
 
-// TODO make these thread safe and also able to be purged
-::ObservableMap<int64_t> mObservablePacketsReceived;
-//std::map<std::string, int64_t> mObservablePacketsReceived;
-::ObservableMap<int64_t> mObservableExpiredPacketsReceived;
-//std::map<std::string, int64_t> mObservableExpiredPacketsReceived;
-::ObservableMap<int64_t> mObservableFuturePacketsReceived;
-//std::map<std::string, int64_t> mObservableFuturePacketsReceived;
-::ObservableMap<int64_t> mObservableTotalPacketsReceived;
-//std::map<std::string, int64_t> mObservableTotalPacketsReceived;
-std::map<std::string, double> mObservableAverageLatency;
-std::map<std::string, double> mObservableAverageCounts;
-std::map<std::string, double> mObservableStandardDeviationOfCounts;
-
-void observePacketsReceived(
-    opentelemetry::metrics::ObserverResult observerResult,
-    void *)
+template<typename F>
+void observeStreamInt64(opentelemetry::metrics::ObserverResult &observerResult,
+                        F &&getValue)
 {
     if (opentelemetry::nostd::holds_alternative
         <
             opentelemetry::nostd::shared_ptr
             <
                 opentelemetry::metrics::ObserverResultT<int64_t>
-            >   
+            >
         > (observerResult))
     {
         auto observer = opentelemetry::nostd::get
@@ -132,57 +213,26 @@ void observePacketsReceived(
             opentelemetry::nostd::shared_ptr
             <
                opentelemetry::metrics::ObserverResultT<int64_t>
-            >   
+            >
         > (observerResult);
-        auto keys = mObservablePacketsReceived.keys();
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &key : keys)
-        {
-            try
+        mStreamMetricSlots.forEach(
+            [&](const int, const ::StreamMetricSlot &slot,
+                const ::StreamLabels &labels)
             {
-                auto value = mObservablePacketsReceived[key];
-                if (value)
-                {
-                    std::map<std::string, std::string>
-                       attribute{ {"stream", key} };
-                    if (addSourceAttribute)
-                    {
-                        attribute.insert(
-                            std::pair{"source", mSourceAttribute.source});
-                    }
-                    observer->Observe(*value, attribute);
-                }
-                else
-                {
-                    throw std::runtime_error("Could not find " + key 
-                                           + " in map");
-                }
-            }
-            catch (const std::exception &e)
-            {
-                spdlog::warn(e.what());
-            }
-        }
-        /*
-        for (const auto &item : mObservablePacketsReceived)
-        {
-            std::map<std::string, std::string> attribute;
-            attribute.insert( std::pair {"stream", item.first} );
-            observer->Observe(item.second, attribute);
-        }
-        */  
-    }   
+                observer->Observe(getValue(slot), labels.attributes);
+            });
+    }
 }
 
-void observeExpiredPacketsReceived(
-    opentelemetry::metrics::ObserverResult observerResult,
-    void *)
+template<typename F>
+void observeStreamDouble(opentelemetry::metrics::ObserverResult &observerResult,
+                         F &&getValue)
 {
     if (opentelemetry::nostd::holds_alternative
         <
             opentelemetry::nostd::shared_ptr
             <
-                opentelemetry::metrics::ObserverResultT<int64_t>
+                opentelemetry::metrics::ObserverResultT<double>
             >
         > (observerResult))
     {
@@ -190,58 +240,31 @@ void observeExpiredPacketsReceived(
         <
             opentelemetry::nostd::shared_ptr
             <
-               opentelemetry::metrics::ObserverResultT<int64_t>
+               opentelemetry::metrics::ObserverResultT<double>
             >
         > (observerResult);
-        auto keys = mObservableExpiredPacketsReceived.keys();
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &key : keys)
-        {
-            try 
-            {   
-                auto value = mObservableExpiredPacketsReceived[key];
-                if (value)
-                {   
-                    std::map<std::string, std::string>
-                       attribute{ {"stream", key} };
-                    if (addSourceAttribute)
-                    {
-                        attribute.insert(
-                            std::pair{"source", mSourceAttribute.source});
-                    }
-                    observer->Observe(*value, attribute);
-                }   
-                else
-                {   
-                    throw std::runtime_error("Could not find " + key 
-                                           + " in map");
-                }   
-            }
-            catch (const std::exception &e) 
-            {   
-                spdlog::warn(e.what());
-            }   
-        }
-        /*
-        for (const auto &item : mObservableExpiredPacketsReceived)
-        {
-            std::map<std::string, std::string> attribute;
-            attribute.insert( std::pair {"stream", item.first} );
-            observer->Observe(item.second, attribute);
-        }
-        */
-    }   
+        mStreamMetricSlots.forEach(
+            [&](const int index, const ::StreamMetricSlot &,
+                const ::StreamLabels &labels)
+            {
+                const auto &gauges
+                    = mStreamMetricSlots.getPublishedGauges(index);
+                observer->Observe(getValue(gauges), labels.attributes);
+            });
+    }
 }
 
-void observeFuturePacketsReceived(
-    opentelemetry::metrics::ObserverResult observerResult,
-    void *)
+/// Observes a double the metrics thread keeps in each stream's slot
+template<typename F>
+void observeStreamSlotDouble(
+    opentelemetry::metrics::ObserverResult &observerResult,
+    F &&getValue)
 {
     if (opentelemetry::nostd::holds_alternative
         <
             opentelemetry::nostd::shared_ptr
             <
-                opentelemetry::metrics::ObserverResultT<int64_t>
+                opentelemetry::metrics::ObserverResultT<double>
             >
         > (observerResult))
     {
@@ -249,58 +272,205 @@ void observeFuturePacketsReceived(
         <
             opentelemetry::nostd::shared_ptr
             <
-               opentelemetry::metrics::ObserverResultT<int64_t>
+               opentelemetry::metrics::ObserverResultT<double>
             >
         > (observerResult);
-        auto keys = mObservableFuturePacketsReceived.keys();
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &key : keys)
-        {
-            try
+        mStreamMetricSlots.forEach(
+            [&](const int, const ::StreamMetricSlot &slot,
+                const ::StreamLabels &labels)
             {
-                auto value = mObservableFuturePacketsReceived[key];
-                if (value)
-                {
-                    std::map<std::string, std::string>
-                       attribute{ {"stream", key} };
-                    if (addSourceAttribute)
-                    {
-                        attribute.insert(
-                            std::pair{"source", mSourceAttribute.source});
-                    }
-                    observer->Observe(*value, attribute);
-                }
-                else
-                {
-                    throw std::runtime_error("Could not find " + key
-                                           + " in map");
-                }
-            }
-            catch (const std::exception &e)
-            {
-                spdlog::warn(e.what());
-            }
-        }
-        /*
-        for (const auto &item : mObservableFuturePacketsReceived)
-        {
-            std::map<std::string, std::string> attribute;
-            attribute.insert( std::pair {"stream", item.first} );
-            observer->Observe(item.second, attribute);
-        }
-        */
+                observer->Observe(getValue(slot), labels.attributes);
+            });
     }
 }
 
+void observePacketsReceived(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamInt64(observerResult,
+                       [](const ::StreamMetricSlot &slot)
+                       {
+                           return slot.packetsReceived.load(
+                                      std::memory_order_relaxed);
+                       });
+}
+
+void observeExpiredPacketsReceived(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamInt64(observerResult,
+                       [](const ::StreamMetricSlot &slot)
+                       {
+                           return slot.expiredPacketsReceived.load(
+                                      std::memory_order_relaxed);
+                       });
+}
+
+void observeFuturePacketsReceived(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamInt64(observerResult,
+                       [](const ::StreamMetricSlot &slot)
+                       {
+                           return slot.futurePacketsReceived.load(
+                                      std::memory_order_relaxed);
+                       });
+}
+
 void observeTotalPacketsReceived(
     opentelemetry::metrics::ObserverResult observerResult,
     void *)
+{
+    observeStreamInt64(observerResult,
+                       [](const ::StreamMetricSlot &slot)
+                       {
+                           return slot.totalPacketsReceived.load(
+                                      std::memory_order_relaxed);
+                       });
+}
+
+void observeGaps(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamInt64(observerResult,
+                       [](const ::StreamMetricSlot &slot)
+                       {
+                           return slot.gaps.load(std::memory_order_relaxed);
+                       });
+}
+
+void observeGapDuration(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamSlotDouble(observerResult,
+                            [](const ::StreamMetricSlot &slot)
+                            {
+                                return slot.gapDuration.load(
+                                           std::memory_order_relaxed)*1.e-6;
+                            });
+}
+
+void observeOverlaps(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamInt64(observerResult,
+                       [](const ::StreamMetricSlot &slot)
+                       {
+                           return slot.overlaps.load(
+                                      std::memory_order_relaxed);
+                       });
+}
+
+void observeOverlapDuration(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamSlotDouble(observerResult,
+                            [](const ::StreamMetricSlot &slot)
+                            {
+                                return slot.overlapDuration.load(
+                                           std::memory_order_relaxed)*1.e-6;
+                            });
+}
+
+void observeTimingDrift(
+    opentelemetry::metrics::ObserverResult observerResult,
+    void *)
+{
+    observeStreamSlotDouble(observerResult,
+                            [](const ::StreamMetricSlot &slot)
+                            {
+                                return slot.timingDrift.load(
+                                           std::memory_order_relaxed);
+                            });
+}
+
+void observeAverageLatency(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeStreamDouble(observerResult,
+                        [](const ::StreamGauges &gauges)
+                        {
+                            return gauges.averageLatency.load(
+                                       std::memory_order_relaxed);
+                        });
+}
+
+void observeAverageCounts(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeStreamDouble(observerResult,
+                        [](const ::StreamGauges &gauges)
+                        {
+                            return gauges.averageCounts.load(
+                                       std::memory_order_relaxed);
+                        });
+}
+
+void observeStandardDeviationOfAverageCounts(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeStreamDouble(observerResult,
+                        [](const ::StreamGauges &gauges)
+                        {
+                            return gauges.standardDeviationOfCounts.load(
+                                       std::memory_order_relaxed);
+                        });
+}
+
+void observeMinimumCounts(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeStreamDouble(observerResult,
+                        [](const ::StreamGauges &gauges)
+                        {
+                            return gauges.minimumCounts.load(
+                                       std::memory_order_relaxed);
+                        });
+}
+
+void observeMaximumCounts(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeStreamDouble(observerResult,
+                        [](const ::StreamGauges &gauges)
+                        {
+                            return gauges.maximumCounts.load(
+                                       std::memory_order_relaxed);
+                        });
+}
+
+/// Labels the import queue's metrics by the data source, if any
+[[nodiscard]] std::map<std::string, std::string> toImportQueueAttributes()
+{
+    std::map<std::string, std::string> attributes;
+    if (!mSourceAttribute.source.empty())
+    {
+        attributes.insert(std::pair{"source", mSourceAttribute.source});
+    }
+    return attributes;
+}
+
+template<typename T, typename F>
+void observeImportQueue(opentelemetry::metrics::ObserverResult &observerResult,
+                        F &&observe)
 {
     if (opentelemetry::nostd::holds_alternative
         <
             opentelemetry::nostd::shared_ptr
             <
-                opentelemetry::metrics::ObserverResultT<int64_t>
+                opentelemetry::metrics::ObserverResultT<T>
             >
         > (observerResult))
     {
@@ -308,145 +478,160 @@ void observeTotalPacketsReceived(
         <
             opentelemetry::nostd::shared_ptr
             <
-               opentelemetry::metrics::ObserverResultT<int64_t>
+               opentelemetry::metrics::ObserverResultT<T>
             >
         > (observerResult);
-        auto keys = mObservableTotalPacketsReceived.keys();
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &key : keys)
+        observe(*observer, ::toImportQueueAttributes());
+    }
+}
+
+void observeImportQueueDepth(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeImportQueue<int64_t>(
+        observerResult,
+        [](auto &observer, const auto &attributes)
+        {
+            observer.Observe(mImportQueueMetrics.depth.load(
+                                std::memory_order_relaxed),
+                             attributes);
+        });
+}
+
+void observeImportQueueOccupancy(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeImportQueue<double>(
+        observerResult,
+        [](auto &observer, const auto &attributes)
         {
-            try
+            auto capacity
+                = mImportQueueMetrics.capacity.load(std::memory_order_relaxed);
+            auto depth
+                = mImportQueueMetrics.depth.load(std::memory_order_relaxed);
+            double occupancy{0};
+            if (capacity > 0)
             {
-                auto value = mObservableTotalPacketsReceived[key];
-                if (value)
-                {
-                    std::map<std::string, std::string>
-                        attribute{ {"stream", key} };
-                    if (addSourceAttribute)
-                    {
-                        attribute.insert(
-                            std::pair{"source", mSourceAttribute.source});
-                    }
-                    observer->Observe(*value, attribute);
-                }
-                else
-                {
-                    throw std::runtime_error("Could not find " + key
-                                           + " in map");
-                }
+                occupancy = static_cast<double> (depth)
+                           /static_cast<double> (capacity);
             }
-            catch (const std::exception &e)
+            observer.Observe(occupancy, attributes);
+        });
+}
+
+/// Exports the residency histogram as cumulative bucket counts
+void observeImportQueueResidencyBuckets(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeImportQueue<int64_t>(
+        observerResult,
+        [](auto &observer, auto attributes)
+        {
+            const auto &upperBounds = ::getResidencyBucketLabels();
+            auto counts
+                = mImportQueueMetrics.residency.getCumulativeCounts();
+            for (size_t i = 0; i < counts.size(); ++i)
             {
-                spdlog::warn(e.what());
+                attributes.insert_or_assign("le", upperBounds[i]);
+                observer.Observe(counts[i], attributes);
             }
-        }
-        /*
-        for (const auto &item : mObservableTotalPacketsReceived)
+        });
+}
+
+void observeImportQueueResidencyCount(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+{
+    observeImportQueue<int64_t>(
+        observerResult,
+        [](auto &observer, const auto &attributes)
         {
-            std::map<std::string, std::string> attribute;
-            attribute.insert( std::pair {"stream", item.first} );
-            observer->Observe(item.second, attribute);//item.first);
-        }
-        */
-    }
+            observer.Observe(mImportQueueMetrics.residency
+                                .getCumulativeCounts().back(),
+                             attributes);
+        });
 }
 
-void observeAverageLatency(
+void observeImportQueueResidencySum(
         opentelemetry::metrics::ObserverResult observerResult,
         void *)
 {
-    if (opentelemetry::nostd::holds_alternative
-        <
-            opentelemetry::nostd::shared_ptr
-            <
-                opentelemetry::metrics::ObserverResultT<double>
-            >   
-        >(observerResult))
-    {
-        auto observer = opentelemetry::nostd::get
-        <
-           opentelemetry::nostd::shared_ptr
-           <
-               opentelemetry::metrics::ObserverResultT<double>
-           >   
-        > (observerResult);
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &item : mObservableAverageLatency)
+    observeImportQueue<double>(
+        observerResult,
+        [](auto &observer, const auto &attributes)
         {
-            std::map<std::string, std::string> attribute;
-            attribute.insert(std::pair{"stream", item.first});
-            if (addSourceAttribute)
-            {
-                attribute.insert(std::pair{"source", mSourceAttribute.source});
-            }
-            observer->Observe(item.second, attribute);
-        }   
-    }   
+            observer.Observe(mImportQueueMetrics.residency.getSum().count()
+                            *1.e-6,
+                             attributes);
+        });
 }
 
-void observeAverageCounts(
+/// Every way the import stage loses a packet is reported under one counter
+/// labelled by the reason
+void observeImportPacketsDropped(
         opentelemetry::metrics::ObserverResult observerResult,
         void *)
 {
-    if (opentelemetry::nostd::holds_alternative
-        <
-            opentelemetry::nostd::shared_ptr
-            <
-                opentelemetry::metrics::ObserverResultT<double>
-            >
-        >(observerResult))
-    {
-        auto observer = opentelemetry::nostd::get
-        <
-           opentelemetry::nostd::shared_ptr
-           <
-               opentelemetry::metrics::ObserverResultT<double>
-           >
-        > (observerResult);
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &item : mObservableAverageCounts)
+    observeImportQueue<int64_t>(
+        observerResult,
+        [](auto &observer, auto attributes)
         {
-            std::map<std::string, std::string> attribute;
-            attribute.insert(std::pair{"stream", item.first});
-            if (addSourceAttribute)
-            {
-                attribute.insert(std::pair{"source", mSourceAttribute.source});
-            }
-            observer->Observe(item.second, attribute);
-        }
-    }
+            attributes.insert_or_assign("reason", "queue_full");
+            observer.Observe(mImportQueueMetrics.packetsEvicted.load(
+                                std::memory_order_relaxed),
+                             attributes);
+            attributes.insert_or_assign("reason", "enqueue_failed");
+            observer.Observe(mImportQueueMetrics.packetsFailedToEnqueue.load(
+                                std::memory_order_relaxed),
+                             attributes);
+            attributes.insert_or_assign("reason", "fan_out_failed");
+            observer.Observe(mImportQueueMetrics.packetsFailedToFanOut.load(
+                                std::memory_order_relaxed),
+                             attributes);
+        });
 }
 
-void observeStandardDeviationOfAverageCounts(
+/// Exports the latency histograms as cumulative bucket counts
+void observeLatencyHistogram(
         opentelemetry::metrics::ObserverResult observerResult,
         void *)
 {
     if (opentelemetry::nostd::holds_alternative
-        <   
+        <
             opentelemetry::nostd::shared_ptr
-            <   
-                opentelemetry::metrics::ObserverResultT<double>
-            >   
+            <
+                opentelemetry::metrics::ObserverResultT<int64_t>
+            >
         > (observerResult))
-    {   
+    {
         auto observer = opentelemetry::nostd::get
-        <   
-           opentelemetry::nostd::shared_ptr
-           <
-               opentelemetry::metrics::ObserverResultT<double>
-           >
+        <
+            opentelemetry::nostd::shared_ptr
+            <
+               opentelemetry::metrics::ObserverResultT<int64_t>
+            >
         > (observerResult);
-        auto addSourceAttribute = !mSourceAttribute.source.empty();
-        for (const auto &item : mObservableStandardDeviationOfCounts)
-        {
-            std::map<std::string, std::string> attribute;
-            attribute.insert(std::pair{"stream", item.first});
-            if (addSourceAttribute)
+        const auto &upperBounds = ::getLatencyBucketLabels();
+        mStreamMetricSlots.forEach(
+            [&](const int, const ::StreamMetricSlot &slot,
+                const ::StreamLabels &labels)
             {
-                attribute.insert(std::pair{"source", mSourceAttribute.source});
-            }
-            observer->Observe(item.second, attribute);
-        }
+                int64_t cumulativeCount{0};
+                for (int i = 0; i < ::LatencyHistogram::NumberOfBuckets; ++i)
+                {
+                    cumulativeCount = cumulativeCount
+                                    + slot.latencyBuckets[i].load(
+                                         std::memory_order_relaxed);
+                    observer->Observe(cumulativeCount,
+                                      ::LatencyBucketAttributes
+                                      {
+                                          labels.attributes, upperBounds[i]
+                                      });
+                }
+            });
     }
 }
 
@@ -526,6 +711,115 @@ void initializeImportMetrics(const ::ProgramOptions &options)
     mStandardDeviationCountsGauge->AddCallback(
             observeStandardDeviationOfAverageCounts,
             nullptr);
+
+    // Peak amplitudes of the good packet counts
+    mMinimumCountsGauge
+        = meter->CreateDoubleObservableGauge(
+             "seismic_data.import.seedlink.client.windowed_minimum",
+             "Smallest count sampled every minute.",
+             "{counts}");
+    mMinimumCountsGauge->AddCallback(observeMinimumCounts, nullptr);
+
+    mMaximumCountsGauge
+        = meter->CreateDoubleObservableGauge(
+             "seismic_data.import.seedlink.client.windowed_maximum",
+             "Largest count sampled every minute.",
+             "{counts}");
+    mMaximumCountsGauge->AddCallback(observeMaximumCounts, nullptr);
+
+    // Latency distribution.  The OTel API has no asynchronous histogram so
+    // the buckets are exported as cumulative counters labeled by their
+    // upper bound in the same layout as a Prometheus histogram.
+    mLatencyHistogramCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.import.seedlink.client.latency.bucket",
+             "Cumulative number of valid packets whose latency in seconds is at most le.",
+             "{packets}");
+    mLatencyHistogramCounter->AddCallback(observeLatencyHistogram, nullptr);
+
+    // Continuity
+    mGapsCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.import.seedlink.client.continuity.gaps",
+             "Number of gaps between consecutive packets.",
+             "{gaps}");
+    mGapsCounter->AddCallback(observeGaps, nullptr);
+
+    mGapDurationCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.import.seedlink.client.continuity.gap_duration",
+             "Cumulative duration of the gaps between consecutive packets.",
+             "s");
+    mGapDurationCounter->AddCallback(observeGapDuration, nullptr);
+
+    mOverlapsCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.import.seedlink.client.continuity.overlaps",
+             "Number of packets that overlap data already received.",
+             "{overlaps}");
+    mOverlapsCounter->AddCallback(observeOverlaps, nullptr);
+
+    mOverlapDurationCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.import.seedlink.client.continuity.overlap_duration",
+             "Cumulative duration of data received more than once.",
+             "s");
+    mOverlapDurationCounter->AddCallback(observeOverlapDuration, nullptr);
+
+    mTimingDriftGauge
+        = meter->CreateDoubleObservableGauge(
+             "seismic_data.import.seedlink.client.continuity.timing_drift",
+             "Difference between the time elapsed over the latest contiguous packets and the time implied by the nominal sampling rate.",
+             "{ppm}");
+    mTimingDriftGauge->AddCallback(observeTimingDrift, nullptr);
+
+    // Import queue
+    mImportQueueDepthGauge
+        = meter->CreateInt64ObservableGauge(
+             "seismic_data.import.seedlink.client.queue.depth",
+             "Number of packets waiting in the import queue.",
+             "{packets}");
+    mImportQueueDepthGauge->AddCallback(observeImportQueueDepth, nullptr);
+
+    mImportQueueOccupancyGauge
+        = meter->CreateDoubleObservableGauge(
+             "seismic_data.import.seedlink.client.queue.occupancy",
+             "Fraction of the import queue that is in use.",
+             "1");
+    mImportQueueOccupancyGauge->AddCallback(observeImportQueueOccupancy,
+                                            nullptr);
+
+    mImportQueueResidencyBucketCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.import.seedlink.client.queue.residency.bucket",
+             "Cumulative number of packets that waited in the import queue for at most le seconds.",
+             "{packets}");
+    mImportQueueResidencyBucketCounter->AddCallback(
+        observeImportQueueResidencyBuckets, nullptr);
+
+    mImportQueueResidencyCountCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.import.seedlink.client.queue.residency.count",
+             "Number of packets dequeued from the import queue.",
+             "{packets}");
+    mImportQueueResidencyCountCounter->AddCallback(
+        observeImportQueueResidencyCount, nullptr);
+
+    mImportQueueResidencySumCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.import.seedlink.client.queue.residency.sum",
+             "Cumulative time packets waited in the import queue.",
+             "s");
+    mImportQueueResidencySumCounter->AddCallback(
+        observeImportQueueResidencySum, nullptr);
+
+    mImportPacketsDroppedCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.import.seedlink.client.packets.dropped",
+             "Number of packets dropped before reaching the writers by reason.",
+             "{packets}");
+    mImportPacketsDroppedCounter->AddCallback(observeImportPacketsDropped,
+                                              nullptr);
 }
 
 
@@ -533,11 +827,16 @@ void initializeImportMetrics(const ::ProgramOptions &options)
 class StreamMetrics
 {
 public:
+    /// @param[in] continuityTolerance  The timing error in sample periods
+    ///                                 beyond which consecutive packets
+    ///                                 are a gap or an overlap.
     StreamMetrics(const std::string applicationName,
                   const USEEDLinkToRingServer::Packet &packet,
-                  std::shared_ptr<spdlog::logger> logger) :
+                  std::shared_ptr<spdlog::logger> logger,
+                  const double continuityTolerance = 0.5) :
         mLogger(logger),
-        mApplicationName(applicationName)
+        mApplicationName(applicationName),
+        mContinuity(continuityTolerance)
     {
         const auto streamIdentifier
             = packet.getStreamIdentifierReference();
@@ -556,17 +855,27 @@ public:
         }
         std::transform(mMetricsKey.begin(), mMetricsKey.end(),
                        mMetricsKey.begin(), ::tolower);
-        mObservablePacketsReceived[mMetricsKey] = 0; 
-        mObservableFuturePacketsReceived[mMetricsKey] = 0;
-        mObservableExpiredPacketsReceived[mMetricsKey] = 0;
-        mObservableTotalPacketsReceived[mMetricsKey] = 0;
-        mObservableAverageLatency[mMetricsKey] = 0;
-        mObservableAverageCounts[mMetricsKey] = 0;
-        mObservableStandardDeviationOfCounts[mMetricsKey] = 0;
+        auto network = streamIdentifier.getNetwork();
+        std::transform(network.begin(), network.end(),
+                       network.begin(), ::tolower);
+        mSlot = mStreamMetricSlots.add(mMetricsKey,
+                                       ::toAttributes(mMetricsKey, network));
 
         spdlog::debug("Made new metrics for " + mName);
         update(packet);
     }
+    StreamMetrics(const StreamMetrics &) = delete;
+    StreamMetrics& operator=(const StreamMetrics &) = delete;
+    /// Stops exporting the stream
+    ~StreamMetrics()
+    {
+        mStreamMetricSlots.remove(mSlot);
+    }
+    /// @result The last time a packet was received from this stream.
+    [[nodiscard]] std::chrono::microseconds getLastUpdate() const noexcept
+    {
+        return mLastUpdate;
+    }
     void update(const USEEDLinkToRingServer::Packet &packet)
     {
         if (packet.getStreamIdentifierReference().getStringReference() !=
@@ -577,13 +886,12 @@ public:
         auto endTime
             = std::chrono::duration_cast<std::chrono::microseconds>
              (packet.getEndTime()); 
+        updateContinuity(packet);
         auto now = ::getNow();
         if (endTime > mMostRecentSample && endTime <= now)
         {
             bool metricsSuccess{true};
-            int nSamples{0};
-            double packetSum{0};
-            double packetSum2{0};
+            USEEDLinkToRingServer::SampleStatistics statistics;
             auto dataType = packet.getDataType();
             if (dataType == USEEDLinkToRingServer::Packet::DataType::Integer32 ||
                 dataType == USEEDLinkToRingServer::Packet::DataType::Double ||
@@ -591,10 +899,8 @@ public:
             {
                 try
                 {
-                    nSamples = packet.getNumberOfSamples();
-                    packetSum = USEEDLinkToRingServer::computeSumOfSamples(packet);
-                    packetSum2
-                        = USEEDLinkToRingServer::computeSumOfSamplesSquared(packet);
+                    statistics
+                        = USEEDLinkToRingServer::computeSampleStatistics(packet);
                 }
                 catch (const std::exception &e)
                 {
@@ -605,51 +911,56 @@ public:
                 }
             }
             now = ::getNow();
-            {
-            std::lock_guard<std::mutex> lock(mMutex);
             mLastUpdate = now;
             mMostRecentSample = endTime;
             mLatency = now - endTime;
             if (metricsSuccess)
             {
+                if (statistics.count > 0)
+                {
+                    if (mRunningSamplesCounter == 0)
+                    {
+                        mRunningMinimum = statistics.minimum;
+                        mRunningMaximum = statistics.maximum;
+                    }
+                    else
+                    {
+                        mRunningMinimum
+                            = std::min(mRunningMinimum, statistics.minimum);
+                        mRunningMaximum
+                            = std::max(mRunningMaximum, statistics.maximum);
+                    }
+                }
                 mRunningPacketsCounter = mRunningPacketsCounter + 1;
                 mRunningTotalPacketsCounter = mRunningTotalPacketsCounter + 1;
                 mRunningSamplesCounter
-                    = mRunningSamplesCounter + nSamples;
-                mRunningSum = mRunningSum + packetSum;
+                    = mRunningSamplesCounter + statistics.count;
+                mRunningSum = mRunningSum + statistics.sum;
                 mRunningLatencySum = mRunningLatencySum + mLatency;
-                mRunningSumSquared = mRunningSumSquared + packetSum2;
-            }
+                mStreamMetricSlots.recordLatency(mSlot, mLatency);
+                mRunningSumSquared
+                    = mRunningSumSquared + statistics.sumOfSquares;
             }
         }
         else if (endTime > now)
         {
             now = ::getNow();
-            {
-            std::lock_guard<std::mutex> lock(mMutex);
             mRunningFuturePacketsCounter = mRunningFuturePacketsCounter + 1;
             mRunningTotalPacketsCounter = mRunningTotalPacketsCounter + 1;
             mLastUpdate = now;
-            }
         }
         else if (endTime < now - std::chrono::months {6})
         {
             now = ::getNow();
-            {
-            std::lock_guard<std::mutex> lock(mMutex);
             mRunningExpiredPacketsCounter = mRunningExpiredPacketsCounter + 1;
             mRunningTotalPacketsCounter = mRunningTotalPacketsCounter + 1;
             mLastUpdate = now;
-            }
         }
         else
         {
             now = ::getNow();
-            {
-            std::lock_guard<std::mutex> lock(mMutex);
             mRunningTotalPacketsCounter = mRunningTotalPacketsCounter + 1;
             mLastUpdate = now;
-            }
         }
     }
     void tabulateAndResetMetrics(const std::chrono::seconds &sampleInterval)
@@ -661,9 +972,9 @@ public:
         double averageCounts{0};
         double varianceOfCounts{0};
         double averageLatency{0};
+        double minimumCounts{0};
+        double maximumCounts{0};
         double besselCorrection{1}; // normalize standard deviation by 1/(n - 1)
-        {
-        std::lock_guard<std::mutex> lock(mMutex);
         packetsCount = mRunningPacketsCounter;
         expiredPacketsCount = mRunningExpiredPacketsCounter;
         futurePacketsCount= mRunningFuturePacketsCounter; 
@@ -680,6 +991,8 @@ public:
             // Var[x] = E[x^2] - E[x]^2
             varianceOfCounts = mRunningSumSquared/mRunningSamplesCounter
                              - averageCounts*averageCounts;
+            minimumCounts = mRunningMinimum;
+            maximumCounts = mRunningMaximum;
         } 
         if (mRunningPacketsCounter > 0)
         {
@@ -692,32 +1005,64 @@ public:
         }
         mRunningSum = 0;
         mRunningSumSquared = 0;
+        mRunningMinimum = 0;
+        mRunningMaximum = 0;
         mRunningSamplesCounter = 0;
         mRunningLatencySum = std::chrono::microseconds{0};
         mRunningPacketsCounter = 0;
         mRunningExpiredPacketsCounter = 0;
         mRunningFuturePacketsCounter = 0;
         mRunningTotalPacketsCounter = 0;
-        }
         auto stdOfCounts
             = besselCorrection*std::sqrt(std::max(0.0, varianceOfCounts));
-        mObservablePacketsReceived.add_or_assign(
-            mMetricsKey, packetsCount); //[mMetricsKey] = packetsCount;
-        mObservableFuturePacketsReceived.add_or_assign(
-            mMetricsKey, futurePacketsCount);
-        mObservableExpiredPacketsReceived.add_or_assign(
-            mMetricsKey, expiredPacketsCount); //[mMetricsKey] = expiredPacketsCount;
-        mObservableTotalPacketsReceived.add_or_assign(
-            mMetricsKey, totalPacketsCount);
-        mObservableAverageLatency[mMetricsKey] = averageLatency;
-        mObservableAverageCounts[mMetricsKey] = averageCounts;
-        mObservableStandardDeviationOfCounts[mMetricsKey] = stdOfCounts;
+        auto &slot = mStreamMetricSlots[mSlot];
+        slot.packetsReceived.fetch_add(packetsCount,
+                                       std::memory_order_relaxed);
+        slot.futurePacketsReceived.fetch_add(futurePacketsCount,
+                                             std::memory_order_relaxed);
+        slot.expiredPacketsReceived.fetch_add(expiredPacketsCount,
+                                              std::memory_order_relaxed);
+        slot.totalPacketsReceived.fetch_add(totalPacketsCount,
+                                            std::memory_order_relaxed);
+        // These are published by the metrics map once all streams are done
+        auto &gauges = mStreamMetricSlots.getBackGauges(mSlot);
+        gauges.averageLatency.store(averageLatency, std::memory_order_relaxed);
+        gauges.averageCounts.store(averageCounts, std::memory_order_relaxed);
+        gauges.standardDeviationOfCounts.store(stdOfCounts,
+                                               std::memory_order_relaxed);
+        gauges.minimumCounts.store(minimumCounts, std::memory_order_relaxed);
+        gauges.maximumCounts.store(maximumCounts, std::memory_order_relaxed);
+    }
+    /// Tallies gaps and overlaps between this packet and the last
+    void updateContinuity(const USEEDLinkToRingServer::Packet &packet)
+    {
+        auto result = mContinuity.update(packet.getStartTime(),
+                                         packet.getNumberOfSamples(),
+                                         packet.getSamplingRate());
+        auto duration
+            = std::chrono::duration_cast<std::chrono::microseconds>
+              (result.duration);
+        if (result.continuity == ::StreamContinuity::Continuity::Gap)
+        {
+            SPDLOG_LOGGER_DEBUG(mLogger, "{} s gap in {}",
+                                duration.count()*1.e-6, mName);
+            mStreamMetricSlots.recordGap(mSlot, duration);
+        }
+        else if (result.continuity ==
+                 ::StreamContinuity::Continuity::Overlap)
+        {
+            SPDLOG_LOGGER_DEBUG(mLogger, "{} s overlap in {}",
+                                duration.count()*1.e-6, mName);
+            mStreamMetricSlots.recordOverlap(mSlot, duration);
+        }
+        mStreamMetricSlots[mSlot].timingDrift.store(
+            mContinuity.getTimingDrift(), std::memory_order_relaxed);
     }
     std::shared_ptr<spdlog::logger> mLogger{nullptr};
-    std::mutex mMutex;
     std::string mApplicationName;
     std::string mName;
     std::string mMetricsKey;
+    ::StreamContinuity mContinuity;
     std::chrono::microseconds mLastUpdate{0};
     std::chrono::microseconds mLatency{0};
     std::chrono::microseconds mRunningLatencySum{0};
@@ -725,13 +1070,19 @@ public:
     std::chrono::microseconds mCreationTime{::getNow()};
     double mRunningSum{0};
     double mRunningSumSquared{0};
+    double mRunningMinimum{0};
+    double mRunningMaximum{0};
     int64_t mRunningPacketsCounter{0};
     int64_t mRunningFuturePacketsCounter{0};
     int64_t mRunningExpiredPacketsCounter{0};
     int64_t mRunningTotalPacketsCounter{0};
     int64_t mRunningSamplesCounter{0};
+    int mSlot{0};
 };
 
+/// @brief Tracks the metrics of the imported streams.  The streams are kept
+///        in least-recently-updated order so streams that stop sending can
+///        be evicted and the number of tracked streams can be bounded.
 class MetricsMap
 {
 public:
@@ -743,44 +1094,320 @@ public:
         auto index = mMetrics.find(identifier);
         if (index == mMetrics.end())
         {
+            if (mMaximumNumberOfStreams > 0 &&
+                static_cast<int> (mMetrics.size()) >= mMaximumNumberOfStreams)
+            {
+                SPDLOG_LOGGER_DEBUG(logger,
+                                    "Evicting least recently updated {}",
+                                    mRecentlyUpdated.back());
+                evictLeastRecentlyUpdated();
+            }
             auto streamMetrics
                 = std::make_unique<::StreamMetrics>
-                  (mApplicationName, packet, logger);
-            mMetrics.insert(std::pair {identifier, std::move(streamMetrics)});
+                  (mApplicationName, packet, logger, mContinuityTolerance);
+            mRecentlyUpdated.emplace_front(identifier);
+            mMetrics.insert(std::pair {std::string {identifier},
+                                       Entry {std::move(streamMetrics),
+                                              mRecentlyUpdated.begin()}});
         }
         else
         {
-            index->second->update(packet);
+            index->second.metrics->update(packet);
+            mRecentlyUpdated.splice(mRecentlyUpdated.begin(),
+                                    mRecentlyUpdated,
+                                    index->second.recentlyUpdated);
         } 
     }
-    void tabulateAndResetAllMetrics()
+    void tabulateAndResetAllMetrics(std::shared_ptr<spdlog::logger> logger)
     {
         auto now = ::getNow();
         if (now > mLastSampleTime + mSampleInterval)
         {
             mLastSampleTime = now;
+            evictStaleStreams(now, logger);
             for (auto &metric : mMetrics)
             {
-                metric.second->tabulateAndResetMetrics(mSampleInterval);
+                metric.second.metrics->tabulateAndResetMetrics(mSampleInterval);
+            }
+            mStreamMetricSlots.publishGauges();
+        }
+    }
+    /// @brief Evicts the streams that have not been updated within the
+    ///        stream time out.
+    void evictStaleStreams(const std::chrono::microseconds &now,
+                           std::shared_ptr<spdlog::logger> logger)
+    {
+        if (mStreamTimeOut.count() <= 0){return;}
+        auto oldestAllowed = now - mStreamTimeOut;
+        while (!mRecentlyUpdated.empty())
+        {
+            auto index = mMetrics.find(mRecentlyUpdated.back());
+            if (index->second.metrics->getLastUpdate() >= oldestAllowed)
+            {
+                break;
             }
+            SPDLOG_LOGGER_INFO(logger, "Evicting stale metrics for {}",
+                               index->first);
+            mMetrics.erase(index);
+            mRecentlyUpdated.pop_back();
         }
     }
-    std::map<std::string, std::unique_ptr<::StreamMetrics>> mMetrics;
+    /// @brief Evicts the least recently updated stream.
+    void evictLeastRecentlyUpdated()
+    {
+        if (mRecentlyUpdated.empty()){return;}
+        mMetrics.erase(mRecentlyUpdated.back());
+        mRecentlyUpdated.pop_back();
+    }
+    struct Entry
+    {
+        std::unique_ptr<::StreamMetrics> metrics;
+        std::list<std::string>::iterator recentlyUpdated;
+    };
+    std::map<std::string, Entry, std::less<>> mMetrics;
+    /// Stream names from most to least recently updated
+    std::list<std::string> mRecentlyUpdated;
     std::string mApplicationName{"seedLinkImport"};
     std::chrono::microseconds mLastSampleTime{::getNow()};
     std::chrono::seconds mSampleInterval{60};
+    /// Streams not updated in this long are evicted.  If this is not
+    /// positive then streams are never evicted for inactivity.
+    std::chrono::seconds mStreamTimeOut{std::chrono::hours {24}};
+    /// If positive then this bounds the number of tracked streams.
+    int mMaximumNumberOfStreams{0};
+    /// Timing errors beyond this many sample periods are gaps or overlaps.
+    double mContinuityTolerance{0.5};
 };
 
 int64_t sumTotalPacketsReceived()
 {
     int64_t result{0};
-    auto keys = mObservableTotalPacketsReceived.keys();
-    for (const auto &key : keys)
+    mStreamMetricSlots.forEach(
+        [&result](const int, const ::StreamMetricSlot &slot,
+                  const ::StreamLabels &)
+        {
+            result = result
+                   + slot.totalPacketsReceived.load(std::memory_order_relaxed);
+        });
+    return result;
+}
+
+/// Writes a Prometheus family with a sample for every stream
+template<typename F>
+void writePrometheusStreamFamily(::PrometheusTextWriter &writer,
+                                 const std::string_view name,
+                                 const std::string_view type,
+                                 const std::string_view help,
+                                 F &&getValue)
+{
+    writer.writeHeader(name, type, help);
+    mStreamMetricSlots.forEach(
+        [&](const int index, const ::StreamMetricSlot &slot,
+            const ::StreamLabels &labels)
+        {
+            writer.writeSample(name,
+                               ::PrometheusLabels {labels.attributes},
+                               getValue(index, slot));
+        });
+}
+
+/// @brief Writes the import metrics in the Prometheus text format.  This
+///        reads the same counters the OTel instruments observe.
+void writePrometheusImportMetrics(::PrometheusTextWriter &writer)
+{
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_packets_valid_total", "counter",
+        "Number of valid data packets received from SEEDLink client.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.packetsReceived.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_packets_future_total", "counter",
+        "Number of future packets received from SEEDLink client.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.futurePacketsReceived.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_packets_expired_total", "counter",
+        "Number of expired packets received from SEEDLink client.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.expiredPacketsReceived.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_packets_all_total", "counter",
+        "Total number of packets received from SEEDLink client.  This includes future and expired packets.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.totalPacketsReceived.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_windowed_average_latency_seconds",
+        "gauge",
+        "Average latency.",
+        [](const int index, const ::StreamMetricSlot &)
+        {
+            return mStreamMetricSlots.getPublishedGauges(index)
+                  .averageLatency.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_windowed_average", "gauge",
+        "Average number of counts sampled every minute.",
+        [](const int index, const ::StreamMetricSlot &)
+        {
+            return mStreamMetricSlots.getPublishedGauges(index)
+                  .averageCounts.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_windowed_standard_deviation",
+        "gauge",
+        "Standard deviation of counts sampled every minute.",
+        [](const int index, const ::StreamMetricSlot &)
+        {
+            return mStreamMetricSlots.getPublishedGauges(index)
+                  .standardDeviationOfCounts.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_windowed_minimum", "gauge",
+        "Smallest count sampled every minute.",
+        [](const int index, const ::StreamMetricSlot &)
+        {
+            return mStreamMetricSlots.getPublishedGauges(index)
+                  .minimumCounts.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_windowed_maximum", "gauge",
+        "Largest count sampled every minute.",
+        [](const int index, const ::StreamMetricSlot &)
+        {
+            return mStreamMetricSlots.getPublishedGauges(index)
+                  .maximumCounts.load(std::memory_order_relaxed);
+        });
+
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_continuity_gaps_total",
+        "counter",
+        "Number of gaps between consecutive packets.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.gaps.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_continuity_gap_duration_seconds_total",
+        "counter",
+        "Cumulative duration of the gaps between consecutive packets.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.gapDuration.load(std::memory_order_relaxed)*1.e-6;
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_continuity_overlaps_total",
+        "counter",
+        "Number of packets that overlap data already received.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.overlaps.load(std::memory_order_relaxed);
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_continuity_overlap_duration_seconds_total",
+        "counter",
+        "Cumulative duration of data received more than once.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.overlapDuration.load(std::memory_order_relaxed)*1.e-6;
+        });
+    writePrometheusStreamFamily(writer,
+        "seismic_data_import_seedlink_client_continuity_timing_drift_ppm",
+        "gauge",
+        "Difference between the time elapsed over the latest contiguous packets and the time implied by the nominal sampling rate.",
+        [](const int, const ::StreamMetricSlot &slot)
+        {
+            return slot.timingDrift.load(std::memory_order_relaxed);
+        });
+
+    constexpr std::string_view latencyName
     {
-        auto value = mObservableTotalPacketsReceived[key];
-        if (value){result = result + *value;}
+        "seismic_data_import_seedlink_client_latency_seconds"
+    };
+    writer.writeHeader(latencyName, "histogram",
+                       "Latency of the valid packets.");
+    const auto &latencyBucketLabels = ::getLatencyBucketLabels();
+    mStreamMetricSlots.forEach(
+        [&](const int, const ::StreamMetricSlot &slot,
+            const ::StreamLabels &labels)
+        {
+            std::array<int64_t, ::LatencyHistogram::NumberOfBuckets> counts;
+            int64_t cumulativeCount{0};
+            for (int i = 0; i < ::LatencyHistogram::NumberOfBuckets; ++i)
+            {
+                cumulativeCount = cumulativeCount
+                                + slot.latencyBuckets[i].load(
+                                     std::memory_order_relaxed);
+                counts[i] = cumulativeCount;
+            }
+            writer.writeHistogram(latencyName,
+                                  ::PrometheusLabels {labels.attributes},
+                                  counts,
+                                  latencyBucketLabels,
+                                  slot.latencySum.load(
+                                      std::memory_order_relaxed)*1.e-6);
+        });
+
+    // Import queue
+    ::PrometheusLabels queueLabels;
+    if (!mSourceAttribute.source.empty())
+    {
+        queueLabels.add("source", mSourceAttribute.source);
     }
-    return result;
+    auto capacity
+        = mImportQueueMetrics.capacity.load(std::memory_order_relaxed);
+    auto depth = mImportQueueMetrics.depth.load(std::memory_order_relaxed);
+    writer.writeHeader("seismic_data_import_seedlink_client_queue_depth",
+                       "gauge",
+                       "Number of packets waiting in the import queue.");
+    writer.writeSample("seismic_data_import_seedlink_client_queue_depth",
+                       queueLabels, depth);
+    writer.writeHeader("seismic_data_import_seedlink_client_queue_occupancy",
+                       "gauge",
+                       "Fraction of the import queue that is in use.");
+    writer.writeSample("seismic_data_import_seedlink_client_queue_occupancy",
+                       queueLabels,
+                       capacity > 0 ?
+                       static_cast<double> (depth)
+                      /static_cast<double> (capacity) : 0.0);
+    constexpr std::string_view residencyName
+    {
+        "seismic_data_import_seedlink_client_queue_residency_seconds"
+    };
+    writer.writeHeader(residencyName, "histogram",
+                       "Time packets waited in the import queue.");
+    writer.writeHistogram(residencyName,
+                          queueLabels,
+                          mImportQueueMetrics.residency.getCumulativeCounts(),
+                          ::getResidencyBucketLabels(),
+                          mImportQueueMetrics.residency.getSum().count()
+                         *1.e-6);
+    constexpr std::string_view droppedName
+    {
+        "seismic_data_import_seedlink_client_packets_dropped_total"
+    };
+    writer.writeHeader(droppedName, "counter",
+        "Number of packets dropped before reaching the writers by reason.");
+    auto droppedLabels = queueLabels;
+    droppedLabels.set("reason", "queue_full");
+    writer.writeSample(droppedName, droppedLabels,
+                       mImportQueueMetrics.packetsEvicted.load(
+                           std::memory_order_relaxed));
+    droppedLabels.set("reason", "enqueue_failed");
+    writer.writeSample(droppedName, droppedLabels,
+                       mImportQueueMetrics.packetsFailedToEnqueue.load(
+                           std::memory_order_relaxed));
+    droppedLabels.set("reason", "fan_out_failed");
+    writer.writeSample(droppedName, droppedLabels,
+                       mImportQueueMetrics.packetsFailedToFanOut.load(
+                           std::memory_order_relaxed));
 }
 
 }
@@ -1,9 +1,16 @@
 #ifndef WRITER_METRICS_HPP
 #define WRITER_METRICS_HPP
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <chrono>
+#include <map>
 #include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <spdlog/spdlog.h>
 #include <opentelemetry/metrics/meter.h>
 #include <opentelemetry/metrics/meter_provider.h>
@@ -11,6 +18,7 @@
 #include <opentelemetry/sdk/metrics/view/view_factory.h>
 #include "uSEEDLinkToRingServer/writerMetricsSingleton.hpp"
 #include "getNow.hpp"
+#include "prometheusExposition.hpp"
 
 namespace
 {
@@ -22,8 +30,192 @@ public:
     static void observePacketsWritten(
         opentelemetry::metrics::ObserverResult observerResult,
         void *)
-    {   
-        if (opentelemetry::nostd::holds_alternative
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getPacketsWrittenCount();
+                     });
+    }
+
+    static void observeInvalidPackets(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getInvalidPacketsCount();
+                     });
+    }
+
+    static void observePacketsFailedToWrite(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getFailedPacketsSentCount();
+                     });
+    }
+
+    static void observeServerErrors(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getServerErrorsCount();
+                     });
+    }
+
+    static void observePacketsFailedToEnqueue(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getFailedPacketsFailedToEnqueueCount();
+                     });
+    }
+
+    static void observeReconnectAttempts(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getReconnectAttemptsCount();
+                     });
+    }
+
+    static void observeDisconnectedWriters(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return static_cast<int64_t> (metrics.isDisconnected());
+                     });
+    }
+
+    static void observeOutageDuration(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeDouble(observerResult,
+                      [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                      {
+                          return metrics.getOutageDuration().count()*1.e-6;
+                      });
+    }
+
+    static void observeHoldoverSize(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getHoldoverSize();
+                     });
+    }
+
+    static void observeHoldoverRecordsDropped(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getHoldoverRecordsDroppedCount();
+                     });
+    }
+
+    static void observeQueueDepth(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getQueueDepth();
+                     });
+    }
+
+    static void observeQueueOccupancy(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeDouble(observerResult,
+                      [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                      {
+                          return metrics.getQueueOccupancy();
+                      });
+    }
+
+    static void observeWriteLatencyBuckets(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeHistogramBuckets(
+            observerResult,
+            [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                -> const USEEDLinkToRingServer::DurationHistogram &
+            {
+                return metrics.getWriteLatencyHistogram();
+            });
+    }
+
+    static void observeQueueResidencyBuckets(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeHistogramBuckets(
+            observerResult,
+            [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                -> const USEEDLinkToRingServer::DurationHistogram &
+            {
+                return metrics.getQueueResidencyHistogram();
+            });
+    }
+
+    static void observeQueueResidencyCount(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getQueueResidencyHistogram()
+                                       .getCumulativeCounts().back();
+                     });
+    }
+
+    static void observeQueueResidencySum(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeDouble(observerResult,
+                      [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                      {
+                          return metrics.getQueueResidencyHistogram()
+                                        .getSum().count()*1.e-6;
+                      });
+    }
+
+    /// Every way a writer loses a packet is reported under one counter
+    /// labelled by the reason so the stage that is shedding load is clear.
+    static void observeDroppedPackets(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        if (!opentelemetry::nostd::holds_alternative
             <
                 opentelemetry::nostd::shared_ptr
                 <
@@ -31,45 +223,258 @@ public:
                 >
             >(observerResult))
         {
-            auto &metrics = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
-            auto nWritten = metrics.getPacketsWrittenCount();
-            opentelemetry::nostd::get
+            return;
+        }
+        auto observer = opentelemetry::nostd::get
+        <
+            opentelemetry::nostd::shared_ptr
             <
-               opentelemetry::nostd::shared_ptr
-               <
-                   opentelemetry::metrics::ObserverResultT<int64_t>
-               >
-            >(observerResult)->Observe(nWritten);
+               opentelemetry::metrics::ObserverResultT<int64_t>
+            >
+        > (observerResult);
+        auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+        for (const auto &metrics : singleton.getWriterMetrics())
+        {
+            auto attributes = toAttributes(*metrics);
+            attributes.insert_or_assign("reason", "queue_full");
+            observer->Observe(metrics->getFailedPacketsFailedToEnqueueCount(),
+                              attributes);
+            attributes.insert_or_assign("reason", "invalid");
+            observer->Observe(metrics->getInvalidPacketsCount(), attributes);
+            attributes.insert_or_assign("reason", "rejected");
+            observer->Observe(metrics->getFailedPacketsSentCount(),
+                              attributes);
+            attributes.insert_or_assign("reason", "holdover_full");
+            observer->Observe(metrics->getHoldoverRecordsDroppedCount(),
+                              attributes);
         }
     }
 
-    static void observeInvalidPackets(
+    /// Histograms are exported Prometheus-style as cumulative bucket
+    /// counts labelled by their upper bound (le).
+    template<typename F>
+    static void observeHistogramBuckets(
+        opentelemetry::metrics::ObserverResult &observerResult,
+        F &&getHistogram)
+    {
+        if (!opentelemetry::nostd::holds_alternative
+            <
+                opentelemetry::nostd::shared_ptr
+                <
+                    opentelemetry::metrics::ObserverResultT<int64_t>
+                >
+            >(observerResult))
+        {
+            return;
+        }
+        auto observer = opentelemetry::nostd::get
+        <
+            opentelemetry::nostd::shared_ptr
+            <
+               opentelemetry::metrics::ObserverResultT<int64_t>
+            >
+        > (observerResult);
+        const auto &bucketLabels = getDurationBucketLabels();
+        auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+        for (const auto &metrics : singleton.getWriterMetrics())
+        {
+            auto counts = getHistogram(*metrics).getCumulativeCounts();
+            auto attributes = toAttributes(*metrics);
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                attributes.insert_or_assign("le", bucketLabels.at(i));
+                observer->Observe(counts[i], attributes);
+            }
+        }
+    }
+
+    static void observeWriteLatencyCount(
         opentelemetry::metrics::ObserverResult observerResult,
         void *)
-    {   
-        if (opentelemetry::nostd::holds_alternative
-            <   
+    {
+        observeInt64(observerResult,
+                     [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                     {
+                         return metrics.getCumulativeWriteLatencyCounts().back();
+                     });
+    }
+
+    static void observeWriteLatencySum(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        observeDouble(observerResult,
+                      [](const USEEDLinkToRingServer::WriterMetrics &metrics)
+                      {
+                          return metrics.getWriteLatencySum().count()*1.e-6;
+                      });
+    }
+
+    /// The pipeline stages are exported as one histogram labelled by stage
+    static void observePipelineStageBuckets(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        if (!opentelemetry::nostd::holds_alternative
+            <
                 opentelemetry::nostd::shared_ptr
-                <   
+                <
                     opentelemetry::metrics::ObserverResultT<int64_t>
-                >   
+                >
             >(observerResult))
         {
-            auto &metrics = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
-            auto nInvalid = metrics.getInvalidPacketsCount();
-            opentelemetry::nostd::get
+            return;
+        }
+        auto observer = opentelemetry::nostd::get
+        <
+            opentelemetry::nostd::shared_ptr
             <
-               opentelemetry::nostd::shared_ptr
-               <
-                   opentelemetry::metrics::ObserverResultT<int64_t>
-               >
-            >(observerResult)->Observe(nInvalid);
+               opentelemetry::metrics::ObserverResultT<int64_t>
+            >
+        > (observerResult);
+        const auto &bucketLabels = getDurationBucketLabels();
+        auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+        for (const auto &metrics : singleton.getWriterMetrics())
+        {
+            for (const auto &[stage, stageName] : getPipelineStages())
+            {
+                auto counts = metrics->getPipelineStageHistogram(stage)
+                                      .getCumulativeCounts();
+                auto attributes = toAttributes(*metrics);
+                attributes.insert_or_assign("stage", stageName);
+                for (size_t i = 0; i < counts.size(); ++i)
+                {
+                    attributes.insert_or_assign("le", bucketLabels.at(i));
+                    observer->Observe(counts[i], attributes);
+                }
+            }
         }
     }
 
-    static void observePacketsFailedToWrite(
+    static void observePipelineStageCount(
         opentelemetry::metrics::ObserverResult observerResult,
         void *)
+    {
+        if (!opentelemetry::nostd::holds_alternative
+            <
+                opentelemetry::nostd::shared_ptr
+                <
+                    opentelemetry::metrics::ObserverResultT<int64_t>
+                >
+            >(observerResult))
+        {
+            return;
+        }
+        auto observer = opentelemetry::nostd::get
+        <
+            opentelemetry::nostd::shared_ptr
+            <
+               opentelemetry::metrics::ObserverResultT<int64_t>
+            >
+        > (observerResult);
+        auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+        for (const auto &metrics : singleton.getWriterMetrics())
+        {
+            for (const auto &[stage, stageName] : getPipelineStages())
+            {
+                auto attributes = toAttributes(*metrics);
+                attributes.insert_or_assign("stage", stageName);
+                observer->Observe(metrics->getPipelineStageHistogram(stage)
+                                          .getCumulativeCounts().back(),
+                                  attributes);
+            }
+        }
+    }
+
+    static void observePipelineStageSum(
+        opentelemetry::metrics::ObserverResult observerResult,
+        void *)
+    {
+        if (!opentelemetry::nostd::holds_alternative
+            <
+                opentelemetry::nostd::shared_ptr
+                <
+                    opentelemetry::metrics::ObserverResultT<double>
+                >
+            >(observerResult))
+        {
+            return;
+        }
+        auto observer = opentelemetry::nostd::get
+        <
+            opentelemetry::nostd::shared_ptr
+            <
+               opentelemetry::metrics::ObserverResultT<double>
+            >
+        > (observerResult);
+        auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+        for (const auto &metrics : singleton.getWriterMetrics())
+        {
+            for (const auto &[stage, stageName] : getPipelineStages())
+            {
+                auto attributes = toAttributes(*metrics);
+                attributes.insert_or_assign("stage", stageName);
+                observer->Observe(metrics->getPipelineStageHistogram(stage)
+                                          .getSum().count()*1.e-6,
+                                  attributes);
+            }
+        }
+    }
+
+    /// The pipeline stages and their names in the metrics
+    [[nodiscard]] static const
+        std::array<std::pair<USEEDLinkToRingServer::PipelineStage,
+                             std::string>, 5> &
+        getPipelineStages()
+    {
+        using USEEDLinkToRingServer::PipelineStage;
+        static const std::array<std::pair<PipelineStage, std::string>, 5>
+            stages
+        {
+            std::pair {PipelineStage::Decode, std::string {"decode"}},
+            std::pair {PipelineStage::Import, std::string {"import"}},
+            std::pair {PipelineStage::Export, std::string {"export"}},
+            std::pair {PipelineStage::Write,  std::string {"write"}},
+            std::pair {PipelineStage::Total,  std::string {"total"}}
+        };
+        return stages;
+    }
+
+    /// Labels each writer by its name and DataLink server
+    [[nodiscard]] static std::map<std::string, std::string>
+        toAttributes(const USEEDLinkToRingServer::WriterMetrics &metrics)
+    {
+        return std::map<std::string, std::string>
+               {
+                   {"writer", metrics.getName()},
+                   {"host", metrics.getHost()}
+               };
+    }
+
+    /// The bucket bounds in seconds, e.g., 1e-05, ..., 10, +Inf
+    [[nodiscard]] static const std::vector<std::string> &
+        getDurationBucketLabels()
+    {
+        static const std::vector<std::string> labels = []()
+        {
+            std::vector<std::string> result;
+            for (const auto &bound :
+                 USEEDLinkToRingServer::DurationHistogram::mBucketBounds)
+            {
+                std::ostringstream label;
+                label << bound*1.e-6;
+                result.push_back(label.str());
+            }
+            result.push_back("+Inf");
+            return result;
+        }();
+        return labels;
+    }
+
+    template<typename F>
+    static void observeInt64(
+        opentelemetry::metrics::ObserverResult &observerResult,
+        F &&getValue)
     {
         if (opentelemetry::nostd::holds_alternative
             <
@@ -79,41 +484,48 @@ public:
                 >
             >(observerResult))
         {
-            auto &metrics = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
-            auto nNotSent = metrics.getFailedPacketsSentCount();
-            opentelemetry::nostd::get
+            auto observer = opentelemetry::nostd::get
             <
                opentelemetry::nostd::shared_ptr
                <
                    opentelemetry::metrics::ObserverResultT<int64_t>
                >
-            >(observerResult)->Observe(nNotSent);
+            >(observerResult);
+            auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+            for (const auto &metrics : singleton.getWriterMetrics())
+            {
+                observer->Observe(getValue(*metrics), toAttributes(*metrics));
+            }
         }
     }
 
-    static void observePacketsFailedToEnqueue(
-        opentelemetry::metrics::ObserverResult observerResult,
-        void *)
-    {   
+    template<typename F>
+    static void observeDouble(
+        opentelemetry::metrics::ObserverResult &observerResult,
+        F &&getValue)
+    {
         if (opentelemetry::nostd::holds_alternative
             <
                 opentelemetry::nostd::shared_ptr
                 <
-                    opentelemetry::metrics::ObserverResultT<int64_t>
+                    opentelemetry::metrics::ObserverResultT<double>
                 >
             >(observerResult))
         {
-            auto &metrics = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
-            auto nNotEnqueued = metrics.getFailedPacketsFailedToEnqueueCount();
-            opentelemetry::nostd::get
+            auto observer = opentelemetry::nostd::get
             <
                opentelemetry::nostd::shared_ptr
                <
-                   opentelemetry::metrics::ObserverResultT<int64_t>
+                   opentelemetry::metrics::ObserverResultT<double>
                >
-            >(observerResult)->Observe(nNotEnqueued);
+            >(observerResult);
+            auto &singleton = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+            for (const auto &metrics : singleton.getWriterMetrics())
+            {
+                observer->Observe(getValue(*metrics), toAttributes(*metrics));
+            }
         }
-    }   
+    }
 
     //static std::atomic<int64_t> mObservablePacketsWritten;
     //static std::atomic<int64_t> mObservableInvalidPackets;
@@ -121,6 +533,454 @@ public:
     //static std::atomic<int64_t> mObservablePacketsFailedToEnqueue;
 };
 
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPacketsWrittenCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mInvalidPacketsCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPacketsFailedToWriteCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mServerErrorsCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPacketsFailedToEnqueueCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mReconnectAttemptsCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mDisconnectedWritersGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mOutageDurationCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mHoldoverSizeGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mHoldoverRecordsDroppedCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mQueueDepthGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mQueueOccupancyGauge;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mWriteLatencyBucketCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mWriteLatencyCountCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mWriteLatencySumCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mQueueResidencyBucketCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mQueueResidencyCountCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mQueueResidencySumCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPacketsDroppedCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPipelineStageBucketCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPipelineStageCountCounter;
+opentelemetry::nostd::shared_ptr<opentelemetry::metrics::ObservableInstrument>
+    mPipelineStageSumCounter;
+
+void initializeWriterMetrics(const ::ProgramOptions &options)
+{
+    auto applicationName = options.applicationName;
+    auto provider = opentelemetry::metrics::Provider::GetMeterProvider();
+    auto meter = provider->GetMeter(applicationName, "1.2.0");
+
+    mPacketsWrittenCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.packets.written",
+             "Number of miniSEED records written to the DataLink server.",
+             "{packets}");
+    mPacketsWrittenCounter->AddCallback(
+        MeasurementFetcher::observePacketsWritten, nullptr);
+
+    mInvalidPacketsCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.packets.invalid",
+             "Number of packets that could not be converted to miniSEED.",
+             "{packets}");
+    mInvalidPacketsCounter->AddCallback(
+        MeasurementFetcher::observeInvalidPackets, nullptr);
+
+    mPacketsFailedToWriteCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.packets.failed_to_write",
+             "Number of miniSEED records the DataLink server did not accept.",
+             "{packets}");
+    mPacketsFailedToWriteCounter->AddCallback(
+        MeasurementFetcher::observePacketsFailedToWrite, nullptr);
+
+    mServerErrorsCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.server_errors",
+             "Number of ERROR responses from the DataLink server.",
+             "{responses}");
+    mServerErrorsCounter->AddCallback(
+        MeasurementFetcher::observeServerErrors, nullptr);
+
+    mPacketsFailedToEnqueueCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.packets.failed_to_enqueue",
+             "Number of packets dropped from the full DataLink export queue.",
+             "{packets}");
+    mPacketsFailedToEnqueueCounter->AddCallback(
+        MeasurementFetcher::observePacketsFailedToEnqueue, nullptr);
+
+    mReconnectAttemptsCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.reconnect_attempts",
+             "Number of attempts to reconnect to the DataLink server.",
+             "{attempts}");
+    mReconnectAttemptsCounter->AddCallback(
+        MeasurementFetcher::observeReconnectAttempts, nullptr);
+
+    mDisconnectedWritersGauge
+        = meter->CreateInt64ObservableGauge(
+             "seismic_data.export.datalink.client.disconnected",
+             "Number of DataLink writers currently disconnected.",
+             "{writers}");
+    mDisconnectedWritersGauge->AddCallback(
+        MeasurementFetcher::observeDisconnectedWriters, nullptr);
+
+    mOutageDurationCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.export.datalink.client.outage_duration",
+             "Cumulative duration of completed DataLink outages.",
+             "{s}");
+    mOutageDurationCounter->AddCallback(
+        MeasurementFetcher::observeOutageDuration, nullptr);
+
+    mHoldoverSizeGauge
+        = meter->CreateInt64ObservableGauge(
+             "seismic_data.export.datalink.client.holdover.size",
+             "Number of miniSEED records held while awaiting reconnection.",
+             "{packets}");
+    mHoldoverSizeGauge->AddCallback(
+        MeasurementFetcher::observeHoldoverSize, nullptr);
+
+    mHoldoverRecordsDroppedCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.holdover.dropped",
+             "Number of held miniSEED records discarded because the holdover buffer was full.",
+             "{packets}");
+    mHoldoverRecordsDroppedCounter->AddCallback(
+        MeasurementFetcher::observeHoldoverRecordsDropped, nullptr);
+
+    mQueueDepthGauge
+        = meter->CreateInt64ObservableGauge(
+             "seismic_data.export.datalink.client.queue.depth",
+             "Number of items waiting in the DataLink writer's queue.",
+             "{packets}");
+    mQueueDepthGauge->AddCallback(
+        MeasurementFetcher::observeQueueDepth, nullptr);
+
+    mQueueOccupancyGauge
+        = meter->CreateDoubleObservableGauge(
+             "seismic_data.export.datalink.client.queue.occupancy",
+             "Fraction of the DataLink writer's queue that is in use.",
+             "1");
+    mQueueOccupancyGauge->AddCallback(
+        MeasurementFetcher::observeQueueOccupancy, nullptr);
+
+    mWriteLatencyBucketCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.write.duration.bucket",
+             "Cumulative number of DataLink writes that completed within the le bound (seconds).",
+             "{writes}");
+    mWriteLatencyBucketCounter->AddCallback(
+        MeasurementFetcher::observeWriteLatencyBuckets, nullptr);
+
+    mWriteLatencyCountCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.write.duration.count",
+             "Number of timed DataLink writes.",
+             "{writes}");
+    mWriteLatencyCountCounter->AddCallback(
+        MeasurementFetcher::observeWriteLatencyCount, nullptr);
+
+    mWriteLatencySumCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.export.datalink.client.write.duration.sum",
+             "Cumulative time spent in DataLink writes.",
+             "s");
+    mWriteLatencySumCounter->AddCallback(
+        MeasurementFetcher::observeWriteLatencySum, nullptr);
+
+    mQueueResidencyBucketCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.queue.residency.bucket",
+             "Cumulative number of packets that waited in the DataLink writer's queue for at most le seconds.",
+             "{packets}");
+    mQueueResidencyBucketCounter->AddCallback(
+        MeasurementFetcher::observeQueueResidencyBuckets, nullptr);
+
+    mQueueResidencyCountCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.queue.residency.count",
+             "Number of packets dequeued by the DataLink writer.",
+             "{packets}");
+    mQueueResidencyCountCounter->AddCallback(
+        MeasurementFetcher::observeQueueResidencyCount, nullptr);
+
+    mQueueResidencySumCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.export.datalink.client.queue.residency.sum",
+             "Cumulative time packets waited in the DataLink writer's queue.",
+             "s");
+    mQueueResidencySumCounter->AddCallback(
+        MeasurementFetcher::observeQueueResidencySum, nullptr);
+
+    mPacketsDroppedCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.export.datalink.client.packets.dropped",
+             "Number of packets or records the DataLink writer dropped by reason.",
+             "{packets}");
+    mPacketsDroppedCounter->AddCallback(
+        MeasurementFetcher::observeDroppedPackets, nullptr);
+
+    mPipelineStageBucketCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.pipeline.stage.duration.bucket",
+             "Cumulative number of records that passed through the pipeline stage within le seconds.  The total stage spans SEEDLink receipt to DataLink write.",
+             "{packets}");
+    mPipelineStageBucketCounter->AddCallback(
+        MeasurementFetcher::observePipelineStageBuckets, nullptr);
+
+    mPipelineStageCountCounter
+        = meter->CreateInt64ObservableCounter(
+             "seismic_data.pipeline.stage.duration.count",
+             "Number of records timed through the pipeline stage.",
+             "{packets}");
+    mPipelineStageCountCounter->AddCallback(
+        MeasurementFetcher::observePipelineStageCount, nullptr);
+
+    mPipelineStageSumCounter
+        = meter->CreateDoubleObservableCounter(
+             "seismic_data.pipeline.stage.duration.sum",
+             "Cumulative time records spent in the pipeline stage.",
+             "s");
+    mPipelineStageSumCounter->AddCallback(
+        MeasurementFetcher::observePipelineStageSum, nullptr);
+}
+
+/// Labels each writer's Prometheus samples by its name and DataLink server
+[[nodiscard]] ::PrometheusLabels
+    toPrometheusLabels(const USEEDLinkToRingServer::WriterMetrics &metrics)
+{
+    ::PrometheusLabels labels;
+    labels.add("writer", metrics.getName());
+    labels.add("host", metrics.getHost());
+    return labels;
+}
+
+/// Writes a Prometheus family with a sample for every writer
+template<typename F>
+void writePrometheusWriterFamily(::PrometheusTextWriter &writer,
+                                 const std::string_view name,
+                                 const std::string_view type,
+                                 const std::string_view help,
+                                 F &&getValue)
+{
+    writer.writeHeader(name, type, help);
+    USEEDLinkToRingServer::WriterMetricsSingleton::getInstance()
+        .forEachWriterMetrics(
+            [&](const USEEDLinkToRingServer::WriterMetrics &metrics)
+            {
+                writer.writeSample(name, ::toPrometheusLabels(metrics),
+                                   getValue(metrics));
+            });
+}
+
+/// Writes a Prometheus histogram for every writer
+template<typename F>
+void writePrometheusWriterHistogram(::PrometheusTextWriter &writer,
+                                    const std::string_view name,
+                                    const std::string_view help,
+                                    F &&getHistogram)
+{
+    writer.writeHeader(name, "histogram", help);
+    const auto &bucketLabels = MeasurementFetcher::getDurationBucketLabels();
+    USEEDLinkToRingServer::WriterMetricsSingleton::getInstance()
+        .forEachWriterMetrics(
+            [&](const USEEDLinkToRingServer::WriterMetrics &metrics)
+            {
+                const auto &histogram = getHistogram(metrics);
+                writer.writeHistogram(name,
+                                      ::toPrometheusLabels(metrics),
+                                      histogram.getCumulativeCounts(),
+                                      bucketLabels,
+                                      histogram.getSum().count()*1.e-6);
+            });
+}
+
+/// @brief Writes the DataLink writers' metrics in the Prometheus text
+///        format.  This reads the same counters the OTel instruments
+///        observe.
+void writePrometheusWriterMetrics(::PrometheusTextWriter &writer)
+{
+    using USEEDLinkToRingServer::WriterMetrics;
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_packets_written_total",
+        "counter",
+        "Number of miniSEED records written to the DataLink server.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getPacketsWrittenCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_packets_invalid_total",
+        "counter",
+        "Number of packets that could not be converted to miniSEED.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getInvalidPacketsCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_packets_failed_to_write_total",
+        "counter",
+        "Number of miniSEED records the DataLink server did not accept.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getFailedPacketsSentCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_server_errors_total",
+        "counter",
+        "Number of ERROR responses from the DataLink server.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getServerErrorsCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_packets_failed_to_enqueue_total",
+        "counter",
+        "Number of packets dropped from the full DataLink export queue.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getFailedPacketsFailedToEnqueueCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_reconnect_attempts_total",
+        "counter",
+        "Number of attempts to reconnect to the DataLink server.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getReconnectAttemptsCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_disconnected",
+        "gauge",
+        "Number of DataLink writers currently disconnected.",
+        [](const WriterMetrics &metrics)
+        {
+            return static_cast<int64_t> (metrics.isDisconnected());
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_outage_duration_seconds_total",
+        "counter",
+        "Cumulative duration of completed DataLink outages.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getOutageDuration().count()*1.e-6;
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_holdover_size",
+        "gauge",
+        "Number of miniSEED records held while awaiting reconnection.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getHoldoverSize();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_holdover_dropped_total",
+        "counter",
+        "Number of held miniSEED records discarded because the holdover buffer was full.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getHoldoverRecordsDroppedCount();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_queue_depth",
+        "gauge",
+        "Number of items waiting in the DataLink writer's queue.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getQueueDepth();
+        });
+    writePrometheusWriterFamily(writer,
+        "seismic_data_export_datalink_client_queue_occupancy",
+        "gauge",
+        "Fraction of the DataLink writer's queue that is in use.",
+        [](const WriterMetrics &metrics)
+        {
+            return metrics.getQueueOccupancy();
+        });
+    writePrometheusWriterHistogram(writer,
+        "seismic_data_export_datalink_client_write_duration_seconds",
+        "Time spent in DataLink writes.",
+        [](const WriterMetrics &metrics)
+            -> const USEEDLinkToRingServer::DurationHistogram &
+        {
+            return metrics.getWriteLatencyHistogram();
+        });
+    writePrometheusWriterHistogram(writer,
+        "seismic_data_export_datalink_client_queue_residency_seconds",
+        "Time packets waited in the DataLink writer's queue.",
+        [](const WriterMetrics &metrics)
+            -> const USEEDLinkToRingServer::DurationHistogram &
+        {
+            return metrics.getQueueResidencyHistogram();
+        });
+
+    constexpr std::string_view droppedName
+    {
+        "seismic_data_export_datalink_client_packets_dropped_total"
+    };
+    writer.writeHeader(droppedName, "counter",
+        "Number of packets or records the DataLink writer dropped by reason.");
+    auto &singleton
+        = USEEDLinkToRingServer::WriterMetricsSingleton::getInstance();
+    singleton.forEachWriterMetrics(
+        [&](const WriterMetrics &metrics)
+        {
+            auto labels = ::toPrometheusLabels(metrics);
+            labels.set("reason", "queue_full");
+            writer.writeSample(droppedName, labels,
+                               metrics.getFailedPacketsFailedToEnqueueCount());
+            labels.set("reason", "invalid");
+            writer.writeSample(droppedName, labels,
+                               metrics.getInvalidPacketsCount());
+            labels.set("reason", "rejected");
+            writer.writeSample(droppedName, labels,
+                               metrics.getFailedPacketsSentCount());
+            labels.set("reason", "holdover_full");
+            writer.writeSample(droppedName, labels,
+                               metrics.getHoldoverRecordsDroppedCount());
+        });
+
+    constexpr std::string_view stageName
+    {
+        "seismic_data_pipeline_stage_duration_seconds"
+    };
+    writer.writeHeader(stageName, "histogram",
+        "Time records spent in the pipeline stage.  The total stage spans SEEDLink receipt to DataLink write.");
+    const auto &bucketLabels = MeasurementFetcher::getDurationBucketLabels();
+    singleton.forEachWriterMetrics(
+        [&](const WriterMetrics &metrics)
+        {
+            for (const auto &[stage, name] :
+                 MeasurementFetcher::getPipelineStages())
+            {
+                auto labels = ::toPrometheusLabels(metrics);
+                labels.add("stage", name);
+                const auto &histogram
+                    = metrics.getPipelineStageHistogram(stage);
+                writer.writeHistogram(stageName, labels,
+                                      histogram.getCumulativeCounts(),
+                                      bucketLabels,
+                                      histogram.getSum().count()*1.e-6);
+            }
+        });
+}
+
 /*
 std::atomic<int64_t> MeasurementFetcher::mObservablePacketsWritten{0};
 std::atomic<int64_t> MeasurementFetcher::mObservableInvalidPackets{0};
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <chrono>
@@ -8,58 +9,386 @@
 
 using namespace USEEDLinkToRingServer;
 
-WriterMetricsSingleton &WriterMetricsSingleton::getInstance()
+///--------------------------------------------------------------------------///
+///                             Duration Histogram                           ///
+///--------------------------------------------------------------------------///
+
+void DurationHistogram::record(
+    const std::chrono::microseconds &duration) noexcept
 {
-    std::mutex mutex;
-    const std::scoped_lock lock{mutex};
-    static WriterMetricsSingleton instance;
-    return instance;
+    auto bucket = std::lower_bound(mBucketBounds.begin(),
+                                   mBucketBounds.end(),
+                                   duration.count())
+                - mBucketBounds.begin();
+    mCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(duration.count(), std::memory_order_relaxed);
 }
-    
-void WriterMetricsSingleton::incrementPacketsWrittenCounter()
+
+std::array<int64_t, DurationHistogram::mBucketBounds.size() + 1>
+DurationHistogram::getCumulativeCounts() const noexcept
 {
-    auto n = mPacketsWrittenCounter.fetch_add(1, std::memory_order_relaxed);
+    std::array<int64_t, mBucketBounds.size() + 1> result;
+    int64_t count{0};
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+        count = count + mCounts[i].load(std::memory_order_relaxed);
+        result[i] = count;
+    }
+    return result;
+}
 
+std::chrono::microseconds DurationHistogram::getSum() const noexcept
+{
+    return std::chrono::microseconds
+           {
+               mSum.load(std::memory_order_relaxed)
+           };
 }
 
-int64_t WriterMetricsSingleton::getPacketsWrittenCount() const noexcept
+///--------------------------------------------------------------------------///
+///                               Writer Metrics                             ///
+///--------------------------------------------------------------------------///
+
+WriterMetrics::WriterMetrics(const std::string &name,
+                             const std::string &host) :
+    mName(name),
+    mHost(host)
+{
+}
+
+const std::string &WriterMetrics::getName() const noexcept
+{
+    return mName;
+}
+
+const std::string &WriterMetrics::getHost() const noexcept
+{
+    return mHost;
+}
+
+void WriterMetrics::incrementPacketsWrittenCounter()
+{
+    mPacketsWrittenCounter.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t WriterMetrics::getPacketsWrittenCount() const noexcept
 {
     return mPacketsWrittenCounter.load(std::memory_order_relaxed);
 }
 
-void WriterMetricsSingleton::incrementInvalidPacketsCounter()
+void WriterMetrics::incrementInvalidPacketsCounter()
 {
     mInvalidPacketsCounter.fetch_add(1, std::memory_order_relaxed);
 }
 
-int64_t WriterMetricsSingleton::getInvalidPacketsCount() const noexcept
-{   
+int64_t WriterMetrics::getInvalidPacketsCount() const noexcept
+{
     return mInvalidPacketsCounter.load(std::memory_order_relaxed);
 }
 
-void WriterMetricsSingleton::incrementFailedPacketsSentCounter()
-{   
+void WriterMetrics::incrementFailedPacketsSentCounter()
+{
     mFailedPacketsSentCounter.fetch_add(1, std::memory_order_relaxed);
-}   
+}
 
-int64_t WriterMetricsSingleton::getFailedPacketsSentCount() const noexcept
-{   
+int64_t WriterMetrics::getFailedPacketsSentCount() const noexcept
+{
     return mFailedPacketsSentCounter.load(std::memory_order_relaxed);
-}   
+}
+
+void WriterMetrics::incrementServerErrorsCounter()
+{
+    mServerErrorsCounter.fetch_add(1, std::memory_order_relaxed);
+}
 
-void WriterMetricsSingleton::incrementFailedPacketsFailedToEnqueueCounter()
-{   
+int64_t WriterMetrics::getServerErrorsCount() const noexcept
+{
+    return mServerErrorsCounter.load(std::memory_order_relaxed);
+}
+
+void WriterMetrics::incrementFailedPacketsFailedToEnqueueCounter()
+{
     mPacketsFailedToEnqueueCounter.fetch_add(1, std::memory_order_relaxed);
-}   
+}
+
+int64_t WriterMetrics::getFailedPacketsFailedToEnqueueCount() const noexcept
+{
+    return mPacketsFailedToEnqueueCounter.load(std::memory_order_relaxed);
+}
+
+void WriterMetrics::incrementReconnectAttemptsCounter()
+{
+    mReconnectAttemptsCounter.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t WriterMetrics::getReconnectAttemptsCount() const noexcept
+{
+    return mReconnectAttemptsCounter.load(std::memory_order_relaxed);
+}
+
+void WriterMetrics::beginOutage()
+{
+    mDisconnected.store(1, std::memory_order_relaxed);
+}
+
+void WriterMetrics::endOutage(const std::chrono::microseconds &duration)
+{
+    mDisconnected.store(0, std::memory_order_relaxed);
+    mOutageDuration.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+bool WriterMetrics::isDisconnected() const noexcept
+{
+    return mDisconnected.load(std::memory_order_relaxed) != 0;
+}
+
+std::chrono::microseconds WriterMetrics::getOutageDuration() const noexcept
+{
+    return std::chrono::microseconds
+           {
+               mOutageDuration.load(std::memory_order_relaxed)
+           };
+}
+
+void WriterMetrics::addToHoldoverSize(const int64_t nRecords)
+{
+    mHoldoverSize.fetch_add(nRecords, std::memory_order_relaxed);
+}
+
+int64_t WriterMetrics::getHoldoverSize() const noexcept
+{
+    return mHoldoverSize.load(std::memory_order_relaxed);
+}
+
+void WriterMetrics::incrementHoldoverRecordsDroppedCounter(
+    const int64_t nRecords)
+{
+    mHoldoverRecordsDroppedCounter.fetch_add(nRecords,
+                                             std::memory_order_relaxed);
+}
+
+int64_t WriterMetrics::getHoldoverRecordsDroppedCount() const noexcept
+{
+    return mHoldoverRecordsDroppedCounter.load(std::memory_order_relaxed);
+}
+
+void WriterMetrics::setQueueCapacity(const int64_t capacity)
+{
+    mQueueCapacity.store(capacity, std::memory_order_relaxed);
+}
+
+void WriterMetrics::setQueueDepth(const int64_t depth)
+{
+    mQueueDepth.store(depth, std::memory_order_relaxed);
+}
+
+int64_t WriterMetrics::getQueueCapacity() const noexcept
+{
+    return mQueueCapacity.load(std::memory_order_relaxed);
+}
+
+int64_t WriterMetrics::getQueueDepth() const noexcept
+{
+    return mQueueDepth.load(std::memory_order_relaxed);
+}
+
+double WriterMetrics::getQueueOccupancy() const noexcept
+{
+    auto capacity = getQueueCapacity();
+    if (capacity <= 0){return 0;}
+    return static_cast<double> (getQueueDepth())
+          /static_cast<double> (capacity);
+}
+
+void WriterMetrics::recordWriteLatency(
+    const std::chrono::microseconds &latency)
+{
+    mWriteLatency.record(latency);
+}
+
+std::array<int64_t, WriterMetrics::mWriteLatencyBucketBounds.size() + 1>
+WriterMetrics::getCumulativeWriteLatencyCounts() const noexcept
+{
+    return mWriteLatency.getCumulativeCounts();
+}
+
+std::chrono::microseconds WriterMetrics::getWriteLatencySum() const noexcept
+{
+    return mWriteLatency.getSum();
+}
+
+const DurationHistogram &
+WriterMetrics::getWriteLatencyHistogram() const noexcept
+{
+    return mWriteLatency;
+}
+
+void WriterMetrics::recordQueueResidency(
+    const std::chrono::microseconds &residency)
+{
+    mQueueResidency.record(residency);
+}
+
+const DurationHistogram &
+WriterMetrics::getQueueResidencyHistogram() const noexcept
+{
+    return mQueueResidency;
+}
+
+void WriterMetrics::recordPipelineTimestamps(
+    const PipelineTimestamps &timestamps)
+{
+    auto record = [this](const PipelineStage stage,
+                         const std::chrono::steady_clock::time_point &start,
+                         const std::chrono::steady_clock::time_point &end)
+    {
+        constexpr std::chrono::steady_clock::time_point unset{};
+        if (start == unset || end == unset){return;}
+        mPipelineStages[static_cast<size_t> (stage)].record(
+            std::chrono::duration_cast<std::chrono::microseconds>
+            (end - start));
+    };
+    record(PipelineStage::Decode, timestamps.received, timestamps.decoded);
+    record(PipelineStage::Import, timestamps.decoded, timestamps.dequeued);
+    record(PipelineStage::Export, timestamps.dequeued, timestamps.encoded);
+    record(PipelineStage::Write,  timestamps.encoded,  timestamps.written);
+    record(PipelineStage::Total,  timestamps.received, timestamps.written);
+}
+
+const DurationHistogram &
+WriterMetrics::getPipelineStageHistogram(
+    const PipelineStage stage) const noexcept
+{
+    return mPipelineStages[static_cast<size_t> (stage)];
+}
+
+///--------------------------------------------------------------------------///
+///                           Writer Metrics Singleton                       ///
+///--------------------------------------------------------------------------///
+
+WriterMetricsSingleton &WriterMetricsSingleton::getInstance()
+{
+    // N.B. Initialization of a function-local static is thread-safe
+    static WriterMetricsSingleton instance;
+    return instance;
+}
+
+std::shared_ptr<WriterMetrics>
+WriterMetricsSingleton::createWriterMetrics(const std::string &name,
+                                            const std::string &host)
+{
+    auto writerMetrics = std::make_shared<WriterMetrics> (name, host);
+    const std::scoped_lock lock{mMutex};
+    mWriterMetrics.push_back(writerMetrics);
+    return writerMetrics;
+}
+
+std::vector<std::shared_ptr<const WriterMetrics>>
+WriterMetricsSingleton::getWriterMetrics() const
+{
+    const std::scoped_lock lock{mMutex};
+    return std::vector<std::shared_ptr<const WriterMetrics>>
+           (mWriterMetrics.begin(), mWriterMetrics.end());
+}
+
+template<typename F>
+int64_t WriterMetricsSingleton::sum(F &&getValue) const noexcept
+{
+    const std::scoped_lock lock{mMutex};
+    int64_t result{0};
+    for (const auto &writerMetrics : mWriterMetrics)
+    {
+        result = result + getValue(*writerMetrics);
+    }
+    return result;
+}
+
+int64_t WriterMetricsSingleton::getPacketsWrittenCount() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getPacketsWrittenCount();
+               });
+}
+
+int64_t WriterMetricsSingleton::getInvalidPacketsCount() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getInvalidPacketsCount();
+               });
+}
+
+int64_t WriterMetricsSingleton::getFailedPacketsSentCount() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getFailedPacketsSentCount();
+               });
+}
+
+int64_t WriterMetricsSingleton::getServerErrorsCount() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getServerErrorsCount();
+               });
+}
 
 int64_t WriterMetricsSingleton::getFailedPacketsFailedToEnqueueCount()
     const noexcept
 {
-    return mPacketsFailedToEnqueueCounter.load(std::memory_order_relaxed);
-}   
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getFailedPacketsFailedToEnqueueCount();
+               });
+}
 
-void USEEDLinkToRingServer::initializeWriterMetricsSingleton()
+int64_t WriterMetricsSingleton::getReconnectAttemptsCount() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getReconnectAttemptsCount();
+               });
+}
+
+int64_t WriterMetricsSingleton::getNumberOfDisconnectedWriters() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return static_cast<int64_t> (metrics.isDisconnected());
+               });
+}
+
+std::chrono::microseconds
+WriterMetricsSingleton::getOutageDuration() const noexcept
 {
-    WriterMetricsSingleton::getInstance();
+    return std::chrono::microseconds
+           {
+               sum([](const WriterMetrics &metrics)
+                   {
+                       return metrics.getOutageDuration().count();
+                   })
+           };
 }
 
+int64_t WriterMetricsSingleton::getHoldoverSize() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getHoldoverSize();
+               });
+}
+
+int64_t WriterMetricsSingleton::getHoldoverRecordsDroppedCount() const noexcept
+{
+    return sum([](const WriterMetrics &metrics)
+               {
+                   return metrics.getHoldoverRecordsDroppedCount();
+               });
+}
+
+void USEEDLinkToRingServer::initializeWriterMetricsSingleton()
+{
+    [[maybe_unused]] auto &instance = WriterMetricsSingleton::getInstance();
+}
@@ -1,11 +1,245 @@
+#include <array>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <spdlog/sinks/ostream_sink.h>
+#include "uSEEDLinkToRingServer/dataLinkClient.hpp"
 #include "uSEEDLinkToRingServer/dataLinkClientOptions.hpp"
+#include "uSEEDLinkToRingServer/dataLinkEngine.hpp"
+#include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/streamIdentifier.hpp"
+#include "uSEEDLinkToRingServer/writerMetricsSingleton.hpp"
+#include "inFlightRecords.hpp"
+#include "logSuppressor.hpp"
+#include "prometheusExposition.hpp"
+#include "rateLimiter.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
 #include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 
+namespace
+{
+
+/// @brief A DataLink server on the loopback interface that accepts writes.
+///        The first connection is reset after the given number of writes -
+///        by default right after the ID exchange so the client's next write
+///        fails.
+class FakeDataLinkServer
+{
+public:
+    /// @param[in] packetSize         The PACKETSIZE advertised to clients.
+    /// @param[in] writesBeforeReset  The number of writes accepted on the
+    ///                               first connection before resetting it.
+    ///                               If negative then no connection is
+    ///                               reset.
+    /// @param[in] sendError          If true then an ERROR is sent in
+    ///                               response to the first write on each
+    ///                               later connection.
+    /// @param[in] port               The port to listen on.  If 0 then any
+    ///                               free port is used.
+    explicit FakeDataLinkServer(const int packetSize = 512,
+                                const int writesBeforeReset = 0,
+                                const bool sendError = false,
+                                const uint16_t port = 0) :
+        mPacketSize(packetSize),
+        mWritesBeforeReset(writesBeforeReset),
+        mSendError(sendError)
+    {
+        mSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        socklen_t length{sizeof(address)};
+        if (mSocket >= 0)
+        {
+            int reuseAddress{1};
+            ::setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR,
+                         &reuseAddress, sizeof(reuseAddress));
+        }
+        if (mSocket >= 0 && mWritesBeforeReset > 0)
+        {
+            // A small receive window backs records up in the client so the
+            // reset lands in the middle of its send buffer
+            int receiveBufferSize{4096};
+            ::setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF,
+                         &receiveBufferSize, sizeof(receiveBufferSize));
+        }
+        if (mSocket < 0 ||
+            ::bind(mSocket, reinterpret_cast<sockaddr *> (&address),
+                   length) != 0 ||
+            ::listen(mSocket, 4) != 0 ||
+            ::getsockname(mSocket, reinterpret_cast<sockaddr *> (&address),
+                          &length) != 0)
+        {
+            throw std::runtime_error("Failed to start DataLink server");
+        }
+        mPort = ntohs(address.sin_port);
+        mThread = std::thread(&FakeDataLinkServer::run, this);
+    }
+    ~FakeDataLinkServer()
+    {
+        mKeepRunning = false;
+        if (mThread.joinable()){mThread.join();}
+        ::close(mSocket);
+    }
+    [[nodiscard]] uint16_t getPort() const noexcept{return mPort;}
+    [[nodiscard]] bool wasReset() const noexcept{return mReset;}
+    [[nodiscard]] int getNumberOfWrites() const noexcept{return mWrites;}
+    /// @result The ID headers sent by the clients.
+    [[nodiscard]] std::vector<std::string> getIdentifiers() const
+    {
+        const std::scoped_lock lock{mMutex};
+        return mIdentifiers;
+    }
+    /// @result The headers of the writes received in full.
+    [[nodiscard]] std::vector<std::string> getWriteHeaders() const
+    {
+        const std::scoped_lock lock{mMutex};
+        return mWriteHeaders;
+    }
+private:
+    /// Reads a frame, i.e., DL, the header length, and the header.
+    /// @result The header or an empty string on failure.
+    [[nodiscard]] std::string readHeader(const int client) const
+    {
+        std::array<char, 3> preheader{};
+        if (!read(client, preheader.data(), preheader.size())){return {};}
+        if (preheader[0] != 'D' || preheader[1] != 'L'){return {};}
+        std::string header(static_cast<uint8_t> (preheader[2]), '\0');
+        if (!read(client, header.data(), header.size())){return {};}
+        return header;
+    }
+    [[nodiscard]] bool read(const int client, char *buffer, size_t n) const
+    {
+        while (n > 0)
+        {
+            pollfd descriptor{client, POLLIN, 0};
+            if (::poll(&descriptor, 1, 100) <= 0)
+            {
+                if (mKeepRunning){continue;}
+                return false;
+            }
+            auto nRead = ::recv(client, buffer, n, 0);
+            if (nRead <= 0){return false;}
+            buffer = buffer + nRead;
+            n = n - static_cast<size_t> (nRead);
+        }
+        return true;
+    }
+    /// Sends a frame with the given header and message.
+    static void sendFrame(const int client, const std::string &header,
+                          const std::string &message = {})
+    {
+        std::string frame{"DL"};
+        frame.push_back(static_cast<char> (header.size()));
+        frame.append(header);
+        frame.append(message);
+        ::send(client, frame.data(), frame.size(), MSG_NOSIGNAL);
+    }
+    /// Closes the connection with a reset rather than a graceful shutdown.
+    static void resetConnection(const int client)
+    {
+        linger reset{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        ::close(client);
+    }
+    void run()
+    {
+        bool first{true};
+        while (mKeepRunning)
+        {
+            pollfd descriptor{mSocket, POLLIN, 0};
+            if (::poll(&descriptor, 1, 100) <= 0){continue;}
+            auto client = ::accept(mSocket, nullptr, nullptr);
+            if (client < 0){continue;}
+            if (auto identifier = readHeader(client);
+                identifier.starts_with("ID"))
+            {
+                {
+                    const std::scoped_lock lock{mMutex};
+                    mIdentifiers.push_back(identifier);
+                }
+                sendFrame(client,
+                          "ID DataLink 2018.078 :: DLPROTO:1.0 PACKETSIZE:"
+                        + std::to_string(mPacketSize) + " WRITE");
+                bool resetting = first && mWritesBeforeReset >= 0;
+                first = false;
+                if (resetting && mWritesBeforeReset == 0)
+                {
+                    // Give the client time to read the response then reset
+                    std::this_thread::sleep_for(std::chrono::milliseconds {100});
+                    resetConnection(client);
+                    mReset = true;
+                    continue;
+                }
+                // WRITE <stream> <start> <end> <flags> <size>
+                int nWrites{0};
+                for (auto header = readHeader(client);
+                     header.starts_with("WRITE");
+                     header = readHeader(client))
+                {
+                    auto size = std::stoi(header.substr(header.rfind(' ')));
+                    std::string payload(size, '\0');
+                    if (!read(client, payload.data(), payload.size())){break;}
+                    {
+                        const std::scoped_lock lock{mMutex};
+                        mWriteHeaders.push_back(header);
+                    }
+                    mWrites = mWrites + 1;
+                    nWrites = nWrites + 1;
+                    if (resetting && nWrites == mWritesBeforeReset){break;}
+                    if (!resetting && nWrites == 1 && mSendError)
+                    {
+                        const std::string message{"Test error"};
+                        sendFrame(client,
+                                  "ERROR 0 " + std::to_string(message.size()),
+                                  message);
+                    }
+                }
+                if (resetting)
+                {
+                    resetConnection(client);
+                    mReset = true;
+                    continue;
+                }
+            }
+            ::close(client);
+        }
+    }
+    std::thread mThread;
+    mutable std::mutex mMutex;
+    std::vector<std::string> mIdentifiers;
+    std::vector<std::string> mWriteHeaders;
+    std::atomic<bool> mKeepRunning{true};
+    std::atomic<bool> mReset{false};
+    std::atomic<int> mWrites{0};
+    int mSocket{-1};
+    int mPacketSize{512};
+    int mWritesBeforeReset{0};
+    uint16_t mPort{0};
+    bool mSendError{false};
+};
+
+}
+
 TEST_CASE("USEEDLinkToRingServer::DataLink", "[clientOptions]")
 {
     namespace USR = USEEDLinkToRingServer;
@@ -18,17 +252,110 @@ TEST_CASE("USEEDLinkToRingServer::DataLink", "[clientOptions]")
         REQUIRE(clientOptions.writeMiniSEED3() == false);
         REQUIRE(clientOptions.getMiniSEEDRecordSize() == 512);
         REQUIRE(clientOptions.flushPackets() == true);
+        REQUIRE(clientOptions.aggregatePackets() == false);
+        REQUIRE(clientOptions.getAggregationLatency() ==
+                std::chrono::milliseconds {1000});
+        REQUIRE(clientOptions.getInitialReconnectDelay() ==
+                std::chrono::milliseconds {1000});
+        REQUIRE(clientOptions.getMaximumReconnectDelay() ==
+                std::chrono::milliseconds {60000});
+        REQUIRE(std::abs(clientOptions.getReconnectJitter() - 0.2) < 1.e-14);
+        REQUIRE(clientOptions.getMaximumHoldoverSize() == 65536);
+        REQUIRE(clientOptions.getFailoverEndpoints().empty());
+        REQUIRE(clientOptions.getEndpoints().size() == 1);
+        REQUIRE(clientOptions.getIOTimeOut() ==
+                std::chrono::milliseconds {60000});
+        REQUIRE(clientOptions.getFailbackProbeInterval() ==
+                std::chrono::milliseconds {30000});
+        REQUIRE(clientOptions.getMaximumPacketsPerSecond() == 0);
+        REQUIRE(clientOptions.getMaximumBytesPerSecond() == 0);
+        REQUIRE(clientOptions.getBurstAllowance() ==
+                std::chrono::milliseconds {1000});
+        REQUIRE(clientOptions.getRealTimeThreshold() ==
+                std::chrono::milliseconds {0});
+        REQUIRE(clientOptions.getMiniSEEDRecordSizes().empty());
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.FTU.HHZ.01") == 512);
+    }
+    SECTION("Record size by stream")
+    {
+        clientOptions.setMiniSEEDRecordSize(1024);
+        clientOptions.addMiniSEEDRecordSize("*.*.HN?.*", 4096);
+        clientOptions.addMiniSEEDRecordSize("UU.*.DAS", 8192);
+        REQUIRE_THROWS(clientOptions.addMiniSEEDRecordSize("UU.FTU", 4096));
+        REQUIRE_THROWS(clientOptions.addMiniSEEDRecordSize("*.*.HH?.*",
+                                                           1000000));
+        REQUIRE_THROWS(clientOptions.setMiniSEEDRecordSize(1000000));
+        REQUIRE(clientOptions.getMiniSEEDRecordSizes().size() == 2);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.FTU.HNZ.01") == 4096);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.FTU.HNZ") == 4096);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.ARR1.DAS") == 8192);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.ARR1.DAS.00") == 8192);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("WY.ARR1.DAS.00") == 1024);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.FTU.HHZ.01") == 1024);
+        const USR::DataLinkClientOptions copy{clientOptions};
+        REQUIRE(copy.getMiniSEEDRecordSize("UU.FTU.HNZ.01") == 4096);
+    }
+    SECTION("Record size over 512 bytes")
+    {
+        // Records may be larger than the original 512 byte limit
+        clientOptions.setMiniSEEDRecordSize(4096);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize() == 4096);
+        REQUIRE(clientOptions.getMiniSEEDRecordSize("UU.FTU.HHZ.01") == 4096);
     }
     const std::string host("127.0.0.1");
     const uint16_t port{1284};
     const std::string name{"abc"};
     int maxSize{412};
+    const std::chrono::milliseconds aggregationLatency{250};
+    const std::chrono::milliseconds initialReconnectDelay{500};
+    const std::chrono::milliseconds maximumReconnectDelay{30000};
+    const double reconnectJitter{0.1};
+    const int maximumHoldoverSize{1024};
+    const std::vector<std::pair<std::string, uint16_t>> failoverEndpoints
+    {
+        std::pair {std::string {"backup1.example.com"}, uint16_t {16000}},
+        std::pair {std::string {"127.0.0.2"}, uint16_t {16001}}
+    };
+    const std::chrono::milliseconds ioTimeOut{2500};
+    const std::chrono::milliseconds failbackProbeInterval{10000};
+    const double maximumPacketsPerSecond{200};
+    const double maximumBytesPerSecond{102400};
+    const std::chrono::milliseconds burstAllowance{250};
+    const std::chrono::milliseconds realTimeThreshold{30000};
     clientOptions.setHost(host);
     clientOptions.setPort(port);
     clientOptions.setName(name);
     clientOptions.setMiniSEEDRecordSize(maxSize);
     clientOptions.enableWriteMiniSEED3();
     clientOptions.disablePacketFlushing();
+    clientOptions.enablePacketAggregation();
+    clientOptions.setAggregationLatency(aggregationLatency);
+    REQUIRE_THROWS(clientOptions.setAggregationLatency(
+                      std::chrono::milliseconds {0}));
+    clientOptions.setReconnectDelays(initialReconnectDelay,
+                                     maximumReconnectDelay);
+    REQUIRE_THROWS(clientOptions.setReconnectDelays(maximumReconnectDelay,
+                                                    initialReconnectDelay));
+    clientOptions.setReconnectJitter(reconnectJitter);
+    REQUIRE_THROWS(clientOptions.setReconnectJitter(1.5));
+    clientOptions.setMaximumHoldoverSize(maximumHoldoverSize);
+    REQUIRE_THROWS(clientOptions.setMaximumHoldoverSize(0));
+    clientOptions.setFailoverEndpoints(failoverEndpoints);
+    clientOptions.setIOTimeOut(ioTimeOut);
+    REQUIRE_THROWS(clientOptions.setIOTimeOut(std::chrono::milliseconds {0}));
+    clientOptions.setFailbackProbeInterval(failbackProbeInterval);
+    REQUIRE_THROWS(clientOptions.setFailbackProbeInterval(
+                      std::chrono::milliseconds {-1}));
+    clientOptions.setMaximumPacketsPerSecond(maximumPacketsPerSecond);
+    REQUIRE_THROWS(clientOptions.setMaximumPacketsPerSecond(-1));
+    clientOptions.setMaximumBytesPerSecond(maximumBytesPerSecond);
+    REQUIRE_THROWS(clientOptions.setMaximumBytesPerSecond(-1));
+    clientOptions.setBurstAllowance(burstAllowance);
+    REQUIRE_THROWS(clientOptions.setBurstAllowance(
+                      std::chrono::milliseconds {0}));
+    clientOptions.setRealTimeThreshold(realTimeThreshold);
+    REQUIRE_THROWS(clientOptions.setRealTimeThreshold(
+                      std::chrono::milliseconds {-1}));
 
     REQUIRE(clientOptions.getHost() == host);
     REQUIRE(clientOptions.getPort() == port);
@@ -36,6 +363,25 @@ TEST_CASE("USEEDLinkToRingServer::DataLink", "[clientOptions]")
     REQUIRE(clientOptions.writeMiniSEED3() == true);
     REQUIRE(clientOptions.getMiniSEEDRecordSize() == maxSize);
     REQUIRE(clientOptions.flushPackets() == false);
+    REQUIRE(clientOptions.aggregatePackets() == true);
+    REQUIRE(clientOptions.getAggregationLatency() == aggregationLatency);
+    REQUIRE(clientOptions.getInitialReconnectDelay() == initialReconnectDelay);
+    REQUIRE(clientOptions.getMaximumReconnectDelay() == maximumReconnectDelay);
+    REQUIRE(std::abs(clientOptions.getReconnectJitter() - reconnectJitter) < 1.e-14);
+    REQUIRE(clientOptions.getMaximumHoldoverSize() == maximumHoldoverSize);
+    REQUIRE(clientOptions.getFailoverEndpoints() == failoverEndpoints);
+    auto endpoints = clientOptions.getEndpoints();
+    REQUIRE(endpoints.size() == 3);
+    REQUIRE(endpoints.at(0).first == host);
+    REQUIRE(endpoints.at(0).second == port);
+    REQUIRE(endpoints.at(1) == failoverEndpoints.at(0));
+    REQUIRE(endpoints.at(2) == failoverEndpoints.at(1));
+    REQUIRE(clientOptions.getIOTimeOut() == ioTimeOut);
+    REQUIRE(clientOptions.getFailbackProbeInterval() == failbackProbeInterval);
+    REQUIRE(clientOptions.getMaximumPacketsPerSecond() == maximumPacketsPerSecond);
+    REQUIRE(clientOptions.getMaximumBytesPerSecond() == maximumBytesPerSecond);
+    REQUIRE(clientOptions.getBurstAllowance() == burstAllowance);
+    REQUIRE(clientOptions.getRealTimeThreshold() == realTimeThreshold);
 
     SECTION("Copy")
     {
@@ -46,5 +392,650 @@ TEST_CASE("USEEDLinkToRingServer::DataLink", "[clientOptions]")
         REQUIRE(copy.writeMiniSEED3() == true);
         REQUIRE(copy.getMiniSEEDRecordSize() == maxSize);
         REQUIRE(copy.flushPackets() == false);
+        REQUIRE(copy.aggregatePackets() == true);
+        REQUIRE(copy.getAggregationLatency() == aggregationLatency);
+        REQUIRE(copy.getInitialReconnectDelay() == initialReconnectDelay);
+        REQUIRE(copy.getMaximumReconnectDelay() == maximumReconnectDelay);
+        REQUIRE(copy.getMaximumHoldoverSize() == maximumHoldoverSize);
+        REQUIRE(copy.getFailoverEndpoints() == failoverEndpoints);
+        REQUIRE(copy.getIOTimeOut() == ioTimeOut);
+        REQUIRE(copy.getFailbackProbeInterval() == failbackProbeInterval);
+        REQUIRE(copy.getMaximumPacketsPerSecond() == maximumPacketsPerSecond);
+        REQUIRE(copy.getMaximumBytesPerSecond() == maximumBytesPerSecond);
+        REQUIRE(copy.getBurstAllowance() == burstAllowance);
+        REQUIRE(copy.getRealTimeThreshold() == realTimeThreshold);
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::RateLimiter", "[rateLimiter]")
+{
+    namespace USR = USEEDLinkToRingServer;
+    USR::DataLinkClientOptions options;
+    SECTION("Unlimited")
+    {
+        ::RateLimiter rateLimiter{options};
+        REQUIRE(!rateLimiter.isLimited());
+        auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < 1000; ++i)
+        {
+            REQUIRE(rateLimiter.tryAcquire(512, now));
+        }
+    }
+    SECTION("Packets per second")
+    {
+        options.setMaximumPacketsPerSecond(10);
+        options.setBurstAllowance(std::chrono::milliseconds {500});
+        ::RateLimiter rateLimiter{options};
+        REQUIRE(rateLimiter.isLimited());
+        auto now = std::chrono::steady_clock::now();
+        // The burst is half a second's worth of packets
+        for (int i = 0; i < 5; ++i)
+        {
+            REQUIRE(rateLimiter.tryAcquire(512, now));
+        }
+        REQUIRE(!rateLimiter.tryAcquire(512, now));
+        auto waitTime = rateLimiter.getWaitTime(512, now);
+        REQUIRE(waitTime > std::chrono::milliseconds {99});
+        REQUIRE(waitTime <= std::chrono::milliseconds {100});
+        REQUIRE(rateLimiter.tryAcquire(512, now + waitTime));
+        REQUIRE(!rateLimiter.tryAcquire(512, now + waitTime));
+    }
+    SECTION("Bytes per second")
+    {
+        options.setMaximumBytesPerSecond(1024);
+        options.setBurstAllowance(std::chrono::milliseconds {1000});
+        ::RateLimiter rateLimiter{options};
+        auto now = std::chrono::steady_clock::now();
+        REQUIRE(rateLimiter.tryAcquire(512, now));
+        REQUIRE(rateLimiter.tryAcquire(512, now));
+        REQUIRE(!rateLimiter.tryAcquire(512, now));
+        REQUIRE(rateLimiter.getWaitTime(512, now) ==
+                std::chrono::milliseconds {500});
+        // A record bigger than the burst goes once the bucket is full
+        REQUIRE(rateLimiter.tryAcquire(4096, now + std::chrono::seconds {1}));
+        REQUIRE(!rateLimiter.tryAcquire(1, now + std::chrono::seconds {1}));
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::LogSuppressor", "[logSuppressor]")
+{
+    const std::chrono::seconds interval{10};
+    ::LogSuppressor suppressor{interval};
+    const std::chrono::steady_clock::time_point start{std::chrono::hours {1}};
+    SECTION("Unkeyed")
+    {
+        // The first occurrence is logged
+        auto emission = suppressor.check({}, start);
+        REQUIRE(emission);
+        REQUIRE(emission->suppressed == 0);
+        for (int i = 0; i < 100; ++i)
+        {
+            REQUIRE(!suppressor.check({}, start + std::chrono::seconds {1}));
+        }
+        REQUIRE(!suppressor.check({}, start + std::chrono::seconds {9}));
+        // The next occurrence after the interval summarizes the rest
+        emission = suppressor.check({}, start + std::chrono::seconds {12});
+        REQUIRE(emission);
+        REQUIRE(emission->suppressed == 101);
+        REQUIRE(emission->elapsed == std::chrono::seconds {12});
+        emission = suppressor.check({}, start + std::chrono::seconds {30});
+        REQUIRE(emission);
+        REQUIRE(emission->suppressed == 0);
+    }
+    SECTION("Keyed")
+    {
+        REQUIRE(suppressor.check("UU.FTU.HHN.01", start));
+        REQUIRE(suppressor.check("UU.CTU.HHZ.01", start));
+        REQUIRE(suppressor.check({}, start));
+        REQUIRE(!suppressor.check("UU.FTU.HHN.01", start));
+        REQUIRE(!suppressor.check("UU.FTU.HHN.01", start));
+        REQUIRE(!suppressor.check("UU.CTU.HHZ.01", start));
+        auto emission = suppressor.check("UU.FTU.HHN.01", start + interval);
+        REQUIRE(emission);
+        REQUIRE(emission->suppressed == 2);
+        emission = suppressor.check("UU.CTU.HHZ.01", start + interval);
+        REQUIRE(emission);
+        REQUIRE(emission->suppressed == 1);
+    }
+    SECTION("Flush")
+    {
+        std::map<std::string, int64_t> flushed;
+        auto flush = [&](const std::chrono::steady_clock::time_point &now,
+                         const bool force = false)
+        {
+            flushed.clear();
+            suppressor.flush([&](const std::string_view &key,
+                                 const ::LogSuppressor::Emission &emission)
+                             {
+                                 flushed[std::string {key}]
+                                     = emission.suppressed;
+                             },
+                             now, force);
+        };
+        REQUIRE(suppressor.check({}, start));
+        REQUIRE(suppressor.check("UU.FTU.HHN.01", start));
+        REQUIRE(!suppressor.check({}, start));
+        REQUIRE(!suppressor.check({}, start));
+        REQUIRE(!suppressor.check("UU.FTU.HHN.01", start));
+        // Nothing is reported within the interval
+        flush(start + std::chrono::seconds {1});
+        REQUIRE(flushed.empty());
+        // After the interval the counts are reported without another
+        // occurrence
+        flush(start + interval);
+        REQUIRE(flushed.size() == 2);
+        REQUIRE(flushed.at("") == 2);
+        REQUIRE(flushed.at("UU.FTU.HHN.01") == 1);
+        // Once
+        flush(start + 3*interval);
+        REQUIRE(flushed.empty());
+        // The flush restarts the interval
+        REQUIRE(!suppressor.check({}, start + interval + std::chrono::seconds {1}));
+        flush(start + interval + std::chrono::seconds {2});
+        REQUIRE(flushed.empty());
+        flush(start + interval + std::chrono::seconds {2}, true);
+        REQUIRE(flushed.at("") == 1);
+    }
+    SECTION("Call site")
+    {
+        std::ostringstream stream;
+        auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt> (stream);
+        auto logger = std::make_shared<spdlog::logger> ("suppressorTest", sink);
+        logger->set_pattern("%v");
+        for (int i = 0; i < 3; ++i)
+        {
+            RATE_LIMITED_LOGGER_WARN(logger, std::string_view {"UU.FTU"},
+                                     "Warning {}", i);
+        }
+        REQUIRE(stream.str() == "Warning 0\n");
+        stream.str("");
+        SuppressedWarnings::getInstance().flush(
+            std::chrono::steady_clock::now(), true);
+        REQUIRE(stream.str().starts_with("Suppressed 2 similar messages from "));
+        REQUIRE(stream.str().find(".cpp:") != std::string::npos);
+        REQUIRE(stream.str().find(" for UU.FTU in ") != std::string::npos);
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::PrometheusTextWriter", "[prometheus]")
+{
+    ::PrometheusTextWriter writer;
+    SECTION("Samples")
+    {
+        ::PrometheusLabels labels{std::map<std::string, std::string>
+                                  {
+                                      {"network", "uu"},
+                                      {"stream", "uu_ctu_hhz_01"}
+                                  }};
+        writer.writeHeader("packets_total", "counter",
+                           "Number of packets.\nA \\ is escaped.");
+        writer.writeSample("packets_total", labels, int64_t {42});
+        labels.set("network", "say \"hi\"");
+        writer.writeSample("packets_total", labels, 0.25);
+        writer.writeSample("packets_total", ::PrometheusLabels {},
+                           std::numeric_limits<double>::infinity());
+        REQUIRE(writer.getText() ==
+            "# HELP packets_total Number of packets.\\nA \\\\ is escaped.\n"
+            "# TYPE packets_total counter\n"
+            "packets_total{network=\"uu\",stream=\"uu_ctu_hhz_01\"} 42\n"
+            "packets_total{network=\"say \\\"hi\\\"\",stream=\"uu_ctu_hhz_01\"} 0.25\n"
+            "packets_total +Inf\n");
+    }
+    SECTION("Histogram")
+    {
+        ::PrometheusLabels labels;
+        labels.add("writer", "w1");
+        const std::array<int64_t, 3> counts{1, 3, 4};
+        const std::array<std::string, 3> bucketLabels{"0.1", "1", "+Inf"};
+        writer.writeHistogram("duration_seconds", labels, counts,
+                              bucketLabels, 2.5);
+        REQUIRE(writer.getText() ==
+            "duration_seconds_bucket{writer=\"w1\",le=\"0.1\"} 1\n"
+            "duration_seconds_bucket{writer=\"w1\",le=\"1\"} 3\n"
+            "duration_seconds_bucket{writer=\"w1\",le=\"+Inf\"} 4\n"
+            "duration_seconds_sum{writer=\"w1\"} 2.5\n"
+            "duration_seconds_count{writer=\"w1\"} 4\n");
+    }
+    SECTION("Buffer is reused")
+    {
+        writer.writeSample("depth", ::PrometheusLabels {}, int64_t {7});
+        auto capacity = writer.getText().capacity();
+        writer.clear();
+        REQUIRE(writer.getText().empty());
+        REQUIRE(writer.getText().capacity() == capacity);
+        writer.writeSample("depth", ::PrometheusLabels {}, int64_t {8});
+        REQUIRE(writer.getText() == "depth 8\n");
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::WriterMetrics", "[writerMetrics]")
+{
+    namespace USR = USEEDLinkToRingServer;
+    auto &singleton = USR::WriterMetricsSingleton::getInstance();
+    auto nWriters = singleton.getWriterMetrics().size();
+    auto nWrittenBefore = singleton.getPacketsWrittenCount();
+    auto metrics1 = singleton.createWriterMetrics("writer1", "localhost:16000");
+    auto metrics2 = singleton.createWriterMetrics("writer2", "localhost:16001");
+    REQUIRE(singleton.getWriterMetrics().size() == nWriters + 2);
+    size_t nVisited{0};
+    singleton.forEachWriterMetrics([&](const USR::WriterMetrics &)
+                                   {
+                                       nVisited = nVisited + 1;
+                                   });
+    REQUIRE(nVisited == nWriters + 2);
+    REQUIRE(metrics1->getName() == "writer1");
+    REQUIRE(metrics1->getHost() == "localhost:16000");
+
+    metrics1->incrementPacketsWrittenCounter();
+    metrics1->incrementPacketsWrittenCounter();
+    metrics2->incrementPacketsWrittenCounter();
+    REQUIRE(metrics1->getPacketsWrittenCount() == 2);
+    REQUIRE(metrics2->getPacketsWrittenCount() == 1);
+    REQUIRE(singleton.getPacketsWrittenCount() == nWrittenBefore + 3);
+
+    metrics2->beginOutage();
+    REQUIRE(metrics2->isDisconnected());
+    metrics2->endOutage(std::chrono::microseconds {1500});
+    REQUIRE(!metrics2->isDisconnected());
+    REQUIRE(metrics2->getOutageDuration() == std::chrono::microseconds {1500});
+
+    metrics1->setQueueCapacity(8);
+    metrics1->setQueueDepth(2);
+    REQUIRE(metrics1->getQueueDepth() == 2);
+    REQUIRE(std::abs(metrics1->getQueueOccupancy() - 0.25) < 1.e-14);
+
+    SECTION("Write latency histogram")
+    {
+        metrics1->recordWriteLatency(std::chrono::microseconds {50});
+        metrics1->recordWriteLatency(std::chrono::microseconds {100});
+        metrics1->recordWriteLatency(std::chrono::microseconds {3000});
+        metrics1->recordWriteLatency(std::chrono::microseconds {20000000});
+        auto counts = metrics1->getCumulativeWriteLatencyCounts();
+        REQUIRE(counts.size() ==
+                USR::WriterMetrics::mWriteLatencyBucketBounds.size() + 1);
+        REQUIRE(counts.at(2) == 1); // <= 50 us
+        REQUIRE(counts.at(3) == 2); // <= 100 us
+        REQUIRE(counts.at(7) == 2); // <= 2500 us
+        REQUIRE(counts.at(8) == 3); // <= 5000 us
+        REQUIRE(counts.at(counts.size() - 2) == 3); // <= 10 s
+        REQUIRE(counts.back() == 4);
+        REQUIRE(metrics1->getWriteLatencySum() ==
+                std::chrono::microseconds {20003150});
+    }
+    SECTION("Queue residency histogram")
+    {
+        metrics2->recordQueueResidency(std::chrono::microseconds {10});
+        metrics2->recordQueueResidency(std::chrono::microseconds {400});
+        metrics2->recordQueueResidency(std::chrono::microseconds {400});
+        const auto &histogram = metrics2->getQueueResidencyHistogram();
+        auto counts = histogram.getCumulativeCounts();
+        REQUIRE(counts.at(0) == 1); // <= 10 us
+        REQUIRE(counts.at(3) == 1); // <= 100 us
+        REQUIRE(counts.at(4) == 1); // <= 250 us
+        REQUIRE(counts.at(5) == 3); // <= 500 us
+        REQUIRE(counts.back() == 3);
+        REQUIRE(histogram.getSum() == std::chrono::microseconds {810});
+        // Write latencies are tallied separately
+        REQUIRE(metrics2->getCumulativeWriteLatencyCounts().back() == 0);
+    }
+    SECTION("Pipeline stage histograms")
+    {
+        using USR::PipelineStage;
+        const std::chrono::steady_clock::time_point start{std::chrono::seconds {100}};
+        USR::PipelineTimestamps timestamps;
+        timestamps.received = start;
+        timestamps.decoded = start + std::chrono::microseconds {20};
+        timestamps.dequeued = start + std::chrono::microseconds {120};
+        timestamps.encoded = start + std::chrono::microseconds {400};
+        timestamps.written = start + std::chrono::microseconds {900};
+        metrics1->recordPipelineTimestamps(timestamps);
+        const auto &decode = metrics1->getPipelineStageHistogram(PipelineStage::Decode);
+        REQUIRE(decode.getCumulativeCounts().at(0) == 0); // <= 10 us
+        REQUIRE(decode.getCumulativeCounts().at(1) == 1); // <= 25 us
+        REQUIRE(decode.getSum() == std::chrono::microseconds {20});
+        const auto &importStage = metrics1->getPipelineStageHistogram(PipelineStage::Import);
+        REQUIRE(importStage.getSum() == std::chrono::microseconds {100});
+        const auto &exportStage = metrics1->getPipelineStageHistogram(PipelineStage::Export);
+        REQUIRE(exportStage.getSum() == std::chrono::microseconds {280});
+        const auto &write = metrics1->getPipelineStageHistogram(PipelineStage::Write);
+        REQUIRE(write.getSum() == std::chrono::microseconds {500});
+        const auto &total = metrics1->getPipelineStageHistogram(PipelineStage::Total);
+        REQUIRE(total.getSum() == std::chrono::microseconds {900});
+        REQUIRE(total.getCumulativeCounts().at(5) == 0); // <= 500 us
+        REQUIRE(total.getCumulativeCounts().at(6) == 1); // <= 1 ms
+        // Stages the record did not pass through are not tallied
+        USR::PipelineTimestamps partial;
+        partial.encoded = start;
+        partial.written = start + std::chrono::microseconds {50};
+        metrics1->recordPipelineTimestamps(partial);
+        REQUIRE(write.getCumulativeCounts().back() == 2);
+        REQUIRE(total.getCumulativeCounts().back() == 1);
+        REQUIRE(decode.getCumulativeCounts().back() == 1);
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::InFlightRecords", "[inFlightRecords]")
+{
+    namespace USR = USEEDLinkToRingServer;
+    ::InFlightRecords inFlight;
+    const std::chrono::steady_clock::time_point start{std::chrono::hours {1}};
+    std::vector<std::pair<int64_t, std::chrono::microseconds>> released;
+    auto release = [&](const size_t bytesSent,
+                       const std::chrono::steady_clock::time_point &sentTime)
+    {
+        inFlight.release(bytesSent, sentTime,
+                         [&](USR::DataLinkPacket &record,
+                             const std::chrono::microseconds &latency)
+                         {
+                             released.emplace_back(record.startTime.count(),
+                                                   latency);
+                         });
+    };
+    // Three 100 byte records appended at different times
+    for (int i = 0; i < 3; ++i)
+    {
+        USR::DataLinkPacket record;
+        record.startTime = std::chrono::microseconds {i};
+        inFlight.push_back(std::move(record),
+                           100*(i + 1),
+                           start + std::chrono::milliseconds {i});
+    }
+    REQUIRE(inFlight.size() == 3);
+    SECTION("Partial send")
+    {
+        // Part of the first record is not enough to release it
+        release(50, start + std::chrono::milliseconds {5});
+        REQUIRE(released.empty());
+        // The rest of the first and part of the second
+        release(150, start + std::chrono::milliseconds {10});
+        REQUIRE(released.size() == 1);
+        REQUIRE(released.at(0).first == 0);
+        REQUIRE(released.at(0).second == std::chrono::milliseconds {10});
+        // The remainder.  Each latency is measured from its own append.
+        release(300, start + std::chrono::milliseconds {20});
+        REQUIRE(released.size() == 3);
+        REQUIRE(released.at(1).first == 1);
+        REQUIRE(released.at(1).second == std::chrono::milliseconds {19});
+        REQUIRE(released.at(2).first == 2);
+        REQUIRE(released.at(2).second == std::chrono::milliseconds {18});
+        REQUIRE(inFlight.empty());
     }
+    SECTION("Requeue newest first")
+    {
+        release(100, start);
+        REQUIRE(inFlight.size() == 2);
+        REQUIRE(inFlight.back().startTime == std::chrono::microseconds {2});
+        inFlight.pop_back();
+        REQUIRE(inFlight.back().startTime == std::chrono::microseconds {1});
+        inFlight.pop_back();
+        REQUIRE(inFlight.empty());
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::DataLinkClient", "[dataLinkClient]")
+{
+    namespace USR = USEEDLinkToRingServer;
+    std::signal(SIGPIPE, SIG_IGN);
+    auto waitFor = [](auto &&condition)
+    {
+        auto deadline = std::chrono::steady_clock::now()
+                      + std::chrono::seconds {5};
+        while (!condition() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds {10});
+        }
+        return condition();
+    };
+    USR::StreamIdentifier identifier;
+    identifier.setNetwork("UU");
+    identifier.setStation("FTU");
+    identifier.setChannel("HHN");
+    identifier.setLocationCode("01");
+    USR::Packet packet;
+    packet.setStreamIdentifier(identifier);
+    packet.setSamplingRate(100);
+    packet.setStartTime(std::chrono::nanoseconds {1759952887000000000});
+    packet.setData(std::vector<int> {1, 2, 3, -4});
+    USR::DataLinkClientOptions options;
+    options.setHost("127.0.0.1");
+    options.setReconnectDelays(std::chrono::milliseconds {10},
+                               std::chrono::milliseconds {100});
+    SECTION("Unreachable server")
+    {
+        // Nothing listens on a bound port so connecting is refused
+        auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length{sizeof(address)};
+        REQUIRE(::bind(socket, reinterpret_cast<sockaddr *> (&address),
+                       length) == 0);
+        REQUIRE(::getsockname(socket, reinterpret_cast<sockaddr *> (&address),
+                              &length) == 0);
+        options.setPort(ntohs(address.sin_port));
+        options.setName("unreachableTest");
+        // The writer starts disconnected and holds records until it can
+        // connect
+        std::unique_ptr<USR::DataLinkClient> client;
+        REQUIRE_NOTHROW(client = std::make_unique<USR::DataLinkClient>
+                                 (options, spdlog::default_logger()));
+        auto future = client->start();
+        client->enqueue(packet);
+        int64_t holdoverSize{0};
+        CHECK(waitFor([&]
+              {
+                  for (const auto &metrics :
+                       USR::WriterMetricsSingleton::getInstance()
+                          .getWriterMetrics())
+                  {
+                      if (metrics->getName() == "unreachableTest")
+                      {
+                          holdoverSize = metrics->getHoldoverSize();
+                      }
+                  }
+                  return holdoverSize == 1;
+              }));
+        client->stop();
+        future.get();
+        ::close(socket);
+    }
+    SECTION("Failed write is held")
+    {
+        FakeDataLinkServer server;
+        options.setPort(server.getPort());
+        options.setName("failedWriteTest");
+        USR::DataLinkClient client{options, spdlog::default_logger()};
+        auto future = client.start();
+        CHECK(waitFor([&]{return server.wasReset();}));
+        std::this_thread::sleep_for(std::chrono::milliseconds {50});
+        client.enqueue(std::move(packet));
+        // The write on the reset connection fails.  Rather than being lost
+        // the record is held then written after reconnecting.  The writer
+        // must be stopped before the future goes out of scope.
+        CHECK(waitFor([&]{return server.getNumberOfWrites() == 1;}));
+        client.stop();
+        future.get();
+        for (const auto &metrics :
+             USR::WriterMetricsSingleton::getInstance().getWriterMetrics())
+        {
+            if (metrics->getName() != "failedWriteTest"){continue;}
+            REQUIRE(metrics->getFailedPacketsSentCount() >= 1);
+            REQUIRE(metrics->getPacketsWrittenCount() == 1);
+            REQUIRE(metrics->getHoldoverSize() == 0);
+            REQUIRE(metrics->getHoldoverRecordsDroppedCount() == 0);
+        }
+    }
+    SECTION("Fails back")
+    {
+        // Reserve a port for the primary server then start with it down
+        uint16_t primaryPort{0};
+        {
+            auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length{sizeof(address)};
+            REQUIRE(::bind(socket, reinterpret_cast<sockaddr *> (&address),
+                           length) == 0);
+            REQUIRE(::getsockname(socket,
+                                  reinterpret_cast<sockaddr *> (&address),
+                                  &length) == 0);
+            primaryPort = ntohs(address.sin_port);
+            ::close(socket);
+        }
+        FakeDataLinkServer failoverServer{512, -1};
+        options.setPort(primaryPort);
+        options.setFailoverEndpoints(
+            {std::pair {std::string {"127.0.0.1"}, failoverServer.getPort()}});
+        options.setFailbackProbeInterval(std::chrono::milliseconds {50});
+        options.setName("failBackTest");
+        USR::DataLinkClient client{options, spdlog::default_logger()};
+        auto future = client.start();
+        CHECK(waitFor([&]
+              {
+                  return failoverServer.getIdentifiers().size() == 1;
+              }));
+        // Once the primary is back the probe notices and the writer moves
+        // back to it
+        FakeDataLinkServer primaryServer{512, -1, false, primaryPort};
+        CHECK(waitFor([&]
+              {
+                  return primaryServer.getIdentifiers().size() == 1;
+              }));
+        client.enqueue(std::move(packet));
+        CHECK(waitFor([&]{return primaryServer.getNumberOfWrites() == 1;}));
+        client.stop();
+        future.get();
+        REQUIRE(failoverServer.getNumberOfWrites() == 0);
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::DataLinkEngine", "[dataLinkEngine]")
+{
+    namespace USR = USEEDLinkToRingServer;
+    std::signal(SIGPIPE, SIG_IGN);
+    auto waitFor = [](auto &&condition)
+    {
+        auto deadline = std::chrono::steady_clock::now()
+                      + std::chrono::seconds {10};
+        while (!condition() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds {10});
+        }
+        return condition();
+    };
+    auto getMetrics = [](const std::string &name)
+    {
+        for (const auto &metrics :
+             USR::WriterMetricsSingleton::getInstance().getWriterMetrics())
+        {
+            if (metrics->getName() == name){return metrics;}
+        }
+        return std::shared_ptr<const USR::WriterMetrics> {nullptr};
+    };
+    // The server only takes 256 byte packets, resets the first connection
+    // after a few of the records, and rejects the first record written
+    // after the reconnect
+    constexpr int packetSize{256};
+    constexpr int nPackets{2000};
+    FakeDataLinkServer server{packetSize, 10, true};
+    USR::DataLinkClientOptions options;
+    options.setHost("127.0.0.1");
+    options.setPort(server.getPort());
+    options.setName("engineTest");
+    options.setReconnectDelays(std::chrono::milliseconds {10},
+                               std::chrono::milliseconds {100});
+    USR::DataLinkEngine engine{{options}, spdlog::default_logger()};
+    auto future = engine.start();
+    REQUIRE(waitFor([&]{return server.getIdentifiers().size() == 1;}));
+    // Let the engine read the server's packet size before packing records
+    std::this_thread::sleep_for(std::chrono::milliseconds {100});
+
+    USR::StreamIdentifier identifier;
+    identifier.setNetwork("UU");
+    identifier.setStation("FTU");
+    identifier.setChannel("HHN");
+    identifier.setLocationCode("01");
+    const std::chrono::microseconds startTime{1759952887000000};
+    const std::chrono::microseconds packetInterval{1000000};
+    auto enqueuePackets = [&](const int first, const int last)
+    {
+        for (int i = first; i < last; ++i)
+        {
+            USR::Packet packet;
+            packet.setStreamIdentifier(identifier);
+            packet.setSamplingRate(100);
+            packet.setStartTime(startTime + i*packetInterval);
+            packet.setData(std::vector<int> {1, 2, 3, -4});
+            engine.enqueue(std::move(packet));
+        }
+    };
+    enqueuePackets(0, nPackets/2);
+    REQUIRE(waitFor([&]{return server.wasReset();}));
+    // Whatever the socket took before the reset is lost but records still
+    // in the engine, and those that arrive during the outage, are written
+    // after it reconnects.  N.B. on loopback the socket can take the whole
+    // first half so the second half ensures there is something to write.
+    enqueuePackets(nPackets/2, nPackets);
+    const auto lastStartTime
+        = " " + std::to_string((startTime + (nPackets - 1)*packetInterval)
+                               .count()) + " ";
+    CHECK(waitFor([&]
+          {
+              auto headers = server.getWriteHeaders();
+              return !headers.empty() &&
+                     headers.back().find(lastStartTime) != std::string::npos;
+          }));
+    CHECK(waitFor([&]
+          {
+              auto metrics = getMetrics("engineTest");
+              return metrics && metrics->getServerErrorsCount() == 1;
+          }));
+    engine.stop();
+    future.get();
+
+    REQUIRE(server.wasReset());
+    auto identifiers = server.getIdentifiers();
+    REQUIRE(identifiers.size() >= 2);
+    for (const auto &clientIdentifier : identifiers)
+    {
+        CHECK(clientIdentifier.starts_with("ID engineTest:"));
+        CHECK(clientIdentifier.ends_with(":Linux"));
+    }
+    // Every record is framed as
+    //   WRITE <stream> <start> <end> N <size>
+    // with a record sized to the server's packet size.  The reset neither
+    // duplicates nor reorders records.
+    auto headers = server.getWriteHeaders();
+    REQUIRE(headers.size() > 10);
+    int64_t previousIndex{-1};
+    for (const auto &header : headers)
+    {
+        std::istringstream stream{header};
+        std::string write;
+        std::string streamName;
+        int64_t recordStartTime{0};
+        stream >> write >> streamName >> recordStartTime;
+        auto index = (recordStartTime - startTime.count())
+                    /packetInterval.count();
+        auto recordStart = startTime + index*packetInterval;
+        auto recordEnd = recordStart + std::chrono::microseconds {30000};
+        CHECK(header == "WRITE UU_FTU_01_HHN/MSEED "
+                      + std::to_string(recordStart.count()) + " "
+                      + std::to_string(recordEnd.count()) + " N "
+                      + std::to_string(packetSize));
+        CHECK(index > previousIndex);
+        previousIndex = index;
+    }
+
+    auto metrics = getMetrics("engineTest");
+    REQUIRE(metrics != nullptr);
+    // Each record is counted once when the socket takes it and the
+    // server's ERROR is not counted as a second, failed write
+    REQUIRE(metrics->getPacketsWrittenCount() == nPackets);
+    REQUIRE(metrics->getServerErrorsCount() == 1);
+    REQUIRE(metrics->getFailedPacketsSentCount() == 0);
+    REQUIRE(metrics->getReconnectAttemptsCount() >= 1);
+    REQUIRE(metrics->getHoldoverSize() == 0);
+    REQUIRE(metrics->getHoldoverRecordsDroppedCount() == 0);
 }
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <vector>
 #include <numeric>
 #include <set>
@@ -7,8 +8,11 @@
 #include <string>
 #include <chrono>
 #include <limits>
+#include <thread>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include "uSEEDLinkToRingServer/packet.hpp"
+#include "uSEEDLinkToRingServer/miniSEEDRecordAggregator.hpp"
+#include "uSEEDLinkToRingServer/recordBuffer.hpp"
 #include "uSEEDLinkToRingServer/streamIdentifier.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_template_test_macros.hpp>
@@ -61,8 +65,49 @@ TEST_CASE("USEEDLinkToRingServer::StreamIdentifier", "[streamIdentifier]")
         REQUIRE(identifier.getStringReference() == "UU.FTU.HHN");
         REQUIRE(USEEDLinkToRingServer::toDataLinkIdentifier(identifier) ==
                 "UU_FTU__HHN/MSEED");
-    }   
-
+    }
+    SECTION("Copy, hash, and compare")
+    {
+        USEEDLinkToRingServer::StreamIdentifier
+            identifier{"uu", "ftu ", "HHN", "01"};
+        REQUIRE(identifier.getStringReference() == "UU.FTU.HHN.01");
+        // The constructor builds the same name and hash as the setters
+        USEEDLinkToRingServer::StreamIdentifier fromSetters;
+        fromSetters.setNetwork("UU");
+        fromSetters.setStation("FTU");
+        fromSetters.setChannel("HHN");
+        fromSetters.setLocationCode("01");
+        REQUIRE(fromSetters == identifier);
+        REQUIRE(fromSetters.getHash() == identifier.getHash());
+        REQUIRE_THROWS(USEEDLinkToRingServer::StreamIdentifier
+                       {"UU", "", "HHN", "01"});
+        REQUIRE_THROWS(USEEDLinkToRingServer::StreamIdentifier
+                       {"UU", "ABCDEFGHI", "HHN", "01"});
+        auto copy = identifier;
+        REQUIRE(copy == identifier);
+        REQUIRE(copy.getHash() == identifier.getHash());
+        REQUIRE(std::hash<USEEDLinkToRingServer::StreamIdentifier> {}(copy)
+             == identifier.getHash());
+        copy.setChannel("HHZ");
+        REQUIRE(copy.getStringReference() == "UU.FTU.HHZ.01");
+        REQUIRE_FALSE(copy == identifier);
+        REQUIRE(identifier < copy);
+        REQUIRE(identifier.getStringReference() == "UU.FTU.HHN.01");
+        REQUIRE_THROWS(copy.setStation("ABCDEFGHI"));
+        REQUIRE(copy.getStation() == "FTU");
+        // FDSN channel codes can be longer than the other codes
+        REQUIRE_NOTHROW(copy.setChannel("H_H_ZZZZZZZZ"));
+        REQUIRE(copy.getStringReference() == "UU.FTU.H_H_ZZZZZZZZ.01");
+        REQUIRE(USEEDLinkToRingServer::toDataLinkIdentifier(copy) ==
+                "UU_FTU_01_H_H_ZZZZZZZZ/MSEED");
+        REQUIRE_THROWS(copy.setChannel(std::string(
+            USEEDLinkToRingServer::StreamIdentifier::MaximumChannelLength + 1,
+            'Z')));
+        REQUIRE(copy.getChannel() == "H_H_ZZZZZZZZ");
+        copy.clear();
+        REQUIRE_FALSE(copy.hasNetwork());
+        REQUIRE_THROWS(copy.getStringReference());
+    }
 }
 
 TEST_CASE("USEEDLinkToRingServer::Packet", "[packet]")
@@ -99,6 +144,48 @@ TEST_CASE("USEEDLinkToRingServer::Packet", "[packet]")
         REQUIRE(packet.getStartTime() == startTime);
     }
 
+    SECTION("Enqueue time")
+    {
+        auto enqueueTime = std::chrono::steady_clock::now();
+        packet.setEnqueueTime(enqueueTime);
+        Packet copy{packet};
+        REQUIRE(copy.getEnqueueTime() == enqueueTime);
+        copy.clear();
+        REQUIRE(copy.getEnqueueTime() ==
+                std::chrono::steady_clock::time_point {});
+    }
+
+    SECTION("Pipeline timestamps")
+    {
+        PipelineTimestamps timestamps;
+        timestamps.received = std::chrono::steady_clock::now();
+        timestamps.decoded = timestamps.received + std::chrono::microseconds {5};
+        packet.setPipelineTimestamps(timestamps);
+        Packet copy{packet};
+        REQUIRE(copy.getPipelineTimestampsReference().received ==
+                timestamps.received);
+        REQUIRE(copy.getPipelineTimestampsReference().decoded ==
+                timestamps.decoded);
+        // The records carry the packet's timestamps and when they were packed
+        std::vector<int> data{1, 2, 3, -4};
+        REQUIRE_NOTHROW(packet.setData(data));
+        constexpr USEEDLinkToRingServer::Compression
+            compression{USEEDLinkToRingServer::Compression::None};
+        constexpr bool flushPackets{true};
+        std::vector<DataLinkPacket> dlPackets;
+        REQUIRE_NOTHROW(dlPackets = USEEDLinkToRingServer::toDataLinkPackets(packet, 512, true, compression, flushPackets, logger));
+        for (const auto &dlPacket : dlPackets)
+        {
+            REQUIRE(dlPacket.timestamps.received == timestamps.received);
+            REQUIRE(dlPacket.timestamps.encoded >= timestamps.decoded);
+            REQUIRE(dlPacket.timestamps.written ==
+                    std::chrono::steady_clock::time_point {});
+        }
+        copy.clear();
+        REQUIRE(copy.getPipelineTimestampsReference().received ==
+                std::chrono::steady_clock::time_point {});
+    }
+
     SECTION("integer32")
     {
         std::vector<int> data{1, 2, 3, -4};
@@ -210,4 +297,281 @@ TEST_CASE("USEEDLinkToRingServer::Packet", "[packet]")
         REQUIRE(dlPackets.size() == 2);
         REQUIRE(dlPackets.at(0).data.size() == 4096);
     }
+
+    SECTION("Span and visit")
+    {
+        REQUIRE(packet.getDataSpan<int> ().empty());
+        REQUIRE_THROWS(packet.visit([](const auto) {}));
+        std::vector<float> data{-4, 1, 2, 3};
+        packet.setData(data);
+        auto samples = packet.getDataSpan<float> ();
+        REQUIRE(samples.size() == data.size());
+        REQUIRE(samples.data() == packet.getDataPointer());
+        REQUIRE(std::equal(samples.begin(), samples.end(), data.begin()));
+        REQUIRE_THROWS(packet.getDataSpan<double> ());
+        auto nSamples = packet.visit([](const auto view)
+        {
+            using T = typename decltype(view)::value_type;
+            REQUIRE(std::is_same_v<T, float>);
+            return static_cast<int> (view.size());
+        });
+        REQUIRE(nSamples == 4);
+    }
+
+    SECTION("Sample statistics")
+    {
+        std::vector<int> data(1001);
+        std::iota(data.begin(), data.end(), -500);
+        data.at(17) = std::numeric_limits<int>::max();
+        data.at(333) = std::numeric_limits<int>::min();
+        packet.setData(data);
+        auto statistics = computeSampleStatistics(packet);
+        int64_t integerSum{0};
+        double sumOfSquares{0};
+        for (const auto x : data)
+        {
+            integerSum = integerSum + x;
+            sumOfSquares = sumOfSquares + static_cast<double> (x)*x;
+        }
+        REQUIRE(statistics.count == static_cast<int64_t> (data.size()));
+        REQUIRE(statistics.integerSum == integerSum);
+        REQUIRE(statistics.sum == static_cast<double> (integerSum));
+        REQUIRE_THAT(statistics.sumOfSquares,
+                     Catch::Matchers::WithinRel(sumOfSquares, 1.e-12));
+        REQUIRE(statistics.minimum == std::numeric_limits<int>::min());
+        REQUIRE(statistics.maximum == std::numeric_limits<int>::max());
+
+        std::vector<double> doubleData{3, -1.5, 2, 8, -7, 0.25, 1, 4, 5};
+        packet.setData(doubleData);
+        statistics = computeSampleStatistics(packet);
+        REQUIRE(statistics.count == 9);
+        REQUIRE_THAT(statistics.sum,
+                     Catch::Matchers::WithinAbs(14.75, 1.e-12));
+        REQUIRE(statistics.minimum == -7);
+        REQUIRE(statistics.maximum == 8);
+
+        packet.setData(std::vector<char> {'a', 'b'});
+        REQUIRE_THROWS(computeSampleStatistics(packet));
+    }
+
+    SECTION("Large packet copy")
+    {
+        std::vector<double> data(4096);
+        std::iota(data.begin(), data.end(), -100);
+        REQUIRE_NOTHROW(packet.setData(data));
+        Packet copy;
+        copy.setData(std::vector<int> {1, 2, 3});
+        copy = packet;
+        REQUIRE(copy.getDataType() == Packet::DataType::Double);
+        REQUIRE(copy.getData<double> () == data);
+        REQUIRE(copy.getEndTime() == packet.getEndTime());
+        std::vector<int> small{5, 6, 7};
+        REQUIRE_NOTHROW(copy.setData(static_cast<int> (small.size()),
+                                     small.data()));
+        REQUIRE(copy.getDataType() == Packet::DataType::Integer32);
+        REQUIRE(copy.getData<int> () == small);
+        REQUIRE(packet.getNumberOfSamples() == 4096);
+        copy.clear();
+        REQUIRE(copy.getNumberOfSamples() == 0);
+        REQUIRE(copy.getDataPointer() == nullptr);
+    }
+
+    SECTION("Single pass without flushing")
+    {
+        std::vector<int> data(1024);
+        std::iota(data.begin(), data.end(), 0);
+        REQUIRE_NOTHROW(packet.setData(data));
+        std::vector<DataLinkPacket> dlPackets;
+        constexpr USEEDLinkToRingServer::Compression
+            compression{USEEDLinkToRingServer::Compression::None};
+        constexpr bool flushPackets{false};
+        REQUIRE_NOTHROW(dlPackets = USEEDLinkToRingServer::toDataLinkPackets(packet, 512, true, compression, flushPackets, logger));
+        // 1024 ints will not fit in fewer than 9 records.  The trailing
+        // samples must not be dropped.
+        REQUIRE(dlPackets.size() >= 9);
+        for (const auto &dlPacket : dlPackets)
+        {
+            REQUIRE(dlPacket.data.size() <= 512);
+        }
+        REQUIRE(dlPackets.back().endTime ==
+                std::chrono::duration_cast<std::chrono::microseconds>
+                (packet.getEndTime()));
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::RecordBufferPool", "[recordBuffer]")
+{
+    using namespace USEEDLinkToRingServer;
+    RecordBufferPool pool{512, 2};
+    REQUIRE(pool.getSlabSize() == 512);
+    REQUIRE(pool.getNumberOfSlabs() == 0);
+    const std::string record(400, 'a');
+    {
+    auto buffer1 = pool.create(record.data(), record.size());
+    REQUIRE(buffer1.size() == record.size());
+    REQUIRE(std::string(buffer1.data(), buffer1.size()) == record);
+    REQUIRE(pool.getNumberOfSlabs() == 2);
+    REQUIRE(pool.getNumberOfAvailableSlabs() == 1);
+    auto buffer2 = std::move(buffer1);
+    REQUIRE(buffer1.empty());
+    REQUIRE(buffer2.size() == record.size());
+    REQUIRE(pool.getNumberOfAvailableSlabs() == 1);
+    }
+    // Slab is recycled
+    REQUIRE(pool.getNumberOfAvailableSlabs() == 2);
+    // Too big for a slab
+    const std::string bigRecord(1024, 'b');
+    auto bigBuffer = pool.create(bigRecord.data(), bigRecord.size());
+    REQUIRE(bigBuffer.size() == bigRecord.size());
+    REQUIRE(pool.getNumberOfAvailableSlabs() == 2);
+
+    SECTION("Concurrent")
+    {
+        auto worker = [&pool, &record]()
+        {
+            std::vector<RecordBuffer> buffers;
+            for (int i = 0; i < 10000; ++i)
+            {
+                buffers.push_back(pool.create(record.data(), record.size()));
+                if (buffers.size() == 8){buffers.clear();}
+            }
+        };
+        std::thread thread1(worker);
+        std::thread thread2(worker);
+        thread1.join();
+        thread2.join();
+        REQUIRE(pool.getNumberOfAvailableSlabs() == pool.getNumberOfSlabs());
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::MiniSEEDRecordAggregator", "[aggregator]")
+{
+    using namespace USEEDLinkToRingServer;
+    const double samplingRate{100};
+    const std::chrono::nanoseconds startTime{1759952887000000000};
+    const std::chrono::microseconds maximumLatency{1000000};
+    const std::chrono::microseconds now{1759952888000000};
+
+    StreamIdentifier identifier;
+    REQUIRE_NOTHROW(identifier.setNetwork("UU"));
+    REQUIRE_NOTHROW(identifier.setStation("FTU"));
+    REQUIRE_NOTHROW(identifier.setChannel("HHN"));
+    REQUIRE_NOTHROW(identifier.setLocationCode("01"));
+
+    // Ten contiguous packets of 10 samples
+    std::vector<Packet> packets;
+    for (int i = 0; i < 10; ++i)
+    {
+        Packet packet;
+        packet.setStreamIdentifier(identifier);
+        packet.setSamplingRate(samplingRate);
+        packet.setStartTime(startTime + std::chrono::milliseconds {100*i});
+        std::vector<int> data(10);
+        std::iota(data.begin(), data.end(), 10*i);
+        packet.setData(std::move(data));
+        packets.push_back(std::move(packet));
+    }
+
+    MiniSEEDRecordAggregator aggregator{512, true,
+                                        Compression::None, maximumLatency};
+    REQUIRE(aggregator.getMaximumLatency() == maximumLatency);
+
+    SECTION("Hold then flush")
+    {
+        for (const auto &packet : packets)
+        {
+            auto records = aggregator.add(packet, now);
+            REQUIRE(records.empty());
+        }
+        REQUIRE(aggregator.getNumberOfStreams() == 1);
+        REQUIRE(aggregator.getNumberOfBufferedSamples() == 100);
+        REQUIRE(aggregator.flushExpired(now).empty());
+        auto records = aggregator.flushExpired(now + maximumLatency);
+        REQUIRE(records.size() == 1);
+        REQUIRE(*records.at(0).streamIdentifier == "UU_FTU_01_HHN/MSEED");
+        REQUIRE(records.at(0).startTime ==
+                std::chrono::duration_cast<std::chrono::microseconds>
+                (startTime));
+        REQUIRE(aggregator.getNumberOfBufferedSamples() == 0);
+        REQUIRE(aggregator.flush().empty());
+    }
+
+    SECTION("Only expired streams are flushed")
+    {
+        StreamIdentifier otherIdentifier{identifier};
+        otherIdentifier.setChannel("HHZ");
+        auto otherPacket = packets.at(0);
+        otherPacket.setStreamIdentifier(otherIdentifier);
+        REQUIRE(aggregator.add(packets.at(0), now).empty());
+        REQUIRE(aggregator.add(otherPacket, now + maximumLatency/2).empty());
+        REQUIRE(aggregator.add(packets.at(1), now + maximumLatency/2).empty());
+        REQUIRE(aggregator.getNumberOfStreams() == 2);
+        // The HHN stream's oldest sample expires first
+        auto records = aggregator.flushExpired(now + maximumLatency);
+        REQUIRE(records.size() == 1);
+        REQUIRE(*records.at(0).streamIdentifier == "UU_FTU_01_HHN/MSEED");
+        REQUIRE(aggregator.getNumberOfBufferedSamples() == 10);
+        records = aggregator.flushExpired(now + 3*maximumLatency/2);
+        REQUIRE(records.size() == 1);
+        REQUIRE(*records.at(0).streamIdentifier == "UU_FTU_01_HHZ/MSEED");
+        REQUIRE(aggregator.flushExpired(now + 2*maximumLatency).empty());
+        // Streams that go quiet are eventually forgotten
+        REQUIRE(aggregator.getNumberOfStreams() == 2);
+        REQUIRE(aggregator.flushExpired(now + std::chrono::hours {1}).empty());
+        REQUIRE(aggregator.getNumberOfStreams() == 0);
+        // and picked up again when they resume
+        REQUIRE(aggregator.add(packets.at(2), now).empty());
+        REQUIRE(aggregator.getNumberOfStreams() == 1);
+        REQUIRE(aggregator.flush().size() == 1);
+    }
+
+    SECTION("Gap forces flush")
+    {
+        REQUIRE(aggregator.add(packets.at(0), now).empty());
+        auto records = aggregator.add(packets.at(2), now);
+        REQUIRE(records.size() == 1);
+        REQUIRE(aggregator.getNumberOfBufferedSamples() == 10);
+        records = aggregator.flush();
+        REQUIRE(records.size() == 1);
+        REQUIRE(records.at(0).startTime ==
+                std::chrono::duration_cast<std::chrono::microseconds>
+                (packets.at(2).getStartTime()));
+    }
+
+    SECTION("Record length by stream")
+    {
+        // 1000 samples need several 512 byte records but fit in one 4096
+        // byte record
+        std::vector<Packet> longPackets;
+        for (int i = 0; i < 10; ++i)
+        {
+            Packet packet;
+            packet.setStreamIdentifier(identifier);
+            packet.setSamplingRate(samplingRate);
+            packet.setStartTime(startTime + std::chrono::seconds {i});
+            std::vector<int> data(100);
+            std::iota(data.begin(), data.end(), 100*i);
+            packet.setData(std::move(data));
+            longPackets.push_back(std::move(packet));
+        }
+        MiniSEEDRecordAggregator
+            largeRecordAggregator{[](const std::string &name)
+                                  {
+                                      return name == "UU.FTU.HHN.01" ?
+                                             4096 : 512;
+                                  },
+                                  true, Compression::None, maximumLatency};
+        size_t nSmallRecords{0};
+        for (const auto &packet : longPackets)
+        {
+            nSmallRecords = nSmallRecords + aggregator.add(packet, now).size();
+            REQUIRE(largeRecordAggregator.add(packet, now).empty());
+        }
+        REQUIRE(nSmallRecords > 1);
+        auto records = largeRecordAggregator.flush();
+        REQUIRE(records.size() == 1);
+        REQUIRE(records.at(0).data.size() > 512);
+        REQUIRE(records.at(0).data.size() <= 4096);
+        REQUIRE(largeRecordAggregator.getNumberOfBufferedSamples() == 0);
+    }
 }
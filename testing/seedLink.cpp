@@ -1,6 +1,11 @@
+#include <chrono>
+#include <cmath>
 #include <string>
+#include <thread>
 #include "uSEEDLinkToRingServer/seedLinkClientOptions.hpp"
 #include "uSEEDLinkToRingServer/streamSelector.hpp"
+#include "streamContinuity.hpp"
+#include "streamMetricSlots.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
@@ -137,3 +142,232 @@ TEST_CASE("USEEDLinkToRingServer::StreamSelector", "[clientOptions]")
     }
 }
 
+TEST_CASE("USEEDLinkToRingServer::StreamMetricSlots", "[streamMetrics]")
+{
+    ::StreamMetricSlots slots;
+    REQUIRE(slots.size() == 0);
+    SECTION("Add and publish")
+    {
+        auto nStreams = ::StreamMetricSlots::ChunkSize + 3;
+        for (int i = 0; i < nStreams; ++i)
+        {
+            REQUIRE(slots.add("uu_stream_" + std::to_string(i)) == i);
+        }
+        REQUIRE(slots.size() == nStreams);
+        REQUIRE(slots[nStreams - 1].labels.load()->metricsKey ==
+                "uu_stream_" + std::to_string(nStreams - 1));
+        auto index = slots.add("uu_ftu_hhz_01",
+                               {{"stream", "uu_ftu_hhz_01"},
+                                {"source", "test"}});
+        auto labels = slots[index].labels.load();
+        REQUIRE(labels->attributes.at("stream") == "uu_ftu_hhz_01");
+        REQUIRE(labels->attributes.at("source") == "test");
+        nStreams = nStreams + 1;
+        slots[5].totalPacketsReceived.fetch_add(7);
+        slots.getBackGauges(5).averageCounts.store(3.5);
+        // Not visible until published
+        REQUIRE(slots.getPublishedGauges(5).averageCounts.load() == 0);
+        slots.publishGauges();
+        REQUIRE(slots.getPublishedGauges(5).averageCounts.load() == 3.5);
+        slots.getBackGauges(5).averageCounts.store(4.5);
+        REQUIRE(slots.getPublishedGauges(5).averageCounts.load() == 3.5);
+        slots.publishGauges();
+        REQUIRE(slots.getPublishedGauges(5).averageCounts.load() == 4.5);
+        int64_t total{0};
+        int count{0};
+        slots.forEach([&](const int, const ::StreamMetricSlot &slot,
+                          const ::StreamLabels &)
+                      {
+                          total = total + slot.totalPacketsReceived.load();
+                          count = count + 1;
+                      });
+        REQUIRE(total == 7);
+        REQUIRE(count == nStreams);
+    }
+    SECTION("Remove and reuse")
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            REQUIRE(slots.add("uu_stream_" + std::to_string(i)) == i);
+        }
+        slots[2].totalPacketsReceived.fetch_add(5);
+        slots.getBackGauges(2).averageLatency.store(1.5);
+        slots.publishGauges();
+        slots.remove(2);
+        slots.remove(2); // Removing twice is harmless
+        REQUIRE(slots.size() == 3);
+        int count{0};
+        slots.forEach([&](const int index, const ::StreamMetricSlot &,
+                          const ::StreamLabels &labels)
+                      {
+                          REQUIRE(index != 2);
+                          REQUIRE(labels.metricsKey ==
+                                  "uu_stream_" + std::to_string(index));
+                          count = count + 1;
+                      });
+        REQUIRE(count == 3);
+        // The freed slot is reused and starts from zero
+        REQUIRE(slots.add("uu_new_stream") == 2);
+        REQUIRE(slots.size() == 4);
+        REQUIRE(slots[2].labels.load()->metricsKey == "uu_new_stream");
+        REQUIRE(slots[2].totalPacketsReceived.load() == 0);
+        REQUIRE(slots.getPublishedGauges(2).averageLatency.load() == 0);
+        REQUIRE(slots.add("uu_stream_4") == 4);
+    }
+    SECTION("Latency histogram")
+    {
+        using namespace std::chrono_literals;
+        REQUIRE(::LatencyHistogram::toBucket(-5s) == 0);
+        REQUIRE(::LatencyHistogram::toBucket(500us) == 0);
+        REQUIRE(::LatencyHistogram::toBucket(1ms) == 1);
+        REQUIRE(::LatencyHistogram::toBucket(1999us) == 1);
+        REQUIRE(::LatencyHistogram::toBucket(2ms) == 2);
+        REQUIRE(::LatencyHistogram::toBucket(30s) == 15);
+        REQUIRE(::LatencyHistogram::toBucket(24h) ==
+                ::LatencyHistogram::NumberOfBuckets - 1);
+        for (int i = 0; i < ::LatencyHistogram::NumberOfBuckets - 1; ++i)
+        {
+            // Every latency in a bucket is below its upper bound
+            std::chrono::microseconds upperBound
+            {
+                static_cast<int64_t>
+                (std::round(::LatencyHistogram::getUpperBound(i)*1.e6))
+            };
+            REQUIRE(::LatencyHistogram::toBucket(upperBound - 1ms) <= i);
+            REQUIRE(::LatencyHistogram::toBucket(upperBound) == i + 1);
+        }
+        REQUIRE(std::isinf(::LatencyHistogram::getUpperBound(
+                   ::LatencyHistogram::NumberOfBuckets - 1)));
+        auto index = slots.add("uu_ftu_hhz_01");
+        slots.recordLatency(index, 1500ms);
+        slots.recordLatency(index, 1800ms);
+        slots.recordLatency(index, 30s);
+        REQUIRE(slots[index].latencyBuckets[11].load() == 2);
+        REQUIRE(slots[index].latencyBuckets[15].load() == 1);
+        REQUIRE(slots[index].latencySum.load() == 33300000);
+        slots.remove(index);
+        REQUIRE(slots.add("uu_ftu_hhz_02") == index);
+        REQUIRE(slots[index].latencyBuckets[11].load() == 0);
+        REQUIRE(slots[index].latencySum.load() == 0);
+    }
+    SECTION("Continuity")
+    {
+        using namespace std::chrono_literals;
+        auto index = slots.add("uu_ftu_hhz_01");
+        slots.recordGap(index, 2s);
+        slots.recordGap(index, 500ms);
+        slots.recordOverlap(index, 10ms);
+        slots[index].timingDrift.store(1.5);
+        REQUIRE(slots[index].gaps.load() == 2);
+        REQUIRE(slots[index].gapDuration.load() == 2500000);
+        REQUIRE(slots[index].overlaps.load() == 1);
+        REQUIRE(slots[index].overlapDuration.load() == 10000);
+        slots.remove(index);
+        REQUIRE(slots.add("uu_ftu_hhz_02") == index);
+        REQUIRE(slots[index].gaps.load() == 0);
+        REQUIRE(slots[index].gapDuration.load() == 0);
+        REQUIRE(slots[index].overlaps.load() == 0);
+        REQUIRE(slots[index].overlapDuration.load() == 0);
+        REQUIRE(slots[index].timingDrift.load() == 0);
+    }
+    SECTION("Concurrent reader")
+    {
+        std::atomic<bool> done{false};
+        int nEmptyKeys{0};
+        std::thread reader([&]()
+        {
+            while (!done.load())
+            {
+                slots.forEach([&](const int, const ::StreamMetricSlot &,
+                                  const ::StreamLabels &labels)
+                              {
+                                  if (labels.metricsKey.empty())
+                                  {
+                                      nEmptyKeys = nEmptyKeys + 1;
+                                  }
+                              });
+            }
+        });
+        for (int i = 0; i < 2*::StreamMetricSlots::ChunkSize; ++i)
+        {
+            auto index = slots.add("stream_" + std::to_string(i));
+            slots[index].packetsReceived.fetch_add(1);
+            // Churn streams to exercise reuse
+            if (i%3 == 0){slots.remove(index);}
+        }
+        done = true;
+        reader.join();
+        REQUIRE(nEmptyKeys == 0);
+        REQUIRE(slots.size() == 2*::StreamMetricSlots::ChunkSize
+                              - (2*::StreamMetricSlots::ChunkSize + 2)/3);
+    }
+}
+
+TEST_CASE("USEEDLinkToRingServer::StreamContinuity", "[streamMetrics]")
+{
+    using namespace std::chrono_literals;
+    using Continuity = ::StreamContinuity::Continuity;
+    constexpr double samplingRate{100};
+    constexpr int nSamples{400}; // 4 s packets
+    const std::chrono::nanoseconds t0{1700000000s};
+    ::StreamContinuity continuity;
+    REQUIRE_THROWS(::StreamContinuity {-1});
+    REQUIRE(continuity.update(t0, 0, samplingRate).continuity ==
+            Continuity::Ignored);
+    REQUIRE(continuity.update(t0, nSamples, 0).continuity ==
+            Continuity::Ignored);
+    REQUIRE(continuity.update(t0, nSamples, samplingRate).continuity ==
+            Continuity::Started);
+    SECTION("Contiguous within tolerance")
+    {
+        // Half a sample period either way is still contiguous
+        auto result = continuity.update(t0 + 4s + 4ms, nSamples, samplingRate);
+        REQUIRE(result.continuity == Continuity::Contiguous);
+        result = continuity.update(t0 + 8s, nSamples, samplingRate);
+        REQUIRE(result.continuity == Continuity::Contiguous);
+        REQUIRE(result.duration == 0ns);
+    }
+    SECTION("Gap")
+    {
+        auto result = continuity.update(t0 + 6s, nSamples, samplingRate);
+        REQUIRE(result.continuity == Continuity::Gap);
+        REQUIRE(result.duration == 2s);
+        // The gap starts a new run
+        result = continuity.update(t0 + 10s, nSamples, samplingRate);
+        REQUIRE(result.continuity == Continuity::Contiguous);
+    }
+    SECTION("Overlap")
+    {
+        auto result = continuity.update(t0 + 3s, nSamples, samplingRate);
+        REQUIRE(result.continuity == Continuity::Overlap);
+        REQUIRE(result.duration == 1s);
+        REQUIRE(continuity.update(t0 + 7s, nSamples, samplingRate).continuity
+                == Continuity::Contiguous);
+        // Retransmitted data is an overlap but does not rewind the stream
+        result = continuity.update(t0, nSamples, samplingRate);
+        REQUIRE(result.continuity == Continuity::Overlap);
+        REQUIRE(result.duration == 4s);
+        REQUIRE(continuity.update(t0 + 11s, nSamples, samplingRate)
+                .continuity == Continuity::Contiguous);
+    }
+    SECTION("Sampling rate change")
+    {
+        REQUIRE(continuity.update(t0 + 4s, 2*nSamples, 2*samplingRate)
+                .continuity == Continuity::Started);
+        REQUIRE(continuity.update(t0 + 8s, 2*nSamples, 2*samplingRate)
+                .continuity == Continuity::Contiguous);
+    }
+    SECTION("Timing drift")
+    {
+        // The clock runs 100 ppm slow: each 4 s packet arrives 400 us late
+        // which is within tolerance so no gap is reported
+        auto startTime = t0;
+        for (int i = 1; i <= 100; ++i)
+        {
+            startTime = startTime + 4s + 400us;
+            REQUIRE(continuity.update(startTime, nSamples, samplingRate)
+                    .continuity == Continuity::Contiguous);
+        }
+        REQUIRE(std::abs(continuity.getTimingDrift() - 100) < 1.e-6);
+    }
+}